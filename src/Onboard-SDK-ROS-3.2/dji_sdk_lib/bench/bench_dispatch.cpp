@@ -0,0 +1,80 @@
+/** @file bench_dispatch.cpp
+ *  @version 3.1.9
+ *  @date November 10, 2016
+ *
+ *  @brief
+ *  Receive cost per frame through the dispatch table, see
+ *  CoreAPI::setFrameCallback(). All frames carry the same 16 byte payload, so
+ *  the rows differ only in where the handler sits in the table. A
+ *  registered handler costs the same at the first, middle and last entry
+ *
+ *  @copyright 2016 DJI. All rights reserved.
+ *
+ */
+
+#include "bench_link.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static int handled;
+
+static void onFrame(CoreAPI *api __UNUSED, const FrameView *frame, UserData userData __UNUSED)
+{
+  handled += frame->length;
+}
+
+//! @note frames from a flight controller CoreAPI, replayed into host
+static double receive(CoreAPI *host, uint8_t cmdSet, uint8_t cmdId, int frames)
+{
+  CaptureDriver fcDriver;
+  CoreAPI fc(&fcDriver);
+  uint8_t data[16];
+  memset(data, 0, sizeof(data));
+  for (int i = 0; i < frames; ++i)
+    fc.send(0, false, (CMD_SET)cmdSet, cmdId, data, sizeof(data));
+
+  std::vector<uint8_t> stream;
+  stream.swap(fcDriver.bytes);
+  double best = 1e9;
+  for (int repeat = 0; repeat < 3; ++repeat)
+  {
+    time_us start = monotonicTimeUs();
+    for (size_t i = 0; i < stream.size(); ++i)
+      host->byteHandler(stream[i]);
+    double ns = (monotonicTimeUs() - start) * 1000.0 / frames;
+    if (ns < best)
+      best = ns;
+  }
+  return best;
+}
+
+int main(int argc, char **argv)
+{
+  int frames = argc > 1 ? atoi(argv[1]) : 100000;
+  CaptureDriver hostDriver;
+  CoreAPI host(&hostDriver);
+
+  const struct
+  {
+    const char *name;
+    uint8_t cmdSet;
+    uint8_t cmdId;
+  } entry[] = {
+    { "registered [0][0]", 0, 0 },
+    { "registered [4][32]", 4, 32 },
+    { "registered [7][63]", DISPATCH_SET_NUM - 1, DISPATCH_CODE_NUM - 1 },
+    { "empty entry [5][5]", 5, 5 },
+    { "outside the table", DISPATCH_SET_NUM, 0 },
+  };
+  for (int i = 0; i < 3; ++i)
+    host.setFrameCallback(entry[i].cmdSet, entry[i].cmdId, onFrame);
+
+  printf("%d frames of 16 bytes, %dx%d table\n", frames, DISPATCH_SET_NUM, DISPATCH_CODE_NUM);
+  for (size_t i = 0; i < sizeof(entry) / sizeof(entry[0]); ++i)
+    printf("%-20s %6.1f ns/frame\n", entry[i].name,
+           receive(&host, entry[i].cmdSet, entry[i].cmdId, frames));
+  printf("%-20s %6.1f ns/frame\n", "default lost control",
+         receive(&host, SET_BROADCAST, CODE_LOSTCTRL, frames));
+  return handled == 3 * 3 * frames * 16 ? 0 : 1;
+}
@@ -0,0 +1,164 @@
+/** @file bench_gimbal_tracker.cpp
+ *  @version 3.1.9
+ *  @date November 10, 2016
+ *
+ *  @brief
+ *  GimbalTracker closing the loop through a simulated N3: gimbal data
+ *  broadcast at 50 Hz, a gimbal following speed commands with a 40 ms lag,
+ *  a target moving up to 24 deg/s and detections at 33 Hz. Detections reach
+ *  the tracker 0, 60 or 120 ms after capture and are stamped either with
+ *  the capture time or with the arrival time
+ *
+ *  @copyright 2016 DJI. All rights reserved.
+ *
+ */
+
+#include "bench_link.h"
+#include "DJI_Camera.h"
+#include "DJI_GimbalTracker.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+
+static const int TICKS = 1000;
+
+//! Gimbal on the simulated flight controller, rates in deg/s.
+static struct Gimbal
+{
+  pthread_mutex_t lock;
+  double yaw, pitch;
+  double commandYaw, commandPitch;
+  double rateYaw, ratePitch;
+  time_us last;
+
+  void step(time_us now)
+  {
+    double dt = (now - last) / 1e6;
+    double a = std::min(1.0, dt / 0.04);
+    last = now;
+    rateYaw += (commandYaw - rateYaw) * a;
+    ratePitch += (commandPitch - ratePitch) * a;
+    yaw += rateYaw * dt;
+    pitch += ratePitch * dt;
+  }
+} gimbal = { PTHREAD_MUTEX_INITIALIZER, 0, 0, 0, 0, 0, 0, 0 };
+
+static time_us origin;
+
+static double targetYaw(time_us t) { return 40 * sin(0.6 * (t - origin) / 1e6); }
+static double targetPitch(time_us t) { return -20 + 10 * sin(0.9 * (t - origin) / 1e6); }
+
+static void onCommand(CoreAPI *api __UNUSED, Header *header __UNUSED, UserData userData __UNUSED) {}
+
+static void onSpeed(CoreAPI *api __UNUSED, const FrameView *frame, UserData userData __UNUSED)
+{
+  const GimbalSpeedData *speed = frame->as<GimbalSpeedData>();
+  if (!speed)
+    return;
+  pthread_mutex_lock(&gimbal.lock);
+  gimbal.step(monotonicTimeUs());
+  gimbal.commandYaw = speed->yaw / 10.0;
+  gimbal.commandPitch = speed->pitch / 10.0;
+  pthread_mutex_unlock(&gimbal.lock);
+}
+
+static void broadcastGimbal(CoreAPI *fc, time_us now)
+{
+  GimbalData data;
+  memset(&data, 0, sizeof(data));
+  pthread_mutex_lock(&gimbal.lock);
+  gimbal.step(now);
+  data.yaw = gimbal.yaw;
+  data.pitch = gimbal.pitch;
+  pthread_mutex_unlock(&gimbal.lock);
+  uint8_t buf[2 + sizeof(GimbalData)];
+  uint16_t flag = 0x0400;
+  memcpy(buf, &flag, sizeof(flag));
+  memcpy(buf + 2, &data, sizeof(data));
+  fc->send(0, false, SET_BROADCAST, CODE_BROADCAST, buf, sizeof(buf));
+}
+
+struct Detection
+{
+  time_us captured;
+  time_us due;
+  double yaw, pitch;
+};
+
+static void track(int delayMs, bool captureTime)
+{
+  LinkPair link(onCommand, 0);
+  VersionData version;
+  memset(&version, 0, sizeof(version));
+  version.fwVersion = MAKE_VERSION(3, 2, 15, 62);
+  strcpy(version.hwVersion, "N3");
+  link.host.setVersionData(version);
+  link.fc.setFrameCallback(SET_CONTROL, Camera::CODE_GIMBAL_SPEED, onSpeed);
+
+  origin = monotonicTimeUs();
+  pthread_mutex_lock(&gimbal.lock);
+  gimbal.yaw = gimbal.commandYaw = gimbal.commandPitch = gimbal.rateYaw = gimbal.ratePitch = 0;
+  gimbal.pitch = -10;
+  gimbal.last = origin;
+  pthread_mutex_unlock(&gimbal.lock);
+
+  Camera camera(&link.host);
+  GimbalTracker tracker(&camera);
+  tracker.start(50);
+
+  std::deque<Detection> pending;
+  double sum = 0, max = 0;
+  int count = 0;
+  for (int i = 0; i < TICKS; ++i)
+  {
+    time_us now = monotonicTimeUs();
+    broadcastGimbal(&link.fc, now);
+    pthread_mutex_lock(&gimbal.lock);
+    double yawError = targetYaw(now) - gimbal.yaw;
+    double pitchError = targetPitch(now) - gimbal.pitch;
+    pthread_mutex_unlock(&gimbal.lock);
+    //! @note 2 frames of 3 ticks, 33 Hz
+    if (i % 3 != 2)
+    {
+      Detection d = { now, now + delayMs * 1000, yawError, pitchError };
+      pending.push_back(d);
+    }
+    while (!pending.empty() && pending.front().due <= now)
+    {
+      tracker.addOffset(pending.front().yaw, pending.front().pitch,
+                        captureTime ? pending.front().captured : now);
+      pending.pop_front();
+    }
+    //! @note 2 s to acquire the target
+    if (i > 100)
+    {
+      double error = hypot(yawError, pitchError);
+      sum += error;
+      max = std::max(max, error);
+      count++;
+    }
+    sleepUntilUs(origin + (i + 1) * 20000);
+  }
+  tracker.stop();
+
+  TrackingStats stats = tracker.getStats();
+  printf("%4d ms  %-8s  error mean %5.2f max %5.2f deg  latency mean %6.0f max %6lld us  "
+         "%llu detections %llu commands\n",
+         delayMs, captureTime ? "capture" : "arrival", sum / count, max, stats.meanLatencyUs,
+         (long long)stats.maxLatencyUs, (unsigned long long)stats.detections,
+         (unsigned long long)stats.commands);
+}
+
+int main()
+{
+  printf("detection delay, stamp, true tracking error over %d s\n", TICKS / 50);
+  const int delay[] = { 0, 60, 120 };
+  for (int i = 0; i < 3; ++i)
+  {
+    track(delay[i], true);
+    track(delay[i], false);
+  }
+  return 0;
+}
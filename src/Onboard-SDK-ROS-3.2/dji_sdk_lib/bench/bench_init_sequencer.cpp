@@ -0,0 +1,158 @@
+/** @file bench_init_sequencer.cpp
+ *  @version 3.1.9
+ *  @date November 10, 2016
+ *
+ *  @brief
+ *  Start-up time of the four blocking calls in a row against InitSequencer,
+ *  cold, warm, after the flight controller changed, and warm again. The
+ *  simulated flight controller answers the version query and the frequency
+ *  setup in 10 ms, activation in 150 ms and control in 100 ms
+ *
+ *  @copyright 2016 DJI. All rights reserved.
+ *
+ */
+
+#include "bench_link.h"
+#include "DJI_InitSequencer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+static const char *CACHE_FILE = "/tmp/bench_init_sequencer.cache";
+
+//! @note the serial number the simulated flight controller reports
+static const char *serial = "SERIAL01";
+
+struct Pending
+{
+  time_us due;
+  req_id_t request;
+  std::vector<uint8_t> ack;
+};
+
+static pthread_mutex_t pendingLock = PTHREAD_MUTEX_INITIALIZER;
+static std::vector<Pending> pending;
+static CoreAPI *fcApi;
+static volatile bool running = true;
+
+static void later(Header *header, int ms, const uint8_t *ack, int len)
+{
+  Pending p;
+  p.due = monotonicTimeUs() + ms * 1000;
+  p.request = requestOf(header);
+  p.ack.assign(ack, ack + len);
+  pthread_mutex_lock(&pendingLock);
+  pending.push_back(p);
+  pthread_mutex_unlock(&pendingLock);
+}
+
+//! @note sends the ACKs queued by onCommand() once they are due
+static void *respond(void *arg __UNUSED)
+{
+  while (running)
+  {
+    time_us now = monotonicTimeUs();
+    std::vector<Pending> due;
+    pthread_mutex_lock(&pendingLock);
+    for (size_t i = 0; i < pending.size();)
+      if (pending[i].due <= now)
+      {
+        due.push_back(pending[i]);
+        pending.erase(pending.begin() + i);
+      }
+      else
+        ++i;
+    pthread_mutex_unlock(&pendingLock);
+    for (size_t i = 0; i < due.size(); ++i)
+      fcApi->ack(due[i].request, &due[i].ack[0], due[i].ack.size());
+    usleep(500);
+  }
+  return NULL;
+}
+
+static void onCommand(CoreAPI *api __UNUSED, Header *header, UserData userData __UNUSED)
+{
+  if (header->isAck)
+    return;
+  uint8_t *payload = payloadOf(header);
+  uint8_t ok[2] = { 0, 0 };
+  if (payload[0] == SET_ACTIVATION && payload[1] == CODE_GETVERSION)
+  {
+    uint8_t ack[80];
+    memset(ack, 0, sizeof(ack));
+    int len = 2;
+    strcpy((char *)ack + len, serial);
+    len += strlen(serial) + 1;
+    strcpy((char *)ack + len, "SDK-v1.0 BETA N3-03.02.15.62");
+    len += 32;
+    later(header, 10, ack, len);
+  }
+  else if (payload[0] == SET_ACTIVATION && payload[1] == CODE_ACTIVATE)
+  {
+    uint32_t version;
+    memcpy(&version, payload + 2 + 8, sizeof(version));
+    uint8_t ack[2] = { (uint8_t)(version == MAKE_VERSION(3, 2, 15, 62) ? 0 : ACK_ACTIVE_VERSION_ERROR),
+                       0 };
+    later(header, 150, ack, sizeof(ack));
+  }
+  else if (payload[0] == SET_ACTIVATION && payload[1] == CODE_FREQUENCY)
+    later(header, 10, ok, sizeof(ok));
+  else if (payload[0] == SET_CONTROL && payload[1] == CODE_SETCONTROL)
+  {
+    uint8_t ack[2] = { ACK_SETCONTROL_OBTAIN_SUCCESS, 0 };
+    later(header, 100, ack, sizeof(ack));
+  }
+}
+
+static void show(const char *name, InitSequencer *sequencer)
+{
+  static const char *phase[INIT_PHASE_NUM] = { "version", "activate", "frequency", "control" };
+  InitReport report = sequencer->getReport();
+  printf("%-10s %6.0f ms  cache %-5s", name, report.totalUs / 1000.0,
+         report.cacheHit ? (report.cacheValid ? "hit" : "stale") : "miss");
+  for (int i = 0; i < INIT_PHASE_NUM; ++i)
+    printf("  %s %3.0f-%3.0f", phase[i], report.phase[i].startUs / 1000.0,
+           report.phase[i].endUs / 1000.0);
+  printf("%s\n", report.ok ? "" : "  FAILED");
+}
+
+int main()
+{
+  LinkPair link(onCommand, 1000);
+  fcApi = &link.fc;
+  pthread_t responder;
+  pthread_create(&responder, NULL, respond, NULL);
+
+  ActivateData user;
+  memset(&user, 0, sizeof(user));
+  user.ID = 1234;
+
+  time_us start = monotonicTimeUs();
+  link.host.getDroneVersion(1);
+  ActivateData data = user;
+  unsigned short activation = link.host.activate(&data, 1);
+  link.host.setBroadcastFreqDefaults(1);
+  link.host.setControl(true, 1);
+  printf("%-10s %6.0f ms  activation ack %d\n", "blocking", (monotonicTimeUs() - start) / 1000.0,
+         activation);
+
+  unlink(CACHE_FILE);
+  InitSequencer sequencer(&link.host);
+  sequencer.setActivateData(user);
+  sequencer.setCacheFile(CACHE_FILE);
+  bool ok = sequencer.run(5000);
+  show("cold", &sequencer);
+  ok = sequencer.run(5000) && ok;
+  show("warm", &sequencer);
+  serial = "SERIAL02";
+  ok = sequencer.run(5000) && ok;
+  show("new FC", &sequencer);
+  ok = sequencer.run(5000) && ok;
+  show("warm", &sequencer);
+  unlink(CACHE_FILE);
+
+  running = false;
+  pthread_join(responder, NULL);
+  return ok && activation == 0 ? 0 : 1;
+}
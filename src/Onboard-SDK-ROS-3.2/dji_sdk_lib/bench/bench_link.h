@@ -0,0 +1,344 @@
+/** @file bench_link.h
+ *  @version 3.1.9
+ *  @date November 10, 2016
+ *
+ *  @brief
+ *  Drivers shared by the link benchmarks: a sink writing to /dev/null, a
+ *  capture driver replayed by hand, and a pair of CoreAPI connected through a
+ *  delayed byte link, see LinkPair
+ *
+ *  @copyright 2016 DJI. All rights reserved.
+ *
+ */
+
+#ifndef BENCH_LINK_H
+#define BENCH_LINK_H
+
+#include "DJI_API.h"
+#include "DJI_Thread.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <deque>
+#include <utility>
+#include <vector>
+
+using namespace DJI;
+using namespace DJI::onboardSDK;
+
+//! Every send() is one write to /dev/null. Records how long lockMemory is held.
+class NullDriver : public HardDriver
+{
+public:
+  NullDriver() : writes(0), bytes(0), heldUs(0), lockedAt(0)
+  {
+    fd = open("/dev/null", O_WRONLY);
+    for (int i = 0; i < 3; ++i)
+      pthread_mutex_init(&lock[i], NULL);
+    pthread_cond_init(&cond, NULL);
+  }
+  ~NullDriver() { close(fd); }
+
+  void init() {}
+  time_ms getTimeStamp() { return monotonicTimeUs() / 1000; }
+  size_t send(const uint8_t *buf, size_t len)
+  {
+    __atomic_fetch_add(&writes, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&bytes, len, __ATOMIC_RELAXED);
+    return write(fd, buf, len);
+  }
+  size_t readall(uint8_t *, size_t) { return 0; }
+  //! @note the STATUS log of every ACK would dominate the timings
+  void displayLog(const char *) {}
+
+  void lockMemory()
+  {
+    pthread_mutex_lock(&lock[0]);
+    lockedAt = monotonicTimeUs();
+  }
+  void freeMemory()
+  {
+    heldUs += monotonicTimeUs() - lockedAt;
+    pthread_mutex_unlock(&lock[0]);
+  }
+  void lockMSG() { pthread_mutex_lock(&lock[1]); }
+  void freeMSG() { pthread_mutex_unlock(&lock[1]); }
+  void lockACK() { pthread_mutex_lock(&lock[2]); }
+  void freeACK() { pthread_mutex_unlock(&lock[2]); }
+  void notify() { pthread_cond_signal(&cond); }
+  void wait(int timeout)
+  {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += timeout;
+    pthread_cond_timedwait(&cond, &lock[2], &ts);
+  }
+
+  uint64_t writes;
+  uint64_t bytes;
+  //! @note guarded by lockMemory
+  uint64_t heldUs;
+
+private:
+  int fd;
+  time_us lockedAt;
+  pthread_mutex_t lock[3];
+  pthread_cond_t cond;
+};
+
+//! Keeps every byte written until deliver(), with real mutexes as a
+//! multi-threaded driver has.
+class CaptureDriver : public HardDriver
+{
+public:
+  CaptureDriver()
+  {
+    for (int i = 0; i < 3; ++i)
+      pthread_mutex_init(&lock[i], NULL);
+    pthread_cond_init(&cond, NULL);
+  }
+
+  void init() {}
+  time_ms getTimeStamp() { return monotonicTimeUs() / 1000; }
+  size_t send(const uint8_t *buf, size_t len)
+  {
+    bytes.insert(bytes.end(), buf, buf + len);
+    return len;
+  }
+  size_t readall(uint8_t *, size_t) { return 0; }
+  void displayLog(const char *) {}
+
+  void lockMemory() { pthread_mutex_lock(&lock[0]); }
+  void freeMemory() { pthread_mutex_unlock(&lock[0]); }
+  void lockMSG() { pthread_mutex_lock(&lock[1]); }
+  void freeMSG() { pthread_mutex_unlock(&lock[1]); }
+  void lockACK() { pthread_mutex_lock(&lock[2]); }
+  void freeACK() { pthread_mutex_unlock(&lock[2]); }
+  void notify() { pthread_cond_signal(&cond); }
+  void wait(int) {}
+
+  //! @note hands what was written to api and forgets it
+  void deliver(CoreAPI *api)
+  {
+    std::vector<uint8_t> out;
+    out.swap(bytes);
+    for (size_t i = 0; i < out.size(); ++i)
+      api->byteHandler(out[i]);
+  }
+
+  std::vector<uint8_t> bytes;
+
+private:
+  pthread_mutex_t lock[3];
+  pthread_cond_t cond;
+};
+
+//! One direction of a link: bytes reach dst->byteHandler() latencyUs after send().
+class Wire
+{
+public:
+  Wire() : dst(NULL), latencyUs(500), running(false)
+  {
+    pthread_mutex_init(&lock, NULL);
+  }
+
+  void start()
+  {
+    running = true;
+    pthread_create(&thread, NULL, loop, this);
+  }
+  void stop()
+  {
+    running = false;
+    pthread_join(thread, NULL);
+  }
+  void push(const uint8_t *buf, size_t len)
+  {
+    time_us due = monotonicTimeUs() + latencyUs;
+    pthread_mutex_lock(&lock);
+    for (size_t i = 0; i < len; ++i)
+      bytes.push_back(std::make_pair(due, buf[i]));
+    pthread_mutex_unlock(&lock);
+  }
+
+  CoreAPI *dst;
+  int latencyUs;
+
+private:
+  static void *loop(void *arg)
+  {
+    Wire *wire = (Wire *)arg;
+    uint8_t buf[4096];
+    while (wire->running)
+    {
+      time_us now = monotonicTimeUs();
+      size_t n = 0;
+      pthread_mutex_lock(&wire->lock);
+      while (!wire->bytes.empty() && wire->bytes.front().first <= now && n < sizeof(buf))
+      {
+        buf[n++] = wire->bytes.front().second;
+        wire->bytes.pop_front();
+      }
+      pthread_mutex_unlock(&wire->lock);
+      for (size_t i = 0; i < n; ++i)
+        wire->dst->byteHandler(buf[i]);
+      usleep(200);
+    }
+    return NULL;
+  }
+
+  volatile bool running;
+  pthread_t thread;
+  pthread_mutex_t lock;
+  std::deque<std::pair<time_us, uint8_t> > bytes;
+};
+
+//! HardDriver of one end of a Wire, every dropEvery-th write is lost.
+class WireDriver : public HardDriver
+{
+public:
+  WireDriver() : out(NULL), dropEvery(0), writes(0)
+  {
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    for (int i = 0; i < 3; ++i)
+      pthread_mutex_init(&lock[i], &attr);
+    pthread_cond_init(&cond, NULL);
+  }
+
+  void init() {}
+  time_ms getTimeStamp() { return monotonicTimeUs() / 1000; }
+  size_t send(const uint8_t *buf, size_t len)
+  {
+    uint64_t n = __atomic_add_fetch(&writes, 1, __ATOMIC_RELAXED);
+    if (out && !(dropEvery && n % dropEvery == 0))
+      out->push(buf, len);
+    return len;
+  }
+  size_t readall(uint8_t *, size_t) { return 0; }
+  //! @note the STATUS log of every ACK would dominate the timings
+  void displayLog(const char *) {}
+
+  void lockMemory() { pthread_mutex_lock(&lock[0]); }
+  void freeMemory() { pthread_mutex_unlock(&lock[0]); }
+  void lockMSG() { pthread_mutex_lock(&lock[1]); }
+  void freeMSG() { pthread_mutex_unlock(&lock[1]); }
+  void lockACK() { pthread_mutex_lock(&lock[2]); }
+  void freeACK() { pthread_mutex_unlock(&lock[2]); }
+  void notify() { pthread_cond_signal(&cond); }
+  void wait(int timeout)
+  {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += timeout;
+    pthread_cond_timedwait(&cond, &lock[2], &ts);
+  }
+
+  Wire *out;
+  int dropEvery;
+  uint64_t writes;
+
+private:
+  pthread_mutex_t lock[3];
+  pthread_cond_t cond;
+};
+
+//! Calls sendPoll() every 10 ms, as the serial thread does.
+class SendPoller
+{
+public:
+  explicit SendPoller(CoreAPI *api) : api(api), running(false) {}
+
+  void start()
+  {
+    running = true;
+    pthread_create(&thread, NULL, loop, this);
+  }
+  void stop()
+  {
+    running = false;
+    pthread_join(thread, NULL);
+  }
+
+private:
+  static void *loop(void *arg)
+  {
+    SendPoller *poller = (SendPoller *)arg;
+    while (poller->running)
+    {
+      poller->api->sendPoll();
+      usleep(10000);
+    }
+    return NULL;
+  }
+
+  CoreAPI *api;
+  volatile bool running;
+  pthread_t thread;
+};
+
+//! A host CoreAPI and a simulated flight controller CoreAPI whose receive
+//! callback is fcRecv, joined by a Wire each way and polled every 10 ms.
+class LinkPair
+{
+public:
+  LinkPair(CallBack fcRecv, int latencyUs)
+      : host(&hostDriver), fc(&fcDriver, handlerOf(fcRecv)), hostPoller(&host), fcPoller(&fc)
+  {
+    hostDriver.out = &up;
+    fcDriver.out = &down;
+    up.dst = &fc;
+    down.dst = &host;
+    up.latencyUs = latencyUs;
+    down.latencyUs = latencyUs;
+    up.start();
+    down.start();
+    hostPoller.start();
+    fcPoller.start();
+  }
+  ~LinkPair()
+  {
+    hostPoller.stop();
+    fcPoller.stop();
+    up.stop();
+    down.stop();
+  }
+
+  WireDriver hostDriver;
+  WireDriver fcDriver;
+  Wire up;
+  Wire down;
+  CoreAPI host;
+  CoreAPI fc;
+
+private:
+  static CallBackHandler handlerOf(CallBack callback)
+  {
+    CallBackHandler handler;
+    handler.callback = callback;
+    handler.userData = 0;
+    return handler;
+  }
+
+  SendPoller hostPoller;
+  SendPoller fcPoller;
+};
+
+//! The request id of a received command, to ACK it from a receive callback.
+static inline req_id_t requestOf(const Header *header)
+{
+  req_id_t id;
+  id.sequence_number = header->sequenceNumber;
+  id.session_id = header->sessionID;
+  id.need_encrypt = header->enc;
+  id.reserve = 0;
+  return id;
+}
+
+static inline uint8_t *payloadOf(Header *header) { return (uint8_t *)header + sizeof(Header); }
+
+#endif // BENCH_LINK_H
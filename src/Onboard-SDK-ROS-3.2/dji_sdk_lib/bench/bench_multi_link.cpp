@@ -0,0 +1,114 @@
+/** @file bench_multi_link.cpp
+ *  @version 3.1.9
+ *  @date November 10, 2016
+ *
+ *  @brief
+ *  1 to 8 independent links in one process, each with its own key and
+ *  encryption setting and its own sending thread. Every command and ACK
+ *  carries the link number, so a frame, ACK or callback reaching the wrong
+ *  CoreAPI is counted as crosstalk
+ *
+ *  @copyright 2016 DJI. All rights reserved.
+ *
+ */
+
+#include "bench_link.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static const int MAX_LINKS = 8;
+static const int COMMANDS = 500;
+
+static LinkPair *links[MAX_LINKS];
+static int acked[MAX_LINKS];
+static int crosstalk;
+
+static int linkOf(CoreAPI *api, bool fc)
+{
+  for (int i = 0; i < MAX_LINKS; ++i)
+    if (links[i] && api == (fc ? &links[i]->fc : &links[i]->host))
+      return i;
+  return -1;
+}
+
+static void onCommand(CoreAPI *api, Header *header, UserData userData __UNUSED)
+{
+  if (header->isAck)
+    return;
+  uint8_t *payload = payloadOf(header);
+  if (payload[0] != SET_MISSION)
+    return;
+  if (payload[2] != linkOf(api, true))
+    __atomic_fetch_add(&crosstalk, 1, __ATOMIC_RELAXED);
+  uint8_t ack[2] = { 0, payload[2] };
+  api->ack(requestOf(header), ack, sizeof(ack));
+}
+
+static void onAck(CoreAPI *api, Header *header, UserData userData)
+{
+  int id = (int)(intptr_t)userData;
+  if (linkOf(api, false) != id || payloadOf(header)[1] != id)
+    __atomic_fetch_add(&crosstalk, 1, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&acked[id], 1, __ATOMIC_RELEASE);
+}
+
+//! @note one command in flight per link, the next goes out on the ACK
+static void *sendCommands(void *arg)
+{
+  int id = (int)(intptr_t)arg;
+  CoreAPI *host = &links[id]->host;
+  uint8_t data[9];
+  memset(data, id, sizeof(data));
+  for (int i = 0; i < COMMANDS; ++i)
+  {
+    host->send(2, host->getEncrypt(), SET_MISSION, CODE_WAYPOINT_INIT, data, sizeof(data), 200, 3,
+               onAck, (UserData)(intptr_t)id);
+    time_us deadline = monotonicTimeUs() + 2000000;
+    while (__atomic_load_n(&acked[id], __ATOMIC_ACQUIRE) <= i && monotonicTimeUs() < deadline)
+      usleep(50);
+  }
+  return NULL;
+}
+
+static bool run(int count)
+{
+  char key[65];
+  for (int i = 0; i < count; ++i)
+  {
+    links[i] = new LinkPair(onCommand, 200);
+    snprintf(key, sizeof(key), "%064d", i + 1);
+    links[i]->host.setKey(key);
+    links[i]->fc.setKey(key);
+    links[i]->host.setEncrypt(i % 2);
+    acked[i] = 0;
+  }
+  crosstalk = 0;
+
+  pthread_t thread[MAX_LINKS];
+  time_us start = monotonicTimeUs();
+  for (int i = 0; i < count; ++i)
+    pthread_create(&thread[i], NULL, sendCommands, (void *)(intptr_t)i);
+  for (int i = 0; i < count; ++i)
+    pthread_join(thread[i], NULL);
+  double seconds = (monotonicTimeUs() - start) / 1e6;
+
+  int total = 0;
+  for (int i = 0; i < count; ++i)
+  {
+    total += acked[i];
+    delete links[i];
+    links[i] = NULL;
+  }
+  printf("%d links  %5d/%5d acked  %6.0f commands/s  crosstalk %d\n", count, total,
+         count * COMMANDS, total / seconds, crosstalk);
+  return total == count * COMMANDS && crosstalk == 0;
+}
+
+int main()
+{
+  bool ok = true;
+  for (int count = 1; count <= MAX_LINKS; count *= 2)
+    ok = run(count) && ok;
+  return ok ? 0 : 1;
+}
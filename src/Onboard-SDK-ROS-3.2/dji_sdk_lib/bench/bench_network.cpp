@@ -0,0 +1,172 @@
+/** @file bench_network.cpp
+ *  @version 3.1.9
+ *  @date November 10, 2016
+ *
+ *  @brief
+ *  Latency NetworkDevice adds over loopback. dji_link_bridge serves the slave
+ *  side of a pseudo-terminal; 32 byte messages go from the master side up to
+ *  NetworkDevice::readall() and back down from NetworkDevice::send(). The
+ *  direct row reads the same pty with LinuxSerialDevice, without the bridge
+ *
+ *  @copyright 2016 DJI. All rights reserved.
+ *
+ */
+
+#include "DJI_LinuxSerialDevice.h"
+#include "DJI_NetworkDevice.h"
+#include "DJI_Thread.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <termios.h>
+#include <unistd.h>
+#include <algorithm>
+#include <vector>
+
+using namespace DJI;
+using namespace DJI::onboardSDK;
+
+static const int MESSAGES = 500;
+static const uint16_t PORT = 5761;
+
+static void report(const char *name, std::vector<double> &up, std::vector<double> &down)
+{
+  std::sort(up.begin(), up.end());
+  std::sort(down.begin(), down.end());
+  printf("%-22s up p50 %5.0f p99 %5.0f us", name, up[up.size() / 2], up[up.size() * 99 / 100]);
+  if (!down.empty())
+    printf("   down p50 %5.0f p99 %5.0f us", down[down.size() / 2], down[down.size() * 99 / 100]);
+  printf("\n");
+}
+
+static bool readMaster(int master, size_t len)
+{
+  uint8_t buf[256];
+  size_t got = 0;
+  while (got < len)
+  {
+    struct pollfd p = { master, POLLIN, 0 };
+    if (poll(&p, 1, 1000) <= 0)
+      return false;
+    ssize_t n = read(master, buf, sizeof(buf));
+    if (n > 0)
+      got += n;
+  }
+  return true;
+}
+
+static bool direct(int master, const char *slave)
+{
+  LinuxSerialDevice serial(slave, 230400);
+  serial.init();
+  std::vector<double> up, down;
+  uint8_t msg[32], buf[256];
+  for (int i = 0; i < MESSAGES; ++i)
+  {
+    memset(msg, i, sizeof(msg));
+    time_us start = monotonicTimeUs();
+    if (write(master, msg, sizeof(msg)) != sizeof(msg))
+      return false;
+    for (size_t got = 0; got < sizeof(msg);)
+      got += serial.readall(buf, sizeof(buf));
+    up.push_back(monotonicTimeUs() - start);
+
+    start = monotonicTimeUs();
+    serial.send(msg, sizeof(msg));
+    if (!readMaster(master, sizeof(msg)))
+      return false;
+    down.push_back(monotonicTimeUs() - start);
+  }
+  serial.close();
+  report("direct", up, down);
+  return true;
+}
+
+static bool bridged(int master, const char *slave, const char *name, const char *transport,
+                    const char *batchBytes, const char *batchUs)
+{
+  pid_t bridge = fork();
+  if (!bridge)
+  {
+    int null = open("/dev/null", O_WRONLY);
+    dup2(null, STDOUT_FILENO);
+    char port[8];
+    snprintf(port, sizeof(port), "%u", PORT);
+    execl(BRIDGE_PATH, BRIDGE_PATH, slave, "230400", port, transport, batchBytes, batchUs,
+          (char *)NULL);
+    _exit(127);
+  }
+  usleep(300000);
+
+  NetworkDevice net("127.0.0.1", PORT, strcmp(transport, "udp") ? NET_TCP : NET_UDP);
+  net.setPingPeriod(50);
+  net.init();
+  bool ok = net.getDeviceStatus();
+  std::vector<double> up, down;
+  uint8_t msg[32], buf[256];
+  //! @note lets the pings settle the clock offset
+  for (int i = 0; ok && i < 20; ++i)
+    net.readall(buf, sizeof(buf));
+  for (int i = 0; ok && i < MESSAGES; ++i)
+  {
+    memset(msg, i, sizeof(msg));
+    time_us start = monotonicTimeUs();
+    ok = write(master, msg, sizeof(msg)) == sizeof(msg);
+    size_t got = 0;
+    while (ok && got < sizeof(msg))
+    {
+      size_t n = net.readall(buf, sizeof(buf));
+      if (n != (size_t)-1)
+        got += n;
+      ok = monotonicTimeUs() - start < 1000000;
+    }
+    up.push_back(monotonicTimeUs() - start);
+
+    start = monotonicTimeUs();
+    net.send(msg, sizeof(msg));
+    ok = ok && readMaster(master, sizeof(msg));
+    down.push_back(monotonicTimeUs() - start);
+  }
+  NetStats stats = net.getStats();
+  net.close();
+  kill(bridge, SIGTERM);
+  waitpid(bridge, NULL, 0);
+  if (!ok)
+  {
+    printf("%-22s FAILED\n", name);
+    return false;
+  }
+  report(name, up, down);
+  printf("%-22s rtt %u us  clock offset %lld us  skipped %u bytes\n", "", stats.rttUs,
+         (long long)stats.clockOffsetUs, stats.skipped);
+  return true;
+}
+
+int main()
+{
+  int master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (master < 0 || grantpt(master) || unlockpt(master))
+  {
+    perror("posix_openpt");
+    return 1;
+  }
+  struct termios tio;
+  tcgetattr(master, &tio);
+  cfmakeraw(&tio);
+  tcsetattr(master, TCSANOW, &tio);
+  char slave[64];
+  snprintf(slave, sizeof(slave), "%s", ptsname(master));
+
+  printf("%d round trips of 32 bytes over loopback\n", MESSAGES);
+  bool ok = direct(master, slave);
+  ok = bridged(master, slave, "tcp", "tcp", "0", "1000") && ok;
+  ok = bridged(master, slave, "udp", "udp", "0", "1000") && ok;
+  ok = bridged(master, slave, "tcp batch 64 B/500 us", "tcp", "64", "500") && ok;
+  close(master);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,125 @@
+/** @file bench_orbit.cpp
+ *  @version 3.1.9
+ *  @date November 10, 2016
+ *
+ *  @brief
+ *  OrbitGenerator against a simulated plant: first-order velocity response
+ *  with a 0.3 s time constant, 50 Hz, 15 m radius at 20 deg/s, radius stepped
+ *  to 25 m half way. Then the cost of compute() and the jitter of start(50)
+ *
+ *  @copyright 2016 DJI. All rights reserved.
+ *
+ */
+
+#include "bench_link.h"
+#include "DJI_Flight.h"
+#include "DJI_Orbit.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static const double EARTH_RADIUS = 6371000.0;
+static const double LATITUDE = 0.4;
+static const double LONGITUDE = 2.0;
+static const double DT = 0.02;
+
+//! Aircraft position in meters from the start of the centre track.
+struct Plant
+{
+  double north, east, vNorth, vEast;
+
+  //! @note velocity setpoints are followed with lag tau, position setpoints
+  //! through a proportional loop of 2/s as the flight controller does
+  void step(const OrbitSetpoint &setpoint, OrbitMode mode)
+  {
+    const double tau = 0.3;
+    double gain = mode == ORBIT_VELOCITY ? 1.0 : 2.0;
+    vNorth += (setpoint.x * gain - vNorth) * DT / tau;
+    vEast += (setpoint.y * gain - vEast) * DT / tau;
+    north += vNorth * DT;
+    east += vEast * DT;
+  }
+};
+
+static bool track(const char *name, OrbitMode mode, double centreSpeed, uint32_t responseMs)
+{
+  NullDriver driver;
+  CoreAPI api(&driver);
+  Flight flight(&api);
+  OrbitGenerator orbit(&flight);
+  orbit.setMode(mode);
+  orbit.setRadius(15);
+  orbit.setAngularRate(20);
+  orbit.setMaxSpeed(15);
+  orbit.setResponseTime(responseMs);
+
+  Plant plant = { 15, 0, 0, 0 };
+  time_us now = 1000000;
+  double sum = 0, max = 0;
+  int count = 0;
+  for (int i = 0; i < 3000; ++i)
+  {
+    if (i == 1500)
+      orbit.setRadius(25);
+    orbit.setCentre(LATITUDE + centreSpeed * i * DT / EARTH_RADIUS, LONGITUDE, 10, centreSpeed, 0,
+                    now);
+    PositionData position;
+    memset(&position, 0, sizeof(position));
+    position.latitude = LATITUDE + plant.north / EARTH_RADIUS;
+    position.longitude = LONGITUDE + plant.east / (EARTH_RADIUS * cos(LATITUDE));
+    OrbitSetpoint setpoint;
+    if (!orbit.compute(position, now, &setpoint))
+      return false;
+    plant.step(setpoint, mode);
+    now += DT * 1000000;
+    //! @note 5 s to settle after the start and after the radius step
+    if ((i > 250 && i < 1500) || i > 1750)
+    {
+      double error = fabs(setpoint.radiusError);
+      sum += error;
+      if (error > max)
+        max = error;
+      count++;
+    }
+  }
+  printf("%-30s radius error mean %5.2f m  max %5.2f m\n", name, sum / count, max);
+  return true;
+}
+
+int main()
+{
+  bool ok = track("velocity, fixed centre", ORBIT_VELOCITY, 0, 300);
+  ok = track("velocity, centre at 3 m/s", ORBIT_VELOCITY, 3, 300) && ok;
+  ok = track("velocity, no response lead", ORBIT_VELOCITY, 0, 0) && ok;
+  ok = track("position, fixed centre", ORBIT_POSITION, 0, 300) && ok;
+  ok = track("position, centre at 3 m/s", ORBIT_POSITION, 3, 300) && ok;
+
+  NullDriver driver;
+  CoreAPI api(&driver);
+  Flight flight(&api);
+  OrbitGenerator orbit(&flight);
+  orbit.setCentre(LATITUDE, LONGITUDE, 10);
+  PositionData position;
+  memset(&position, 0, sizeof(position));
+  position.latitude = LATITUDE + 10 / EARTH_RADIUS;
+  position.longitude = LONGITUDE;
+  OrbitSetpoint setpoint;
+  const int calls = 1000000;
+  time_us start = monotonicTimeUs();
+  for (int i = 0; i < calls; ++i)
+  {
+    position.longitude += 1e-9;
+    orbit.compute(position, start, &setpoint);
+  }
+  printf("compute()                      %5.0f ns\n", (monotonicTimeUs() - start) * 1000.0 / calls);
+
+  orbit.start(50);
+  usleep(3000000);
+  orbit.stop();
+  PeriodStats period = orbit.getPeriodStats();
+  printf("start(50) for 3 s              %llu ticks  %llu overruns  jitter mean %.1f us  max %lld us\n",
+         (unsigned long long)period.ticks, (unsigned long long)period.overruns, period.meanJitterUs,
+         (long long)period.maxJitterUs);
+  return ok && !period.overruns ? 0 : 1;
+}
@@ -0,0 +1,101 @@
+/** @file bench_policy.cpp
+ *  @version 3.1.9
+ *  @date November 10, 2016
+ *
+ *  @brief
+ *  Cost of the send and receive paths on a single thread. Built once with the
+ *  default policies (bench_policy) and once with API_SINGLE_THREAD and
+ *  API_NO_CRYPTO (bench_policy_stripped), see DJI_Policy.h
+ *
+ *  @copyright 2016 DJI. All rights reserved.
+ *
+ */
+
+#include "bench_link.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static int acked;
+
+static void onCommand(CoreAPI *api, Header *header, UserData userData __UNUSED)
+{
+  if (header->isAck)
+    return;
+  uint8_t ack[2] = { 0, 0 };
+  api->ack(requestOf(header), ack, sizeof(ack));
+}
+
+static void onAck(CoreAPI *api __UNUSED, Header *header __UNUSED, UserData userData __UNUSED)
+{
+  acked++;
+}
+
+static double sendFrames(int frames)
+{
+  NullDriver driver;
+  CoreAPI api(&driver);
+  uint8_t data[17];
+  memset(data, 7, sizeof(data));
+  time_us start = monotonicTimeUs();
+  for (int i = 0; i < frames; ++i)
+    api.send(0, false, SET_CONTROL, CODE_CONTROL, data, sizeof(data));
+  return (monotonicTimeUs() - start) * 1000.0 / frames;
+}
+
+static double receiveBroadcasts(int frames)
+{
+  CaptureDriver fcDriver, hostDriver;
+  CoreAPI fc(&fcDriver), host(&hostDriver);
+  uint8_t data[18];
+  memset(data, 0, sizeof(data));
+  data[0] = 0x02;
+  for (int i = 0; i < frames; ++i)
+    fc.send(0, false, SET_BROADCAST, CODE_BROADCAST, data, sizeof(data));
+
+  std::vector<uint8_t> stream;
+  stream.swap(fcDriver.bytes);
+  time_us start = monotonicTimeUs();
+  for (size_t i = 0; i < stream.size(); ++i)
+    host.byteHandler(stream[i]);
+  return (monotonicTimeUs() - start) * 1000.0 / frames;
+}
+
+//! @note send, FC ACK and ACK callback, all on this thread
+static double roundTrips(int commands)
+{
+  CaptureDriver hostDriver, fcDriver;
+  CallBackHandler handler;
+  handler.callback = onCommand;
+  handler.userData = 0;
+  CoreAPI host(&hostDriver), fc(&fcDriver, handler);
+  uint8_t data[9];
+  memset(data, 7, sizeof(data));
+  acked = 0;
+  time_us start = monotonicTimeUs();
+  for (int i = 0; i < commands; ++i)
+  {
+    host.send(2, false, SET_MISSION, CODE_WAYPOINT_INIT, data, sizeof(data), 500, 3, onAck, 0);
+    hostDriver.deliver(&fc);
+    fcDriver.deliver(&host);
+  }
+  double ns = (monotonicTimeUs() - start) * 1000.0 / commands;
+  if (acked != commands)
+    printf("only %d of %d commands acked\n", acked, commands);
+  return ns;
+}
+
+int main(int argc, char **argv)
+{
+  int count = argc > 1 ? atoi(argv[1]) : 200000;
+#if defined(API_SINGLE_THREAD) && defined(API_NO_CRYPTO)
+  printf("stripped: API_SINGLE_THREAD API_NO_CRYPTO\n");
+#else
+  printf("default\n");
+#endif
+  printf("sizeof(CoreAPI)        %8lu bytes\n", (unsigned long)sizeof(CoreAPI));
+  printf("send session 0         %8.1f ns/frame\n", sendFrames(count));
+  printf("receive broadcast      %8.1f ns/frame\n", receiveBroadcasts(count / 4));
+  printf("session 2 round trip   %8.1f ns/command\n", roundTrips(count / 4));
+  return acked == count / 4 ? 0 : 1;
+}
@@ -0,0 +1,142 @@
+/** @file bench_send.cpp
+ *  @version 3.1.9
+ *  @date November 10, 2016
+ *
+ *  @brief
+ *  Contention of CoreAPI::send() with 1 to 8 sending threads, then a check
+ *  that 8 threads mixing session 0 and session 2 frames lose nothing
+ *
+ *  @copyright 2016 DJI. All rights reserved.
+ *
+ */
+
+#include "bench_link.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static const char *key = "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef";
+
+struct Sender
+{
+  CoreAPI *api;
+  bool encrypt;
+  int frames;
+  volatile bool *go;
+};
+
+static void *sendFrames(void *arg)
+{
+  Sender *s = (Sender *)arg;
+  uint8_t data[17];
+  memset(data, 7, sizeof(data));
+  while (!*s->go)
+    ;
+  for (int i = 0; i < s->frames; ++i)
+    s->api->send(0, s->encrypt, SET_CONTROL, CODE_CONTROL, data, sizeof(data));
+  return NULL;
+}
+
+static void contention(bool encrypt, int threads, int frames)
+{
+  NullDriver driver;
+  CoreAPI api(&driver);
+  api.setKey(key);
+
+  volatile bool go = false;
+  pthread_t thread[8];
+  Sender sender = { &api, encrypt, frames, &go };
+  for (int i = 0; i < threads; ++i)
+    pthread_create(&thread[i], NULL, sendFrames, &sender);
+  time_us start = monotonicTimeUs();
+  go = true;
+  for (int i = 0; i < threads; ++i)
+    pthread_join(thread[i], NULL);
+  double seconds = (monotonicTimeUs() - start) / 1e6;
+
+  printf("%-9s threads=%d %8.0f kframes/s  lockMemory held %.2f us/frame\n",
+         encrypt ? "encrypted" : "plain", threads, threads * frames / seconds / 1000,
+         (double)driver.heldUs / driver.writes);
+}
+
+static int session0;
+static int session2;
+static int acked;
+
+static void onCommand(CoreAPI *api, Header *header, UserData userData __UNUSED)
+{
+  if (header->isAck)
+    return;
+  if (header->sessionID == 0)
+  {
+    __atomic_fetch_add(&session0, 1, __ATOMIC_RELAXED);
+    return;
+  }
+  __atomic_fetch_add(&session2, 1, __ATOMIC_RELAXED);
+  uint8_t ack[2] = { 0, 0 };
+  api->ack(requestOf(header), ack, sizeof(ack));
+}
+
+static void onAck(CoreAPI *api __UNUSED, Header *header __UNUSED, UserData userData __UNUSED)
+{
+  __atomic_fetch_add(&acked, 1, __ATOMIC_RELAXED);
+}
+
+static void *sendMixed(void *arg)
+{
+  CoreAPI *api = (CoreAPI *)arg;
+  uint8_t data[17];
+  memset(data, 7, sizeof(data));
+  for (int i = 0; i < 300; ++i)
+  {
+    api->send(0, true, SET_CONTROL, CODE_CONTROL, data, (size_t)17);
+    if (i % 10 == 0)
+      api->send(2, true, SET_MISSION, CODE_WAYPOINT_INIT, data, (size_t)9, 500, 3, onAck, 0);
+    usleep(200);
+  }
+  return NULL;
+}
+
+static bool delivery()
+{
+  WireDriver hostDriver, fcDriver;
+  Wire up, down;
+  hostDriver.out = &up;
+  fcDriver.out = &down;
+  CoreAPI host(&hostDriver);
+  CallBackHandler handler;
+  handler.callback = onCommand;
+  handler.userData = 0;
+  CoreAPI fc(&fcDriver, handler);
+  host.setKey(key);
+  fc.setKey(key);
+  up.dst = &fc;
+  down.dst = &host;
+  up.start();
+  down.start();
+  SendPoller poller(&host);
+  poller.start();
+
+  pthread_t thread[8];
+  for (int i = 0; i < 8; ++i)
+    pthread_create(&thread[i], NULL, sendMixed, &host);
+  for (int i = 0; i < 8; ++i)
+    pthread_join(thread[i], NULL);
+  usleep(1500000);
+
+  poller.stop();
+  up.stop();
+  down.stop();
+  printf("8 threads: session 0 %d/2400, session 2 %d/240, acked %d/240\n", session0,
+         session2, acked);
+  return session0 == 2400 && session2 == 240 && acked == 240;
+}
+
+int main(int argc, char **argv)
+{
+  int frames = argc > 1 ? atoi(argv[1]) : 20000;
+  for (int encrypt = 0; encrypt < 2; ++encrypt)
+    for (int threads = 1; threads <= 8; threads *= 2)
+      contention(encrypt, threads, frames);
+  return delivery() ? 0 : 1;
+}
@@ -0,0 +1,139 @@
+/** @file bench_serial.cpp
+ *  @version 3.1.9
+ *  @date November 10, 2016
+ *
+ *  @brief
+ *  LinuxSerialDevice on the slave side of a pseudo-terminal: receive latency
+ *  of single bytes, a 1 MB send through partial writes checked byte by byte,
+ *  and the wait()/notify() semantics. Exits non-zero on any mismatch
+ *
+ *  @copyright 2016 DJI. All rights reserved.
+ *
+ */
+
+#include "DJI_LinuxSerialDevice.h"
+#include "DJI_Thread.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+
+using namespace DJI;
+using namespace DJI::onboardSDK;
+
+static const size_t BULK_SIZE = 1 << 20;
+
+static uint8_t bulk[BULK_SIZE];
+
+struct Drain
+{
+  int fd;
+  size_t got;
+  bool intact;
+};
+
+//! @note reads the master side until the whole pattern arrived
+static void *drain(void *arg)
+{
+  Drain *d = (Drain *)arg;
+  uint8_t buf[8192];
+  while (d->got < BULK_SIZE)
+  {
+    ssize_t n = read(d->fd, buf, sizeof(buf));
+    if (n <= 0)
+      continue;
+    for (ssize_t i = 0; i < n; ++i)
+      if (buf[i] != (uint8_t)((d->got + i) * 7))
+        d->intact = false;
+    d->got += n;
+  }
+  return NULL;
+}
+
+static bool receiveLatency(int master, LinuxSerialDevice *dev, int bytes)
+{
+  uint8_t buf[4096];
+  double sum = 0, max = 0;
+  for (int i = 0; i < bytes; ++i)
+  {
+    uint8_t c = i;
+    time_us start = monotonicTimeUs();
+    if (write(master, &c, 1) != 1)
+      return false;
+    size_t n = dev->readall(buf, sizeof(buf));
+    double us = monotonicTimeUs() - start;
+    if (n != 1 || buf[0] != c)
+    {
+      printf("byte %d: read %lu bytes\n", i, (unsigned long)n);
+      return false;
+    }
+    sum += us;
+    if (us > max)
+      max = us;
+  }
+  printf("receive latency     mean %6.1f us  max %6.0f us  (%d bytes)\n", sum / bytes, max, bytes);
+  return true;
+}
+
+static bool bulkSend(int master, LinuxSerialDevice *dev)
+{
+  for (size_t i = 0; i < BULK_SIZE; ++i)
+    bulk[i] = i * 7;
+  Drain d = { master, 0, true };
+  pthread_t thread;
+  pthread_create(&thread, NULL, drain, &d);
+  time_us start = monotonicTimeUs();
+  size_t sent = dev->send(bulk, BULK_SIZE);
+  pthread_join(thread, NULL);
+  time_us us = monotonicTimeUs() - start;
+  printf("send 1 MB           %lu sent  %lu received  %s  %.1f MB/s\n", (unsigned long)sent,
+         (unsigned long)d.got, d.intact ? "intact" : "CORRUPT", (double)sent / us);
+  return sent == BULK_SIZE && d.got == BULK_SIZE && d.intact;
+}
+
+//! @note a notify() before wait() must not be lost, an unnotified wait() times out
+static bool waitNotify(LinuxSerialDevice *dev)
+{
+  dev->lockACK();
+  dev->notify();
+  time_us start = monotonicTimeUs();
+  dev->wait(1);
+  time_us notified = monotonicTimeUs() - start;
+  start = monotonicTimeUs();
+  dev->wait(1);
+  time_us timedOut = monotonicTimeUs() - start;
+  dev->freeACK();
+  printf("wait after notify   %6lu us\n", (unsigned long)notified);
+  printf("wait without notify %6lu ms\n", (unsigned long)(timedOut / 1000));
+  return notified < 100000 && timedOut >= 900000 && timedOut < 1500000;
+}
+
+int main(int argc, char **argv)
+{
+  int bytes = argc > 1 ? atoi(argv[1]) : 2000;
+  int master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (master < 0 || grantpt(master) || unlockpt(master))
+  {
+    perror("posix_openpt");
+    return 1;
+  }
+  LinuxSerialDevice dev(ptsname(master), 230400);
+  dev.init();
+  if (!dev.getDeviceStatus())
+    return 1;
+  printf("%s  low latency %s\n", dev.getDevice(), dev.isLowLatency() ? "on" : "off");
+
+  struct termios tio;
+  tcgetattr(master, &tio);
+  cfmakeraw(&tio);
+  tcsetattr(master, TCSANOW, &tio);
+
+  bool ok = receiveLatency(master, &dev, bytes);
+  ok = bulkSend(master, &dev) && ok;
+  ok = waitNotify(&dev) && ok;
+  close(master);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,162 @@
+/** @file bench_shared_link.cpp
+ *  @version 3.1.9
+ *  @date November 10, 2016
+ *
+ *  @brief
+ *  SharedLinkServer fan-out to 1, 2 and 4 reader processes while the
+ *  simulated flight controller broadcasts every ms, then the round trip of
+ *  client commands through the daemon. Every sample carries its generation
+ *  in all four quaternion fields, so a torn read shows up as a mismatch
+ *
+ *  @copyright 2016 DJI. All rights reserved.
+ *
+ */
+
+#include "bench_link.h"
+#include "DJI_SharedLink.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+
+static const char *NAME = "/bench_shared_link";
+static const int READ_US = 1000000;
+static const int COMMANDS = 200;
+
+static volatile bool running;
+
+//! @note runs in a child process, exits with the number of torn samples
+static int reader(int id)
+{
+  SharedLinkClient client;
+  while (!client.open(NAME, "reader", 1))
+    usleep(1000);
+  while (!client.getGeneration())
+    usleep(1000);
+
+  BroadcastData data;
+  uint32_t generation = 0, last = 0;
+  long reads = 0, samples = 0, torn = 0;
+  time_us end = monotonicTimeUs() + READ_US;
+  while (monotonicTimeUs() < end)
+  {
+    if (!client.getBroadcast(&data, &generation))
+      continue;
+    reads++;
+    if (generation == last)
+      continue;
+    samples++;
+    last = generation;
+    float32_t g = data.q.q0;
+    if (data.q.q1 != g || data.q.q2 != g || data.q.q3 != g)
+      torn++;
+  }
+  printf("  reader %d  %6.2f M reads/s  %5ld samples  %ld torn\n", id, reads / (READ_US / 1e6) / 1e6,
+         samples, torn);
+  fflush(stdout);
+  client.close();
+  return torn ? 1 : 0;
+}
+
+static void onCommand(CoreAPI *api, Header *header, UserData userData __UNUSED)
+{
+  if (header->isAck)
+    return;
+  uint8_t ack[2] = { 0, 0 };
+  api->ack(requestOf(header), ack, sizeof(ack));
+}
+
+static void *broadcast(void *arg)
+{
+  CoreAPI *fc = (CoreAPI *)arg;
+  uint8_t buf[2 + sizeof(QuaternionData)] = { 0x02, 0x00 };
+  for (uint32_t g = 1; running; ++g)
+  {
+    QuaternionData q = { (float32_t)g, (float32_t)g, (float32_t)g, (float32_t)g };
+    memcpy(buf + 2, &q, sizeof(q));
+    fc->send(0, false, SET_BROADCAST, CODE_BROADCAST, buf, sizeof(buf));
+    usleep(1000);
+  }
+  return NULL;
+}
+
+static void *serve(void *arg)
+{
+  SharedLinkServer *server = (SharedLinkServer *)arg;
+  while (running)
+    if (!server->poll())
+      usleep(200);
+  return NULL;
+}
+
+//! @note the readers are forked before any thread is started
+static bool run(int readers, bool commands)
+{
+  pid_t child[8];
+  fflush(stdout);
+  for (int i = 0; i < readers; ++i)
+    if (!(child[i] = fork()))
+      _exit(reader(i));
+
+  LinkPair link(onCommand, 500);
+  SharedLinkServer server(&link.host);
+  if (!server.open(NAME))
+    return false;
+  running = true;
+  pthread_t broadcaster, poller;
+  pthread_create(&broadcaster, NULL, broadcast, &link.fc);
+  pthread_create(&poller, NULL, serve, &server);
+
+  bool ok = true;
+  for (int i = 0; i < readers; ++i)
+  {
+    int status;
+    waitpid(child[i], &status, 0);
+    ok = ok && WIFEXITED(status) && !WEXITSTATUS(status);
+  }
+
+  if (commands)
+  {
+    SharedLinkClient client;
+    client.open(NAME, "commands", 5);
+    uint8_t freq[16];
+    memset(freq, 0, sizeof(freq));
+    double sum = 0, max = 0;
+    int done = 0;
+    for (int i = 0; i < COMMANDS; ++i)
+    {
+      SharedResult result;
+      time_us start = monotonicTimeUs();
+      uint32_t token = client.send(SET_ACTIVATION, CODE_FREQUENCY, freq, sizeof(freq));
+      if (!token || !client.waitResult(token, &result, 1000) || result.status != SHARED_ACKED)
+        continue;
+      double ms = (monotonicTimeUs() - start) / 1000.0;
+      sum += ms;
+      if (ms > max)
+        max = ms;
+      done++;
+    }
+    printf("commands  %d/%d done  round trip mean %.2f ms  max %.2f ms  (500 us each way)\n", done,
+           COMMANDS, done ? sum / done : 0, max);
+    ok = ok && done == COMMANDS;
+    client.close();
+  }
+
+  running = false;
+  pthread_join(broadcaster, NULL);
+  pthread_join(poller, NULL);
+  SharedLinkStats stats = server.getStats();
+  server.close();
+  printf("%d reader%s  %u broadcasts published\n", readers, readers > 1 ? "s" : " ", stats.broadcasts);
+  return ok;
+}
+
+int main()
+{
+  printf("%ld CPUs, a broadcast every ms, readers poll for %d ms\n", sysconf(_SC_NPROCESSORS_ONLN),
+         READ_US / 1000);
+  bool ok = true;
+  for (int readers = 1; readers <= 4; readers *= 2)
+    ok = run(readers, readers == 4) && ok;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,94 @@
+/** @file bench_waypoint_decimate.cpp
+ *  @version 3.1.9
+ *  @date November 10, 2016
+ *
+ *  @brief
+ *  WayPoint::decimate() on 10k point synthetic paths: a survey lawnmower with
+ *  0.3 m jitter and a climbing spiral. Reports kept points and time
+ *
+ *  @copyright 2016 DJI. All rights reserved.
+ *
+ */
+
+#include "DJI_WayPoint.h"
+#include "DJI_Thread.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+using namespace DJI;
+using namespace DJI::onboardSDK;
+
+static const int POINTS = 10000;
+static const double EARTH_RADIUS = 6371000.0;
+static const double LATITUDE = 0.4;
+
+static void place(WayPointData *point, int index, double east, double north, double up)
+{
+  memset(point, 0, sizeof(WayPointData));
+  point->index = index;
+  point->latitude = LATITUDE + north / EARTH_RADIUS;
+  point->longitude = 2.0 + east / (EARTH_RADIUS * cos(LATITUDE));
+  point->altitude = 30 + up;
+}
+
+static double jitter(double meters) { return (rand() % 1000 - 500) / 1000.0 * meters; }
+
+//! @note 10 legs of 1 km, 50 m apart, one point per metre, one action halfway
+static void lawnmower(std::vector<WayPointData> &path)
+{
+  srand(1);
+  for (int i = 0; i < POINTS; ++i)
+  {
+    int leg = i / 1000;
+    double along = i % 1000;
+    double east = (leg % 2 ? 1000 - along : along) + jitter(0.3);
+    place(&path[i], i, east, leg * 50.0 + jitter(0.3), jitter(0.2));
+  }
+  path[POINTS / 2].hasAction = 1;
+  path[POINTS / 2].actionNumber = 1;
+}
+
+//! @note 20 turns of 100 m radius climbing 100 m, a curve everywhere
+static void spiral(std::vector<WayPointData> &path)
+{
+  for (int i = 0; i < POINTS; ++i)
+  {
+    double angle = 2 * M_PI * 20 * i / POINTS;
+    place(&path[i], i, 100 * cos(angle), 100 * sin(angle), 100.0 * i / POINTS);
+  }
+}
+
+static void run(const char *name, void (*make)(std::vector<WayPointData> &), float32_t crossTrack,
+                float32_t altitude)
+{
+  std::vector<WayPointData> path(POINTS);
+  WayPointDecimation report;
+  double best = 1e9;
+  for (int repeat = 0; repeat < 5; ++repeat)
+  {
+    make(path);
+    time_us start = monotonicTimeUs();
+    WayPoint::decimate(&path[0], path.size(), crossTrack, altitude, &report);
+    best = std::min(best, (monotonicTimeUs() - start) / 1000.0);
+  }
+  printf("%-9s tol %.1f/%.1f m  %5lu -> %4lu points (%lu pinned)  dropped max %.2f/%.2f m  "
+         "saves %6.0f ms upload  %.2f ms\n",
+         name, crossTrack, altitude, (unsigned long)report.inputPoints,
+         (unsigned long)report.outputPoints, (unsigned long)report.pinnedPoints,
+         report.maxCrossTrack, report.maxAltitude, report.savedUploadMs, best);
+}
+
+int main()
+{
+  const float32_t tolerance[] = { 0.5, 1.0, 2.0 };
+  for (int i = 0; i < 3; ++i)
+    run("lawnmower", lawnmower, tolerance[i], 0.5);
+  for (int i = 0; i < 3; ++i)
+    run("spiral", spiral, tolerance[i], 0.5);
+  return 0;
+}
@@ -0,0 +1,101 @@
+/** @file bench_waypoint_upload.cpp
+ *  @version 3.1.9
+ *  @date November 10, 2016
+ *
+ *  @brief
+ *  WayPointUploader over a simulated link losing every 7th frame: upload
+ *  time of a 60 point mission by window size, with and without readback.
+ *  Window 1 is the one point per round trip of WayPoint::uploadIndexData()
+ *
+ *  @copyright 2016 DJI. All rights reserved.
+ *
+ */
+
+#include "bench_link.h"
+#include "DJI_WayPointUploader.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static const int POINTS = 60;
+
+//! @note what the simulated flight controller accepted
+static WayPointData stored[POINTS];
+
+static void onCommand(CoreAPI *api, Header *header, UserData userData __UNUSED)
+{
+  if (header->isAck)
+    return;
+  uint8_t *payload = payloadOf(header);
+  if (payload[0] != SET_MISSION)
+    return;
+  if (payload[1] == CODE_WAYPOINT_ADDPOINT)
+  {
+    WayPointData data;
+    memcpy(&data, payload + 2, sizeof(data));
+    if (data.index < POINTS)
+      stored[data.index] = data;
+    uint8_t ack[2] = { 0, data.index };
+    api->ack(requestOf(header), ack, sizeof(ack));
+  }
+  else if (payload[1] == CODE_WAYPOINT_INDEX_READ)
+  {
+    uint8_t ack[2 + sizeof(WayPointData)];
+    uint8_t index = payload[2] < POINTS ? payload[2] : 0;
+    ack[0] = 0;
+    ack[1] = index;
+    memcpy(ack + 2, &stored[index], sizeof(WayPointData));
+    api->ack(requestOf(header), ack, sizeof(ack));
+  }
+}
+
+static bool upload(int window, bool readback, int latencyUs)
+{
+  memset(stored, 0, sizeof(stored));
+  LinkPair link(onCommand, latencyUs);
+  link.hostDriver.dropEvery = 7;
+
+  WayPoint wp(&link.host);
+  WayPointInitData info;
+  memset(&info, 0, sizeof(info));
+  info.indexNumber = POINTS;
+  wp.setInfo(info);
+  for (int i = 0; i < POINTS; ++i)
+  {
+    WayPointData data;
+    memset(&data, 0, sizeof(data));
+    data.index = i;
+    data.latitude = 0.39 + i * 1e-6;
+    data.longitude = 1.98;
+    data.altitude = 10 + i;
+    wp.setIndex(&data, i);
+  }
+
+  WayPointUploader uploader(&wp);
+  uploader.setWindow(window);
+  uploader.setReadback(readback);
+  uploader.setRetry(4, 200);
+  bool ok = uploader.upload(30000);
+  UploadStats stats = uploader.getStats();
+
+  int wrong = 0;
+  for (int i = 0; i < POINTS; ++i)
+    if (stored[i].index != i || stored[i].altitude != 10 + i)
+      wrong++;
+  printf("window %d%s  %8.1f ms  rtt %5.1f/%5.1f/%6.1f ms  sends %3u retries %2u%s\n",
+         uploader.getWindow(), readback ? " readback" : "         ", stats.totalUs / 1000.0,
+         stats.minRttUs / 1000.0, stats.meanRttUs / 1000.0, stats.maxRttUs / 1000.0, stats.sends,
+         stats.retries, ok && !wrong ? "" : "  FAILED");
+  return ok && !wrong;
+}
+
+int main(int argc, char **argv)
+{
+  int latencyUs = argc > 1 ? atoi(argv[1]) : 5000;
+  bool ok = true;
+  printf("%d points, %d us each way, every 7th host frame lost\n", POINTS, latencyUs);
+  for (int readback = 0; readback < 2; ++readback)
+    for (int window = 1; window <= 8; window *= 2)
+      ok = upload(window, readback, latencyUs) && ok;
+  return ok ? 0 : 1;
+}
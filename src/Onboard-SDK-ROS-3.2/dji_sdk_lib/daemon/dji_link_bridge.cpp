@@ -0,0 +1,285 @@
+/** @file dji_link_bridge.cpp
+ *  @version 3.1.9
+ *  @date November 10, 2016
+ *
+ *  @brief
+ *  Serves a local serial port to a NetworkDevice over TCP or UDP
+ *
+ *  @copyright 2016 DJI. All rights reserved.
+ *
+ */
+
+#include "DJI_LinuxSerialDevice.h"
+#include "DJI_NetworkDevice.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+using namespace DJI;
+using namespace DJI::onboardSDK;
+
+static volatile sig_atomic_t running = 1;
+
+static void onSignal(int) { running = 0; }
+
+static void usage(const char *self)
+{
+  fprintf(stderr, "usage: %s <device> <baudrate> <port> [tcp|udp] [batch bytes] [batch us] "
+                  "[nodelay]\n"
+                  "  tcp, no batching and nodelay 1 by default\n"
+                  "  batch bytes: serial bytes gathered into one frame, 0 sends each read\n"
+                  "  batch us: longest a batch waits for more bytes, 1000 by default; the port\n"
+                  "  is polled in whole milliseconds\n",
+      self);
+}
+
+typedef struct Bridge
+{
+  LinuxSerialDevice *serial;
+  bool udp;
+  bool noDelay;
+  size_t batchBytes;
+  time_us batchUs;
+
+  //! @note guards the peer, both directions use it
+  pthread_mutex_t lock;
+  int sock;
+  int client;
+  struct sockaddr_storage peer;
+  socklen_t peerLength;
+
+  uint32_t framesUp;
+  uint32_t framesDown;
+  uint32_t bytesUp;
+  uint32_t bytesDown;
+} Bridge;
+
+static void sendFrame(Bridge *bridge, uint8_t type, uint64_t timeUs, const uint8_t *payload,
+    size_t len)
+{
+  uint8_t frame[sizeof(NetFrameHeader) + NET_PAYLOAD_MAX];
+  size_t size = NetFrameParser::encode(frame, type, timeUs, payload, len);
+
+  pthread_mutex_lock(&bridge->lock);
+  if (bridge->udp)
+  {
+    if (bridge->peerLength)
+      sendto(bridge->sock, frame, size, 0, (struct sockaddr *)&bridge->peer,
+          bridge->peerLength);
+  }
+  else
+  {
+    size_t sent = 0;
+    while (bridge->client >= 0 && sent < size)
+    {
+      ssize_t ans = send(bridge->client, frame + sent, size - sent, MSG_NOSIGNAL);
+      if (ans > 0)
+        sent += ans;
+      else if (ans < 0 && errno == EINTR)
+        continue;
+      else
+        break;
+    }
+  }
+  pthread_mutex_unlock(&bridge->lock);
+}
+
+//! @note serial to network, stamps each batch with the time its first byte
+//! was read
+static void *upstream(void *arg)
+{
+  Bridge *bridge = (Bridge *)arg;
+  size_t limit = bridge->batchBytes;
+  if (limit == 0 || limit > NET_PAYLOAD_MAX)
+    limit = NET_PAYLOAD_MAX;
+
+  uint8_t buf[NET_PAYLOAD_MAX];
+  while (running)
+  {
+    bridge->serial->setReadTimeout(100);
+    size_t len = bridge->serial->readall(buf, limit);
+    if (len == 0 || len == (size_t)-1)
+      continue;
+    time_us stamp = monotonicTimeUs();
+
+    if (bridge->batchBytes)
+    {
+      time_us end = stamp + bridge->batchUs;
+      for (time_us now = stamp; len < limit && now < end; now = monotonicTimeUs())
+      {
+        bridge->serial->setReadTimeout((end - now + 999) / 1000);
+        size_t ans = bridge->serial->readall(buf + len, limit - len);
+        if (ans != (size_t)-1)
+          len += ans;
+      }
+    }
+
+    sendFrame(bridge, NET_DATA, stamp, buf, len);
+    bridge->framesUp++;
+    bridge->bytesUp += len;
+  }
+  return 0;
+}
+
+static void handle(Bridge *bridge, const NetFrameHeader &header, const uint8_t *payload)
+{
+  if (header.type == NET_DATA)
+  {
+    bridge->serial->send(payload, header.length);
+    bridge->framesDown++;
+    bridge->bytesDown += header.length;
+  }
+  else if (header.type == NET_PING)
+    sendFrame(bridge, NET_PONG, monotonicTimeUs(), payload, header.length);
+}
+
+static void serveUdp(Bridge *bridge)
+{
+  NetFrameParser parser;
+  uint8_t data[sizeof(NetFrameHeader) + NET_PAYLOAD_MAX];
+  while (running)
+  {
+    struct pollfd pfd = { bridge->sock, POLLIN, 0 };
+    if (poll(&pfd, 1, 100) <= 0)
+      continue;
+    struct sockaddr_storage from;
+    socklen_t fromLength = sizeof(from);
+    ssize_t ans =
+        recvfrom(bridge->sock, data, sizeof(data), 0, (struct sockaddr *)&from, &fromLength);
+    if (ans <= 0)
+      continue;
+
+    //! @note the last sender is the peer, so a restarted client is picked up
+    pthread_mutex_lock(&bridge->lock);
+    memcpy(&bridge->peer, &from, fromLength);
+    bridge->peerLength = fromLength;
+    pthread_mutex_unlock(&bridge->lock);
+
+    parser.reset();
+    parser.append(data, ans);
+    NetFrameHeader header;
+    const uint8_t *payload;
+    while (parser.next(&header, &payload))
+      handle(bridge, header, payload);
+  }
+}
+
+static void serveTcp(Bridge *bridge)
+{
+  NetFrameParser parser;
+  uint8_t data[sizeof(NetFrameHeader) + NET_PAYLOAD_MAX];
+  while (running)
+  {
+    struct pollfd pfd = { bridge->sock, POLLIN, 0 };
+    if (poll(&pfd, 1, 100) <= 0)
+      continue;
+    int client = accept(bridge->sock, 0, 0);
+    if (client < 0)
+      continue;
+    int value = bridge->noDelay ? 1 : 0;
+    setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &value, sizeof(value));
+    printf("client connected\n");
+
+    pthread_mutex_lock(&bridge->lock);
+    bridge->client = client;
+    pthread_mutex_unlock(&bridge->lock);
+
+    parser.reset();
+    while (running)
+    {
+      struct pollfd cfd = { client, POLLIN, 0 };
+      if (poll(&cfd, 1, 100) <= 0)
+        continue;
+      ssize_t ans = recv(client, data, sizeof(data), 0);
+      if (ans < 0 && errno == EINTR)
+        continue;
+      if (ans <= 0)
+        break;
+      parser.append(data, ans);
+      NetFrameHeader header;
+      const uint8_t *payload;
+      while (parser.next(&header, &payload))
+        handle(bridge, header, payload);
+    }
+
+    pthread_mutex_lock(&bridge->lock);
+    bridge->client = -1;
+    pthread_mutex_unlock(&bridge->lock);
+    close(client);
+    printf("client disconnected\n");
+  }
+}
+
+int main(int argc, char **argv)
+{
+  if (argc < 4)
+  {
+    usage(argv[0]);
+    return 1;
+  }
+
+  Bridge bridge;
+  memset(&bridge, 0, sizeof(bridge));
+  bridge.udp = argc > 4 && strcmp(argv[4], "udp") == 0;
+  bridge.batchBytes = argc > 5 ? strtoul(argv[5], 0, 0) : 0;
+  bridge.batchUs = argc > 6 ? strtoul(argv[6], 0, 0) : 1000;
+  bridge.noDelay = argc > 7 ? atoi(argv[7]) != 0 : true;
+  bridge.client = -1;
+  pthread_mutex_init(&bridge.lock, 0);
+
+  LinuxSerialDevice serial(argv[1], atoi(argv[2]));
+  serial.init();
+  if (!serial.getDeviceStatus())
+    return 1;
+  bridge.serial = &serial;
+
+  bridge.sock = socket(AF_INET6, (bridge.udp ? SOCK_DGRAM : SOCK_STREAM) | SOCK_CLOEXEC, 0);
+  if (bridge.sock < 0)
+  {
+    perror("socket");
+    return 1;
+  }
+  int value = 0;
+  setsockopt(bridge.sock, IPPROTO_IPV6, IPV6_V6ONLY, &value, sizeof(value));
+  value = 1;
+  setsockopt(bridge.sock, SOL_SOCKET, SO_REUSEADDR, &value, sizeof(value));
+  struct sockaddr_in6 addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin6_family = AF_INET6;
+  addr.sin6_addr = in6addr_any;
+  addr.sin6_port = htons(atoi(argv[3]));
+  if (bind(bridge.sock, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+      (!bridge.udp && listen(bridge.sock, 1) != 0))
+  {
+    perror("bind");
+    return 1;
+  }
+
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+  signal(SIGPIPE, SIG_IGN);
+
+  pthread_t thread;
+  if (pthread_create(&thread, 0, upstream, &bridge) != 0)
+    return 1;
+  if (bridge.udp)
+    serveUdp(&bridge);
+  else
+    serveTcp(&bridge);
+  pthread_join(thread, 0);
+
+  printf("up %u frames %u bytes, down %u frames %u bytes\n", bridge.framesUp, bridge.bytesUp,
+      bridge.framesDown, bridge.bytesDown);
+  close(bridge.sock);
+  pthread_mutex_destroy(&bridge.lock);
+  return 0;
+}
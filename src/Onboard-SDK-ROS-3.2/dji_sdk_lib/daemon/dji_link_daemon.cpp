@@ -0,0 +1,98 @@
+/** @file dji_link_daemon.cpp
+ *  @version 3.1.9
+ *  @date November 10, 2016
+ *
+ *  @brief
+ *  Owns the flight controller serial port and shares it with local processes
+ *
+ *  @copyright 2016 DJI. All rights reserved.
+ *
+ */
+
+#include "DJI_LinuxSerialDevice.h"
+#include "DJI_InitSequencer.h"
+#include "DJI_SharedLink.h"
+#include "DJI_ThreadTopology.h"
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+using namespace DJI;
+using namespace DJI::onboardSDK;
+
+static volatile sig_atomic_t running = 1;
+
+static void onSignal(int) { running = 0; }
+
+static void usage(const char *self)
+{
+  fprintf(stderr, "usage: %s <device> <baudrate> <app id> <app key> [shm name] [cache file]\n"
+                  "  shm name defaults to /dji_link\n",
+      self);
+}
+
+int main(int argc, char **argv)
+{
+  if (argc < 5)
+  {
+    usage(argv[0]);
+    return 1;
+  }
+  const char *name = argc > 5 ? argv[5] : "/dji_link";
+
+  LinuxSerialDevice serial(argv[1], atoi(argv[2]));
+  serial.init();
+  if (!serial.getDeviceStatus())
+    return 1;
+
+  CoreAPI api(&serial);
+  ThreadTopology topology;
+  LinkThreads threads(&api, &topology);
+  if (!threads.start())
+    return 1;
+
+  char key[65];
+  strncpy(key, argv[4], sizeof(key) - 1);
+  key[sizeof(key) - 1] = 0;
+  ActivateData user;
+  memset(&user, 0, sizeof(user));
+  user.ID = atoi(argv[3]);
+  user.encKey = key;
+
+  //! @note clients take control authority themselves through the daemon
+  InitSequencer init(&api);
+  init.setActivateData(user);
+  init.setObtainControl(false);
+  if (argc > 6)
+    init.setCacheFile(argv[6]);
+  if (!init.run(5000))
+  {
+    fprintf(stderr, "Flight controller did not come up\n");
+    threads.stop();
+    return 1;
+  }
+
+  SharedLinkServer server(&api);
+  if (!server.open(name))
+  {
+    threads.stop();
+    return 1;
+  }
+
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+  while (running)
+    if (!server.poll())
+      usleep(1000);
+
+  SharedLinkStats stats = server.getStats();
+  printf("broadcasts %u, commands %u, acked %u, rejected %u, failed %u, timeouts %u\n",
+      stats.broadcasts, stats.commands, stats.acked, stats.rejected, stats.failed,
+      stats.timeouts);
+  server.close();
+  threads.stop();
+  return 0;
+}
@@ -28,7 +28,9 @@
 
 #include "DJI_Type.h"
 #include "DJI_HardDriver.h"
+#include "DJI_Policy.h"
 #include "DJI_App.h"
+#include "DJI_Kinematics.h"
 
 namespace DJI
 {
@@ -39,6 +41,8 @@ class Flight;
 class Camera;
 class VirtualRC;
 class HotPoint;
+class TriggerRegistry;
+class MissionEventQueue;
 
 //! @todo sort enum and move to a new file
 
@@ -256,8 +260,16 @@ class CoreAPI
       /**@note Better interface entrance*/
       UserData userData = 0);
 
-  /**@note Main interface*/
-  void send(Command *parameter);
+  /**@note Main interface, returns the session used (0 in session mode 0),
+   * -1 if no session or memory is available*/
+  int send(Command *parameter);
+
+  /**@note Frees the sessions still waiting for an ACK with this userData, so
+   * their handler never runs, and returns once a handler of it the read
+   * thread is running has returned. Objects passed as userData call it
+   * before they go away, without holding a lock their handlers take and
+   * not from one of those handlers*/
+  void cancelSessions(UserData userData);
   //@}
 
   /// Activation Control
@@ -350,6 +362,8 @@ class CoreAPI
    * Reset all broadcast frequencies to their default values
    */
   void setBroadcastFreqDefaults();
+  //! @note the 16 default frequencies for the current firmware
+  void getBroadcastFreqDefaults(uint8_t *freq) const;
 
   /**
    * Blocking API Control
@@ -411,6 +425,63 @@ class CoreAPI
   Version getFwVersion() const;
   char * getHwVersion() const;
   char * getHwSerialNum() const;
+  /**
+   * Firmware quirks resolved from the last version query. Use this instead of
+   * comparing getFwVersion()/getHwVersion() in code that runs per packet.
+   */
+  const FirmwareBehaviour &getFirmwareBehaviour() const;
+  /**
+   * Use version data known from a previous run, eg. to activate before the
+   * version query returns. A later getDroneVersion() ACK overwrites it.
+   */
+  void setVersionData(const VersionData &data);
+  const VersionData &getVersionData() const;
+
+  /**
+   * Encryption flag used by Flight, WayPoint, Camera etc. for this instance.
+   * Defaults to DJI::onboardSDK::encrypt (USE_ENCRYPT).
+   */
+  uint8_t getEncrypt() const;
+  void setEncrypt(uint8_t value);
+
+  /**
+   * Derive session timeouts from the measured ACK round trip of each command
+   * set instead of the constant given to send(). The timeout is
+   * srtt + max(POLL_TICK, 4 * rttvar), kept within [minTimeout, maxTimeout] ms
+   * and doubled on each retransmission. Once a command set has RTT samples
+   * the estimate overrides the timeout passed to send(), shorter or longer;
+   * raise minTimeout to keep a floor. A command set without RTT samples
+   * keeps the caller's timeout. minTimeout is never below POLL_TICK.
+   *
+   * @note round trips are measured whether or not this is enabled
+   */
+  void setAdaptiveTimeout(bool enable, uint16_t minTimeout = POLL_TICK, uint16_t maxTimeout = 2000);
+  bool getAdaptiveTimeout() const;
+  RttEstimate getRttEstimate(CMD_SET cmdSet) const;
+  void resetRttEstimate();
+
+  /**
+   * Collect outgoing frames in a transmit buffer and write them with one
+   * HardDriver::send() call. The buffer is written out when the next frame
+   * does not fit, at the end of sendPoll() and readPoll(), when the oldest
+   * frame has waited deadlineUs, and on flush().
+   *
+   * The deadline is checked when frames are sent and by flushIfDue(); a
+   * thread that sleeps until then is woken through setTxPendingCallback().
+   * LinkThreads does both.
+   *
+   * @note call flush() after a frame that must leave at once
+   */
+  void setWriteCombining(bool enable, uint32_t deadlineUs = 300);
+  bool getWriteCombining() const;
+  void flush();
+  //! @note flushes if the deadline passed, returns when it expires (monotonic
+  //! microseconds) while frames are waiting, else 0
+  uint64_t flushIfDue();
+  //! @note called with the memory lock held when a frame enters an empty buffer
+  void setTxPendingCallback(CallBackHandler callback) { txPendingCallback = callback; }
+  TxStats getTxStats() const;
+  void resetTxStats();
 
   /**
    * Parse SDK version returned from drone, and populate the API versionData member
@@ -419,6 +490,8 @@ class CoreAPI
 
   /**Get broadcasted data values from flight controller.*/
   BroadcastData getBroadcastData() const;
+  //! @note cheap alternative to getBroadcastData().pos.health
+  uint8_t getPositionHealth() const;
 
   bool nonBlockingCBThreadEnable;
 
@@ -461,6 +534,19 @@ class CoreAPI
 
   void setBroadcastCallback(CallBack handler, UserData userData = 0);
   void setFromMobileCallback(CallBack handler, UserData userData = 0);
+  CallBackHandler getFromMobileCallback() const { return fromMobileCallback; }
+  CallBackHandler getBroadcastCallback() const { return broadcastCallback; }
+
+  //! @note attitude and velocity of the latest broadcast, see KinematicsCache
+  KinematicsCache *getKinematics() { return &kinematics; }
+
+  //! @note evaluated on every broadcast frame, see TriggerRegistry
+  void setTriggerRegistry(TriggerRegistry *registry) { triggers = registry; }
+  TriggerRegistry *getTriggerRegistry() const { return triggers; }
+
+  //! @note mission pushes are decoded into it, see MissionEventQueue
+  void setMissionEventQueue(MissionEventQueue *queue) { missionEvents = queue; }
+  MissionEventQueue *getMissionEventQueue() const { return missionEvents; }
 
   void setMisssionCallback(CallBackHandler callback) { missionCallback = callback; }
   void setHotPointCallback(CallBackHandler callback) { hotPointCallback = callback; }
@@ -474,6 +560,29 @@ class CoreAPI
   void setFollowCallback(CallBack handler, UserData userData = 0);
   void setWayPointEventCallback(CallBack handler, UserData userData = 0);
 
+  /**
+   * Received request frames are dispatched through a table indexed by
+   * command set and command id. CoreAPI fills the SET_BROADCAST entries with
+   * its own handlers, which call the callbacks above. setFrameCallback()
+   * replaces one entry, getFrameCallback() returns the current one for
+   * chaining and resetFrameCallback() puts the default back.
+   *
+   * The user receive callback still sees every request frame afterwards.
+   *
+   * @note callbacks run on the read thread
+   * @note returns false if cmdSet >= DISPATCH_SET_NUM or cmdId >= DISPATCH_CODE_NUM
+   */
+  bool setFrameCallback(uint8_t cmdSet, uint8_t cmdId, FrameCallBack handler, UserData userData = 0);
+  FrameCallBackHandler getFrameCallback(uint8_t cmdSet, uint8_t cmdId) const;
+  void resetFrameCallback(uint8_t cmdSet, uint8_t cmdId);
+
+  //! @note default SET_BROADCAST handlers
+  static void broadcastFrame(CoreAPI *api, const FrameView *frame, UserData userData = 0);
+  static void fromMobileFrame(CoreAPI *api, const FrameView *frame, UserData userData = 0);
+  static void lostControlFrame(CoreAPI *api, const FrameView *frame, UserData userData = 0);
+  static void missionFrame(CoreAPI *api, const FrameView *frame, UserData userData = 0);
+  static void wayPointEventFrame(CoreAPI *api, const FrameView *frame, UserData userData = 0);
+
 
   static void activateCallback(CoreAPI *api, Header *protocolHeader, UserData userData = 0);
   static void getDroneVersionCallback(CoreAPI *api, Header *protocolHeader, UserData userData = 0);
@@ -640,7 +749,6 @@ class CoreAPI
   BroadcastData broadcastData;
   uint32_t ackFrameStatus;
   bool broadcastFrameStatus;
-  unsigned char encodeSendData[BUFFER_SIZE];
   unsigned char encodeACK[ACK_SIZE];
 
   //! Mobile Data Transparent Transmission - callbacks
@@ -652,6 +760,7 @@ class CoreAPI
   CallBackHandler followCallback;
   CallBackHandler missionCallback;
   CallBackHandler recvCallback;
+  FrameCallBackHandler dispatch[DISPATCH_SET_NUM][DISPATCH_CODE_NUM];
 
   CallBackHandler obtainControlMobileCallback;
   CallBackHandler releaseControlMobileCallback;
@@ -702,9 +811,76 @@ class CoreAPI
 
   //! Versioning and activation
   VersionData versionData;
+  FirmwareBehaviour firmware;
   ActivateData accountData;
 
-  unsigned short seq_num;
+  //! @note claimed with LockPolicy::nextSequence()
+  uint16_t seq_num;
+  uint8_t encryption;
+
+  //! ACK handed from the read thread to the callback (or callback thread)
+  CallBack ackCallback;
+  UserData ackUserData;
+  //! @note userData of the handler being run, under lockMemory, see cancelSessions()
+  UserData ackRunning;
+  Header *ackHeader;
+  TriggerRegistry *triggers;
+  MissionEventQueue *missionEvents;
+  KinematicsCache kinematics;
+
+  //! ACK round trip estimates, guarded by lockMemory
+  bool adaptiveTimeout;
+  uint16_t minTimeout;
+  uint16_t maxTimeout;
+  RttEstimate rtt[RTT_SET_NUM];
+  uint16_t sessionTimeout(uint8_t cmdSet, uint16_t timeout) const;
+  void sampleRtt(CMDSession *session, time_ms now);
+
+  //! Write-combining transmit buffer, guarded by lockMemory
+  enum TxFlush
+  {
+    TX_FLUSH_FULL,
+    TX_FLUSH_TICK,
+    TX_FLUSH_DEADLINE,
+    TX_FLUSH_EXPLICIT
+  };
+  bool txCombine;
+  uint32_t txDeadlineUs;
+  uint8_t txBuffer[TX_COMBINE_SIZE];
+  size_t txLength;
+  uint32_t txFrames;
+  uint64_t txOldest;
+  uint64_t txAppendSum;
+  TxStats txStats;
+  CallBackHandler txPendingCallback;
+  uint64_t txNow() const;
+  void writeData(const uint8_t *buf, size_t len);
+  void flushTx(TxFlush reason);
+
+  //! Multi-producer single-consumer queue of frames to the transport. Any
+  //! sender may append; they are sent by the holder of lockMemory, which the
+  //! sender holding bit 0 of txDrain takes on behalf of the others.
+#if TX_QUEUE_NUM > 0
+  struct TxSlot
+  {
+    //! @note n + 1 once the frame of turn n is in, n + TX_QUEUE_NUM once sent
+    uint32_t turn;
+    unsigned char frame[BUFFER_SIZE];
+  };
+  TxSlot txQueue[TX_QUEUE_NUM];
+  uint32_t txHead;
+  uint32_t txTail;
+  uint32_t txDrain;
+  bool queueTx(const unsigned char *frame, uint16_t length);
+  bool txReady() const;
+#endif
+  void handOff(const unsigned char *frame, uint16_t length);
+  void sendQueued();
+  void drainTx();
+
+  //! Flight status history of the homepoint altitude state machine
+  int homepointPrevState;
+  int homepointCurrState;
 
   SDKFilter filter;
 
@@ -720,16 +896,23 @@ class CoreAPI
   void setup(void);
   void setupMMU(void);
   void setupSession(void);
+  void setupDispatch(void);
+  //! @note decode a mission push into missionEvents
+  void queueMissionEvent(const FrameView *frame);
+  void resolveFirmwareBehaviour(void);
 
   MMU_Tab *allocMemory(unsigned short size);
 
   void freeSession(CMDSession *session);
-  CMDSession *allocSession(unsigned short session_id, unsigned short size);
+  CMDSession *claimSession(unsigned short session_id);
+  void releaseSession(CMDSession *session);
 
   void freeACK(ACKSession *session);
   ACKSession *allocACK(unsigned short session_id, unsigned short size);
   MMU_Tab MMU[MMU_TABLE_NUM];
   CMDSession CMDSessionTab[SESSION_TABLE_NUM];
+  //! @note bit n: CMDSessionTab[n] is claimed by a sender, see claimSession()
+  uint32_t sessionClaim;
   ACKSession ACKSessionTab[SESSION_TABLE_NUM - 1];
   unsigned char memory[MEMORY_SIZE];
   unsigned short encrypt(unsigned char *pdest, const unsigned char *psrc,
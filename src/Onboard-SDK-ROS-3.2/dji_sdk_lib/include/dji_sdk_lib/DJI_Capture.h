@@ -0,0 +1,193 @@
+/** @file DJI_Capture.h
+ *  @version 3.1.9
+ *  @date November 10, 2016
+ *
+ *  @brief
+ *  Camera shots timed to predicted crossings of trigger positions
+ *
+ *  @copyright 2016 DJI. All rights reserved.
+ *
+ */
+
+#ifndef DJI_CAPTURE_H
+#define DJI_CAPTURE_H
+
+#include "DJI_Camera.h"
+#include "DJI_Thread.h"
+
+#ifdef __linux__
+
+namespace DJI
+{
+namespace onboardSDK
+{
+
+#define CAPTURE_POINT_MAX 256
+//! @note shots kept in the log, older ones are overwritten
+#define CAPTURE_LOG_SIZE 256
+
+enum CaptureMode
+{
+  CAPTURE_IDLE = 0,
+  //! @note shoot when passing each point of setPoints()
+  CAPTURE_POINTS,
+  //! @note shoot every setInterval() meters
+  CAPTURE_DISTANCE
+};
+
+typedef struct CapturePoint
+{
+  //! @note radians like PositionData
+  float64_t latitude;
+  float64_t longitude;
+} CapturePoint;
+
+typedef struct CaptureRecord
+{
+  //! @note point index, or shot number in CAPTURE_DISTANCE
+  uint32_t index;
+  //! @note instant the shot was scheduled for and setCamera() was called
+  time_us predictedUs;
+  time_us firedUs;
+  //! @note the point, or the predicted shot position in CAPTURE_DISTANCE
+  CapturePoint target;
+  //! @note position at firedUs plus the shutter latency, from the broadcasts
+  //! around it, valid once resolved
+  CapturePoint actual;
+  bool resolved;
+  //! @note meters from target to actual; targets of CAPTURE_DISTANCE are one
+  //! interval apart, so this is the spacing error there too
+  float64_t error;
+} CaptureRecord;
+
+typedef struct CaptureStats
+{
+  uint32_t shots;
+  //! @note points passed farther than the tolerance
+  uint32_t missed;
+  uint32_t resolved;
+  float64_t meanError;
+  float64_t rmsError;
+  float64_t maxError;
+  //! @note firedUs - predictedUs
+  float64_t meanLateUs;
+  int64_t maxLateUs;
+} CaptureStats;
+
+//! CaptureScheduler takes pictures where they are planned, not when a loop polls.
+/*!\remark
+ *  Every broadcast carrying the position is stored with the time it arrived.
+ *  On each tick the scheduler moves the last position along the broadcast
+ *  velocity to now and predicts when the next trigger is crossed. If that is
+ *  before the next tick, it sleeps until that instant on the monotonic clock
+ *  and calls Camera::setCamera(CODE_CAMERA_SHOT). Shots are therefore spaced
+ *  by the prediction, not by the tick period:
+ *
+ *   CaptureScheduler capture(&camera);
+ *   capture.setLatency(40);
+ *   capture.setInterval(20);
+ *   capture.start(50);
+ *
+ *  In CAPTURE_POINTS mode a point is crossed at the closest approach along
+ *  the current velocity. It is shot if the aircraft passes within
+ *  setTolerance(), counted as missed otherwise, and the scheduler moves on to
+ *  the next point. In CAPTURE_DISTANCE mode the distance is counted from the
+ *  predicted position of the previous shot, so errors do not add up; the
+ *  first shot is one interval after setInterval().
+ *
+ *  Each shot is logged with the predicted and the actual position, which is
+ *  interpolated from the broadcasts around the shot. getLog() and getStats()
+ *  give the spacing error.
+ *
+ *  @note the scheduler chains itself into the broadcast callback of CoreAPI,
+ *  set other broadcast callbacks before it
+ */
+class CaptureScheduler : public PeriodicThread
+{
+  public:
+  CaptureScheduler(Camera *CameraAPI = 0);
+  ~CaptureScheduler();
+
+  //! @note false if there are more than CAPTURE_POINT_MAX points
+  bool setPoints(const CapturePoint *points, size_t count);
+  //! @note meters, counted from the current position
+  void setInterval(float64_t meters);
+  void clear();
+
+  CaptureMode getMode() const;
+  //! @note next point to shoot, or shots taken in CAPTURE_DISTANCE
+  uint32_t getNextIndex() const;
+
+  //! @note copies up to max records out, oldest first
+  size_t getLog(CaptureRecord *out, size_t max) const;
+  CaptureStats getStats() const;
+  void resetStats();
+
+  public: //! @note Access method
+  Camera *getCamera() const;
+  void setCamera(Camera *value);
+
+  //! @note meters a point may be missed by and still be shot
+  void setTolerance(float64_t value);
+  float64_t getTolerance() const;
+  //! @note time from setCamera() to the exposure in ms, shots are sent that early
+  void setLatency(uint32_t ms);
+  uint32_t getLatency() const;
+
+  static void broadcastCallback(CoreAPI *api, Header *protocolHeader, UserData capture);
+
+  protected:
+  void tick(time_us now);
+
+  private:
+  typedef struct Sample
+  {
+    time_us time;
+    float64_t latitude;
+    float64_t longitude;
+    float64_t north;
+    float64_t east;
+  } Sample;
+
+  void hook(CoreAPI *value);
+  void record(const Sample &sample);
+  void resolve(CaptureRecord *shot);
+  void logShot(const CaptureRecord &shot);
+  static void positionAt(const Sample &sample, time_us time, CapturePoint *out);
+  static void offset(const CapturePoint &from, const CapturePoint &to, float64_t *north,
+      float64_t *east);
+
+  Camera *camera;
+  CoreAPI *api;
+  CallBackHandler previous;
+
+  mutable pthread_mutex_t lock;
+  CaptureMode mode;
+  CapturePoint point[CAPTURE_POINT_MAX];
+  uint32_t pointCount;
+  uint32_t next;
+  float64_t interval;
+  CapturePoint anchor;
+  //! @note distance mode waits for the first position to anchor at
+  bool anchored;
+  float64_t tolerance;
+  time_us latency;
+
+  //! @note two latest broadcasts carrying the position
+  Sample last;
+  Sample before;
+  uint32_t samples;
+
+  CaptureRecord log[CAPTURE_LOG_SIZE];
+  uint32_t logCount;
+  CaptureStats stats;
+  float64_t errorSum;
+  float64_t errorSquareSum;
+  float64_t lateSum;
+};
+
+} // namespace onboardSDK
+} // namespace DJI
+
+#endif // __linux__
+#endif // DJI_CAPTURE_H
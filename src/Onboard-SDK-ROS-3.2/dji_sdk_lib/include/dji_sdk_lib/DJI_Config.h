@@ -13,9 +13,39 @@
 #define DJI_CONFIG_H
 
 #include <stdint.h>
+//! @note sizes may be overridden from the build, eg. -DMEMORY_SIZE=4096
+#ifndef MEMORY_SIZE
 #define MEMORY_SIZE 1024 // unit is byte
+#endif
+#ifndef BUFFER_SIZE
 #define BUFFER_SIZE 1024
+#endif
+#ifndef ACK_SIZE
 #define ACK_SIZE 10
+#endif
+//! @note write-combining transmit buffer, see CoreAPI::setWriteCombining()
+#ifndef TX_COMBINE_SIZE
+#define TX_COMBINE_SIZE 256
+#endif
+//! @note frames handed from the senders to the transport, a power of two,
+//! see CoreAPI::sendInterface(). 0 writes each frame under lockMemory
+#ifndef TX_QUEUE_NUM
+#if defined(API_SINGLE_THREAD) || !defined(__linux__)
+#define TX_QUEUE_NUM 0
+#else
+#define TX_QUEUE_NUM 8
+#endif
+#endif
+#if TX_QUEUE_NUM & (TX_QUEUE_NUM - 1)
+#error "TX_QUEUE_NUM must be a power of two"
+#endif
+//! @note receive dispatch table, see CoreAPI::setFrameCallback()
+#ifndef DISPATCH_SET_NUM
+#define DISPATCH_SET_NUM 8
+#endif
+#ifndef DISPATCH_CODE_NUM
+#define DISPATCH_CODE_NUM 64
+#endif
 
 //! @note The static memory flag means DJI onboardSDK library will not alloc
 //! memory from heap.
@@ -36,6 +66,16 @@
 //! @note if you do NOT want to use AES encrypt, comment this macro below
 //#define USE_ENCRYPT
 
+//! @note if readPoll, sendPoll and all callbacks run on one thread, this
+//! macro compiles the memory and message locks out. See DJI_Policy.h
+//! The helpers that send from their own thread (CommandStreamer,
+//! FollowStreamer, MobileTransfer) can not be used in such a build.
+//#define API_SINGLE_THREAD
+
+//! @note this macro compiles the AES codec out, encrypted frames are
+//! refused in both directions. Do not combine with USE_ENCRYPT
+//#define API_NO_CRYPTO
+
 //! @todo Not supported in this release.
 //#define USE_SIMULATION
 
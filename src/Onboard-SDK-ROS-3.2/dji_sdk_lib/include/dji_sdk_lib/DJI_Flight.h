@@ -150,6 +150,7 @@ class Flight
 
   QuaternionData getQuaternion() const;
 
+  //! @note angles are derived once per broadcast sample, see CoreAPI::getKinematics()
   EulerAngle getEulerAngle() const;
 
   PositionData getPosition() const;
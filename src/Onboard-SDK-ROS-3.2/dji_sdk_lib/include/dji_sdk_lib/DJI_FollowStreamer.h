@@ -0,0 +1,129 @@
+/** @file DJI_FollowStreamer.h
+ *  @version 3.1.9
+ *  @date November 10, 2016
+ *
+ *  @brief
+ *  Fixed-rate Follow target streaming with motion extrapolation
+ *
+ *  @copyright 2016 DJI. All rights reserved.
+ *
+ */
+
+#ifndef DJI_FOLLOWSTREAMER_H
+#define DJI_FOLLOWSTREAMER_H
+
+#include "DJI_Follow.h"
+#include "DJI_Thread.h"
+
+#ifdef __linux__
+
+namespace DJI
+{
+namespace onboardSDK
+{
+
+//! @note number of fixes kept for the velocity estimate
+#define FOLLOW_HISTORY_SIZE 16
+
+//! Prediction error of FollowStreamer, in meters. Each new fix is compared
+//! with the position the streamer extrapolated for its timestamp.
+typedef struct PredictionStats
+{
+  uint64_t fixes;
+  uint64_t samples;
+  uint64_t sent;
+  float64_t lastError;
+  float64_t meanError;
+  float64_t rmsError;
+  float64_t maxError;
+} PredictionStats;
+
+//! FollowStreamer sends extrapolated Follow targets at a fixed rate.
+/*!\remark
+ *  Target sources (vision, a second GPS, a ground station link) deliver fixes
+ *  late and irregularly. Feed every fix with the time it was measured:
+ *
+ *   Follow follow(&api);
+ *   follow.start(&data, 1);
+ *   FollowStreamer streamer(&follow);
+ *   streamer.start(20);
+ *   ...
+ *   streamer.addFix(target, monotonicTimeUs() - sourceLatency);
+ *
+ *  The target velocity is a least squares fit over the last fixes (bounded
+ *  history, nothing allocated per update). On every tick the streamer sends
+ *  the last fix moved along that velocity to the current time, at most
+ *  setMaxExtrapolation() past the last fix, and holds the position after that.
+ *
+ *  @note timestamps are monotonicTimeUs() microseconds
+ *  @note the streamer calls Follow::updateTarget() from its own thread, do not
+ *  call it elsewhere while the streamer runs
+ */
+class FollowStreamer : public PeriodicThread
+{
+  public:
+  FollowStreamer(Follow *FollowAPI = 0);
+  ~FollowStreamer();
+
+  void addFix(const FollowTarget &target, time_us timestamp);
+  void addFix(float64_t latitude, float64_t longitude, uint16_t height, uint16_t angle,
+      time_us timestamp);
+  //! @note drop the history, nothing is sent until the next fix
+  void reset();
+
+  //! @note number of fixes used for the velocity fit, 2 to FOLLOW_HISTORY_SIZE
+  void setHistory(uint8_t value);
+  void setMaxExtrapolation(uint32_t ms);
+
+  //! @note predicted target at a given time, false without any fix
+  bool predict(time_us timestamp, FollowTarget *target) const;
+  //! @note estimated target velocity in m/s, north/east
+  void getVelocity(float64_t *north, float64_t *east) const;
+
+  PredictionStats getPredictionStats() const;
+  void resetPredictionStats();
+
+  public: //! @note Access method
+  Follow *getFollow() const;
+  void setFollow(Follow *value);
+
+  protected:
+  void tick(time_us now);
+
+  private:
+  typedef struct Fix
+  {
+    time_us time;
+    float64_t latitude;
+    float64_t longitude;
+    float64_t height;
+    uint16_t angle;
+  } Fix;
+
+  void fit();
+  bool extrapolate(time_us timestamp, FollowTarget *target) const;
+
+  Follow *follow;
+
+  mutable pthread_mutex_t lock;
+  Fix history[FOLLOW_HISTORY_SIZE];
+  uint8_t head;
+  uint8_t count;
+  uint8_t window;
+  time_us maxExtrapolation;
+
+  //! @note fit result, per second, anchored at the last fix
+  float64_t latRate;
+  float64_t lonRate;
+  float64_t heightRate;
+
+  PredictionStats stats;
+  float64_t errorSum;
+  float64_t errorSquareSum;
+};
+
+} // namespace onboardSDK
+} // namespace DJI
+
+#endif // __linux__
+#endif // DJI_FOLLOWSTREAMER_H
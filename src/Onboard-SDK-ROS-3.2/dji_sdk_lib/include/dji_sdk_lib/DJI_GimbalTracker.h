@@ -0,0 +1,161 @@
+/** @file DJI_GimbalTracker.h
+ *  @version 3.1.9
+ *  @date November 10, 2016
+ *
+ *  @brief
+ *  Closed-loop gimbal speed control keeping a detected target in frame
+ *
+ *  @copyright 2016 DJI. All rights reserved.
+ *
+ */
+
+#ifndef DJI_GIMBALTRACKER_H
+#define DJI_GIMBALTRACKER_H
+
+#include "DJI_Camera.h"
+#include "DJI_Thread.h"
+
+#ifdef __linux__
+
+namespace DJI
+{
+namespace onboardSDK
+{
+
+//! @note broadcast gimbal samples kept to look up the angle at capture time
+#define GIMBAL_HISTORY_SIZE 64
+//! @note GimbalSpeedData is in 0.1 deg/s and accepts at most 180 deg/s
+#define GIMBAL_SPEED_MAX 1800
+
+typedef struct TrackingStats
+{
+  uint64_t detections;
+  uint64_t commands;
+  //! @note angle between the target and the image centre at detection, degrees
+  float64_t lastError;
+  float64_t meanError;
+  float64_t rmsError;
+  float64_t maxError;
+  //! @note from frame capture to the first speed command using the detection
+  float64_t meanLatencyUs;
+  int64_t maxLatencyUs;
+  //! @note commands held back because the gimbal reported a limit
+  uint64_t limitHits;
+} TrackingStats;
+
+//! GimbalTracker turns vision detections into gimbal speed commands.
+/*!\remark
+ *  A detection says where the target was in the image when the frame was
+ *  captured. By the time it is processed the gimbal has moved, so the
+ *  tracker keeps the broadcast gimbal angles of the last samples, adds the
+ *  offset to the angle the gimbal had at capture time and tracks that
+ *  absolute direction. Successive detections give the target's angular
+ *  rate, which is fed forward and used to extrapolate between frames.
+ *
+ *   GimbalTracker tracker(&camera);
+ *   tracker.setGain(2.0);
+ *   tracker.start(30);
+ *   ...
+ *   //! in the detection callback, with the capture time of the image
+ *   tracker.addOffset(yawDeg, pitchDeg, captured);
+ *
+ *  On every tick the command is gain x error plus the target rate, clamped
+ *  to setMaxRate(). An axis whose limit flag is set in the broadcast only
+ *  moves back towards its centre. Without a detection for setTimeout() the
+ *  gimbal is stopped once and the tracker waits.
+ *
+ *  @note angles are degrees, yaw positive to the right, pitch positive up
+ *  @note the tracker chains itself into the broadcast callback of CoreAPI,
+ *  set other broadcast callbacks before it
+ */
+class GimbalTracker : public PeriodicThread
+{
+  public:
+  GimbalTracker(Camera *CameraAPI = 0);
+  ~GimbalTracker();
+
+  //! @note target offset from the image centre, captured in monotonicTimeUs()
+  void addOffset(float64_t yaw, float64_t pitch, time_us captured);
+  //! @note target relative to the camera in meters, forward, right and down
+  void addPosition(float64_t forward, float64_t right, float64_t down, time_us captured);
+  //! @note forget the target and stop the gimbal on the next tick
+  void reset();
+
+  bool isTracking() const;
+  //! @note gimbal angle at a given time from the broadcast history
+  bool getGimbalAt(time_us time, float64_t *yaw, float64_t *pitch) const;
+
+  TrackingStats getStats() const;
+  void resetStats();
+
+  public: //! @note Access method
+  Camera *getCamera() const;
+  void setCamera(Camera *value);
+
+  //! @note 1/s, degrees per second commanded per degree of error
+  void setGain(float64_t value);
+  float64_t getGain() const;
+  //! @note deg/s
+  void setMaxRate(float64_t value);
+  float64_t getMaxRate() const;
+  //! @note ms without a detection before the gimbal is stopped
+  void setTimeout(uint32_t ms);
+  uint32_t getTimeout() const;
+
+  static void broadcastCallback(CoreAPI *api, Header *protocolHeader, UserData tracker);
+
+  protected:
+  void tick(time_us now);
+
+  private:
+  typedef struct Sample
+  {
+    time_us time;
+    float64_t yaw;
+    float64_t pitch;
+  } Sample;
+
+  void hook(CoreAPI *value);
+  void record(const GimbalData &data, float64_t aircraftYaw);
+  bool gimbalAt(time_us time, float64_t *yaw, float64_t *pitch) const;
+  static float64_t wrap(float64_t angle);
+  static int16_t toSpeed(float64_t rate);
+
+  Camera *camera;
+  CoreAPI *api;
+  CallBackHandler previous;
+
+  mutable pthread_mutex_t lock;
+  Sample history[GIMBAL_HISTORY_SIZE];
+  uint32_t historyCount;
+  bool yawLimit;
+  bool pitchLimit;
+  //! @note gimbal yaw relative to the aircraft, tells which limit is hit
+  float64_t relativeYaw;
+
+  //! @note absolute target direction at targetTime
+  bool hasTarget;
+  bool tracking;
+  bool fresh;
+  float64_t targetYaw;
+  float64_t targetPitch;
+  float64_t yawRate;
+  float64_t pitchRate;
+  time_us targetTime;
+
+  float64_t gain;
+  float64_t maxRate;
+  time_us timeout;
+
+  TrackingStats stats;
+  float64_t errorSum;
+  float64_t errorSquareSum;
+  float64_t latencySum;
+  uint64_t latencyCount;
+};
+
+} // namespace onboardSDK
+} // namespace DJI
+
+#endif // __linux__
+#endif // DJI_GIMBALTRACKER_H
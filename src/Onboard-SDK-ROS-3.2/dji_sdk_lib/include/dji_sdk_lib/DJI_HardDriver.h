@@ -58,6 +58,11 @@ class HardDriver
    *  @brief use conditional variable to signal controller thread about
    *  arrival of ACK frame.
    *
+   *  void clearACK();
+   *  @brief forget a notify() nobody waited for. Called with lockACK() held
+   *  when a blocking command is issued, so a late ACK of an earlier command
+   *  does not end its wait().
+   *
    *  void displayLog(char *buf);
    *  @brief Micro "API_LOG" invoked this function, to pass datalog.
    *  In order to pass data through different stream or channel.
@@ -97,6 +102,7 @@ class HardDriver
 
   virtual void notify() = 0;
   virtual void wait(int timeout) = 0;
+  virtual void clearACK() {;}
 
   virtual void lockProtocolHeader() {;}
   virtual void freeProtocolHeader() {;}
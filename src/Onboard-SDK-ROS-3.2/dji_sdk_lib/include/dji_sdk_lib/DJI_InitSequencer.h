@@ -0,0 +1,157 @@
+/** @file DJI_InitSequencer.h
+ *  @version 3.1.9
+ *  @date November 10, 2016
+ *
+ *  @brief
+ *  Overlapped start-up handshake with cached version data
+ *
+ *  @copyright 2016 DJI. All rights reserved.
+ *
+ */
+
+#ifndef DJI_INITSEQUENCER_H
+#define DJI_INITSEQUENCER_H
+
+#include "DJI_API.h"
+#include "DJI_Thread.h"
+
+#ifdef __linux__
+
+namespace DJI
+{
+namespace onboardSDK
+{
+
+//! @note flight controllers remembered in the cache file
+#define INIT_CACHE_SIZE 4
+
+enum InitPhaseId
+{
+  INIT_VERSION = 0,
+  INIT_ACTIVATE,
+  INIT_FREQUENCY,
+  INIT_CONTROL,
+  INIT_PHASE_NUM
+};
+
+//! One step of the start-up. Times are microseconds since run() started.
+typedef struct InitPhase
+{
+  bool started;
+  bool done;
+  bool ok;
+  //! @note sends issued by the sequencer, protocol retries not included
+  uint8_t attempts;
+  uint16_t ack;
+  time_us startUs;
+  time_us endUs;
+} InitPhase;
+
+typedef struct InitReport
+{
+  bool ok;
+  //! @note started from cached version data
+  bool cacheHit;
+  //! @note the version ACK matched the cached data
+  bool cacheValid;
+  //! @note activation result cached for this flight controller, 0xFFFF if none
+  uint16_t cachedActivation;
+  time_us totalUs;
+  InitPhase phase[INIT_PHASE_NUM];
+} InitReport;
+
+//! InitSequencer brings the link up with as few serial round trips as possible.
+/*!\remark
+ *  The usual start-up is four blocking calls in a row: getDroneVersion(),
+ *  activate(), setBroadcastFreq() and setControl(). The sequencer issues them
+ *  as soon as what they depend on is known:
+ *
+ *   version ---+--> activate --> control
+ *              +--> broadcast frequency
+ *
+ *  With setCacheFile() the version data of the last flight controllers is
+ *  kept on disk, keyed by serial number. A warm start applies the most
+ *  recent entry and sends the version query, the activation and the
+ *  frequency setup at once. If the version ACK shows another flight
+ *  controller or firmware, activation and frequency are sent again with the
+ *  real data.
+ *
+ *   InitSequencer init(&api);
+ *   init.setActivateData(user);
+ *   init.setCacheFile("/var/tmp/dji_init.cache");
+ *   init.run(5000);
+ *   InitReport report = init.getReport();
+ *
+ *  @note run() blocks, readPoll() and sendPoll() must keep running
+ *  @note the timeout of run() is in milliseconds
+ *  @note run() and the destructor cancel the sessions still waiting for an
+ *  ACK, see CoreAPI::cancelSessions(); a late ACK is dropped
+ */
+class InitSequencer
+{
+  public:
+  InitSequencer(CoreAPI *ControlAPI = 0);
+  ~InitSequencer();
+
+  void setActivateData(const ActivateData &data);
+  //! @note 16 frequencies, 0 uses CoreAPI::getBroadcastFreqDefaults()
+  void setBroadcastFreq(const uint8_t *freq);
+  void setObtainControl(bool value);
+  //! @note 0 disables the cache
+  void setCacheFile(const char *path);
+
+  bool run(int timeout);
+  InitReport getReport() const;
+
+  public: //! @note Access method
+  CoreAPI *getApi() const;
+  void setApi(CoreAPI *value);
+
+  static void versionCallback(CoreAPI *api, Header *protocolHeader, UserData sequencer);
+  static void activateCallback(CoreAPI *api, Header *protocolHeader, UserData sequencer);
+  static void frequencyCallback(CoreAPI *api, Header *protocolHeader, UserData sequencer);
+  static void controlCallback(CoreAPI *api, Header *protocolHeader, UserData sequencer);
+
+  private:
+  typedef struct CacheEntry
+  {
+    VersionData version;
+    uint16_t activation;
+  } CacheEntry;
+
+  void begin(InitPhaseId id);
+  void end(InitPhaseId id, uint16_t ack, bool ok);
+  void skip(InitPhaseId id);
+  bool finished() const;
+  void sendActivate();
+  void sendFrequency();
+  void sendControl();
+  static uint16_t ackOf(Header *protocolHeader);
+
+  bool loadCache();
+  void saveCache();
+
+  CoreAPI *api;
+  ActivateData activateData;
+  uint8_t freq[16];
+  bool defaultFreq;
+  bool obtainControl;
+  char cacheFile[128];
+
+  mutable pthread_mutex_t lock;
+  pthread_cond_t cond;
+  InitReport report;
+  time_us start;
+  //! @note a warm start guessed wrong, resend on the stale ACK
+  bool redoActivate;
+  bool redoFrequency;
+
+  CacheEntry cache[INIT_CACHE_SIZE];
+  uint8_t cacheCount;
+};
+
+} // namespace onboardSDK
+} // namespace DJI
+
+#endif // __linux__
+#endif // DJI_INITSEQUENCER_H
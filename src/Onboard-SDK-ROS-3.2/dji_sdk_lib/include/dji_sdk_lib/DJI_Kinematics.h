@@ -0,0 +1,116 @@
+/** @file DJI_Kinematics.h
+ *  @version 3.1.9
+ *  @date November 10, 2016
+ *
+ *  @brief
+ *  Attitude and velocity derived once per broadcast sample
+ *
+ *  @copyright 2016 DJI. All rights reserved.
+ *
+ */
+
+#ifndef DJI_KINEMATICS_H
+#define DJI_KINEMATICS_H
+
+#include "DJI_Type.h"
+#include "DJI_Policy.h"
+
+namespace DJI
+{
+namespace onboardSDK
+{
+
+//! @note reads of a sample being derived by another thread before deriving it again
+#define KINEMATICS_SPIN 64
+
+typedef struct KinematicsData
+{
+  //! @note broadcast sample the values come from, 0 before the first one
+  uint32_t generation;
+  //! @note flight controller time of the sample, 1/400 s
+  uint32_t timeStamp;
+  QuaternionData q;
+  EulerAngle euler;
+  //! @note body to ground (NED) rotation, row major
+  float64_t rotation[3][3];
+  //! @note forward, right, down in m/s
+  Vector3dData bodyVelocity;
+  //! @note horizontal speed in m/s and its course in rad from north
+  float64_t groundSpeed;
+  Angle heading;
+} KinematicsData;
+
+//! KinematicsCache keeps what is derived from the attitude and velocity broadcast.
+/*!\remark
+ *  CoreAPI::broadcast() publishes the quaternion and velocity of every frame
+ *  carrying either of them. The first reader after that computes the Euler
+ *  angles, rotation matrix, body velocity and ground track and stores them;
+ *  later readers of the same sample copy the result. Nothing is computed
+ *  when nobody reads.
+ *
+ *  With API_LOCK_FREE, sample and results are each behind a sequence lock,
+ *  so readers never take a driver lock and never block the read thread.
+ *  Readers racing the one that derives a new sample wait for it for up to
+ *  KINEMATICS_SPIN reads, then derive their own copy. Other targets have no
+ *  atomics; there readers derive and copy under the driver's lockMSG(),
+ *  which CoreAPI::broadcast() already holds while it publishes.
+ *
+ *   KinematicsCache *k = api->getKinematics();
+ *   EulerAngle e = k->getEulerAngle();
+ *   KinematicsData all = k->get();
+ *
+ *  @note publish() has a single caller, the read thread
+ *  @note CoreAPI sets the driver through setDriver() along with its own
+ */
+class KinematicsCache
+{
+  public:
+  KinematicsCache();
+
+  void setDriver(HardDriver *value);
+  void publish(const QuaternionData &q, const VelocityData &v, uint32_t timeStamp);
+
+  KinematicsData get();
+  EulerAngle getEulerAngle();
+  float64_t getGroundSpeed();
+  Angle getHeading();
+
+  //! @note samples published so far
+  uint32_t getGeneration() const;
+  //! @note samples derived so far, by the cache or by readers that gave up waiting
+  uint32_t getDeriveCount() const;
+
+  static void derive(KinematicsData *out, const QuaternionData &q, const VelocityData &v);
+
+  private:
+  typedef struct Sample
+  {
+    uint32_t timeStamp;
+    QuaternionData q;
+    VelocityData v;
+  } Sample;
+
+#ifdef API_LOCK_FREE
+  uint32_t readSample(Sample *out) const;
+  bool readDerived(KinematicsData *out) const;
+  void writeDerived(const KinematicsData &data);
+  void deriveSample(KinematicsData *out);
+#endif // API_LOCK_FREE
+
+  HardDriver *driver;
+
+  //! @note odd while publish() writes, sample generation is sampleSeq / 2
+  uint32_t sampleSeq;
+  Sample sample;
+  //! @note odd while a reader stores a result
+  uint32_t derivedSeq;
+  KinematicsData derived;
+  //! @note newest generation a reader took on deriving
+  uint32_t claimed;
+  uint32_t deriveCount;
+};
+
+} // namespace onboardSDK
+} // namespace DJI
+
+#endif // DJI_KINEMATICS_H
@@ -0,0 +1,119 @@
+/** @file DJI_LinuxSerialDevice.h
+ *  @version 3.1.9
+ *  @date November 10, 2016
+ *
+ *  @brief
+ *  Reference HardDriver for Linux serial ports
+ *
+ *  @copyright 2016 DJI. All rights reserved.
+ *
+ */
+
+#ifndef DJI_LINUXSERIALDEVICE_H
+#define DJI_LINUXSERIALDEVICE_H
+
+#include "DJI_HardDriver.h"
+#include "DJI_Thread.h"
+
+#ifdef __linux__
+#include <pthread.h>
+
+namespace DJI
+{
+namespace onboardSDK
+{
+
+//! LinuxSerialDevice drives the flight controller UART from Linux.
+/*!\remark
+ *  The port is opened in raw mode (8N1, no flow control, no echo, no line
+ *  processing). When the UART driver supports it ASYNC_LOW_LATENCY is set so
+ *  received bytes are pushed to user space without the tty flip buffer delay;
+ *  ptys and USB adapters without it keep working.
+ *
+ *   LinuxSerialDevice serial("/dev/ttyTHS1", 230400);
+ *   CoreAPI api(&serial);
+ *   //! init() is called by CoreAPI
+ *
+ *  readall() waits up to setReadTimeout() for the first byte and then returns
+ *  everything available in one read(). send() writes the whole frame,
+ *  waiting for the port when the kernel buffer is full.
+ *
+ *  Locks are plain pthread mutexes (futex based). Timed waits and
+ *  getTimeStamp() use CLOCK_MONOTONIC, so they are not affected by NTP or
+ *  manual clock changes.
+ *
+ *  @note wait() takes seconds like the other HardDriver implementations.
+ *  A notify() that arrives before wait() is kept, so an ACK faster than the
+ *  caller is not lost; clearACK() drops it when the next blocking command
+ *  is issued. Both go through an AckSignal.
+ */
+class LinuxSerialDevice : public HardDriver
+{
+  public:
+  LinuxSerialDevice(const char *device, unsigned int baudrate);
+  ~LinuxSerialDevice();
+
+  void init();
+  bool getDeviceStatus();
+  time_ms getTimeStamp();
+  size_t send(const uint8_t *buf, size_t len);
+  size_t readall(uint8_t *buf, size_t maxlen);
+
+  void lockMemory();
+  void freeMemory();
+
+  void lockMSG();
+  void freeMSG();
+
+  void lockACK();
+  void freeACK();
+
+  void notify();
+  void wait(int timeout);
+  void clearACK();
+
+  void lockProtocolHeader();
+  void freeProtocolHeader();
+
+  void lockNonBlockCBAck();
+  void freeNonBlockCBAck();
+
+  void notifyNonBlockCBAckRecv();
+  void nonBlockWait();
+
+  //! @note open the port again, eg. after the adapter was unplugged
+  bool reopen();
+  void close();
+
+  public: //! @note Access method
+  void setDevice(const char *device);
+  const char *getDevice() const;
+  void setBaudrate(unsigned int baudrate);
+  unsigned int getBaudrate() const;
+  //! @note time readall() waits for data, in milliseconds
+  void setReadTimeout(int ms);
+  int getReadTimeout() const;
+  bool isLowLatency() const;
+
+  private:
+  bool configure();
+
+  char device[64];
+  unsigned int baudrate;
+  int fd;
+  int readTimeout;
+  bool lowLatency;
+
+  pthread_mutex_t memLock;
+  pthread_mutex_t msgLock;
+  AckSignal ack;
+
+  pthread_mutex_t headerLock;
+  AckSignal nbAck;
+};
+
+} // namespace onboardSDK
+} // namespace DJI
+
+#endif // __linux__
+#endif // DJI_LINUXSERIALDEVICE_H
@@ -0,0 +1,175 @@
+/** @file DJI_MissionEvent.h
+ *  @version 3.1.9
+ *  @date November 10, 2016
+ *
+ *  @brief
+ *  Decoded mission status and waypoint event pushes, queued for the application
+ *
+ *  @copyright 2016 DJI. All rights reserved.
+ *
+ */
+
+#ifndef DJI_MISSIONEVENT_H
+#define DJI_MISSIONEVENT_H
+
+#include "DJI_API.h"
+
+namespace DJI
+{
+namespace onboardSDK
+{
+
+//! @note events the queue holds, power of two
+#define MISSION_EVENT_QUEUE_SIZE 64
+
+enum MissionEventType
+{
+  //! @note CODE_MISSION pushes, one per mission type
+  MISSION_EVENT_WAYPOINT_STATUS = 0,
+  MISSION_EVENT_HOTPOINT_STATUS,
+  MISSION_EVENT_FOLLOW_STATUS,
+  MISSION_EVENT_IOC_STATUS,
+  //! @note CODE_WAYPOINT pushes
+  MISSION_EVENT_WAYPOINT_UPLOADED,
+  MISSION_EVENT_WAYPOINT_FINISHED,
+  MISSION_EVENT_WAYPOINT_REACHED,
+  //! @note kept raw, see MissionEvent::raw
+  MISSION_EVENT_UNKNOWN
+};
+
+typedef struct WayPointStatusEvent
+{
+  uint8_t targetIndex;
+  uint8_t status;
+  uint8_t error;
+} WayPointStatusEvent;
+
+typedef struct HotPointStatusEvent
+{
+  uint8_t status;
+  //! @note as pushed by the flight controller
+  uint16_t radius;
+  uint8_t error;
+  uint8_t velocity;
+} HotPointStatusEvent;
+
+typedef struct FollowStatusEvent
+{
+  uint8_t status;
+  uint8_t trackingStatus;
+} FollowStatusEvent;
+
+typedef struct WayPointUploadedEvent
+{
+  uint8_t valid;
+  //! @note seconds
+  uint16_t estimatedTime;
+} WayPointUploadedEvent;
+
+typedef struct WayPointFinishedEvent
+{
+  uint8_t repeat;
+} WayPointFinishedEvent;
+
+typedef struct WayPointReachedEvent
+{
+  uint8_t index;
+  uint8_t status;
+} WayPointReachedEvent;
+
+//! @note raw bytes kept of every push
+#define MISSION_EVENT_RAW_SIZE 8
+
+typedef struct MissionEvent
+{
+  uint8_t type;
+  //! @note counts every decoded push, gaps mean the queue overflowed
+  uint32_t sequence;
+  //! @note monotonicTimeUs() the frame was decoded, HardDriver::getTimeStamp()
+  //! in us on targets without it
+  time_us hostTimeUs;
+  //! @note flight controller time of the latest broadcast before the push
+  TimeStampData fcTime;
+  union
+  {
+    WayPointStatusEvent wayPoint;
+    HotPointStatusEvent hotPoint;
+    FollowStatusEvent follow;
+    WayPointUploadedEvent uploaded;
+    WayPointFinishedEvent finished;
+    WayPointReachedEvent reached;
+  };
+  uint8_t rawLength;
+  uint8_t raw[MISSION_EVENT_RAW_SIZE];
+} MissionEvent;
+
+//! MissionEventQueue hands decoded mission pushes to the application.
+/*!\remark
+ *  CoreAPI::missionFrame() and wayPointEventFrame() decode each push into
+ *  a MissionEvent while the frame is still in the receive buffer and put it
+ *  in a single producer, single consumer ring. The read thread never waits
+ *  on the application; when the ring is full the event is counted as
+ *  dropped. With API_LOCK_FREE the ring indices are atomics, elsewhere they
+ *  are shared under the driver's lockMSG(). The callbacks set by setMisssionCallback() and friends still get
+ *  the raw Header.
+ *
+ *   MissionEventQueue events(&api);
+ *   MissionEvent batch[16];
+ *   size_t n = events.drain(batch, 16);
+ *   for (size_t i = 0; i < n; ++i)
+ *     if (batch[i].type == MISSION_EVENT_WAYPOINT_REACHED)
+ *       ...
+ *
+ *  setHistory() gives a buffer that keeps the latest drained events, e.g.
+ *  for a post-flight log. It is written by drain(), so the consumer thread
+ *  owns it and getHistory() needs no lock.
+ *
+ *  @note drain() and the history belong to one consumer thread
+ */
+class MissionEventQueue
+{
+  public:
+  MissionEventQueue(CoreAPI *ControlAPI = 0);
+  ~MissionEventQueue();
+
+  //! @note producer side, called from the read thread
+  bool push(const MissionEvent &event);
+
+  //! @note copies up to max events out, oldest first
+  size_t drain(MissionEvent *out, size_t max);
+  size_t size() const;
+  uint32_t getDropped() const;
+
+  //! @note buffer of capacity events, 0 to stop keeping history
+  void setHistory(MissionEvent *buffer, size_t capacity);
+  //! @note copies up to max history events out, oldest first
+  size_t getHistory(MissionEvent *out, size_t max) const;
+  void clearHistory();
+
+  //! @note false if the frame is not a mission push
+  static bool decode(uint8_t cmdId, const uint8_t *data, size_t length, MissionEvent *event);
+
+  public: //! @note Access method
+  CoreAPI *getApi() const;
+  void setApi(CoreAPI *value);
+
+  private:
+  CoreAPI *api;
+
+  MissionEvent ring[MISSION_EVENT_QUEUE_SIZE];
+  //! @note written by the producer
+  uint32_t head;
+  //! @note written by the consumer
+  uint32_t tail;
+  uint32_t dropped;
+
+  MissionEvent *history;
+  size_t historyCapacity;
+  size_t historyCount;
+  size_t historyNext;
+};
+
+} // namespace onboardSDK
+} // namespace DJI
+
+#endif // DJI_MISSIONEVENT_H
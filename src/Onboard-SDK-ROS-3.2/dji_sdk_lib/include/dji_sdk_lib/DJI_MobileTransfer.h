@@ -0,0 +1,193 @@
+/** @file DJI_MobileTransfer.h
+ *  @version 3.1.9
+ *  @date November 10, 2016
+ *
+ *  @brief
+ *  Fragmenting, windowed transfers over the mobile data channel
+ *
+ *  @copyright 2016 DJI. All rights reserved.
+ *
+ */
+
+#ifndef DJI_MOBILETRANSFER_H
+#define DJI_MOBILETRANSFER_H
+
+#include "DJI_API.h"
+#include "DJI_Thread.h"
+
+#ifdef __linux__
+
+namespace DJI
+{
+namespace onboardSDK
+{
+
+//! @note sendToMobile() refuses more than 100 bytes
+#define MOBILE_FRAME_SIZE 100
+#define MOBILE_FRAME_MAGIC 0xB7
+#define MOBILE_DATA_HEADER_SIZE 7
+#define MOBILE_ACK_SIZE 9
+#define MOBILE_FRAGMENT_SIZE (MOBILE_FRAME_SIZE - MOBILE_DATA_HEADER_SIZE)
+#define MOBILE_MAX_FRAGMENTS 256
+#define MOBILE_MAX_TRANSFER (MOBILE_MAX_FRAGMENTS * MOBILE_FRAGMENT_SIZE)
+//! @note the ACK bitmap covers this many fragments after the cumulative ACK
+#define MOBILE_MAX_WINDOW 32
+
+class MobileTransfer;
+
+typedef void (*MobileReceiveHandler)(MobileTransfer *transfer, const uint8_t *data, size_t len,
+    UserData userData);
+
+//! Counters of a MobileTransfer. Rates are payload bytes per second.
+typedef struct MobileTransferStats
+{
+  uint32_t transfers;
+  uint32_t completed;
+  uint32_t failed;
+  uint64_t frames;
+  uint64_t retransmits;
+  uint64_t acksSent;
+  uint64_t acksReceived;
+  uint64_t bytesSent;
+  uint64_t bytesReceived;
+  uint32_t received;
+  uint32_t duplicates;
+  //! @note last completed outgoing transfer
+  time_us lastTransferUs;
+  double lastThroughput;
+  //! @note raw channel limit: MOBILE_FRAME_SIZE bytes per tick
+  double channelLimit;
+  //! @note lastThroughput / channelLimit
+  double efficiency;
+} MobileTransferStats;
+
+//! MobileTransfer moves buffers larger than one sendToMobile() frame.
+/*!\remark
+ *  Buffers are split into fragments of MOBILE_FRAGMENT_SIZE bytes. Up to
+ *  getWindow() fragments are unacknowledged at a time, the receiver answers
+ *  with a cumulative ACK plus a bitmap of the fragments received after it,
+ *  and only missing fragments are sent again: after setRetransmitTimeout(),
+ *  or at once when a fragment sent later has already been acknowledged
+ *  three positions ahead.
+ *
+ *  The channel has no flow control of its own, so the transfer runs on a
+ *  PeriodicThread and sends one frame per tick. The tick rate is the packet
+ *  rate allowed on the channel:
+ *
+ *   MobileTransfer transfer(&api);
+ *   transfer.setReceiveCallback(onBuffer, 0);
+ *   transfer.start(10);
+ *   transfer.send(log, logLen);
+ *
+ *  The mobile app must speak the same framing. Every frame starts with
+ *  MOBILE_FRAME_MAGIC and a type byte, little endian fields:
+ *
+ *   DATA  magic, 1, id, seq(2), total(2), payload
+ *   ACK   magic, 2, id, next(2), bitmap(4)
+ *
+ *  next is the first fragment not received, bit i of bitmap is fragment
+ *  next + 1 + i. Frames without the magic byte go to the previous
+ *  from-mobile callback, or to CoreAPI::parseFromMobileCallback().
+ *
+ *  A DATA frame with the id of the transfer just finished is taken as a
+ *  retransmission and acknowledged again, unless its total differs or
+ *  nothing of that transfer was seen for two retransmit timeouts; then it
+ *  starts a new transfer, as after a sender restart.
+ *
+ *  @note one outgoing and one incoming transfer at a time
+ */
+class MobileTransfer : public PeriodicThread
+{
+  public:
+  enum FrameType
+  {
+    FRAME_DATA = 1,
+    FRAME_ACK = 2
+  };
+
+  public:
+  MobileTransfer(CoreAPI *ControlAPI = 0);
+  ~MobileTransfer();
+
+  //! @note queue a buffer, false if a transfer is running or len is too large
+  bool send(const uint8_t *data, size_t len);
+  void cancel();
+  bool isBusy() const;
+
+  //! @note fragments in flight, at most MOBILE_MAX_WINDOW
+  void setWindow(uint8_t value);
+  uint8_t getWindow() const;
+  //! @note resend an unacknowledged fragment after ms, give up after retry sends
+  void setRetransmitTimeout(uint32_t ms, uint8_t retry = 10);
+
+  void setReceiveCallback(MobileReceiveHandler handler, UserData userData = 0);
+
+  MobileTransferStats getStats() const;
+  void resetStats();
+
+  public: //! @note Access method
+  CoreAPI *getApi() const;
+  //! @note installs the from-mobile callback, keeps the previous one for other frames
+  void setApi(CoreAPI *value);
+
+  static void fromMobileCallback(CoreAPI *api, Header *protocolHeader, UserData transfer);
+
+  protected:
+  void tick(time_us now);
+
+  private:
+  void onData(const uint8_t *frame, size_t len);
+  void onAck(const uint8_t *frame, size_t len);
+  //! @note next fragment to send, -1 if none is due
+  int nextFragment(time_us now);
+  void complete(bool ok, time_us now);
+  size_t buildAck(uint8_t *frame);
+
+  CoreAPI *api;
+  CallBackHandler previous;
+  MobileReceiveHandler receiveHandler;
+  UserData receiveData;
+
+  uint8_t window;
+  time_us rto;
+  uint8_t retryTimes;
+
+  mutable pthread_mutex_t lock;
+  MobileTransferStats stats;
+
+  //! @note outgoing transfer
+  bool txBusy;
+  uint8_t txId;
+  uint16_t txTotal;
+  size_t txLen;
+  uint16_t txNext;
+  uint16_t txNew;
+  //! @note most recently sent fragment that was acknowledged
+  uint16_t txLatest;
+  time_us txLatestSentAt;
+  time_us txStart;
+  uint8_t txBuf[MOBILE_MAX_TRANSFER];
+  bool txAcked[MOBILE_MAX_FRAGMENTS];
+  uint8_t txSends[MOBILE_MAX_FRAGMENTS];
+  time_us txSentAt[MOBILE_MAX_FRAGMENTS];
+
+  //! @note incoming transfer
+  bool rxActive;
+  bool rxDoneValid;
+  //! @note last frame of the finished transfer, completing or duplicate
+  time_us rxDoneAt;
+  uint8_t rxId;
+  uint16_t rxTotal;
+  uint16_t rxCount;
+  uint16_t rxNext;
+  size_t rxLen;
+  bool ackPending;
+  uint8_t rxBuf[MOBILE_MAX_TRANSFER];
+  bool rxGot[MOBILE_MAX_FRAGMENTS];
+};
+
+} // namespace onboardSDK
+} // namespace DJI
+
+#endif // __linux__
+#endif // DJI_MOBILETRANSFER_H
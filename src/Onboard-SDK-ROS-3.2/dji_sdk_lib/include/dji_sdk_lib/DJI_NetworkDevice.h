@@ -0,0 +1,219 @@
+/** @file DJI_NetworkDevice.h
+ *  @version 3.1.9
+ *  @date November 10, 2016
+ *
+ *  @brief
+ *  HardDriver tunnelling the flight controller byte stream over TCP or UDP
+ *
+ *  @copyright 2016 DJI. All rights reserved.
+ *
+ */
+
+#ifndef DJI_NETWORKDEVICE_H
+#define DJI_NETWORKDEVICE_H
+
+#include "DJI_HardDriver.h"
+#include "DJI_Thread.h"
+
+#ifdef __linux__
+#include <pthread.h>
+
+namespace DJI
+{
+namespace onboardSDK
+{
+
+#define NET_FRAME_MAGIC 0xD5
+//! @note largest payload of one tunnel frame, fits a UDP datagram on any link
+#define NET_PAYLOAD_MAX 1400
+//! @note clock offset samples, the one with the shortest round trip is used
+#define NET_CLOCK_SAMPLES 8
+
+enum NetTransport
+{
+  NET_TCP,
+  NET_UDP
+};
+
+enum NetFrameType
+{
+  //! @note serial bytes, timeUs is when the bridge read them from the port
+  NET_DATA = 0,
+  //! @note timeUs is the sender's clock, echoed back in the NET_PONG payload
+  NET_PING,
+  //! @note timeUs is the bridge's clock when answering
+  NET_PONG,
+  //! @note tells a UDP bridge where to send
+  NET_HELLO
+};
+
+#pragma pack(1)
+typedef struct NetFrameHeader
+{
+  uint8_t magic;
+  uint8_t type;
+  uint16_t length;
+  uint64_t timeUs;
+} NetFrameHeader;
+#pragma pack()
+
+//! Splits a byte stream (TCP) or datagrams (UDP) into tunnel frames.
+class NetFrameParser
+{
+  public:
+  NetFrameParser();
+
+  //! @note false if the data does not fit, the parser is reset then
+  bool append(const uint8_t *data, size_t len);
+  //! @note payload stays valid until the next append()
+  bool next(NetFrameHeader *header, const uint8_t **payload);
+  void reset();
+  //! @note bytes skipped to find the next frame
+  uint32_t getSkipped() const;
+
+  static size_t encode(uint8_t *out, uint8_t type, uint64_t timeUs, const uint8_t *payload,
+      size_t len);
+
+  private:
+  uint8_t buf[2 * (sizeof(NetFrameHeader) + NET_PAYLOAD_MAX)];
+  size_t begin;
+  size_t end;
+  uint32_t skipped;
+};
+
+typedef struct NetStats
+{
+  uint32_t framesSent;
+  uint32_t framesReceived;
+  uint32_t bytesSent;
+  uint32_t bytesReceived;
+  //! @note bytes skipped to find the next frame
+  uint32_t skipped;
+  uint32_t reconnects;
+  //! @note best round trip to the bridge and the bridge clock minus ours
+  uint32_t rttUs;
+  int64_t clockOffsetUs;
+} NetStats;
+
+//! NetworkDevice talks to the flight controller through dji_link_bridge.
+/*!\remark
+ *  The bridge runs on the computer wired to the UART and forwards the raw
+ *  byte stream. CoreAPI works as with a local port:
+ *
+ *   NetworkDevice net("192.168.1.20", 5760, NET_TCP);
+ *   net.init();
+ *   CoreAPI api(&net);
+ *
+ *  Bytes are carried in small frames with the time the bridge read them,
+ *  so getRxTimeUs() tells when the data left the flight controller even
+ *  though it crossed the network. Bridge time is converted to ours with an
+ *  offset measured by pings; readall() sends one every setPingPeriod().
+ *
+ *  setNoDelay() controls Nagle's algorithm on TCP. No delay is the default,
+ *  so each send() leaves at once; CoreAPI::setWriteCombining() batches
+ *  frames before they reach the driver. The bridge batches what it reads
+ *  from the port, see its options.
+ *
+ *  On UDP lost datagrams are lost bytes; the protocol CRC drops the
+ *  broken frame and session retries cover commands.
+ *
+ *  Locks, wait() and notify() behave as in LinuxSerialDevice, through the
+ *  same AckSignal.
+ */
+class NetworkDevice : public HardDriver
+{
+  public:
+  NetworkDevice(const char *host, uint16_t port, NetTransport transport = NET_TCP);
+  ~NetworkDevice();
+
+  void init();
+  bool getDeviceStatus();
+  time_ms getTimeStamp();
+  size_t send(const uint8_t *buf, size_t len);
+  size_t readall(uint8_t *buf, size_t maxlen);
+
+  void lockMemory();
+  void freeMemory();
+
+  void lockMSG();
+  void freeMSG();
+
+  void lockACK();
+  void freeACK();
+
+  void notify();
+  void wait(int timeout);
+  void clearACK();
+
+  void lockProtocolHeader();
+  void freeProtocolHeader();
+
+  void lockNonBlockCBAck();
+  void freeNonBlockCBAck();
+
+  void notifyNonBlockCBAckRecv();
+  void nonBlockWait();
+
+  bool reconnect();
+  void close();
+
+  //! @note local monotonic time the bridge read the bytes last returned by
+  //! readall(), 0 before the clock offset is known
+  time_us getRxTimeUs() const;
+  NetStats getStats() const;
+
+  public: //! @note Access method
+  void setNoDelay(bool value);
+  bool getNoDelay() const;
+  //! @note time readall() waits for data, in milliseconds
+  void setReadTimeout(int ms);
+  int getReadTimeout() const;
+  //! @note 0 disables the clock offset pings
+  void setPingPeriod(uint32_t ms);
+  uint32_t getPingPeriod() const;
+
+  private:
+  bool configure();
+  bool sendFrame(uint8_t type, uint64_t timeUs, const uint8_t *payload, size_t len);
+  void onPong(const NetFrameHeader &header, const uint8_t *payload, size_t len, time_us now);
+  size_t takePending(uint8_t *buf, size_t maxlen);
+
+  char host[64];
+  uint16_t port;
+  NetTransport transport;
+  int fd;
+  bool noDelay;
+  int readTimeout;
+  uint32_t pingPeriod;
+  time_us lastPing;
+  time_us lastConnect;
+
+  //! @note guards fd writes, send() and pings come from different threads
+  pthread_mutex_t sendLock;
+  NetFrameParser parser;
+  //! @note payload of the current data frame not yet returned by readall()
+  const uint8_t *pending;
+  size_t pendingLength;
+  uint64_t pendingTime;
+  time_us rxTime;
+
+  mutable pthread_mutex_t statsLock;
+  NetStats stats;
+  uint32_t sampleRtt[NET_CLOCK_SAMPLES];
+  int64_t sampleOffset[NET_CLOCK_SAMPLES];
+  uint8_t sampleIndex;
+  bool offsetValid;
+
+  pthread_mutex_t memLock;
+  pthread_mutex_t msgLock;
+  AckSignal ack;
+
+  pthread_mutex_t headerLock;
+  AckSignal nbAck;
+};
+
+} // namespace onboardSDK
+} // namespace DJI
+
+#endif // __linux__
+#endif // DJI_NETWORKDEVICE_H
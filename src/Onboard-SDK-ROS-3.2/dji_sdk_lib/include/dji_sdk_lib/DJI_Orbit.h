@@ -0,0 +1,173 @@
+/** @file DJI_Orbit.h
+ *  @version 3.1.9
+ *  @date November 10, 2016
+ *
+ *  @brief
+ *  Client-side orbit around a moving point, streamed as movement control
+ *
+ *  @copyright 2016 DJI. All rights reserved.
+ *
+ */
+
+#ifndef DJI_ORBIT_H
+#define DJI_ORBIT_H
+
+#include "DJI_Flight.h"
+#include "DJI_Thread.h"
+
+#ifdef __linux__
+
+namespace DJI
+{
+namespace onboardSDK
+{
+
+//! @note longest the centre is moved along its velocity past the last update
+#define ORBIT_MAX_EXTRAPOLATION_US 2000000
+
+enum OrbitMode
+{
+  //! @note horizontal velocity setpoints, tangential plus a radial correction
+  ORBIT_VELOCITY = 0,
+  //! @note horizontal position offsets to the next point of the circle
+  ORBIT_POSITION
+};
+
+//! One tick of OrbitGenerator, as passed to Flight::setMovementControl().
+typedef struct OrbitSetpoint
+{
+  uint8_t flag;
+  float32_t x;
+  float32_t y;
+  float32_t z;
+  float32_t yaw;
+  //! @note distance to the centre minus the radius, in meters
+  float64_t radiusError;
+  //! @note bearing from the centre, radians, 0 is north
+  float64_t angle;
+} OrbitSetpoint;
+
+//! Tracking error of OrbitGenerator, absolute radius error in meters.
+typedef struct OrbitStats
+{
+  uint64_t ticks;
+  uint64_t sent;
+  float64_t lastError;
+  float64_t meanError;
+  float64_t rmsError;
+  float64_t maxError;
+} OrbitStats;
+
+//! OrbitGenerator flies a circle around a point without the HotPoint mission.
+/*!\remark
+ *  HotPoint::start() uploads the whole mission and every updateRadius() or
+ *  updateYawRate() is another round trip. The generator instead computes a
+ *  setpoint from the latest broadcast position on every tick and sends it
+ *  with Flight::setMovementControl(), so setRadius(), setAngularRate() and
+ *  setCentre() take effect on the next tick:
+ *
+ *   OrbitGenerator orbit(&flight);
+ *   orbit.setRadius(15);
+ *   orbit.setAngularRate(20);
+ *   orbit.setCentre(lat, lon, 10);
+ *   orbit.start(50);
+ *   ...
+ *   //! a moving centre, e.g. a vehicle, with its velocity
+ *   orbit.setCentre(lat, lon, 10, north, east, monotonicTimeUs());
+ *
+ *  In ORBIT_VELOCITY mode the velocity is the centre velocity, plus angular
+ *  rate x radius along the circle, plus setGain() x radius error towards
+ *  it, taken setResponseTime() ahead on the circle. In ORBIT_POSITION mode
+ *  it is the offset to the point of the circle one tick ahead. The height
+ *  is sent as a vertical position, the yaw faces the centre unless
+ *  setFaceCentre(false).
+ *
+ *  Obtain control authority first. Nothing is sent before setCentre().
+ *
+ *  @note latitude and longitude are in radians like PositionData
+ *  @note the generator calls Flight::setMovementControl() from its own
+ *  thread, stop other streamers while it runs
+ */
+class OrbitGenerator : public PeriodicThread
+{
+  public:
+  OrbitGenerator(Flight *FlightAPI = 0);
+  ~OrbitGenerator();
+
+  void setCentre(float64_t latitude, float64_t longitude, float32_t height);
+  //! @note velocity in m/s north/east, timestamp in monotonicTimeUs()
+  void setCentre(float64_t latitude, float64_t longitude, float32_t height, float64_t north,
+      float64_t east, time_us timestamp);
+  //! @note stop sending until the next setCentre()
+  void clearCentre();
+
+  //! @note centre at a given time, false without a centre
+  bool getCentre(time_us timestamp, float64_t *latitude, float64_t *longitude) const;
+
+  //! @note setpoint for a position at a given time, used by tick()
+  bool compute(const PositionData &position, time_us now, OrbitSetpoint *setpoint) const;
+
+  OrbitStats getStats() const;
+  void resetStats();
+
+  public: //! @note Access method
+  Flight *getFlight() const;
+  void setFlight(Flight *value);
+
+  void setMode(OrbitMode value);
+  OrbitMode getMode() const;
+  //! @note meters
+  void setRadius(float64_t value);
+  float64_t getRadius() const;
+  //! @note degrees per second, positive is clockwise seen from above
+  void setAngularRate(float64_t value);
+  float64_t getAngularRate() const;
+  //! @note radial correction in 1/s, ORBIT_VELOCITY only
+  void setGain(float64_t value);
+  float64_t getGain() const;
+  //! @note time the aircraft takes to reach a velocity setpoint, ORBIT_VELOCITY
+  //! only. Without it the orbit drifts outwards by the lag.
+  void setResponseTime(uint32_t ms);
+  uint32_t getResponseTime() const;
+  //! @note horizontal speed limit in m/s
+  void setMaxSpeed(float64_t value);
+  float64_t getMaxSpeed() const;
+  void setFaceCentre(bool value);
+  bool getFaceCentre() const;
+
+  protected:
+  void tick(time_us now);
+
+  private:
+  bool centreAt(time_us timestamp, float64_t *latitude, float64_t *longitude) const;
+
+  Flight *flight;
+
+  mutable pthread_mutex_t lock;
+  bool hasCentre;
+  float64_t centreLatitude;
+  float64_t centreLongitude;
+  float32_t centreHeight;
+  float64_t centreNorth;
+  float64_t centreEast;
+  time_us centreTime;
+
+  OrbitMode mode;
+  float64_t radius;
+  float64_t angularRate;
+  float64_t gain;
+  //! @note seconds
+  float64_t responseTime;
+  float64_t maxSpeed;
+  bool faceCentre;
+
+  OrbitStats stats;
+  float64_t errorSum;
+  float64_t errorSquareSum;
+};
+
+} // namespace onboardSDK
+} // namespace DJI
+
+#endif // __linux__
+#endif // DJI_ORBIT_H
@@ -0,0 +1,173 @@
+/** @file DJI_Policy.h
+ *  @version 3.1.9
+ *  @date November 10, 2016
+ *
+ *  @brief
+ *  Compile-time lock and crypto policies of CoreAPI
+ *
+ *  @copyright 2016 DJI. All rights reserved.
+ *
+ */
+
+#ifndef DJI_POLICY_H
+#define DJI_POLICY_H
+
+#include "DJI_HardDriver.h"
+
+#if defined(API_NO_CRYPTO) && defined(USE_ENCRYPT)
+#error "API_NO_CRYPTO and USE_ENCRYPT can not be used together"
+#endif
+
+namespace DJI
+{
+namespace onboardSDK
+{
+
+/*! @note The lock-free send path needs the __atomic builtins and
+ *  thread_local, so it is only built on Linux. Other targets, eg. STM32 with
+ *  Keil or arm-none-eabi, keep one lockMemory section around each send.
+ */
+#if !defined(API_SINGLE_THREAD) && defined(__linux__)
+#define API_LOCK_FREE
+#endif
+
+#ifdef API_LOCK_FREE
+//! Locks of the session memory and broadcast data go through the HardDriver.
+//! Sequence numbers and session slots are claimed with atomics, outside the locks.
+struct DriverLockPolicy
+{
+  static inline void lockMemory(HardDriver *driver) { driver->lockMemory(); }
+  static inline void freeMemory(HardDriver *driver) { driver->freeMemory(); }
+  static inline void lockMSG(HardDriver *driver) { driver->lockMSG(); }
+  static inline void freeMSG(HardDriver *driver) { driver->freeMSG(); }
+
+  //! @note a send builds its frame without any lock...
+  static inline void lockSend(HardDriver *) {}
+  static inline void freeSend(HardDriver *) {}
+  //! @note ...and takes lockMemory to enter it in session memory
+  static inline void lockHandOff(HardDriver *driver) { driver->lockMemory(); }
+  static inline void freeHandOff(HardDriver *driver) { driver->freeMemory(); }
+
+  static inline uint16_t nextSequence(uint16_t *seq)
+  {
+    return __atomic_fetch_add(seq, 1, __ATOMIC_RELAXED);
+  }
+  //! @note true if bit was clear and now belongs to the caller
+  static inline bool claimBit(uint32_t *bits, int bit)
+  {
+    return !(__atomic_fetch_or(bits, 1u << bit, __ATOMIC_ACQUIRE) & (1u << bit));
+  }
+  static inline void releaseBit(uint32_t *bits, int bit)
+  {
+    __atomic_fetch_and(bits, ~(1u << bit), __ATOMIC_RELEASE);
+  }
+
+  //! @note slots of the transmit queue, see CoreAPI::queueTx()
+  static inline uint32_t load(const uint32_t *value)
+  {
+    return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+  }
+  static inline void store(uint32_t *value, uint32_t desired)
+  {
+    __atomic_store_n(value, desired, __ATOMIC_RELEASE);
+  }
+  //! @note on failure expected is updated to the current value
+  static inline bool compareExchange(uint32_t *value, uint32_t *expected, uint32_t desired)
+  {
+    return __atomic_compare_exchange_n(value, expected, desired, true,
+                                       __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+  }
+  static inline void fence() { __atomic_thread_fence(__ATOMIC_SEQ_CST); }
+};
+#else
+//! Locks go through the HardDriver and a whole send holds lockMemory, so
+//! sequence numbers and session slots are plain variables.
+struct DriverLockPolicy
+{
+  static inline void lockMemory(HardDriver *driver) { driver->lockMemory(); }
+  static inline void freeMemory(HardDriver *driver) { driver->freeMemory(); }
+  static inline void lockMSG(HardDriver *driver) { driver->lockMSG(); }
+  static inline void freeMSG(HardDriver *driver) { driver->freeMSG(); }
+
+  static inline void lockSend(HardDriver *driver) { driver->lockMemory(); }
+  static inline void freeSend(HardDriver *driver) { driver->freeMemory(); }
+  //! @note already held through lockSend()
+  static inline void lockHandOff(HardDriver *) {}
+  static inline void freeHandOff(HardDriver *) {}
+
+  static inline uint16_t nextSequence(uint16_t *seq) { return (*seq)++; }
+  static inline bool claimBit(uint32_t *bits, int bit)
+  {
+    bool ans = !(*bits & (1u << bit));
+    *bits |= 1u << bit;
+    return ans;
+  }
+  static inline void releaseBit(uint32_t *bits, int bit) { *bits &= ~(1u << bit); }
+};
+#endif // API_LOCK_FREE
+
+//! Single thread builds: no lock, no virtual call.
+struct NoLockPolicy
+{
+  static inline void lockMemory(HardDriver *) {}
+  static inline void freeMemory(HardDriver *) {}
+  static inline void lockMSG(HardDriver *) {}
+  static inline void freeMSG(HardDriver *) {}
+
+  static inline void lockSend(HardDriver *) {}
+  static inline void freeSend(HardDriver *) {}
+  static inline void lockHandOff(HardDriver *) {}
+  static inline void freeHandOff(HardDriver *) {}
+
+  static inline uint16_t nextSequence(uint16_t *seq) { return (*seq)++; }
+  static inline bool claimBit(uint32_t *bits, int bit)
+  {
+    bool ans = !(*bits & (1u << bit));
+    *bits |= 1u << bit;
+    return ans;
+  }
+  static inline void releaseBit(uint32_t *bits, int bit) { *bits &= ~(1u << bit); }
+};
+
+struct AESCryptoPolicy
+{
+  static const bool enabled = true;
+};
+
+struct NoCryptoPolicy
+{
+  static const bool enabled = false;
+};
+
+/*! @note The policies are picked once for the whole library by the macros
+ *  of DJI_Config.h. The ACK lock and wait()/notify() always go through the
+ *  HardDriver, blocking calls need them whatever the build.
+ */
+#ifdef API_SINGLE_THREAD
+typedef NoLockPolicy LockPolicy;
+#else
+typedef DriverLockPolicy LockPolicy;
+#endif // API_SINGLE_THREAD
+
+//! @note storage class of the send staging buffers, shared under lockSend()
+//! where there is no lock-free send path
+#ifdef API_LOCK_FREE
+#define API_THREAD_LOCAL thread_local
+#else
+#define API_THREAD_LOCAL
+#endif // API_LOCK_FREE
+
+#if TX_QUEUE_NUM > 0 && !defined(API_LOCK_FREE)
+#error "TX_QUEUE_NUM needs the lock-free send path, see API_LOCK_FREE"
+#endif
+
+#ifdef API_NO_CRYPTO
+typedef NoCryptoPolicy CryptoPolicy;
+#else
+typedef AESCryptoPolicy CryptoPolicy;
+#endif // API_NO_CRYPTO
+
+} // namespace onboardSDK
+} // namespace DJI
+
+#endif // DJI_POLICY_H
@@ -0,0 +1,284 @@
+/** @file DJI_SharedLink.h
+ *  @version 3.1.9
+ *  @date November 10, 2016
+ *
+ *  @brief
+ *  Broadcast fan-out and command queue between processes in shared memory
+ *
+ *  @copyright 2016 DJI. All rights reserved.
+ *
+ */
+
+#ifndef DJI_SHAREDLINK_H
+#define DJI_SHAREDLINK_H
+
+#include "DJI_API.h"
+#include "DJI_Thread.h"
+
+#ifdef __linux__
+#include <pthread.h>
+
+namespace DJI
+{
+namespace onboardSDK
+{
+
+#define SHARED_LINK_MAGIC 0x4C4A4444
+#define SHARED_LINK_VERSION 1
+//! @note broadcast samples kept for readers that fall behind
+#define SHARED_BROADCAST_SLOTS 16
+//! @note command slots, power of two
+#define SHARED_QUEUE_SIZE 64
+#define SHARED_CLIENT_MAX 16
+#define SHARED_COMMAND_SIZE 100
+#define SHARED_ACK_SIZE 64
+//! @note results kept per client, older tokens are overwritten
+#define SHARED_RESULT_NUM 8
+//! @note a client not heard from for this long loses control authority
+#define SHARED_CLIENT_TIMEOUT_US 1000000
+
+enum SharedStatus
+{
+  SHARED_NONE = 0,
+  //! @note handed to CoreAPI, waiting for the ACK
+  SHARED_SENT,
+  SHARED_ACKED,
+  //! @note sent in session mode 0, no ACK follows
+  SHARED_DONE,
+  //! @note no ACK within the retries
+  SHARED_TIMEOUT,
+  //! @note control authority is held by another client
+  SHARED_REJECTED,
+  //! @note no free session or malformed command
+  SHARED_FAILED
+};
+
+typedef struct SharedResult
+{
+  uint32_t token;
+  uint16_t status;
+  uint16_t ack;
+  uint8_t length;
+  uint8_t data[SHARED_ACK_SIZE];
+} SharedResult;
+
+typedef struct SharedCommand
+{
+  //! @note slot sequence of the queue, see SharedLinkClient::send()
+  uint32_t sequence;
+  uint32_t token;
+  uint8_t client;
+  uint8_t cmdSet;
+  uint8_t cmdId;
+  uint8_t sessionMode;
+  uint16_t timeout;
+  uint8_t retry;
+  uint8_t length;
+  uint8_t data[SHARED_COMMAND_SIZE];
+} SharedCommand;
+
+typedef struct SharedClient
+{
+  //! @note 0 free, 1 attached, 2 being attached
+  uint32_t state;
+  int32_t pid;
+  uint8_t priority;
+  char name[15];
+  uint64_t heartbeatUs;
+  uint32_t nextToken;
+  //! @note odd while the daemon writes a result
+  uint32_t resultSeq;
+  SharedResult result[SHARED_RESULT_NUM];
+} SharedClient;
+
+typedef struct SharedBroadcast
+{
+  //! @note odd while the daemon writes the slot
+  uint32_t sequence;
+  uint32_t generation;
+  uint64_t timeUs;
+  BroadcastData data;
+} SharedBroadcast;
+
+//! Layout of the shared memory object. Counters are only touched with
+//! __atomic builtins, which are lock-free and so work across processes.
+typedef struct SharedLinkRegion
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t size;
+  int32_t serverPid;
+
+  //! @note newest published sample, its slot is generation % SHARED_BROADCAST_SLOTS
+  uint32_t generation;
+  SharedBroadcast broadcast[SHARED_BROADCAST_SLOTS];
+
+  //! @note producers claim head, the daemon alone advances tail
+  uint32_t queueHead;
+  uint32_t queueTail;
+  SharedCommand queue[SHARED_QUEUE_SIZE];
+
+  //! @note client holding control authority, -1 for none
+  int32_t authority;
+  SharedClient client[SHARED_CLIENT_MAX];
+} SharedLinkRegion;
+
+typedef struct SharedLinkStats
+{
+  uint32_t broadcasts;
+  uint32_t commands;
+  uint32_t rejected;
+  uint32_t failed;
+  uint32_t acked;
+  uint32_t timeouts;
+  uint32_t authorityChanges;
+} SharedLinkStats;
+
+//! SharedLinkServer lets one process own the serial port and share it.
+/*!\remark
+ *  Every decoded broadcast is copied into a ring of seqlock protected slots
+ *  in a POSIX shared memory object. Any number of SharedLinkClient
+ *  processes read it without a syscall or a lock.
+ *
+ *  Clients queue commands in a bounded multi-producer queue in the same
+ *  object. poll() drains it, orders each batch by client priority and sends
+ *  the commands through CoreAPI. ACKs are written back to the result slots
+ *  of the sending client.
+ *
+ *  Commands of SET_CONTROL, SET_MISSION and SET_VIRTUALRC need control
+ *  authority. A client gets it by sending setControl(true) (CODE_SETCONTROL
+ *  with 1) while nobody holds it, while the holder has a lower priority or
+ *  after the holder stopped heart-beating. The holder changes once the
+ *  flight controller ACKs the obtain or release. Commands without authority are
+ *  answered with SHARED_REJECTED and never reach the flight controller.
+ *
+ *   SharedLinkServer server(&api);
+ *   server.open("/dji_link");
+ *   while (running)
+ *     if (!server.poll())
+ *       usleep(1000);
+ *
+ *  @note a client killed in the middle of send() stalls the queue; the
+ *  window is a few instructions long
+ */
+class SharedLinkServer
+{
+  public:
+  SharedLinkServer(CoreAPI *ControlAPI = 0);
+  ~SharedLinkServer();
+
+  bool open(const char *name);
+  void close();
+  bool isOpen() const;
+
+  //! @note returns the commands handled
+  int poll();
+
+  int getAuthority() const;
+  SharedLinkStats getStats() const;
+
+  public: //! @note Access method
+  CoreAPI *getApi() const;
+  void setApi(CoreAPI *value);
+
+  static void broadcastCallback(CoreAPI *api, Header *protocolHeader, UserData server);
+  static void ackCallback(CoreAPI *api, Header *protocolHeader, UserData server);
+
+  private:
+  //! @note command waiting for its ACK, indexed by session
+  typedef struct Pending
+  {
+    bool used;
+    uint8_t client;
+    uint32_t token;
+    time_us deadline;
+    //! @note 1 obtain, -1 release, committed on the flight controller's ACK
+    int8_t control;
+  } Pending;
+
+  void publish();
+  void handle(const SharedCommand &command);
+  bool arbitrate(const SharedCommand &command, time_us now);
+  void commitAuthority(uint8_t client, int8_t control);
+  bool clientAlive(int client, time_us now) const;
+  void sweep(time_us now);
+  void result(uint8_t client, uint32_t token, uint16_t status, uint16_t ack,
+      const uint8_t *data, size_t length);
+
+  CoreAPI *api;
+  CallBackHandler previous;
+  char name[64];
+  SharedLinkRegion *region;
+  SharedLinkStats stats;
+
+  //! @note the read thread and poll() both write results, guards pending
+  //! and stats
+  mutable pthread_mutex_t lock;
+  Pending pending[SESSION_TABLE_NUM];
+  time_us lastReap;
+};
+
+//! SharedLinkClient talks to a SharedLinkServer in another process.
+/*!\remark
+ *   SharedLinkClient link;
+ *   link.open("/dji_link", "planner", 10);
+ *   BroadcastData data;
+ *   uint32_t seen = 0;
+ *   if (link.getBroadcast(&data, &seen))
+ *     ...
+ *   uint32_t token = link.obtainControl();
+ *   SharedResult r;
+ *   link.waitResult(token, &r, 1000);
+ *
+ *  The broadcast getters copy a slot and retry if the daemon overwrote it
+ *  meanwhile. getBroadcast(generation) reaches back SHARED_BROADCAST_SLOTS
+ *  samples, so a reader that polls slower than the broadcast rate can still
+ *  see every sample.
+ *
+ *  @note call heartbeat() at least every SHARED_CLIENT_TIMEOUT_US while
+ *  holding control authority; send() heart-beats as well
+ */
+class SharedLinkClient
+{
+  public:
+  SharedLinkClient();
+  ~SharedLinkClient();
+
+  bool open(const char *name, const char *clientName, uint8_t priority);
+  void close();
+  bool isOpen() const;
+
+  uint32_t getGeneration() const;
+  //! @note newest sample, false before the first one
+  bool getBroadcast(BroadcastData *data, uint32_t *generation = 0) const;
+  //! @note false if the sample was not published yet or has been overwritten
+  bool getBroadcast(uint32_t generation, BroadcastData *data) const;
+
+  //! @note returns a token for getResult(), 0 if the queue is full
+  uint32_t send(CMD_SET cmdSet, uint8_t cmdId, const void *data, size_t length,
+      uint8_t sessionMode = 2, uint16_t timeout = 100, uint8_t retry = 3);
+  uint32_t obtainControl();
+  uint32_t releaseControl();
+  bool hasControl() const;
+
+  //! @note false if the token is unknown or its slot was reused
+  bool getResult(uint32_t token, SharedResult *result) const;
+  //! @note polls until the result is final, timeout in ms
+  bool waitResult(uint32_t token, SharedResult *result, int timeout);
+
+  void heartbeat();
+
+  public: //! @note Access method
+  int getClientId() const;
+  uint8_t getPriority() const;
+
+  private:
+  SharedLinkRegion *region;
+  int id;
+};
+
+} // namespace onboardSDK
+} // namespace DJI
+
+#endif // __linux__
+#endif // DJI_SHAREDLINK_H
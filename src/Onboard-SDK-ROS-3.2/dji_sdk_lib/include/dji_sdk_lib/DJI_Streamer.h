@@ -0,0 +1,111 @@
+/** @file DJI_Streamer.h
+ *  @version 3.1.9
+ *  @date November 10, 2016
+ *
+ *  @brief
+ *  Fixed-rate command streaming for movement control and VirtualRC
+ *
+ *  @copyright 2016 DJI. All rights reserved.
+ *
+ */
+
+#ifndef DJI_STREAMER_H
+#define DJI_STREAMER_H
+
+#include "DJI_Flight.h"
+#include "DJI_VirtualRC.h"
+#include "DJI_Thread.h"
+
+#ifdef __linux__
+
+namespace DJI
+{
+namespace onboardSDK
+{
+
+//! CommandStreamer keeps re-sending the most recent setpoint at a fixed rate.
+/*!\remark
+ *  The flight controller leaves API/VirtualRC control when the command stream
+ *  stops. Instead of a usleep() loop in every application, set the setpoint
+ *  with setMovementControl() or setVRCData() whenever it changes and let the
+ *  streamer send it on its own thread:
+ *
+ *   CommandStreamer streamer(&flight);
+ *   streamer.setTimeout(500, CommandStreamer::TIMEOUT_BRAKE);
+ *   streamer.start(50);
+ *   ...
+ *   streamer.setMovementControl(flag, x, y, z, yaw);
+ *
+ *  If the application does not update the setpoint within the timeout, the
+ *  streamer either stops sending (the aircraft hovers, TIMEOUT_STOP) or sends
+ *  a zero-velocity brake command (TIMEOUT_BRAKE) until a new setpoint arrives.
+ *
+ *  @note VirtualRC data must not be sent faster than 25Hz, so VirtualRC
+ *  setpoints are decimated to at most 25Hz whatever the streaming rate.
+ */
+class CommandStreamer : public PeriodicThread
+{
+  public:
+  enum TimeoutAction
+  {
+    TIMEOUT_STOP = 0,
+    TIMEOUT_BRAKE = 1
+  };
+
+  enum Target
+  {
+    TARGET_NONE = 0,
+    TARGET_MOVEMENT = 1,
+    TARGET_VIRTUALRC = 2
+  };
+
+  public:
+  CommandStreamer(Flight *FlightAPI = 0, VirtualRC *VirtualRCAPI = 0);
+  ~CommandStreamer();
+
+  //! @note timeoutMs = 0 disables the timeout
+  void setTimeout(uint32_t timeoutMs, TimeoutAction action = TIMEOUT_BRAKE);
+
+  void setMovementControl(uint8_t flag, float32_t x, float32_t y, float32_t z, float32_t yaw);
+  void setMovementControl(const FlightData &data);
+  void setVRCData(const VirtualRCData &data);
+  //! @note stop sending until the next setpoint
+  void clearSetpoint();
+
+  Target getTarget() const;
+  bool isTimedOut() const;
+  uint64_t getSentCount() const;
+  uint64_t getTimeoutCount() const;
+
+  public: //! @note Access method
+  Flight *getFlight() const;
+  void setFlight(Flight *value);
+  VirtualRC *getVirtualRC() const;
+  void setVirtualRC(VirtualRC *value);
+
+  protected:
+  void tick(time_us now);
+
+  private:
+  Flight *flight;
+  VirtualRC *vrc;
+
+  mutable pthread_mutex_t setpointLock;
+  Target target;
+  FlightData movement;
+  VirtualRCData vrcData;
+  time_us updateTime;
+  uint32_t timeout;
+  TimeoutAction timeoutAction;
+
+  std::atomic<bool> timedOut;
+  std::atomic<uint64_t> sent;
+  std::atomic<uint64_t> timeouts;
+  uint32_t vrcDivider;
+};
+
+} // namespace onboardSDK
+} // namespace DJI
+
+#endif // __linux__
+#endif // DJI_STREAMER_H
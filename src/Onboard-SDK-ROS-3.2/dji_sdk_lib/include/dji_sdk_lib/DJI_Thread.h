@@ -0,0 +1,159 @@
+/** @file DJI_Thread.h
+ *  @version 3.1.9
+ *  @date November 10, 2016
+ *
+ *  @brief
+ *  Periodic real-time thread support for DJI onboardSDK library
+ *
+ *  @copyright 2016 DJI. All rights reserved.
+ *
+ */
+
+#ifndef DJI_THREAD_H
+#define DJI_THREAD_H
+
+#include "DJI_Type.h"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <atomic>
+
+namespace DJI
+{
+namespace onboardSDK
+{
+
+class ThreadTopology;
+
+//! Threads of a link, see ThreadTopology.
+enum ThreadRole
+{
+  THREAD_READER = 0,
+  THREAD_POLLER,
+  THREAD_CALLBACK,
+  THREAD_STREAMER,
+  THREAD_ROLE_NUM
+};
+
+//! Scheduling options for threads owned by the library.
+typedef struct ThreadConfig
+{
+  //! @note 0 keeps the default scheduler, 1-99 requests SCHED_FIFO at that priority
+  int priority;
+  //! @note -1 leaves CPU placement to the kernel
+  int cpu;
+  //! @note SCHED_RR instead of SCHED_FIFO when priority is set
+  bool roundRobin;
+  //! @note nice value for the default scheduler, ignored when priority is set
+  int niceness;
+  //! @note more CPUs the thread may run on, bit n is CPU n, added to cpu
+  uint32_t cpuMask;
+  //! @note thread name shown by top and ps, at most 15 characters
+  char name[16];
+} ThreadConfig;
+
+//! Apply a ThreadConfig to the calling thread, true if the real-time class was granted.
+bool applyThreadConfig(const ThreadConfig *config);
+
+//! Period statistics of a PeriodicThread. Jitter is wake-up time minus deadline.
+typedef struct PeriodStats
+{
+  uint64_t ticks;
+  uint64_t overruns;
+  int64_t minJitterUs;
+  int64_t maxJitterUs;
+  double meanJitterUs;
+} PeriodStats;
+
+//! Monotonic clock in microseconds, shared by all timing code of the library.
+time_us monotonicTimeUs();
+//! Sleeps until a monotonicTimeUs() deadline, with timer resolution.
+void sleepUntilUs(time_us deadline);
+
+//! AckSignal is the lock, condition and flag behind a driver's lockACK(), notify() and wait().
+/*!\remark
+ *  LinuxSerialDevice and NetworkDevice keep one for blocking command ACKs
+ *  and one for the non-blocking callback thread. A notify() that comes
+ *  before wait() is kept, so an ACK faster than the caller is not lost;
+ *  clear() drops it when the next blocking command is issued.
+ *
+ *  @note notify(), wait() and clear() are called with lock() held. wait()
+ *  takes seconds on CLOCK_MONOTONIC, below 0 it does not time out
+ */
+class AckSignal
+{
+  public:
+  AckSignal();
+  ~AckSignal();
+
+  void lock();
+  void unlock();
+
+  void notify();
+  void wait(int timeout);
+  void clear();
+
+  private:
+  pthread_mutex_t mutex;
+  pthread_cond_t recv;
+  bool pending;
+};
+
+//! PeriodicThread runs tick() at a fixed rate on a dedicated thread.
+/*!\remark
+ *  Deadlines are absolute (clock_nanosleep on CLOCK_MONOTONIC with TIMER_ABSTIME),
+ *  so a slow tick does not shift the following ones. When a tick overruns a
+ *  whole period the missed deadlines are skipped and counted as overruns.
+ *
+ *  If SCHED_FIFO is refused (no CAP_SYS_NICE) the thread still starts with the
+ *  default scheduler; check isRealtime().
+ */
+class PeriodicThread
+{
+  public:
+  PeriodicThread();
+  virtual ~PeriodicThread();
+
+  bool start(uint32_t rateHz, const ThreadConfig *config = 0);
+  void stop();
+
+  bool isRunning() const;
+  bool isRealtime() const;
+  uint32_t getRate() const;
+
+  PeriodStats getPeriodStats() const;
+  void resetPeriodStats();
+
+  //! @note take the config of role from topology when start() has none
+  void setTopology(ThreadTopology *topology, ThreadRole role);
+
+  protected:
+  //! @note called from the periodic thread, now is the scheduled deadline
+  virtual void tick(time_us now) = 0;
+  //! @note called from the periodic thread once before it exits
+  virtual void onStop() {}
+
+  private:
+  static void *entry(void *self);
+  void run();
+  void record(int64_t jitterUs, uint64_t overruns);
+
+  pthread_t thread;
+  std::atomic<bool> running;
+  bool realtime;
+  uint32_t rate;
+  time_us periodUs;
+  ThreadConfig config;
+  ThreadTopology *topology;
+  ThreadRole role;
+
+  mutable pthread_mutex_t statsLock;
+  PeriodStats stats;
+  double jitterSum;
+};
+
+} // namespace onboardSDK
+} // namespace DJI
+
+#endif // __linux__
+#endif // DJI_THREAD_H
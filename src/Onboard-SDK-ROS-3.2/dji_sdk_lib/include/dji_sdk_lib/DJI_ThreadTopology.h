@@ -0,0 +1,161 @@
+/** @file DJI_ThreadTopology.h
+ *  @version 3.1.9
+ *  @date November 10, 2016
+ *
+ *  @brief
+ *  CPU placement, scheduling and usage counters for the threads of a link
+ *
+ *  @copyright 2016 DJI. All rights reserved.
+ *
+ */
+
+#ifndef DJI_THREADTOPOLOGY_H
+#define DJI_THREADTOPOLOGY_H
+
+#include "DJI_API.h"
+#include "DJI_Thread.h"
+
+#ifdef __linux__
+#include <sys/types.h>
+#include <time.h>
+
+namespace DJI
+{
+namespace onboardSDK
+{
+
+//! What a thread of the topology is doing right now, read from the kernel.
+typedef struct ThreadUsage
+{
+  //! @note a thread holds the role, the other fields are its last sample otherwise
+  bool active;
+  pid_t tid;
+  //! @note CPU it last ran on
+  int cpu;
+  //! @note CPUs it may run on, bit n is CPU n
+  uint32_t cpuMask;
+  int policy;
+  int priority;
+  uint64_t cpuTimeUs;
+  uint64_t voluntarySwitches;
+  uint64_t involuntarySwitches;
+} ThreadUsage;
+
+//! ThreadTopology says where each thread of a link runs and how it is scheduled.
+/*!\remark
+ *  A link has up to four busy threads: the reader (readPoll()), the poller
+ *  (sendPoll()), the callback executor (callbackPoll(), only with
+ *  userCallbackThread) and a CommandStreamer. Each role gets a ThreadConfig:
+ *  CPU affinity, SCHED_FIFO/SCHED_RR priority or nice value, and a name.
+ *
+ *   ThreadTopology topology;
+ *   ThreadConfig reader = { 60, 3 };
+ *   strcpy(reader.name, "dji-reader");
+ *   topology.setConfig(THREAD_READER, reader);
+ *
+ *   LinkThreads link(&api, &topology);
+ *   link.start();
+ *   streamer.setTopology(&topology, THREAD_STREAMER);
+ *   streamer.start(50);
+ *
+ *  Threads the application creates itself call enter() first and leave()
+ *  before they exit:
+ *
+ *   topology.enter(THREAD_CALLBACK);
+ *   while (running)
+ *     api.callbackPoll(&api);
+ *   topology.leave(THREAD_CALLBACK);
+ *
+ *  getUsage() reads the CPU time and the voluntary and involuntary context
+ *  switches of the thread holding a role, along with the affinity and
+ *  scheduler it really got. This shows whether the placement worked.
+ *
+ *  @note without CAP_SYS_NICE the real-time class is refused and the thread
+ *  keeps the default scheduler, check getUsage().policy
+ */
+class ThreadTopology
+{
+  public:
+  ThreadTopology();
+  ~ThreadTopology();
+
+  void setConfig(ThreadRole role, const ThreadConfig &config);
+  ThreadConfig getConfig(ThreadRole role) const;
+
+  //! @note called from the thread taking the role, true if real-time was granted
+  bool enter(ThreadRole role);
+  //! @note like enter() for threads already configured, eg. PeriodicThread
+  void attach(ThreadRole role);
+  //! @note called from the thread holding the role before it exits
+  void leave(ThreadRole role);
+
+  ThreadUsage getUsage(ThreadRole role) const;
+  static const char *getRoleName(ThreadRole role);
+
+  private:
+  typedef struct Slot
+  {
+    ThreadConfig config;
+    pthread_t thread;
+    clockid_t clock;
+    ThreadUsage usage;
+  } Slot;
+
+  void sample(Slot *slot) const;
+
+  mutable pthread_mutex_t lock;
+  mutable Slot slot[THREAD_ROLE_NUM];
+};
+
+//! LinkThreads runs the reader and poller loops of a CoreAPI.
+/*!\remark
+ *  The reader calls readPoll() back to back, it blocks in
+ *  HardDriver::readall(). The poller calls sendPoll() every setPollPeriod()
+ *  milliseconds and, with CoreAPI::setWriteCombining(), also writes out
+ *  buffered frames when their deadline expires. Both take their
+ *  ThreadConfig from the topology.
+ *
+ *  @note stop() waits for the reader, so readall() must return now and then
+ */
+class LinkThreads
+{
+  public:
+  LinkThreads(CoreAPI *ControlAPI = 0, ThreadTopology *topology = 0);
+  ~LinkThreads();
+
+  bool start();
+  void stop();
+  bool isRunning() const;
+
+  public: //! @note Access method
+  CoreAPI *getApi() const;
+  void setApi(CoreAPI *value);
+  ThreadTopology *getTopology() const;
+  void setTopology(ThreadTopology *value);
+  void setPollPeriod(uint32_t ms);
+  uint32_t getPollPeriod() const;
+
+  private:
+  static void *readerEntry(void *self);
+  static void *pollerEntry(void *self);
+  static void txPendingCallback(CoreAPI *api, Header *protocolHeader, UserData self);
+  void detachApi();
+
+  CoreAPI *api;
+  ThreadTopology *topology;
+  uint32_t pollPeriod;
+  std::atomic<bool> running;
+  pthread_t reader;
+  pthread_t poller;
+
+  //! @note wakes the poller when a frame enters the empty transmit buffer
+  pthread_mutex_t wakeLock;
+  pthread_cond_t wake;
+  bool txPending;
+};
+
+} // namespace onboardSDK
+} // namespace DJI
+
+#endif // __linux__
+#endif // DJI_THREADTOPOLOGY_H
@@ -0,0 +1,183 @@
+/** @file DJI_Trigger.h
+ *  @version 3.1.9
+ *  @date November 10, 2016
+ *
+ *  @brief
+ *  Conditions on broadcast data, evaluated as frames are decoded
+ *
+ *  @copyright 2016 DJI. All rights reserved.
+ *
+ */
+
+#ifndef DJI_TRIGGER_H
+#define DJI_TRIGGER_H
+
+#include "DJI_API.h"
+
+#ifdef __linux__
+#include <pthread.h>
+#endif // __linux__
+
+namespace DJI
+{
+namespace onboardSDK
+{
+
+//! @note triggers a registry can hold, one bit each in evaluate()
+#define TRIGGER_MAX 32
+
+//! Broadcast values a trigger can watch.
+enum TriggerField
+{
+  TRIGGER_HEIGHT = 0,
+  TRIGGER_ALTITUDE,
+  TRIGGER_POSITION_HEALTH,
+  TRIGGER_VELOCITY_X,
+  TRIGGER_VELOCITY_Y,
+  TRIGGER_VELOCITY_Z,
+  TRIGGER_HORIZONTAL_SPEED,
+  TRIGGER_GIMBAL_ROLL,
+  TRIGGER_GIMBAL_PITCH,
+  TRIGGER_GIMBAL_YAW,
+  TRIGGER_RC_MODE,
+  TRIGGER_RC_GEAR,
+  TRIGGER_FLIGHT_STATUS,
+  TRIGGER_BATTERY,
+  TRIGGER_CTRL_MODE,
+  TRIGGER_CTRL_DEVICE,
+  TRIGGER_FIELD_NUM
+};
+
+enum TriggerCompare
+{
+  //! @note true above threshold, false again below threshold - hysteresis
+  TRIGGER_ABOVE = 0,
+  //! @note true below threshold, false again above threshold + hysteresis
+  TRIGGER_BELOW,
+  TRIGGER_EQUAL,
+  TRIGGER_NOT_EQUAL,
+  //! @note true for the frame in which the value differs from the last one
+  TRIGGER_CHANGED
+};
+
+enum TriggerMode
+{
+  //! @note fire once when the condition turns true
+  TRIGGER_EDGE = 0,
+  //! @note fire on every frame carrying the field while the condition holds
+  TRIGGER_LEVEL
+};
+
+typedef struct TriggerSpec
+{
+  TriggerField field;
+  TriggerCompare compare;
+  float64_t threshold;
+  float64_t hysteresis;
+  TriggerMode mode;
+  //! @note remove the trigger after it fired once
+  bool oneShot;
+} TriggerSpec;
+
+class TriggerRegistry;
+
+//! @note called from the read thread, after the broadcast lock is released
+typedef void (*TriggerCallback)(TriggerRegistry *registry, int id, float64_t value,
+    UserData userData);
+
+//! TriggerRegistry wakes the application when broadcast data meets a condition.
+/*!\remark
+ *  Each trigger is compiled on add() to the broadcast channel that carries
+ *  its field, a reader for the value and a comparison. CoreAPI::broadcast()
+ *  evaluates only the triggers whose channel is in the enable flag of the
+ *  frame, while it still holds the broadcast lock, and fires them once the
+ *  lock is released. The homepoint altitude logic in broadcast() is the same
+ *  kind of edge detection on the flight status.
+ *
+ *   TriggerRegistry triggers(&api);
+ *   TriggerSpec spec = { TRIGGER_HEIGHT, TRIGGER_ABOVE, 10, 0.5, TRIGGER_EDGE, false };
+ *   int id = triggers.add(spec, onHeight, &ctx);
+ *
+ *   //! or block until it holds, without polling getBroadcastData()
+ *   TriggerSpec sky = { TRIGGER_FLIGHT_STATUS, TRIGGER_EQUAL,
+ *       Flight::STATUS_SKY_STANDBY, 0, TRIGGER_EDGE, true };
+ *   triggers.waitUntil(sky, 30000);
+ *
+ *  The state of a new trigger is unknown until its field first arrives, an
+ *  edge trigger fires if the condition already holds then.
+ *
+ *  @note callbacks run on the read thread, keep them short and do not call
+ *  add() or remove() of the firing trigger from them
+ *  @note wait() and waitUntil() are only available on Linux
+ */
+class TriggerRegistry
+{
+  public:
+  TriggerRegistry(CoreAPI *ControlAPI = 0);
+  ~TriggerRegistry();
+
+  //! @note -1 if the registry is full or the spec is invalid
+  int add(const TriggerSpec &spec, TriggerCallback callback = 0, UserData userData = 0);
+  bool remove(int id);
+  void clear();
+
+  bool isTrue(int id) const;
+  uint32_t getFireCount(int id) const;
+  float64_t getLastValue(int id) const;
+
+#ifdef __linux__
+  //! @note returns when the trigger fires next, or at once for a level trigger
+  //! that holds already. The timeout is in milliseconds.
+  bool wait(int id, int timeout);
+  //! @note add a temporary trigger, wait for it and remove it
+  bool waitUntil(const TriggerSpec &spec, int timeout);
+#endif // __linux__
+
+  //! @note called by CoreAPI::broadcast() with the broadcast lock held,
+  //! returns the triggers to pass to fire()
+  uint32_t evaluate(const BroadcastData &data, uint16_t enableFlag,
+      const FirmwareBehaviour &firmware);
+  //! @note called by CoreAPI::broadcast() once the lock is released
+  void fire(uint32_t fired);
+
+  public: //! @note Access method
+  CoreAPI *getApi() const;
+  void setApi(CoreAPI *value);
+
+  private:
+  typedef float64_t (*Reader)(const BroadcastData &data);
+
+  typedef struct Trigger
+  {
+    bool used;
+    TriggerSpec spec;
+    //! @note compiled spec
+    uint8_t channel;
+    Reader read;
+    //! @note evaluation state
+    bool known;
+    bool state;
+    float64_t last;
+    float64_t firedValue;
+    uint32_t fires;
+    TriggerCallback callback;
+    UserData userData;
+  } Trigger;
+
+  static uint16_t channelsOf(uint16_t enableFlag, const FirmwareBehaviour &firmware);
+  void lock() const;
+  void unlock() const;
+
+  CoreAPI *api;
+  Trigger trigger[TRIGGER_MAX];
+
+#ifdef __linux__
+  mutable pthread_mutex_t mutex;
+  pthread_cond_t cond;
+#endif // __linux__
+};
+
+} // namespace onboardSDK
+} // namespace DJI
+
+#endif // DJI_TRIGGER_H
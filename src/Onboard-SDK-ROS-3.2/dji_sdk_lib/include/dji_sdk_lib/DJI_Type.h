@@ -54,13 +54,24 @@
 
 
 //! This is the default status printing mechanism
+//! @note the message is formatted on the caller's stack, so several CoreAPI
+//! instances (and threads) can log at the same time. STM32 keeps the shared
+//! DJI::onboardSDK::buffer to save stack.
+#ifdef STM32
+#define API_LOG_BUFFER(name) char *name = DJI::onboardSDK::buffer
+#else
+#define API_LOG_BUFFER(name) char name[DJI::onboardSDK::bufsize]
+#endif // STM32
+
 #define API_LOG(driver, title, fmt, ...)                                  \
   if ((title))                                                            \
   {                                                                       \
-    int len = (sprintf(DJI::onboardSDK::buffer, "%s %s,line %d: " fmt,    \
+    API_LOG_BUFFER(apiLogBuffer);                                         \
+    int len = (snprintf(apiLogBuffer, DJI::onboardSDK::bufsize,           \
+        "%s %s,line %d: " fmt,                                            \
         (title) ? (title) : "NONE", __func__, __LINE__, ##__VA_ARGS__));  \
-    if ((len != -1) && (len < 1024))                                      \
-      (driver)->displayLog();                                             \
+    if ((len >= 0) && (len < (int)DJI::onboardSDK::bufsize))              \
+      (driver)->displayLog(apiLogBuffer);                                 \
     else                                                                  \
       (driver)->displayLog("ERROR: log printer inner fault\n");           \
   }
@@ -118,7 +129,9 @@ namespace onboardSDK
 {
 
 const size_t bufsize = 1024;
+//! @note only used by API_LOG on STM32, other targets log from the stack
 extern char buffer[];
+//! @note default of CoreAPI::getEncrypt() for new instances
 extern uint8_t encrypt;
 
 const size_t SESSION_TABLE_NUM = 32;
@@ -162,6 +175,33 @@ typedef struct CallBackHandler
   UserData userData;
 } CallBackHandler;
 
+//! Request frame received from the flight controller, see CoreAPI::setFrameCallback()
+typedef struct FrameView
+{
+  Header *header;
+  uint8_t cmdSet;
+  uint8_t cmdId;
+  //! @note payload after the cmdSet and cmdId bytes
+  const uint8_t *data;
+  size_t length;
+
+  //! @note payload at offset as one of the packed protocol structs, 0 if the
+  //! frame is too short
+  template <typename T>
+  const T *as(size_t offset = 0) const
+  {
+    return length >= offset + sizeof(T) ? (const T *)(data + offset) : 0;
+  }
+} FrameView;
+
+typedef void (*FrameCallBack)(DJI::onboardSDK::CoreAPI *, const FrameView *, UserData);
+
+typedef struct FrameCallBackHandler
+{
+  FrameCallBack callback;
+  UserData userData;
+} FrameCallBackHandler;
+
 typedef struct Command
 {
   unsigned short sessionMode : 2;
@@ -202,6 +242,7 @@ typedef struct CMDSession
   uint32_t sent : 5;
   uint32_t retry : 5;
   uint32_t timeout : 16;
+  uint8_t cmdSet;
   MMU_Tab *mmu;
   CallBack handler;
   UserData userData;
@@ -652,6 +693,65 @@ typedef struct VersionData
 
 
 #pragma pack()
+
+/**
+ * Hardware/firmware quirks, resolved once from VersionData.
+ * See CoreAPI::getFirmwareBehaviour()
+ */
+typedef struct FirmwareBehaviour
+{
+  //! M100 broadcast layout: no GPS/RTK channels, 12 channels in total
+  bool isM100;
+  //! Broadcast timestamp carries the nano-second and sync fields (FW > 3.1)
+  bool fullTimeStamp;
+  //! Gimbal limit flags and control mode are not reported by M100 FW 2.3
+  bool hasGimbalLimit;
+  bool hasCtrlMode;
+  //! A3/M600 FW between 3.2.0.0 and 3.2.15.39 report MSL altitude, vertical
+  //! position control needs the homepoint altitude offset
+  bool homepointOffset;
+  //! Setting control fails in mode F before 3.2, in mode P afterwards
+  bool needModeF;
+  uint8_t broadcastChannels;
+  //! Broadcast sizes of GimbalData and CtrlInfoData (one byte less before FW 3.1)
+  uint8_t gimbalSize;
+  uint8_t ctrlInfoSize;
+  //! Bit of the broadcast enable flag carrying FlightStatus
+  uint16_t flightStatusFlag;
+} FirmwareBehaviour;
+
+//! @note command sets tracked by the RTT estimator, SET_ACTIVATION to SET_VIRTUALRC
+const size_t RTT_SET_NUM = 8;
+
+//! ACK round trip of one command set in ms, smoothed as in RFC 6298.
+//! Only ACKs of frames sent once are sampled (Karn's rule).
+typedef struct RttEstimate
+{
+  uint32_t samples;
+  uint32_t retransmits;
+  uint32_t lastRtt;
+  float32_t srtt;
+  float32_t rttvar;
+  //! @note timeout the next session of this set gets in adaptive mode
+  uint16_t rto;
+} RttEstimate;
+
+//! Transmit counters of a CoreAPI. With write combining off every frame is a write.
+typedef struct TxStats
+{
+  uint32_t frames;
+  //! @note HardDriver::send() calls, one syscall each on Linux
+  uint32_t writes;
+  uint32_t bytes;
+  //! @note why the combining buffer was written out
+  uint32_t flushFull;
+  uint32_t flushTick;
+  uint32_t flushDeadline;
+  uint32_t flushExplicit;
+  //! @note time frames waited in the buffer, in microseconds
+  uint32_t maxDelayUs;
+  uint64_t totalDelayUs;
+} TxStats;
 #ifdef SDK_DEV
 #include "devtype.h"
 #endif // SDK_DEV
@@ -21,6 +21,18 @@ namespace DJI
 namespace onboardSDK
 {
 
+//! Report of WayPoint::decimate()
+typedef struct WayPointDecimation
+{
+  size_t inputPoints;
+  size_t outputPoints;
+  //! @note points kept because of actions, damping or a turn mode change
+  size_t pinnedPoints;
+  float32_t maxCrossTrack;
+  float32_t maxAltitude;
+  float32_t savedUploadMs;
+} WayPointDecimation;
+
 class WayPoint
 {
   public:
@@ -65,6 +77,29 @@ class WayPoint
   void setInfo(const WayPointInitData &value);
   WayPointInitData getInfo() const;
   void setIndex(WayPointData *value, size_t pos);
+
+  /**
+   * @brief
+   * Drop nearly collinear points before uploading a mission (Douglas-Peucker
+   * in a local ENU frame around the first point).
+   *
+   * A point is removed only if it lies within crossTrack meters horizontally
+   * and altitude meters vertically of the segment between the kept points
+   * around it. First and last points, points with actions or damping, and
+   * points where turnMode changes are always kept. The list is compacted in
+   * place and re-indexed from 0, the new length is returned.
+   *
+   * @note pointUploadMs is the round trip assumed per uploaded point for
+   * savedUploadMs, WayPointUploader::getStats() gives a measured one.
+   */
+  static size_t decimate(WayPointData *list, size_t count, float32_t crossTrack,
+      float32_t altitude, WayPointDecimation *report = 0, float32_t pointUploadMs = 20);
+  //! @note local copy of a point set with setIndex(), 0 if out of range
+  const WayPointData *getIndexData(uint8_t pos) const;
+
+  CoreAPI *getApi() const;
+  void setApi(CoreAPI *value);
+
   static void idleVelocityCallback(CoreAPI *api, Header *protocolHeader, UserData wpapi);
   static void getWaypointSettingsCallback(CoreAPI *api, Header *protocolHeader, UserData wpapi);
   static void uploadIndexDataCallback(CoreAPI *api, Header *protocolHeader, UserData wpapi);
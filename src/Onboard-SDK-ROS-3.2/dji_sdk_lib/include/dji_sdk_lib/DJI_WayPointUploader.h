@@ -0,0 +1,184 @@
+/** @file DJI_WayPointUploader.h
+ *  @version 3.1.9
+ *  @date November 10, 2016
+ *
+ *  @brief
+ *  Pipelined waypoint upload for DJI onboardSDK library
+ *
+ *  @copyright 2016 DJI. All rights reserved.
+ *
+ */
+
+#ifndef DJI_WAYPOINTUPLOADER_H
+#define DJI_WAYPOINTUPLOADER_H
+
+#include "DJI_WayPoint.h"
+#include "DJI_Thread.h"
+
+#ifdef __linux__
+
+namespace DJI
+{
+namespace onboardSDK
+{
+
+//! Result of the last WayPointUploader::upload(). Times are in microseconds.
+typedef struct UploadStats
+{
+  uint16_t points;
+  uint16_t uploaded;
+  uint16_t failed;
+  uint32_t sends;
+  uint32_t retries;
+  uint32_t readbacks;
+  uint32_t mismatches;
+  time_us totalUs;
+  time_us minRttUs;
+  time_us maxRttUs;
+  double meanRttUs;
+} UploadStats;
+
+//! Result of the last WayPointUploader::sync().
+typedef struct SyncStats
+{
+  bool fullInit;
+  uint16_t points;
+  uint16_t uploaded;
+  uint16_t skipped;
+  uint16_t failed;
+  //! @note round trips of a plain init and full upload minus the ones sync() used
+  int32_t savedRoundTrips;
+} SyncStats;
+
+//! WayPointUploader keeps several waypoint uploads in flight at once.
+/*!\remark
+ *  WayPoint::uploadIndexData(WayPointData *, int) waits for every ACK before
+ *  the next point is sent. The uploader instead sends up to getWindow() points
+ *  on separate auto sessions, matches ACKs by waypoint index and retries each
+ *  point on its own. With setReadback(true) every accepted point is read back
+ *  with CODE_WAYPOINT_INDEX_READ in the same pipeline and re-uploaded if it
+ *  differs.
+ *
+ *   WayPoint wp(&api);
+ *   wp.init(&info, 1000);
+ *   for (...) wp.setIndex(&point, point.index);
+ *   WayPointUploader uploader(&wp);
+ *   uploader.upload(10000);
+ *
+ *  upload() blocks the calling thread. The ACK callbacks run on the read
+ *  thread, so readPoll() and sendPoll() must keep running meanwhile.
+ *
+ *  sync() uploads only what changed since the flight controller last
+ *  confirmed the mission. It reads the settings back first and runs a full
+ *  init only if they differ, then uploads the points whose content hash
+ *  differs from the one confirmed by the last ACK (or readback).
+ *
+ *  @note the window is limited by the session memory (MEMORY_SIZE), see
+ *  getMaxWindow().
+ *  @note timeouts of upload() and sync() are in milliseconds.
+ */
+class WayPointUploader
+{
+  public:
+  WayPointUploader(WayPoint *WayPointAPI = 0);
+  ~WayPointUploader();
+
+  //! @note upload every point of the mission, return true if all were accepted
+  bool upload(int timeout);
+  //! @note upload only the listed indexes
+  bool upload(const uint8_t *indexes, uint16_t count, int timeout);
+  //! @note make the flight controller mission match the local one
+  bool sync(int timeout);
+  //! @note forget what the flight controller confirmed, next sync() uploads everything
+  void invalidate();
+  //! @note release the sessions still waiting for an ACK, see CoreAPI::cancelSessions();
+  //! call it when no upload() or sync() is running, the destructor does
+  void cancel();
+
+  void setWindow(uint8_t value);
+  uint8_t getWindow() const;
+  uint8_t getMaxWindow() const;
+  //! @note attempts per point and time to wait for each ACK
+  void setRetry(uint8_t retry, int ackTimeout = 1000);
+  void setReadback(bool value);
+  bool getReadback() const;
+
+  UploadStats getStats() const;
+  SyncStats getSyncStats() const;
+  //! @note round trip of the last accepted attempt, 0 if the point failed
+  time_us getPointRtt(uint8_t index) const;
+
+  public: //! @note Access method
+  WayPoint *getWayPoint() const;
+  void setWayPoint(WayPoint *value);
+
+  static void addPointCallback(CoreAPI *api, Header *protocolHeader, UserData slot);
+  static void readbackCallback(CoreAPI *api, Header *protocolHeader, UserData slot);
+  static void requestCallback(CoreAPI *api, Header *protocolHeader, UserData uploader);
+
+  private:
+  enum SlotState
+  {
+    SLOT_IDLE = 0,
+    SLOT_WAIT_ADD,
+    SLOT_WAIT_READ,
+    SLOT_ADD_ACKED,
+    SLOT_READ_ACKED
+  };
+
+  typedef struct Slot
+  {
+    WayPointUploader *owner;
+    SlotState state;
+    uint8_t index;
+    uint8_t attempts;
+    uint8_t ack;
+    //! @note no session was available, send again without counting an attempt
+    bool unsent;
+    time_us sentAt;
+    time_us deadline;
+    WayPointData readback;
+  } Slot;
+
+  bool issue(Slot *slot, bool readback);
+  void retry(Slot *slot);
+  void finish(Slot *slot, bool ok);
+  void onAck(Slot *slot, Header *protocolHeader, bool readback);
+  static bool samePoint(const WayPointData &a, const WayPointData &b);
+  bool request(uint8_t cmd, void *data, size_t len, time_us end);
+  static uint32_t hash(const void *data, size_t len);
+  static uint32_t hashInfo(const WayPointInitData &info);
+
+  WayPoint *wp;
+
+  uint8_t window;
+  uint8_t retryTimes;
+  int ackTimeout;
+  bool readbackEnable;
+
+  mutable pthread_mutex_t lock;
+  pthread_cond_t cond;
+  Slot slots[SESSION_TABLE_NUM];
+  UploadStats stats;
+  double rttSum;
+  time_us pointRtt[256];
+  bool accepted[256];
+
+  //! @note single blocking request outside the window (settings read, init)
+  bool requestDone;
+  uint8_t requestAck[MAX_ACK_SIZE];
+  size_t requestLen;
+
+  //! @note content last confirmed by the flight controller
+  bool initValid;
+  uint32_t confirmedInit;
+  bool pointValid[256];
+  uint32_t confirmedPoint[256];
+  SyncStats syncStats;
+};
+
+} // namespace onboardSDK
+} // namespace DJI
+
+#endif // __linux__
+#endif // DJI_WAYPOINTUPLOADER_H
@@ -35,12 +35,45 @@ CoreAPI::init(HardDriver* sDevice, CallBackHandler userRecvCallback,
               bool userCallbackThread)
 {
   serialDevice = sDevice;
+  kinematics.setDriver(sDevice);
   // serialDevice->init();
 
   seq_num              = 0;
+  encryption           = DJI::onboardSDK::encrypt;
   ackFrameStatus       = 11;
   broadcastFrameStatus = false;
 
+  ackCallback        = 0;
+  ackUserData        = 0;
+  ackRunning         = 0;
+  ackHeader          = 0;
+  triggers           = 0;
+  missionEvents      = 0;
+  homepointPrevState = 0;
+  homepointCurrState = 0;
+
+  adaptiveTimeout = false;
+  minTimeout      = POLL_TICK;
+  maxTimeout      = 2000;
+  memset(rtt, 0, sizeof(rtt));
+
+  txCombine                  = false;
+  txDeadlineUs               = 300;
+  txLength                   = 0;
+  txFrames                   = 0;
+  txOldest                   = 0;
+  txAppendSum                = 0;
+  txPendingCallback.callback = 0;
+  txPendingCallback.userData = 0;
+  memset(&txStats, 0, sizeof(txStats));
+#if TX_QUEUE_NUM > 0
+  for (int i = 0; i < TX_QUEUE_NUM; ++i)
+    txQueue[i].turn = i;
+  txHead  = 0;
+  txTail  = 0;
+  txDrain = 0;
+#endif
+
   filter.recvIndex  = 0;
   filter.reuseCount = 0;
   filter.reuseIndex = 0;
@@ -63,6 +96,7 @@ CoreAPI::init(HardDriver* sDevice, CallBackHandler userRecvCallback,
 
   recvCallback.callback = userRecvCallback.callback;
   recvCallback.userData = userRecvCallback.userData;
+  setupDispatch();
 
   callbackThread = false;
   hotPointData   = false;
@@ -73,13 +107,15 @@ CoreAPI::init(HardDriver* sDevice, CallBackHandler userRecvCallback,
   nonBlockingCBThreadEnable = false;
   ack_data                  = 99;
   versionData.fwVersion     = 0; //! Default init value
+  versionData.hwVersion[0]  = 0;
   ack_activation            = 0xFF;
+  resolveFirmwareBehaviour();
 
 
   //! @todo simplify code above
-  serialDevice->lockMSG();
+  LockPolicy::lockMSG(serialDevice);
   memset((unsigned char*)&broadcastData, 0, sizeof(broadcastData));
-  serialDevice->freeMSG();
+  LockPolicy::freeMSG(serialDevice);
 
   setup();
 }
@@ -96,17 +132,20 @@ CoreAPI::send(unsigned char session, unsigned char is_enc, CMD_SET cmdSet,
               unsigned char cmdID, void* pdata, int len, CallBack ackCallback,
               int timeout, int retry)
 {
+  //! @note staged per thread, or shared under lockSend() without API_LOCK_FREE
+  static API_THREAD_LOCAL unsigned char stage[BUFFER_SIZE];
   Command        param;
-  unsigned char* ptemp = (unsigned char*)encodeSendData;
+  LockPolicy::lockSend(serialDevice);
+  unsigned char* ptemp = stage;
   *ptemp++             = cmdSet;
   *ptemp++             = cmdID;
 
-  memcpy(encodeSendData + SET_CMD_SIZE, pdata, len);
+  memcpy(stage + SET_CMD_SIZE, pdata, len);
 
   param.handler     = ackCallback;
   param.sessionMode = session;
   param.length      = len + SET_CMD_SIZE;
-  param.buf         = encodeSendData;
+  param.buf         = stage;
   param.retry       = retry;
 
   param.timeout = timeout;
@@ -115,6 +154,7 @@ CoreAPI::send(unsigned char session, unsigned char is_enc, CMD_SET cmdSet,
   param.userData = 0;
 
   sendInterface(&param);
+  LockPolicy::freeSend(serialDevice);
 }
 
 void
@@ -122,17 +162,19 @@ CoreAPI::send(unsigned char session_mode, bool is_enc, CMD_SET cmd_set,
               unsigned char cmd_id, void* pdata, size_t len, int timeout,
               int retry_time, CallBack ack_handler, UserData userData)
 {
+  static API_THREAD_LOCAL unsigned char stage[BUFFER_SIZE];
   Command        param;
-  unsigned char* ptemp = (unsigned char*)encodeSendData;
+  LockPolicy::lockSend(serialDevice);
+  unsigned char* ptemp = stage;
   *ptemp++             = cmd_set;
   *ptemp++             = cmd_id;
 
-  memcpy(encodeSendData + SET_CMD_SIZE, pdata, len);
+  memcpy(stage + SET_CMD_SIZE, pdata, len);
 
   param.handler     = ack_handler;
   param.sessionMode = session_mode;
   param.length      = len + SET_CMD_SIZE;
-  param.buf         = encodeSendData;
+  param.buf         = stage;
   param.retry       = retry_time;
 
   param.timeout = timeout;
@@ -141,12 +183,16 @@ CoreAPI::send(unsigned char session_mode, bool is_enc, CMD_SET cmd_set,
   param.userData = userData;
 
   sendInterface(&param);
+  LockPolicy::freeSend(serialDevice);
 }
 
-void
+int
 CoreAPI::send(Command* parameter)
 {
-  sendInterface(parameter);
+  LockPolicy::lockSend(serialDevice);
+  int ans = sendInterface(parameter);
+  LockPolicy::freeSend(serialDevice);
+  return ans;
 }
 
 void
@@ -212,6 +258,7 @@ CoreAPI::getDroneVersion(int timeout)
     versionData.version_crc     = 0x0;
     versionData.fwVersion       = 0;
     versionData.version_name[0] = 0;
+    resolveFirmwareBehaviour();
   }
 
   return versionData;
@@ -437,9 +484,33 @@ CoreAPI::parseDroneVersionInfo(unsigned char* ackPtrIncoming)
             this->versionData.version_crc);
   }
 
+  resolveFirmwareBehaviour();
   return true;
 }
 
+void
+CoreAPI::resolveFirmwareBehaviour()
+{
+  Version fw = versionData.fwVersion;
+
+  firmware.isM100         = strcmp(versionData.hwVersion, "M100") == 0;
+  firmware.fullTimeStamp  = fw > MAKE_VERSION(3, 1, 0, 0);
+  firmware.hasGimbalLimit = fw != versionM100_23;
+  firmware.hasCtrlMode    = fw != versionM100_23;
+  firmware.homepointOffset =
+    (fw > MAKE_VERSION(3, 2, 0, 0) && fw < MAKE_VERSION(3, 2, 15, 39)) ||
+    fw == MAKE_VERSION(3, 2, 100, 0);
+  firmware.needModeF = fw < MAKE_VERSION(3, 2, 0, 0);
+
+  firmware.broadcastChannels = firmware.isM100 ? 12 : 14;
+  firmware.gimbalSize =
+    sizeof(GimbalData) - (fw < MAKE_VERSION(3, 1, 0, 0) ? 1 : 0);
+  firmware.ctrlInfoSize =
+    sizeof(CtrlInfoData) - (fw < MAKE_VERSION(3, 1, 0, 0) ? 1 : 0);
+  //! @note see setBroadcastFreqDefaults() for the channel layouts
+  firmware.flightStatusFlag = firmware.isM100 ? (1 << 9) : (1 << 11);
+}
+
 void
 CoreAPI::activate(ActivateData* data, CallBack callback, UserData userData)
 {
@@ -513,22 +584,10 @@ CoreAPI::setBroadcastFreq(uint8_t* dataLenIs16, CallBack callback,
   //! @note see also enum BROADCAST_FREQ in DJI_API.h
   for (int i = 0; i < 16; ++i)
   {
-    if (strcmp(versionData.hwVersion, "M100") == 0)
-      if (i < 12)
-      {
-        dataLenIs16[i] = (dataLenIs16[i] > 5 ? 5 : dataLenIs16[i]);
-      }
-      else
-        dataLenIs16[i] = 0;
+    if (i < firmware.broadcastChannels)
+      dataLenIs16[i] = (dataLenIs16[i] > 5 ? 5 : dataLenIs16[i]);
     else
-    {
-      if (i < 14)
-      {
-        dataLenIs16[i] = (dataLenIs16[i] > 5 ? 5 : dataLenIs16[i]);
-      }
-      else
-        dataLenIs16[i] = 0;
-    }
+      dataLenIs16[i] = 0;
   }
   send(2, 0, SET_ACTIVATION, CODE_FREQUENCY, dataLenIs16, 16, 100, 1,
        callback ? callback : CoreAPI::setFrequencyCallback, userData);
@@ -540,22 +599,10 @@ CoreAPI::setBroadcastFreq(uint8_t* dataLenIs16, int timeout)
   //! @note see also enum BROADCAST_FREQ in DJI_API.h
   for (int i = 0; i < 16; ++i)
   {
-    if (strcmp(versionData.hwVersion, "M100") == 0)
-      if (i < 12)
-      {
-        dataLenIs16[i] = (dataLenIs16[i] > 5 ? 5 : dataLenIs16[i]);
-      }
-      else
-        dataLenIs16[i] = 0;
+    if (i < firmware.broadcastChannels)
+      dataLenIs16[i] = (dataLenIs16[i] > 5 ? 5 : dataLenIs16[i]);
     else
-    {
-      if (i < 14)
-      {
-        dataLenIs16[i] = (dataLenIs16[i] > 5 ? 5 : dataLenIs16[i]);
-      }
-      else
-        dataLenIs16[i] = 0;
-    }
+      dataLenIs16[i] = 0;
   }
   send(2, 0, SET_ACTIVATION, CODE_FREQUENCY, dataLenIs16, 16, 100, 1, 0, 0);
 
@@ -567,9 +614,9 @@ CoreAPI::setBroadcastFreq(uint8_t* dataLenIs16, int timeout)
 }
 
 void
-CoreAPI::setBroadcastFreqDefaults()
+CoreAPI::getBroadcastFreqDefaults(uint8_t* freq) const
 {
-  uint8_t freq[16];
+  memset(freq, BROADCAST_FREQ_0HZ, 16);
 
   /* Channels definition:
    * M100:
@@ -604,7 +651,7 @@ CoreAPI::setBroadcastFreqDefaults()
    *
    */
 
-  if (strcmp(versionData.hwVersion, "M100") == 0)
+  if (firmware.isM100)
   {
     freq[0]  = BROADCAST_FREQ_1HZ;
     freq[1]  = BROADCAST_FREQ_10HZ;
@@ -636,6 +683,13 @@ CoreAPI::setBroadcastFreqDefaults()
     freq[12] = BROADCAST_FREQ_50HZ;
     freq[13] = BROADCAST_FREQ_10HZ;
   }
+}
+
+void
+CoreAPI::setBroadcastFreqDefaults()
+{
+  uint8_t freq[16];
+  getBroadcastFreqDefaults(freq);
   setBroadcastFreq(freq);
 }
 
@@ -698,73 +752,7 @@ unsigned short
 CoreAPI::setBroadcastFreqDefaults(int timeout)
 {
   uint8_t freq[16];
-
-  /* Channels definition:
-   * M100:
-   * 0 - Timestamp
-   * 1 - Attitude Quaterniouns
-   * 2 - Acceleration
-   * 3 - Velocity (Ground Frame)
-   * 4 - Angular Velocity (Body Frame)
-   * 5 - Position
-   * 6 - Magnetometer
-   * 7 - RC Channels Data
-   * 8 - Gimbal Data
-   * 9 - Flight Status
-   * 10 - Battery Level
-   * 11 - Control Information
-   *
-   * A3:
-   * 0 - Timestamp
-   * 1 - Attitude Quaterniouns
-   * 2 - Acceleration
-   * 3 - Velocity (Ground Frame)
-   * 4 - Angular Velocity (Body Frame)
-   * 5 - Position
-   * 6 - GPS Detailed Information
-   * 7 - RTK Detailed Information
-   * 8 - Magnetometer
-   * 9 - RC Channels Data
-   * 10 - Gimbal Data
-   * 11 - Flight Status
-   * 12 - Battery Level
-   * 13 - Control Information
-   *
-   */
-
-  if (strcmp(versionData.hwVersion, "M100") == 0)
-  {
-    freq[0]  = BROADCAST_FREQ_1HZ;
-    freq[1]  = BROADCAST_FREQ_10HZ;
-    freq[2]  = BROADCAST_FREQ_50HZ;
-    freq[3]  = BROADCAST_FREQ_100HZ;
-    freq[4]  = BROADCAST_FREQ_50HZ;
-    freq[5]  = BROADCAST_FREQ_10HZ;
-    freq[6]  = BROADCAST_FREQ_1HZ;
-    freq[7]  = BROADCAST_FREQ_10HZ;
-    freq[8]  = BROADCAST_FREQ_50HZ;
-    freq[9]  = BROADCAST_FREQ_100HZ;
-    freq[10] = BROADCAST_FREQ_50HZ;
-    freq[11] = BROADCAST_FREQ_10HZ;
-  }
-  else
-  { //! A3/N3/M600
-    freq[0]  = BROADCAST_FREQ_1HZ;
-    freq[1]  = BROADCAST_FREQ_10HZ;
-    freq[2]  = BROADCAST_FREQ_50HZ;
-    freq[3]  = BROADCAST_FREQ_100HZ;
-    freq[4]  = BROADCAST_FREQ_50HZ;
-    freq[5]  = BROADCAST_FREQ_10HZ;
-    freq[6]  = BROADCAST_FREQ_0HZ;
-    freq[7]  = BROADCAST_FREQ_0HZ;
-    freq[8]  = BROADCAST_FREQ_1HZ;
-    freq[9]  = BROADCAST_FREQ_10HZ;
-    freq[10] = BROADCAST_FREQ_50HZ;
-    freq[11] = BROADCAST_FREQ_100HZ;
-    freq[12] = BROADCAST_FREQ_50HZ;
-    freq[13] = BROADCAST_FREQ_10HZ;
-  }
-
+  getBroadcastFreqDefaults(freq);
   return setBroadcastFreq(freq, timeout);
 }
 
@@ -832,7 +820,7 @@ void
 CoreAPI::setControl(bool enable, CallBack callback, UserData userData)
 {
   unsigned char data = enable ? 1 : 0;
-  send(2, DJI::onboardSDK::encrypt, SET_CONTROL, CODE_SETCONTROL, &data, 1, 500,
+  send(2, encryption, SET_CONTROL, CODE_SETCONTROL, &data, 1, 500,
        2, callback ? callback : CoreAPI::setControlCallback, userData);
 }
 
@@ -840,7 +828,7 @@ unsigned short
 CoreAPI::setControl(bool enable, int timeout)
 {
   unsigned char data = enable ? 1 : 0;
-  send(2, DJI::onboardSDK::encrypt, SET_CONTROL, CODE_SETCONTROL, &data, 1, 500,
+  send(2, encryption, SET_CONTROL, CODE_SETCONTROL, &data, 1, 500,
        2, 0, 0);
 
   // Wait for end of ACK frame to arrive
@@ -850,7 +838,7 @@ CoreAPI::setControl(bool enable, int timeout)
 
   if (missionACKUnion.simpleACK == ACK_SETCONTROL_ERROR_MODE)
   {
-    if (versionData.fwVersion < MAKE_VERSION(3, 2, 0, 0))
+    if (firmware.needModeF)
       missionACKUnion.simpleACK = ACK_SETCONTROL_NEED_MODE_F;
     else
       missionACKUnion.simpleACK = ACK_SETCONTROL_NEED_MODE_P;
@@ -875,6 +863,7 @@ void
 CoreAPI::setDriver(HardDriver* sDevice)
 {
   serialDevice = sDevice;
+  kinematics.setDriver(sDevice);
 }
 
 void
@@ -887,6 +876,7 @@ CoreAPI::getDroneVersionCallback(CoreAPI* api, Header* protocolHeader,
     api->versionData.version_crc     = 0x0;
     api->versionData.fwVersion       = 0;
     api->versionData.version_name[0] = 0;
+    api->resolveFirmwareBehaviour();
   }
 }
 
@@ -1218,6 +1208,74 @@ CoreAPI::getHwVersion() const
 {
   return (char*)versionData.hwVersion;
 }
+const FirmwareBehaviour&
+CoreAPI::getFirmwareBehaviour() const
+{
+  return firmware;
+}
+
+void
+CoreAPI::setVersionData(const VersionData& data)
+{
+  versionData = data;
+  resolveFirmwareBehaviour();
+}
+
+const VersionData&
+CoreAPI::getVersionData() const
+{
+  return versionData;
+}
+
+uint8_t
+CoreAPI::getEncrypt() const
+{
+  return encryption;
+}
+
+void
+CoreAPI::setEncrypt(uint8_t value)
+{
+  encryption = value;
+}
+
+void
+CoreAPI::setAdaptiveTimeout(bool enable, uint16_t minMs, uint16_t maxMs)
+{
+  LockPolicy::lockMemory(serialDevice);
+  minTimeout      = minMs > POLL_TICK ? minMs : POLL_TICK;
+  maxTimeout      = maxMs > minTimeout ? maxMs : minTimeout;
+  adaptiveTimeout = enable;
+  LockPolicy::freeMemory(serialDevice);
+}
+
+bool
+CoreAPI::getAdaptiveTimeout() const
+{
+  return adaptiveTimeout;
+}
+
+RttEstimate
+CoreAPI::getRttEstimate(CMD_SET cmdSet) const
+{
+  RttEstimate ans;
+  memset(&ans, 0, sizeof(ans));
+  if ((size_t)cmdSet >= RTT_SET_NUM)
+    return ans;
+  LockPolicy::lockMemory(serialDevice);
+  ans = rtt[cmdSet];
+  LockPolicy::freeMemory(serialDevice);
+  return ans;
+}
+
+void
+CoreAPI::resetRttEstimate()
+{
+  LockPolicy::lockMemory(serialDevice);
+  memset(rtt, 0, sizeof(rtt));
+  LockPolicy::freeMemory(serialDevice);
+}
+
 char*
 CoreAPI::getHwSerialNum() const
 {
@@ -1253,7 +1311,7 @@ CoreAPI::setControlCallback(CoreAPI* api, Header* protocolHeader,
   switch (ack_data)
   {
     case ACK_SETCONTROL_ERROR_MODE:
-      if (api->versionData.fwVersion < MAKE_VERSION(3, 2, 0, 0))
+      if (api->firmware.needModeF)
       {
         API_LOG(api->serialDevice, STATUS_LOG,
                 "Obtain control failed: switch to F mode\n");
@@ -1272,13 +1330,13 @@ CoreAPI::setControlCallback(CoreAPI* api, Header* protocolHeader,
       break;
     case ACK_SETCONTROL_OBTAIN_RUNNING:
       API_LOG(api->serialDevice, STATUS_LOG, "Obtain control running\n");
-      api->send(2, DJI::onboardSDK::encrypt, SET_CONTROL, CODE_SETCONTROL,
+      api->send(2, api->getEncrypt(), SET_CONTROL, CODE_SETCONTROL,
                 &data, 1, 500, 2, CoreAPI::setControlCallback);
       break;
     case ACK_SETCONTROL_RELEASE_RUNNING:
       API_LOG(api->serialDevice, STATUS_LOG, "Release control running\n");
       data = 0;
-      api->send(2, DJI::onboardSDK::encrypt, SET_CONTROL, CODE_SETCONTROL,
+      api->send(2, api->getEncrypt(), SET_CONTROL, CODE_SETCONTROL,
                 &data, 1, 500, 2, CoreAPI::setControlCallback);
       break;
     case ACK_SETCONTROL_IOC:
@@ -14,6 +14,9 @@
 #include <DJI_Flight.h>
 #include "DJI_App.h"
 #include "DJI_API.h"
+#include "DJI_Trigger.h"
+#include "DJI_MissionEvent.h"
+#include "DJI_Thread.h"
 
 using namespace DJI;
 using namespace DJI::onboardSDK;
@@ -44,9 +47,9 @@ unsigned char getCmdCode(Header *protocolHeader)
 }
 
 BroadcastData DJI::onboardSDK::CoreAPI::getBroadcastData() const {
-  serialDevice->lockMSG();
+  LockPolicy::lockMSG(serialDevice);
   BroadcastData data = broadcastData;
-  serialDevice->freeMSG();
+  LockPolicy::freeMSG(serialDevice);
   return data;
 }
 
@@ -54,6 +57,14 @@ BatteryData DJI::onboardSDK::CoreAPI::getBatteryCapacity() const { return getBro
 
 CtrlInfoData DJI::onboardSDK::CoreAPI::getCtrlInfo() const { return getBroadcastData().ctrlInfo; }
 
+uint8_t DJI::onboardSDK::CoreAPI::getPositionHealth() const
+{
+  LockPolicy::lockMSG(serialDevice);
+  uint8_t health = broadcastData.pos.health;
+  LockPolicy::freeMSG(serialDevice);
+  return health;
+}
+
 void DJI::onboardSDK::CoreAPI::setBroadcastFrameStatus(bool isFrame)
 {
   broadcastFrameStatus = isFrame;
@@ -71,13 +82,11 @@ void DJI::onboardSDK::CoreAPI::broadcast(Header *protocolHeader)
 {
   unsigned char *pdata = ((unsigned char *)protocolHeader) + sizeof(Header);
   unsigned short *enableFlag;
-  serialDevice->lockMSG();
+  LockPolicy::lockMSG(serialDevice);
   pdata += 2;
   enableFlag = (unsigned short *)pdata;
   broadcastData.dataFlag = *enableFlag;
   size_t len = MSG_ENABLE_FLAG_LEN;
-  static int currentState = 0;
-  static int prevState = 0;
 
   //! @warning Change to const (+change interface for passData) in next release
   uint16_t DATA_FLAG = 0x0001;
@@ -93,7 +102,7 @@ void DJI::onboardSDK::CoreAPI::broadcast(Header *protocolHeader)
    */
   broadcastData.activation = ack_activation;
 
-  if (versionData.fwVersion > MAKE_VERSION(3,1,0,0))
+  if (firmware.fullTimeStamp)
     passData(*enableFlag, DATA_FLAG, &broadcastData.timeStamp, pdata, sizeof(TimeStampData),
         len);
   else
@@ -106,7 +115,7 @@ void DJI::onboardSDK::CoreAPI::broadcast(Header *protocolHeader)
   passData(*enableFlag, DATA_FLAG, &broadcastData.w, pdata, sizeof(CommonData), len);
   passData(*enableFlag, DATA_FLAG, &broadcastData.pos, pdata, sizeof(PositionData), len);
 
-  if (strcmp(versionData.hwVersion, "M100") != 0) //! N3/A3/M600
+  if (!firmware.isM100) //! N3/A3/M600
   {
     passData(*enableFlag, DATA_FLAG, &broadcastData.gps, pdata, sizeof(GPSData), len);
     passData(*enableFlag, DATA_FLAG, &broadcastData.rtk, pdata, sizeof(RTKData), len);
@@ -117,40 +126,47 @@ void DJI::onboardSDK::CoreAPI::broadcast(Header *protocolHeader)
   }
   passData(*enableFlag, DATA_FLAG, &broadcastData.mag, pdata, sizeof(MagnetData), len);
   passData(*enableFlag, DATA_FLAG, &broadcastData.rc, pdata, sizeof(RadioData), len);
-  passData(*enableFlag, DATA_FLAG, &broadcastData.gimbal, pdata,
-      sizeof(GimbalData) - ((versionData.fwVersion < MAKE_VERSION(3,1,0,0)) ? 1 : 0), len);
+  passData(*enableFlag, DATA_FLAG, &broadcastData.gimbal, pdata, firmware.gimbalSize, len);
   passData(*enableFlag, DATA_FLAG, &broadcastData.status, pdata, sizeof(FlightStatus), len);
   passData(*enableFlag, DATA_FLAG, &broadcastData.battery, pdata, sizeof(BatteryData), len);
-  passData(*enableFlag, DATA_FLAG, &broadcastData.ctrlInfo, pdata,
-      sizeof(CtrlInfoData) - ((versionData.fwVersion < MAKE_VERSION(3,1,0,0)) ? 1 : 0), len);
-  serialDevice->freeMSG();
+  passData(*enableFlag, DATA_FLAG, &broadcastData.ctrlInfo, pdata, firmware.ctrlInfoSize, len);
+  //! @note quaternion and velocity are the second and fourth channel on every firmware
+  if ((*enableFlag) & 0x000A)
+    kinematics.publish(broadcastData.q, broadcastData.v, broadcastData.timeStamp.time);
+  //! Values needed by the homepoint state machine below, read while still locked
+  uint8_t posHealth = broadcastData.pos.health;
+  float32_t posAltitude = broadcastData.pos.altitude;
+  int flightStatus = broadcastData.status;
+  //! Only the triggers on channels of this frame, fired once unlocked
+  TriggerRegistry *frameTriggers = triggers;
+  uint32_t fired = frameTriggers ? frameTriggers->evaluate(broadcastData, *enableFlag, firmware) : 0;
+  LockPolicy::freeMSG(serialDevice);
 
   /**
    * Set broadcast frame status
    * @todo Implement proper notification mechanism
    */
   setBroadcastFrameStatus(true);
-  static int counter=0;
 
   //! State Machine for MSL Altitude bug in A3 and M600
   //! Handles the case if users start OSDK after arming aircraft (STATUS_ON_GROUND)/after takeoff (STATUS_IN_AIR)
   //! Transition from STATUS_MOTOR_STOPPED to STATUS_ON_GROUND can be seen with Takeoff command with 1hz flight status data
   //! Transition from STATUS_ON_GROUND to STATUS_MOTOR_STOPPED can be seen with Landing command only for frequencies >= 50Hz
-  if (strcmp(getHwVersion(), "M100") != 0)
+  if (!firmware.isM100)
   {//! Only runs if Flight status is available
-  if((*enableFlag) & (1<<11)) {
-    if (getBroadcastData().pos.health > 3) {
-      if (getFlightStatus() != currentState) {
-        prevState = currentState;
-        currentState = getFlightStatus();
-        if (prevState == Flight::STATUS_MOTOR_OFF && currentState == Flight::STATUS_GROUND_STANDBY) {
-          homepointAltitude = getBroadcastData().pos.altitude;
+  if((*enableFlag) & firmware.flightStatusFlag) {
+    if (posHealth > 3) {
+      if (flightStatus != homepointCurrState) {
+        homepointPrevState = homepointCurrState;
+        homepointCurrState = flightStatus;
+        if (homepointPrevState == Flight::STATUS_MOTOR_OFF && homepointCurrState == Flight::STATUS_GROUND_STANDBY) {
+          homepointAltitude = posAltitude;
         }
-        if (prevState == Flight::STATUS_SKY_STANDBY && currentState == Flight::STATUS_GROUND_STANDBY) {
-          homepointAltitude = getBroadcastData().pos.altitude;
+        if (homepointPrevState == Flight::STATUS_SKY_STANDBY && homepointCurrState == Flight::STATUS_GROUND_STANDBY) {
+          homepointAltitude = posAltitude;
         }
         //! This case would exist if the user starts OSDK after take off.
-        else if (prevState == Flight::STATUS_MOTOR_OFF && currentState == Flight::STATUS_SKY_STANDBY) {
+        else if (homepointPrevState == Flight::STATUS_MOTOR_OFF && homepointCurrState == Flight::STATUS_SKY_STANDBY) {
           homepointAltitude = 999999;
         }
       }
@@ -159,114 +175,196 @@ void DJI::onboardSDK::CoreAPI::broadcast(Header *protocolHeader)
     }
    }
   }
+  if (fired)
+    frameTriggers->fire(fired);
   if (broadcastCallback.callback)
     broadcastCallback.callback(this, protocolHeader, broadcastCallback.userData);
 }
 #endif
 void DJI::onboardSDK::CoreAPI::recvReqData(Header *protocolHeader)
 {
-  unsigned char buf[100] = { 0, 0 };
+  FrameView frame;
+  frame.header = protocolHeader;
+  frame.cmdSet = getCmdSet(protocolHeader);
+  frame.cmdId = getCmdCode(protocolHeader);
+  frame.data = (const uint8_t *)protocolHeader + sizeof(Header) + SET_CMD_SIZE;
+  frame.length = protocolHeader->length > EXC_DATA_SIZE + SET_CMD_SIZE
+                     ? protocolHeader->length - EXC_DATA_SIZE - SET_CMD_SIZE
+                     : 0;
+
+  FrameCallBackHandler entry = { 0, 0 };
+  if (frame.cmdSet < DISPATCH_SET_NUM && frame.cmdId < DISPATCH_CODE_NUM)
+    entry = dispatch[frame.cmdSet][frame.cmdId];
+
+  if (entry.callback)
+    entry.callback(this, &frame, entry.userData);
+  else if (frame.cmdSet == SET_BROADCAST)
+  {
+    API_LOG(serialDevice, STATUS_LOG, "Unknown BROADCAST command code\n");
+  }
+  else
+    API_LOG(serialDevice, DEBUG_LOG, "Received unknown command\n");
+  if (recvCallback.callback)
+    recvCallback.callback(this, protocolHeader, recvCallback.userData);
+}
+
+void CoreAPI::setupDispatch()
+{
+  memset(dispatch, 0, sizeof(dispatch));
+  setFrameCallback(SET_BROADCAST, CODE_BROADCAST, broadcastFrame);
+  setFrameCallback(SET_BROADCAST, CODE_LOSTCTRL, lostControlFrame);
+  setFrameCallback(SET_BROADCAST, CODE_FROMMOBILE, fromMobileFrame);
+  setFrameCallback(SET_BROADCAST, CODE_MISSION, missionFrame);
+  setFrameCallback(SET_BROADCAST, CODE_WAYPOINT, wayPointEventFrame);
+}
+
+bool CoreAPI::setFrameCallback(uint8_t cmdSet, uint8_t cmdId, FrameCallBack handler, UserData userData)
+{
+  if (cmdSet >= DISPATCH_SET_NUM || cmdId >= DISPATCH_CODE_NUM)
+    return false;
+  dispatch[cmdSet][cmdId].callback = handler;
+  dispatch[cmdSet][cmdId].userData = userData;
+  return true;
+}
+
+FrameCallBackHandler CoreAPI::getFrameCallback(uint8_t cmdSet, uint8_t cmdId) const
+{
+  FrameCallBackHandler ans = { 0, 0 };
+  if (cmdSet < DISPATCH_SET_NUM && cmdId < DISPATCH_CODE_NUM)
+    ans = dispatch[cmdSet][cmdId];
+  return ans;
+}
 
-  uint8_t ack = *((unsigned char *)protocolHeader + sizeof(Header) + 2);
-  if (getCmdSet(protocolHeader) == SET_BROADCAST)
+void CoreAPI::resetFrameCallback(uint8_t cmdSet, uint8_t cmdId)
+{
+  FrameCallBack handler = 0;
+  if (cmdSet == SET_BROADCAST)
   {
-    switch (getCmdCode(protocolHeader))
+    switch (cmdId)
     {
       case CODE_BROADCAST:
-        broadcast(protocolHeader);
-        break;
-      case CODE_FROMMOBILE:
-        API_LOG(serialDevice, STATUS_LOG, "Receive data from mobile\n");
-        if (fromMobileCallback.callback)
-        {
-          fromMobileCallback.callback(this, protocolHeader, fromMobileCallback.userData);
-        }
-        else
-        {
-          parseFromMobileCallback(this, protocolHeader);
-        }
+        handler = broadcastFrame;
         break;
       case CODE_LOSTCTRL:
-        API_LOG(serialDevice, STATUS_LOG, "onboardSDK lost control\n");
-        Ack param;
-        if (protocolHeader->sessionID > 0)
-        {
-          buf[0] = buf[1] = 0;
-          param.sessionID = protocolHeader->sessionID;
-          param.seqNum = protocolHeader->sequenceNumber;
-          param.encrypt = protocolHeader->enc;
-          param.buf = buf;
-          param.length = 2;
-          ackInterface(&param);
-        }
+        handler = lostControlFrame;
+        break;
+      case CODE_FROMMOBILE:
+        handler = fromMobileFrame;
         break;
       case CODE_MISSION:
-        //! @todo add mission session decode
-        if (missionCallback.callback)
-          missionCallback.callback(this, protocolHeader, missionCallback.userData);
-        else
-        {
-          switch (ack)
-          {
-            case MISSION_MODE_A:
-              break;
-            case MISSION_WAYPOINT:
-              if (wayPointData)
-              {
-                if (wayPointCallback.callback)
-                  wayPointCallback.callback(this, protocolHeader,
-                      wayPointCallback.userData);
-                else
-                  API_LOG(serialDevice, STATUS_LOG, "Mode waypoint \n");
-              }
-              break;
-            case MISSION_HOTPOINT:
-              if (hotPointData)
-              {
-                if (hotPointCallback.callback)
-                  hotPointCallback.callback(this, protocolHeader,
-                      hotPointCallback.userData);
-                else
-                  API_LOG(serialDevice, STATUS_LOG, "Mode HP \n");
-              }
-              break;
-            case MISSION_FOLLOW:
-              if (followData)
-              {
-                if (followCallback.callback)
-                  followCallback.callback(this, protocolHeader,
-                      followCallback.userData);
-                else
-                  API_LOG(serialDevice, STATUS_LOG, "Mode Follow \n");
-              }
-              break;
-            case MISSION_IOC:
-              //! @todo compare IOC with other mission modes comprehensively
-              API_LOG(serialDevice, STATUS_LOG, "Mode IOC \n");
-              break;
-            default:
-              API_LOG(serialDevice, ERROR_LOG, "Unknown mission code 0x%X \n", ack);
-              break;
-          }
-        }
+        handler = missionFrame;
         break;
       case CODE_WAYPOINT:
-        //! @todo add waypoint session decode
-        if (wayPointEventCallback.callback)
-          wayPointEventCallback.callback(this, protocolHeader,
-              wayPointEventCallback.userData);
-        else
-          API_LOG(serialDevice, STATUS_LOG, "WAYPOINT DATA");
-        break;
-      default:
-        API_LOG(serialDevice, STATUS_LOG, "Unknown BROADCAST command code\n");
+        handler = wayPointEventFrame;
         break;
     }
   }
+  setFrameCallback(cmdSet, cmdId, handler);
+}
+
+void CoreAPI::broadcastFrame(CoreAPI *api, const FrameView *frame, UserData userData __UNUSED)
+{
+  api->broadcast(frame->header);
+}
+
+void CoreAPI::fromMobileFrame(CoreAPI *api, const FrameView *frame, UserData userData __UNUSED)
+{
+  API_LOG(api->serialDevice, STATUS_LOG, "Receive data from mobile\n");
+  if (api->fromMobileCallback.callback)
+    api->fromMobileCallback.callback(api, frame->header, api->fromMobileCallback.userData);
   else
-    API_LOG(serialDevice, DEBUG_LOG, "Received unknown command\n");
-  if (recvCallback.callback)
-    recvCallback.callback(this, protocolHeader, recvCallback.userData);
+    api->parseFromMobileCallback(api, frame->header);
+}
+
+void CoreAPI::lostControlFrame(CoreAPI *api, const FrameView *frame, UserData userData __UNUSED)
+{
+  API_LOG(api->serialDevice, STATUS_LOG, "onboardSDK lost control\n");
+  if (frame->header->sessionID > 0)
+  {
+    unsigned char buf[2] = { 0, 0 };
+    Ack param;
+    param.sessionID = frame->header->sessionID;
+    param.seqNum = frame->header->sequenceNumber;
+    param.encrypt = frame->header->enc;
+    param.buf = buf;
+    param.length = 2;
+    api->ackInterface(&param);
+  }
+}
+
+void CoreAPI::missionFrame(CoreAPI *api, const FrameView *frame, UserData userData __UNUSED)
+{
+  api->queueMissionEvent(frame);
+  if (api->missionCallback.callback)
+  {
+    api->missionCallback.callback(api, frame->header, api->missionCallback.userData);
+    return;
+  }
+
+  uint8_t ack = frame->length ? frame->data[0] : 0xFF;
+  switch (ack)
+  {
+    case MISSION_MODE_A:
+      break;
+    case MISSION_WAYPOINT:
+      if (api->wayPointData)
+      {
+        if (api->wayPointCallback.callback)
+          api->wayPointCallback.callback(api, frame->header, api->wayPointCallback.userData);
+        else
+          API_LOG(api->serialDevice, STATUS_LOG, "Mode waypoint \n");
+      }
+      break;
+    case MISSION_HOTPOINT:
+      if (api->hotPointData)
+      {
+        if (api->hotPointCallback.callback)
+          api->hotPointCallback.callback(api, frame->header, api->hotPointCallback.userData);
+        else
+          API_LOG(api->serialDevice, STATUS_LOG, "Mode HP \n");
+      }
+      break;
+    case MISSION_FOLLOW:
+      if (api->followData)
+      {
+        if (api->followCallback.callback)
+          api->followCallback.callback(api, frame->header, api->followCallback.userData);
+        else
+          API_LOG(api->serialDevice, STATUS_LOG, "Mode Follow \n");
+      }
+      break;
+    case MISSION_IOC:
+      //! @todo compare IOC with other mission modes comprehensively
+      API_LOG(api->serialDevice, STATUS_LOG, "Mode IOC \n");
+      break;
+    default:
+      API_LOG(api->serialDevice, ERROR_LOG, "Unknown mission code 0x%X \n", ack);
+      break;
+  }
+}
+
+void CoreAPI::wayPointEventFrame(CoreAPI *api, const FrameView *frame, UserData userData __UNUSED)
+{
+  api->queueMissionEvent(frame);
+  if (api->wayPointEventCallback.callback)
+    api->wayPointEventCallback.callback(api, frame->header, api->wayPointEventCallback.userData);
+  else
+    API_LOG(api->serialDevice, STATUS_LOG, "WAYPOINT DATA");
+}
+
+void CoreAPI::queueMissionEvent(const FrameView *frame)
+{
+  MissionEventQueue *queue = missionEvents;
+  MissionEvent event;
+  if (!queue || !MissionEventQueue::decode(frame->cmdId, frame->data, frame->length, &event))
+    return;
+#ifdef __linux__
+  event.hostTimeUs = monotonicTimeUs();
+#else
+  event.hostTimeUs = serialDevice->getTimeStamp() * 1000;
+#endif
+  event.fcTime = getTime();
+  queue->push(event);
 }
 
 void CoreAPI::setBroadcastCallback(CallBack userCallback, UserData userData)
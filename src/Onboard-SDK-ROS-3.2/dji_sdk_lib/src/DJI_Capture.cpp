@@ -0,0 +1,367 @@
+/** @file DJI_Capture.cpp
+ *  @version 3.1.9
+ *  @date November 10, 2016
+ *
+ *  @brief
+ *  Camera shots timed to predicted crossings of trigger positions
+ *
+ *  @copyright 2016 DJI. All rights reserved.
+ *
+ */
+
+#include "DJI_Capture.h"
+
+#ifdef __linux__
+#include <string.h>
+#include <math.h>
+
+using namespace DJI;
+using namespace DJI::onboardSDK;
+
+//! @note mean earth radius in meters, trigger spacing is small enough for a flat earth
+#define EARTH_RADIUS 6371000.0
+//! @note below this ground speed in m/s no crossing time is predicted
+#define CAPTURE_MIN_SPEED 0.2
+//! @note position channel of the broadcast enable flag, same on every firmware
+#define CAPTURE_POSITION_FLAG 0x0020
+
+CaptureScheduler::CaptureScheduler(Camera *CameraAPI)
+{
+  camera = 0;
+  api = 0;
+  previous.callback = 0;
+  previous.userData = 0;
+  pthread_mutex_init(&lock, 0);
+  mode = CAPTURE_IDLE;
+  pointCount = 0;
+  next = 0;
+  interval = 0;
+  memset(&anchor, 0, sizeof(anchor));
+  anchored = false;
+  tolerance = 5;
+  latency = 0;
+  memset(&last, 0, sizeof(last));
+  memset(&before, 0, sizeof(before));
+  samples = 0;
+  logCount = 0;
+  resetStats();
+  setCamera(CameraAPI);
+}
+
+CaptureScheduler::~CaptureScheduler()
+{
+  stop();
+  setCamera(0);
+  pthread_mutex_destroy(&lock);
+}
+
+bool CaptureScheduler::setPoints(const CapturePoint *points, size_t count)
+{
+  if (count > CAPTURE_POINT_MAX)
+    return false;
+  pthread_mutex_lock(&lock);
+  memcpy(point, points, count * sizeof(CapturePoint));
+  pointCount = count;
+  next = 0;
+  mode = CAPTURE_POINTS;
+  pthread_mutex_unlock(&lock);
+  return true;
+}
+
+void CaptureScheduler::setInterval(float64_t meters)
+{
+  pthread_mutex_lock(&lock);
+  interval = meters;
+  next = 0;
+  anchored = false;
+  mode = meters > 0 ? CAPTURE_DISTANCE : CAPTURE_IDLE;
+  pthread_mutex_unlock(&lock);
+}
+
+void CaptureScheduler::clear()
+{
+  pthread_mutex_lock(&lock);
+  mode = CAPTURE_IDLE;
+  pointCount = 0;
+  next = 0;
+  pthread_mutex_unlock(&lock);
+}
+
+CaptureMode CaptureScheduler::getMode() const { return mode; }
+
+uint32_t CaptureScheduler::getNextIndex() const { return next; }
+
+void CaptureScheduler::positionAt(const Sample &sample, time_us time, CapturePoint *out)
+{
+  float64_t dt = ((int64_t)time - (int64_t)sample.time) / 1000000.0;
+  out->latitude = sample.latitude + sample.north * dt / EARTH_RADIUS;
+  out->longitude = sample.longitude + sample.east * dt / (EARTH_RADIUS * cos(sample.latitude));
+}
+
+void CaptureScheduler::offset(const CapturePoint &from, const CapturePoint &to, float64_t *north,
+    float64_t *east)
+{
+  *north = (to.latitude - from.latitude) * EARTH_RADIUS;
+  *east = (to.longitude - from.longitude) * EARTH_RADIUS * cos(from.latitude);
+}
+
+void CaptureScheduler::tick(time_us deadline __UNUSED)
+{
+  Camera *target = camera;
+  time_us now = monotonicTimeUs();
+  time_us period = getRate() ? 1000000 / getRate() : 20000;
+  //! @note shots due before the next tick, plus the latency they are sent early
+  time_us horizon = period + latency;
+
+  CaptureRecord shot;
+  memset(&shot, 0, sizeof(shot));
+  bool fire = false;
+  time_us when = now;
+
+  pthread_mutex_lock(&lock);
+  if (!target || mode == CAPTURE_IDLE || samples == 0)
+  {
+    pthread_mutex_unlock(&lock);
+    return;
+  }
+
+  CapturePoint here;
+  positionAt(last, now, &here);
+  float64_t vn = last.north, ve = last.east;
+  float64_t speed2 = vn * vn + ve * ve;
+  bool moving = speed2 >= CAPTURE_MIN_SPEED * CAPTURE_MIN_SPEED;
+
+  if (mode == CAPTURE_POINTS)
+  {
+    while (next < pointCount)
+    {
+      float64_t dn, de;
+      offset(here, point[next], &dn, &de);
+      float64_t distance = sqrt(dn * dn + de * de);
+      if (!moving)
+      {
+        fire = distance <= tolerance;
+        break;
+      }
+      //! @note closest approach along the current velocity
+      float64_t t = (dn * vn + de * ve) / speed2;
+      float64_t mn = dn - vn * t, me = de - ve * t;
+      float64_t miss = sqrt(mn * mn + me * me);
+      if (t < 0)
+      {
+        //! @note crossed since the last tick, shoot late if still close
+        if (distance <= tolerance)
+        {
+          fire = true;
+          break;
+        }
+        stats.missed++;
+        next++;
+        continue;
+      }
+      if (miss <= tolerance && t * 1000000 < horizon)
+      {
+        fire = true;
+        time_us ahead = t * 1000000;
+        when = ahead > latency ? now + ahead - latency : now;
+      }
+      break;
+    }
+    if (fire)
+    {
+      shot.index = next;
+      shot.target = point[next];
+      next++;
+    }
+  }
+  else if (!anchored)
+  {
+    anchor = here;
+    anchored = true;
+  }
+  else
+  {
+    float64_t dn, de;
+    offset(anchor, here, &dn, &de);
+    float64_t remaining = interval - sqrt(dn * dn + de * de);
+    if (remaining <= 0)
+    {
+      fire = true;
+      shot.target = here;
+    }
+    else if (moving && remaining / sqrt(speed2) * 1000000 < horizon)
+    {
+      float64_t t = remaining / sqrt(speed2);
+      time_us ahead = t * 1000000;
+      fire = true;
+      when = ahead > latency ? now + ahead - latency : now;
+      positionAt(last, now + ahead, &shot.target);
+    }
+    if (fire)
+    {
+      shot.index = next++;
+      anchor = shot.target;
+    }
+  }
+  pthread_mutex_unlock(&lock);
+
+  if (!fire)
+    return;
+  sleepUntilUs(when);
+  target->setCamera(Camera::CODE_CAMERA_SHOT);
+  shot.predictedUs = when;
+  shot.firedUs = monotonicTimeUs();
+
+  pthread_mutex_lock(&lock);
+  logShot(shot);
+  pthread_mutex_unlock(&lock);
+}
+
+//! @note called with lock held
+void CaptureScheduler::logShot(const CaptureRecord &shot)
+{
+  log[logCount % CAPTURE_LOG_SIZE] = shot;
+  logCount++;
+
+  int64_t late = (int64_t)shot.firedUs - (int64_t)shot.predictedUs;
+  stats.shots++;
+  lateSum += late;
+  stats.meanLateUs = lateSum / stats.shots;
+  if (late > stats.maxLateUs)
+    stats.maxLateUs = late;
+}
+
+//! @note called with lock held, leaves the shot unresolved until a broadcast
+//! after its exposure arrived
+void CaptureScheduler::resolve(CaptureRecord *shot)
+{
+  time_us exposure = shot->firedUs + latency;
+  if (exposure > last.time)
+    return;
+  if (samples >= 2 && exposure >= before.time && last.time > before.time)
+  {
+    float64_t f = (float64_t)(exposure - before.time) / (last.time - before.time);
+    shot->actual.latitude = before.latitude + (last.latitude - before.latitude) * f;
+    shot->actual.longitude = before.longitude + (last.longitude - before.longitude) * f;
+  }
+  else
+    positionAt(samples >= 2 ? before : last, exposure, &shot->actual);
+
+  float64_t dn, de;
+  offset(shot->target, shot->actual, &dn, &de);
+  shot->error = sqrt(dn * dn + de * de);
+  shot->resolved = true;
+
+  stats.resolved++;
+  errorSum += shot->error;
+  errorSquareSum += shot->error * shot->error;
+  stats.meanError = errorSum / stats.resolved;
+  stats.rmsError = sqrt(errorSquareSum / stats.resolved);
+  if (shot->error > stats.maxError)
+    stats.maxError = shot->error;
+}
+
+void CaptureScheduler::record(const Sample &sample)
+{
+  pthread_mutex_lock(&lock);
+  before = last;
+  last = sample;
+  samples++;
+
+  //! @note unresolved shots are the newest ones
+  uint32_t kept = logCount < CAPTURE_LOG_SIZE ? logCount : CAPTURE_LOG_SIZE;
+  uint32_t first = logCount;
+  while (first > logCount - kept && !log[(first - 1) % CAPTURE_LOG_SIZE].resolved)
+    first--;
+  for (uint32_t i = first; i < logCount; ++i)
+    resolve(&log[i % CAPTURE_LOG_SIZE]);
+  pthread_mutex_unlock(&lock);
+}
+
+void CaptureScheduler::broadcastCallback(CoreAPI *api, Header *protocolHeader, UserData capture)
+{
+  CaptureScheduler *self = (CaptureScheduler *)capture;
+  BroadcastData data = api->getBroadcastData();
+  if (data.dataFlag & CAPTURE_POSITION_FLAG)
+  {
+    //! @note broadcast velocity is north, east, up
+    Sample sample;
+    sample.time = monotonicTimeUs();
+    sample.latitude = data.pos.latitude;
+    sample.longitude = data.pos.longitude;
+    sample.north = data.v.x;
+    sample.east = data.v.y;
+    self->record(sample);
+  }
+  if (self->previous.callback)
+    self->previous.callback(api, protocolHeader, self->previous.userData);
+}
+
+size_t CaptureScheduler::getLog(CaptureRecord *out, size_t max) const
+{
+  pthread_mutex_lock(&lock);
+  size_t kept = logCount < CAPTURE_LOG_SIZE ? logCount : CAPTURE_LOG_SIZE;
+  size_t count = kept < max ? kept : max;
+  for (size_t i = 0; i < count; ++i)
+    out[i] = log[(logCount - count + i) % CAPTURE_LOG_SIZE];
+  pthread_mutex_unlock(&lock);
+  return count;
+}
+
+CaptureStats CaptureScheduler::getStats() const
+{
+  pthread_mutex_lock(&lock);
+  CaptureStats ans = stats;
+  pthread_mutex_unlock(&lock);
+  return ans;
+}
+
+void CaptureScheduler::resetStats()
+{
+  pthread_mutex_lock(&lock);
+  memset(&stats, 0, sizeof(stats));
+  errorSum = 0;
+  errorSquareSum = 0;
+  lateSum = 0;
+  pthread_mutex_unlock(&lock);
+}
+
+Camera *CaptureScheduler::getCamera() const { return camera; }
+
+void CaptureScheduler::setCamera(Camera *value)
+{
+  camera = value;
+  hook(value ? value->getApi() : 0);
+}
+
+void CaptureScheduler::hook(CoreAPI *value)
+{
+  if (api && api->getBroadcastCallback().userData == this)
+    api->setBroadcastCallback(previous);
+  api = value;
+  if (api)
+  {
+    previous = api->getBroadcastCallback();
+    api->setBroadcastCallback(CaptureScheduler::broadcastCallback, this);
+  }
+}
+
+void CaptureScheduler::setTolerance(float64_t value)
+{
+  pthread_mutex_lock(&lock);
+  tolerance = value < 0 ? 0 : value;
+  pthread_mutex_unlock(&lock);
+}
+
+float64_t CaptureScheduler::getTolerance() const { return tolerance; }
+
+void CaptureScheduler::setLatency(uint32_t ms)
+{
+  pthread_mutex_lock(&lock);
+  latency = (time_us)ms * 1000;
+  pthread_mutex_unlock(&lock);
+}
+
+uint32_t CaptureScheduler::getLatency() const { return latency / 1000; }
+
+#endif // __linux__
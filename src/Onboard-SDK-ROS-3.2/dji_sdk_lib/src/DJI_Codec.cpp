@@ -571,7 +571,7 @@ void encodeData(SDKFilter *p_filter, Header *p_head, ptr_aes256_codec codec_func
   unsigned int data_idx;
   unsigned char *data_ptr;
 
-  if (p_head->enc == 0)
+  if (!CryptoPolicy::enabled || p_head->enc == 0)
     return;
   if (p_head->length == sizeof(Header))
     return;
@@ -599,6 +599,12 @@ void DJI::onboardSDK::CoreAPI::callApp(SDKFilter *p_filter)
 {
   // pass current data to handler
   Header *p_head = (Header *)p_filter->recvBuf;
+  if (!CryptoPolicy::enabled && p_head->enc)
+  {
+    API_LOG(serialDevice, ERROR_LOG, "Encrypted frame dropped, built without crypto\n");
+    sdk_stream_prepare_lambda(p_filter);
+    return;
+  }
   encodeData(p_filter, p_head, aes256_decrypt_ecb);
   appHandler((Header *)p_filter->recvBuf);
   sdk_stream_prepare_lambda(p_filter);
@@ -864,6 +870,12 @@ unsigned short DJI::onboardSDK::CoreAPI::encrypt(unsigned char *pdest,
   if (w_len > 1024)
     return 0;
 
+  if (is_enc && !CryptoPolicy::enabled)
+  {
+    API_LOG(serialDevice, ERROR_LOG, "Can not send encode data, built without crypto\n");
+    return 0;
+  }
+
   if (filter.encode == 0 && is_enc)
   {
     API_LOG(serialDevice, ERROR_LOG,
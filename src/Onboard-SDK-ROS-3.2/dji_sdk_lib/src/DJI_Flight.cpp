@@ -38,7 +38,7 @@ void Flight::task(TASK taskname, CallBack TaskCallback, UserData userData)
 {
   taskData.cmdData = taskname;
   taskData.cmdSequence++;
-  api->send(2, encrypt, SET_CONTROL, CODE_TASK, (unsigned char *)&taskData, sizeof(taskData),
+  api->send(2, api->getEncrypt(), SET_CONTROL, CODE_TASK, (unsigned char *)&taskData, sizeof(taskData),
       100, 3, TaskCallback ? TaskCallback : Flight::taskCallback, userData);
 }
 
@@ -47,7 +47,7 @@ unsigned short Flight::task(TASK taskname, int timeout)
   taskData.cmdData = taskname;
   taskData.cmdSequence++;
 
-    api->send(2, encrypt, SET_CONTROL, CODE_TASK, (unsigned char *) &taskData, sizeof(taskData),
+    api->send(2, api->getEncrypt(), SET_CONTROL, CODE_TASK, (unsigned char *) &taskData, sizeof(taskData),
               100, 3, 0, 0);
     api->serialDevice->lockACK();
     api->serialDevice->wait(timeout);
@@ -58,14 +58,14 @@ unsigned short Flight::task(TASK taskname, int timeout)
 void Flight::setArm(bool enable, CallBack ArmCallback, UserData userData)
 {
   uint8_t data = enable ? 1 : 0;
-  api->send(2, encrypt, SET_CONTROL, CODE_SETARM, &data, 1, 0, 1,
+  api->send(2, api->getEncrypt(), SET_CONTROL, CODE_SETARM, &data, 1, 0, 1,
       ArmCallback ? ArmCallback : Flight::armCallback, userData);
 }
 
 unsigned short Flight::setArm(bool enable, int timeout)
 {
   uint8_t data = enable ? 1 : 0;
-  api->send(2, encrypt, SET_CONTROL, CODE_SETARM, &data, 1, 10, 10, 0, 0);
+  api->send(2, api->getEncrypt(), SET_CONTROL, CODE_SETARM, &data, 1, 10, 10, 0, 0);
 
 
   api->serialDevice->lockACK();
@@ -94,51 +94,28 @@ void Flight::setMovementControl(uint8_t flag, float32_t x, float32_t y, float32_
   data.x = x;
   data.y = y;
   data.yaw = yaw;
-  if(api->getFwVersion() > MAKE_VERSION(3,2,0,0) && api->getFwVersion() < MAKE_VERSION(3,2,15,39)) {
-    if (flag & (1 << 4)) {
-      if (api->getBroadcastData().pos.health > 3) {
-        if(api->homepointAltitude!= 999999) {
-          data.z = z + api->homepointAltitude;
-          api->send(0, encrypt, SET_CONTROL, CODE_CONTROL, &data, sizeof(FlightData));
-        }
-      } else {
-        API_LOG(api->getDriver(), STATUS_LOG, "Not enough GPS locks, cannot run Movement Control \n");
+  //! @note FW with MSL altitude reports need the homepoint offset for vertical position control
+  if (api->getFirmwareBehaviour().homepointOffset && (flag & (1 << 4))) {
+    if (api->getPositionHealth() > 3) {
+      if(api->homepointAltitude!= 999999) {
+        data.z = z + api->homepointAltitude;
+        api->send(0, api->getEncrypt(), SET_CONTROL, CODE_CONTROL, &data, sizeof(FlightData));
       }
-    }
-    else
-    {
-      data.z = z;
-      api->send(0, encrypt, SET_CONTROL, CODE_CONTROL, &data, sizeof(FlightData));
-    }
-  }
-  else if(api->getFwVersion() == MAKE_VERSION(3,2,100,0)) {
-    if (flag & (1 << 4)) {
-      if (api->getBroadcastData().pos.health > 3) {
-        if(api->homepointAltitude!= 999999) {
-          data.z = z + api->homepointAltitude;
-          api->send(0, encrypt, SET_CONTROL, CODE_CONTROL, &data, sizeof(FlightData));
-        }
-      } else {
-        API_LOG(api->getDriver(), STATUS_LOG, "Not enough GPS locks, cannot run Movement Control \n");
-      }
-    }
-    else
-    {
-      data.z = z;
-      api->send(0, encrypt, SET_CONTROL, CODE_CONTROL, &data, sizeof(FlightData));
+    } else {
+      API_LOG(api->getDriver(), STATUS_LOG, "Not enough GPS locks, cannot run Movement Control \n");
     }
   }
   else
   {
     data.z = z;
-    api->send(0, encrypt, SET_CONTROL, CODE_CONTROL, &data, sizeof(FlightData));
+    api->send(0, api->getEncrypt(), SET_CONTROL, CODE_CONTROL, &data, sizeof(FlightData));
   }
 }
 
 
 void Flight::setFlight(FlightData *data)
 {
-  api->send(0, encrypt, SET_CONTROL, CODE_CONTROL, (unsigned char *)data, sizeof(FlightData));
+  api->send(0, api->getEncrypt(), SET_CONTROL, CODE_CONTROL, (unsigned char *)data, sizeof(FlightData));
 }
 
 QuaternionData Flight::getQuaternion() const
@@ -156,7 +133,7 @@ QuaternionData Flight::getQuaternion() const
   return api->getBroadcastData().q;
 }
 
-EulerAngle Flight::getEulerAngle() const {return Flight::toEulerAngle(api->getBroadcastData().q); }
+EulerAngle Flight::getEulerAngle() const { return api->getKinematics()->getEulerAngle(); }
 
 PositionData Flight::getPosition() const { return api->getBroadcastData().pos; }
 
@@ -182,7 +159,7 @@ Flight::Status Flight::getStatus() const
 
 Flight::Mode Flight::getControlMode() const
 {
-  if (api->getFwVersion() != versionM100_23)
+  if (api->getFirmwareBehaviour().hasCtrlMode)
     return (Flight::Mode)api->getBroadcastData().ctrlInfo.mode;
   return MODE_NOT_SUPPORTED;
 }
@@ -194,7 +171,7 @@ Angle Flight::getYaw() const
     return AngularSim.yaw;
   else
 #endif // USE_SIMULATION
-  return toEulerAngle(api->getBroadcastData().q).yaw;
+  return api->getKinematics()->getEulerAngle().yaw;
 }
 
 Angle Flight::getRoll() const
@@ -204,7 +181,7 @@ Angle Flight::getRoll() const
     return AngularSim.roll;
   else
 #endif // USE_SIMULATION
-  return toEulerAngle(api->getBroadcastData().q).roll;
+  return api->getKinematics()->getEulerAngle().roll;
 }
 
 Angle Flight::getPitch() const
@@ -214,7 +191,7 @@ Angle Flight::getPitch() const
     return AngularSim.pitch;
   else
 #endif // USE_SIMULATION
-  return toEulerAngle(api->getBroadcastData().q).pitch;
+  return api->getKinematics()->getEulerAngle().pitch;
 }
 
 void Flight::armCallback(CoreAPI *api, Header *protocolHeader, UserData userData __UNUSED)
@@ -37,7 +37,7 @@ void Follow::start(FollowData *Data, CallBack callback, UserData userData)
     followData = *Data;
   else
     resetData();
-  api->send(2, encrypt, SET_MISSION, CODE_FOLLOW_START, &followData, sizeof(followData), 500, 2,
+  api->send(2, api->getEncrypt(), SET_MISSION, CODE_FOLLOW_START, &followData, sizeof(followData), 500, 2,
       callback ? callback : missionCallback, userData);
 }
 
@@ -47,7 +47,7 @@ MissionACK Follow::start(FollowData *Data, int timeout)
     followData = *Data;
   else
     resetData();
-  api->send(2, encrypt, SET_MISSION, CODE_FOLLOW_START, &followData, sizeof(followData), 500, 2, 0,0);
+  api->send(2, api->getEncrypt(), SET_MISSION, CODE_FOLLOW_START, &followData, sizeof(followData), 500, 2, 0,0);
 
   api->serialDevice->lockACK();
   api->serialDevice->wait(timeout);
@@ -59,14 +59,14 @@ MissionACK Follow::start(FollowData *Data, int timeout)
 void Follow::stop(CallBack callback, UserData userData)
 {
   uint8_t zero = 0;
-  api->send(2, encrypt, SET_MISSION, CODE_FOLLOW_STOP, &zero, sizeof(zero), 500, 2,
+  api->send(2, api->getEncrypt(), SET_MISSION, CODE_FOLLOW_STOP, &zero, sizeof(zero), 500, 2,
       callback ? callback : missionCallback, userData);
 }
 
 MissionACK Follow::stop(int timeout)
 {
   uint8_t zero = 0;
-  api->send(2, encrypt, SET_MISSION, CODE_FOLLOW_STOP, &zero, sizeof(zero), 500, 2, 0, 0);
+  api->send(2, api->getEncrypt(), SET_MISSION, CODE_FOLLOW_STOP, &zero, sizeof(zero), 500, 2, 0, 0);
 
   api->serialDevice->lockACK();
   api->serialDevice->wait(timeout);
@@ -78,14 +78,14 @@ MissionACK Follow::stop(int timeout)
 void Follow::pause(bool isPause, CallBack callback, UserData userData)
 {
   uint8_t followData = isPause ? 0 : 1;
-  api->send(2, encrypt, SET_MISSION, CODE_FOLLOW_SETPAUSE, &followData, sizeof(followData), 500, 2,
+  api->send(2, api->getEncrypt(), SET_MISSION, CODE_FOLLOW_SETPAUSE, &followData, sizeof(followData), 500, 2,
       callback ? callback : missionCallback, userData);
 }
 
 MissionACK Follow::pause(bool isPause, int timeout)
 {
   uint8_t followData = isPause ? 0 : 1;
-  api->send(2, encrypt, SET_MISSION, CODE_FOLLOW_SETPAUSE, &followData, sizeof(followData), 500, 2, 0, 0);
+  api->send(2, api->getEncrypt(), SET_MISSION, CODE_FOLLOW_SETPAUSE, &followData, sizeof(followData), 500, 2, 0, 0);
 
   api->serialDevice->lockACK();
   api->serialDevice->wait(timeout);
@@ -97,7 +97,7 @@ MissionACK Follow::pause(bool isPause, int timeout)
 void Follow::updateTarget(FollowTarget target)
 {
   followData.target = target;
-  api->send(0, encrypt, SET_MISSION, CODE_FOLLOW_TARGET, &(followData.target), sizeof(FollowTarget));
+  api->send(0, api->getEncrypt(), SET_MISSION, CODE_FOLLOW_TARGET, &(followData.target), sizeof(FollowTarget));
 }
 
 void Follow::updateTarget(float64_t latitude, float64_t longitude, uint16_t height,
@@ -107,7 +107,7 @@ void Follow::updateTarget(float64_t latitude, float64_t longitude, uint16_t heig
   followData.target.longitude = longitude;
   followData.target.height = height;
   followData.target.angle = angle;
-  api->send(0, encrypt, SET_MISSION, CODE_FOLLOW_TARGET, &(followData.target), sizeof(FollowTarget));
+  api->send(0, api->getEncrypt(), SET_MISSION, CODE_FOLLOW_TARGET, &(followData.target), sizeof(FollowTarget));
 }
 
 FollowData Follow::getData() const { return followData; }
@@ -0,0 +1,219 @@
+/** @file DJI_FollowStreamer.cpp
+ *  @version 3.1.9
+ *  @date November 10, 2016
+ *
+ *  @brief
+ *  Fixed-rate Follow target streaming with motion extrapolation
+ *
+ *  @copyright 2016 DJI. All rights reserved.
+ *
+ */
+
+#include "DJI_FollowStreamer.h"
+
+#ifdef __linux__
+#include <string.h>
+#include <math.h>
+
+using namespace DJI;
+using namespace DJI::onboardSDK;
+
+//! @note mean earth radius in meters, for the prediction error only
+#define EARTH_RADIUS 6371000.0
+
+FollowStreamer::FollowStreamer(Follow *FollowAPI)
+{
+  follow = FollowAPI;
+  pthread_mutex_init(&lock, 0);
+  window = 8;
+  maxExtrapolation = 1000000;
+  reset();
+  resetPredictionStats();
+}
+
+FollowStreamer::~FollowStreamer()
+{
+  stop();
+  pthread_mutex_destroy(&lock);
+}
+
+void FollowStreamer::addFix(float64_t latitude, float64_t longitude, uint16_t height,
+    uint16_t angle, time_us timestamp)
+{
+  FollowTarget target;
+  target.latitude = latitude;
+  target.longitude = longitude;
+  target.height = height;
+  target.angle = angle;
+  addFix(target, timestamp);
+}
+
+void FollowStreamer::addFix(const FollowTarget &target, time_us timestamp)
+{
+  pthread_mutex_lock(&lock);
+  if (count > 0 && timestamp <= history[head].time)
+  {
+    //! @note out of order or duplicated fix, the fit needs increasing time
+    pthread_mutex_unlock(&lock);
+    return;
+  }
+
+  FollowTarget predicted;
+  if (count > 0 && extrapolate(timestamp, &predicted))
+  {
+    float64_t dn = (target.latitude - predicted.latitude) * EARTH_RADIUS;
+    float64_t de =
+      (target.longitude - predicted.longitude) * cos(target.latitude) * EARTH_RADIUS;
+    float64_t error = sqrt(dn * dn + de * de);
+    stats.samples++;
+    stats.lastError = error;
+    if (error > stats.maxError)
+      stats.maxError = error;
+    errorSum += error;
+    errorSquareSum += error * error;
+    stats.meanError = errorSum / stats.samples;
+    stats.rmsError = sqrt(errorSquareSum / stats.samples);
+  }
+
+  head = (head + 1) % FOLLOW_HISTORY_SIZE;
+  history[head].time = timestamp;
+  history[head].latitude = target.latitude;
+  history[head].longitude = target.longitude;
+  history[head].height = target.height;
+  history[head].angle = target.angle;
+  if (count < FOLLOW_HISTORY_SIZE)
+    count++;
+  stats.fixes++;
+  fit();
+  pthread_mutex_unlock(&lock);
+}
+
+void FollowStreamer::reset()
+{
+  pthread_mutex_lock(&lock);
+  head = 0;
+  count = 0;
+  latRate = lonRate = heightRate = 0;
+  pthread_mutex_unlock(&lock);
+}
+
+void FollowStreamer::setHistory(uint8_t value)
+{
+  pthread_mutex_lock(&lock);
+  window = value < 2 ? 2 : (value > FOLLOW_HISTORY_SIZE ? FOLLOW_HISTORY_SIZE : value);
+  fit();
+  pthread_mutex_unlock(&lock);
+}
+
+void FollowStreamer::setMaxExtrapolation(uint32_t ms)
+{
+  pthread_mutex_lock(&lock);
+  maxExtrapolation = (time_us)ms * 1000;
+  pthread_mutex_unlock(&lock);
+}
+
+//! @note least squares slope over the last fixes, relative to the newest one
+void FollowStreamer::fit()
+{
+  uint8_t n = count < window ? count : window;
+  latRate = lonRate = heightRate = 0;
+  if (n < 2)
+    return;
+
+  const Fix &last = history[head];
+  float64_t st = 0, stt = 0, sLat = 0, sLon = 0, sH = 0, stLat = 0, stLon = 0, stH = 0;
+  for (uint8_t i = 0; i < n; ++i)
+  {
+    const Fix &f = history[(head + FOLLOW_HISTORY_SIZE - i) % FOLLOW_HISTORY_SIZE];
+    float64_t t = -(float64_t)(last.time - f.time) / 1000000.0;
+    float64_t lat = f.latitude - last.latitude;
+    float64_t lon = f.longitude - last.longitude;
+    float64_t h = f.height - last.height;
+    st += t;
+    stt += t * t;
+    sLat += lat;
+    sLon += lon;
+    sH += h;
+    stLat += t * lat;
+    stLon += t * lon;
+    stH += t * h;
+  }
+  float64_t den = n * stt - st * st;
+  if (den <= 0)
+    return;
+  latRate = (n * stLat - st * sLat) / den;
+  lonRate = (n * stLon - st * sLon) / den;
+  heightRate = (n * stH - st * sH) / den;
+}
+
+bool FollowStreamer::extrapolate(time_us timestamp, FollowTarget *target) const
+{
+  if (count == 0)
+    return false;
+
+  const Fix &last = history[head];
+  time_us ahead = timestamp > last.time ? timestamp - last.time : 0;
+  if (ahead > maxExtrapolation)
+    ahead = maxExtrapolation;
+  float64_t dt = ahead / 1000000.0;
+
+  float64_t height = last.height + heightRate * dt;
+  target->latitude = last.latitude + latRate * dt;
+  target->longitude = last.longitude + lonRate * dt;
+  target->height = height < 0 ? 0 : (height > 65535 ? 65535 : (uint16_t)(height + 0.5));
+  target->angle = last.angle;
+  return true;
+}
+
+bool FollowStreamer::predict(time_us timestamp, FollowTarget *target) const
+{
+  pthread_mutex_lock(&lock);
+  bool ans = extrapolate(timestamp, target);
+  pthread_mutex_unlock(&lock);
+  return ans;
+}
+
+void FollowStreamer::getVelocity(float64_t *north, float64_t *east) const
+{
+  pthread_mutex_lock(&lock);
+  float64_t lat = count ? history[head].latitude : 0;
+  *north = latRate * EARTH_RADIUS;
+  *east = lonRate * cos(lat) * EARTH_RADIUS;
+  pthread_mutex_unlock(&lock);
+}
+
+PredictionStats FollowStreamer::getPredictionStats() const
+{
+  pthread_mutex_lock(&lock);
+  PredictionStats ans = stats;
+  pthread_mutex_unlock(&lock);
+  return ans;
+}
+
+void FollowStreamer::resetPredictionStats()
+{
+  pthread_mutex_lock(&lock);
+  memset(&stats, 0, sizeof(stats));
+  errorSum = 0;
+  errorSquareSum = 0;
+  pthread_mutex_unlock(&lock);
+}
+
+Follow *FollowStreamer::getFollow() const { return follow; }
+
+void FollowStreamer::setFollow(Follow *value) { follow = value; }
+
+void FollowStreamer::tick(time_us now)
+{
+  FollowTarget target;
+  pthread_mutex_lock(&lock);
+  bool ready = extrapolate(now, &target);
+  if (ready && follow)
+    stats.sent++;
+  pthread_mutex_unlock(&lock);
+
+  if (ready && follow)
+    follow->updateTarget(target);
+}
+
+#endif // __linux__
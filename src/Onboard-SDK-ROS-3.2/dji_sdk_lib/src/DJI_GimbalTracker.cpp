@@ -0,0 +1,359 @@
+/** @file DJI_GimbalTracker.cpp
+ *  @version 3.1.9
+ *  @date November 10, 2016
+ *
+ *  @brief
+ *  Closed-loop gimbal speed control keeping a detected target in frame
+ *
+ *  @copyright 2016 DJI. All rights reserved.
+ *
+ */
+
+#include "DJI_GimbalTracker.h"
+
+#ifdef __linux__
+#include <string.h>
+#include <math.h>
+
+using namespace DJI;
+using namespace DJI::onboardSDK;
+
+//! @note gimbal channel of the broadcast enable flag, M100 has no GPS/RTK channels
+#define GIMBAL_FLAG 0x0400
+#define GIMBAL_FLAG_M100 0x0100
+//! @note middle of the pitch range, tells which pitch limit is hit
+#define GIMBAL_PITCH_CENTRE -30.0
+//! @note longest the gimbal angle is extrapolated past the last broadcast
+#define GIMBAL_EXTRAPOLATION_US 100000
+
+GimbalTracker::GimbalTracker(Camera *CameraAPI)
+{
+  camera = 0;
+  api = 0;
+  previous.callback = 0;
+  previous.userData = 0;
+  pthread_mutex_init(&lock, 0);
+  historyCount = 0;
+  yawLimit = false;
+  pitchLimit = false;
+  relativeYaw = 0;
+  hasTarget = false;
+  tracking = false;
+  fresh = false;
+  targetYaw = targetPitch = 0;
+  yawRate = pitchRate = 0;
+  targetTime = 0;
+  gain = 2.0;
+  maxRate = 90;
+  timeout = 500000;
+  resetStats();
+  setCamera(CameraAPI);
+}
+
+GimbalTracker::~GimbalTracker()
+{
+  stop();
+  setCamera(0);
+  pthread_mutex_destroy(&lock);
+}
+
+float64_t GimbalTracker::wrap(float64_t angle)
+{
+  angle = fmod(angle + 180, 360);
+  return angle < 0 ? angle + 180 : angle - 180;
+}
+
+int16_t GimbalTracker::toSpeed(float64_t rate)
+{
+  float64_t speed = rate * 10;
+  if (speed > GIMBAL_SPEED_MAX)
+    speed = GIMBAL_SPEED_MAX;
+  if (speed < -GIMBAL_SPEED_MAX)
+    speed = -GIMBAL_SPEED_MAX;
+  return (int16_t)lround(speed);
+}
+
+//! @note called with lock held
+bool GimbalTracker::gimbalAt(time_us time, float64_t *yaw, float64_t *pitch) const
+{
+  uint32_t kept = historyCount < GIMBAL_HISTORY_SIZE ? historyCount : GIMBAL_HISTORY_SIZE;
+  if (kept == 0)
+    return false;
+
+  const Sample &newest = history[(historyCount - 1) % GIMBAL_HISTORY_SIZE];
+  if (time >= newest.time)
+  {
+    *yaw = newest.yaw;
+    *pitch = newest.pitch;
+    if (kept >= 2)
+    {
+      //! @note keep turning at the last measured rate for a short while
+      const Sample &older = history[(historyCount - 2) % GIMBAL_HISTORY_SIZE];
+      time_us ahead = time - newest.time;
+      if (ahead > GIMBAL_EXTRAPOLATION_US)
+        ahead = GIMBAL_EXTRAPOLATION_US;
+      if (newest.time > older.time)
+      {
+        float64_t f = (float64_t)ahead / (newest.time - older.time);
+        *yaw = wrap(newest.yaw + wrap(newest.yaw - older.yaw) * f);
+        *pitch = newest.pitch + (newest.pitch - older.pitch) * f;
+      }
+    }
+    return true;
+  }
+
+  for (uint32_t i = 1; i < kept; ++i)
+  {
+    const Sample &b = history[(historyCount - i) % GIMBAL_HISTORY_SIZE];
+    const Sample &a = history[(historyCount - i - 1) % GIMBAL_HISTORY_SIZE];
+    if (time >= a.time)
+    {
+      float64_t f = b.time > a.time ? (float64_t)(time - a.time) / (b.time - a.time) : 0;
+      *yaw = wrap(a.yaw + wrap(b.yaw - a.yaw) * f);
+      *pitch = a.pitch + (b.pitch - a.pitch) * f;
+      return true;
+    }
+  }
+  const Sample &oldest = history[(historyCount - kept) % GIMBAL_HISTORY_SIZE];
+  *yaw = oldest.yaw;
+  *pitch = oldest.pitch;
+  return true;
+}
+
+bool GimbalTracker::getGimbalAt(time_us time, float64_t *yaw, float64_t *pitch) const
+{
+  pthread_mutex_lock(&lock);
+  bool ans = gimbalAt(time, yaw, pitch);
+  pthread_mutex_unlock(&lock);
+  return ans;
+}
+
+void GimbalTracker::addPosition(float64_t forward, float64_t right, float64_t down,
+    time_us captured)
+{
+  float64_t yaw = atan2(right, forward) * 180 / M_PI;
+  float64_t pitch = -atan2(down, sqrt(forward * forward + right * right)) * 180 / M_PI;
+  addOffset(yaw, pitch, captured);
+}
+
+void GimbalTracker::addOffset(float64_t yaw, float64_t pitch, time_us captured)
+{
+  pthread_mutex_lock(&lock);
+  float64_t gimbalYaw, gimbalPitch;
+  if ((hasTarget && captured <= targetTime) || !gimbalAt(captured, &gimbalYaw, &gimbalPitch))
+  {
+    //! @note out of order, or no broadcast yet to refer the offset to
+    pthread_mutex_unlock(&lock);
+    return;
+  }
+
+  float64_t absYaw = wrap(gimbalYaw + yaw);
+  float64_t absPitch = gimbalPitch + pitch;
+  if (hasTarget && captured - targetTime < timeout)
+  {
+    //! @note target rate smoothed over the last detections
+    float64_t dt = (captured - targetTime) / 1000000.0;
+    float64_t yr = wrap(absYaw - targetYaw) / dt;
+    float64_t pr = (absPitch - targetPitch) / dt;
+    yr = yr > maxRate ? maxRate : (yr < -maxRate ? -maxRate : yr);
+    pr = pr > maxRate ? maxRate : (pr < -maxRate ? -maxRate : pr);
+    yawRate = 0.5 * yawRate + 0.5 * yr;
+    pitchRate = 0.5 * pitchRate + 0.5 * pr;
+  }
+  else
+    yawRate = pitchRate = 0;
+
+  hasTarget = true;
+  fresh = true;
+  targetYaw = absYaw;
+  targetPitch = absPitch;
+  targetTime = captured;
+
+  float64_t error = sqrt(yaw * yaw + pitch * pitch);
+  stats.detections++;
+  stats.lastError = error;
+  if (error > stats.maxError)
+    stats.maxError = error;
+  errorSum += error;
+  errorSquareSum += error * error;
+  stats.meanError = errorSum / stats.detections;
+  stats.rmsError = sqrt(errorSquareSum / stats.detections);
+  pthread_mutex_unlock(&lock);
+}
+
+void GimbalTracker::reset()
+{
+  pthread_mutex_lock(&lock);
+  hasTarget = false;
+  pthread_mutex_unlock(&lock);
+}
+
+bool GimbalTracker::isTracking() const { return tracking; }
+
+void GimbalTracker::tick(time_us deadline __UNUSED)
+{
+  Camera *target = camera;
+  if (!target)
+    return;
+
+  time_us now = monotonicTimeUs();
+  GimbalSpeedData speed;
+  memset(&speed, 0, sizeof(speed));
+  speed.reserved = 0x80;
+
+  pthread_mutex_lock(&lock);
+  float64_t gimbalYaw, gimbalPitch;
+  if (!hasTarget || now - targetTime > timeout || !gimbalAt(now, &gimbalYaw, &gimbalPitch))
+  {
+    bool stopping = tracking;
+    hasTarget = false;
+    tracking = false;
+    pthread_mutex_unlock(&lock);
+    if (stopping)
+      target->setGimbalSpeed(&speed);
+    return;
+  }
+
+  float64_t dt = (now - targetTime) / 1000000.0;
+  float64_t yawError = wrap(targetYaw + yawRate * dt - gimbalYaw);
+  float64_t pitchError = targetPitch + pitchRate * dt - gimbalPitch;
+  float64_t yaw = gain * yawError + yawRate;
+  float64_t pitch = gain * pitchError + pitchRate;
+  yaw = yaw > maxRate ? maxRate : (yaw < -maxRate ? -maxRate : yaw);
+  pitch = pitch > maxRate ? maxRate : (pitch < -maxRate ? -maxRate : pitch);
+
+  //! @note at a limit only move back towards the centre
+  if (yawLimit && yaw * relativeYaw > 0)
+  {
+    yaw = 0;
+    stats.limitHits++;
+  }
+  if (pitchLimit && pitch * (gimbalPitch - GIMBAL_PITCH_CENTRE) > 0)
+  {
+    pitch = 0;
+    stats.limitHits++;
+  }
+  speed.yaw = toSpeed(yaw);
+  speed.pitch = toSpeed(pitch);
+
+  bool first = fresh;
+  time_us captured = targetTime;
+  fresh = false;
+  tracking = true;
+  pthread_mutex_unlock(&lock);
+
+  target->setGimbalSpeed(&speed);
+
+  pthread_mutex_lock(&lock);
+  stats.commands++;
+  if (first)
+  {
+    int64_t latency = monotonicTimeUs() - captured;
+    latencyCount++;
+    latencySum += latency;
+    stats.meanLatencyUs = latencySum / latencyCount;
+    if (latency > stats.maxLatencyUs)
+      stats.maxLatencyUs = latency;
+  }
+  pthread_mutex_unlock(&lock);
+}
+
+void GimbalTracker::record(const GimbalData &data, float64_t aircraftYaw)
+{
+  pthread_mutex_lock(&lock);
+  Sample *s = &history[historyCount % GIMBAL_HISTORY_SIZE];
+  s->time = monotonicTimeUs();
+  s->yaw = data.yaw;
+  s->pitch = data.pitch;
+  historyCount++;
+  yawLimit = data.yawLimit;
+  pitchLimit = data.pitchLimit;
+  relativeYaw = wrap(data.yaw - aircraftYaw);
+  pthread_mutex_unlock(&lock);
+}
+
+void GimbalTracker::broadcastCallback(CoreAPI *api, Header *protocolHeader, UserData tracker)
+{
+  GimbalTracker *self = (GimbalTracker *)tracker;
+  const FirmwareBehaviour &firmware = api->getFirmwareBehaviour();
+  BroadcastData data = api->getBroadcastData();
+  if (data.dataFlag & (firmware.isM100 ? GIMBAL_FLAG_M100 : GIMBAL_FLAG))
+  {
+    if (!firmware.hasGimbalLimit)
+    {
+      data.gimbal.yawLimit = 0;
+      data.gimbal.pitchLimit = 0;
+    }
+    self->record(data.gimbal, api->getKinematics()->getEulerAngle().yaw * 180 / M_PI);
+  }
+  if (self->previous.callback)
+    self->previous.callback(api, protocolHeader, self->previous.userData);
+}
+
+TrackingStats GimbalTracker::getStats() const
+{
+  pthread_mutex_lock(&lock);
+  TrackingStats ans = stats;
+  pthread_mutex_unlock(&lock);
+  return ans;
+}
+
+void GimbalTracker::resetStats()
+{
+  pthread_mutex_lock(&lock);
+  memset(&stats, 0, sizeof(stats));
+  errorSum = 0;
+  errorSquareSum = 0;
+  latencySum = 0;
+  latencyCount = 0;
+  pthread_mutex_unlock(&lock);
+}
+
+Camera *GimbalTracker::getCamera() const { return camera; }
+
+void GimbalTracker::setCamera(Camera *value)
+{
+  camera = value;
+  hook(value ? value->getApi() : 0);
+}
+
+void GimbalTracker::hook(CoreAPI *value)
+{
+  if (api && api->getBroadcastCallback().userData == this)
+    api->setBroadcastCallback(previous);
+  api = value;
+  if (api)
+  {
+    previous = api->getBroadcastCallback();
+    api->setBroadcastCallback(GimbalTracker::broadcastCallback, this);
+  }
+}
+
+void GimbalTracker::setGain(float64_t value)
+{
+  pthread_mutex_lock(&lock);
+  gain = value < 0 ? 0 : value;
+  pthread_mutex_unlock(&lock);
+}
+
+float64_t GimbalTracker::getGain() const { return gain; }
+
+void GimbalTracker::setMaxRate(float64_t value)
+{
+  pthread_mutex_lock(&lock);
+  maxRate = value < 0 ? 0 : (value > GIMBAL_SPEED_MAX / 10 ? GIMBAL_SPEED_MAX / 10 : value);
+  pthread_mutex_unlock(&lock);
+}
+
+float64_t GimbalTracker::getMaxRate() const { return maxRate; }
+
+void GimbalTracker::setTimeout(uint32_t ms)
+{
+  pthread_mutex_lock(&lock);
+  timeout = (time_us)ms * 1000;
+  pthread_mutex_unlock(&lock);
+}
+
+uint32_t GimbalTracker::getTimeout() const { return timeout / 1000; }
+
+#endif // __linux__
@@ -39,13 +39,13 @@ void HotPoint::initData()
 
 void HotPoint::start(CallBack callback, UserData userData)
 {
-  api->send(2, encrypt, SET_MISSION, CODE_HOTPOINT_START, &hotPointData, sizeof(hotPointData), 500, 2,
+  api->send(2, api->getEncrypt(), SET_MISSION, CODE_HOTPOINT_START, &hotPointData, sizeof(hotPointData), 500, 2,
       callback ? callback : startCallback, userData);
 }
 
 HotPointStartACK HotPoint::start(int timeout)
 {
-  api->send(2, encrypt, SET_MISSION, CODE_HOTPOINT_START, &hotPointData, sizeof(hotPointData), 500, 2, 0, 0);
+  api->send(2, api->getEncrypt(), SET_MISSION, CODE_HOTPOINT_START, &hotPointData, sizeof(hotPointData), 500, 2, 0, 0);
 
   api->serialDevice->lockACK();
   api->serialDevice->wait(timeout);
@@ -57,14 +57,14 @@ HotPointStartACK HotPoint::start(int timeout)
 void HotPoint::stop(CallBack callback, UserData userData)
 {
   uint8_t zero = 0;
-  api->send(2, encrypt, SET_MISSION, CODE_HOTPOINT_STOP, &zero, sizeof(zero), 500, 2,
+  api->send(2, api->getEncrypt(), SET_MISSION, CODE_HOTPOINT_STOP, &zero, sizeof(zero), 500, 2,
       callback ? callback : missionCallback, userData);
 }
 
 MissionACK HotPoint::stop(int timeout)
 {
   uint8_t zero = 0;
-  api->send(2, encrypt, SET_MISSION, CODE_HOTPOINT_STOP, &zero, sizeof(zero), 500, 2, 0, 0);
+  api->send(2, api->getEncrypt(), SET_MISSION, CODE_HOTPOINT_STOP, &zero, sizeof(zero), 500, 2, 0, 0);
 
   api->serialDevice->lockACK();
   api->serialDevice->wait(timeout);
@@ -76,14 +76,14 @@ MissionACK HotPoint::stop(int timeout)
 void HotPoint::pause(bool isPause, CallBack callback, UserData userData)
 {
   uint8_t data = isPause ? 0 : 1;
-  api->send(2, encrypt, SET_MISSION, CODE_HOTPOINT_SETPAUSE, &data, sizeof(data), 500, 2,
+  api->send(2, api->getEncrypt(), SET_MISSION, CODE_HOTPOINT_SETPAUSE, &data, sizeof(data), 500, 2,
       callback ? callback : missionCallback, userData);
 }
 
 MissionACK HotPoint::pause(bool isPause, int timeout)
 {
   uint8_t data = isPause ? 0 : 1;
-  api->send(2, encrypt, SET_MISSION, CODE_HOTPOINT_SETPAUSE, &data, sizeof(data), 500, 2, 0, 0);
+  api->send(2, api->getEncrypt(), SET_MISSION, CODE_HOTPOINT_SETPAUSE, &data, sizeof(data), 500, 2, 0, 0);
 
   api->serialDevice->lockACK();
   api->serialDevice->wait(timeout);
@@ -96,7 +96,7 @@ void HotPoint::updateYawRate(HotPoint::YawRate &Data, CallBack callback, UserDat
 {
   hotPointData.yawRate = Data.yawRate;
   hotPointData.clockwise = Data.clockwise ? 1 : 0;
-  api->send(2, encrypt, SET_MISSION, CODE_HOTPOINT_YAWRATE, &Data, sizeof(Data), 500, 2,
+  api->send(2, api->getEncrypt(), SET_MISSION, CODE_HOTPOINT_YAWRATE, &Data, sizeof(Data), 500, 2,
       callback ? callback : missionCallback, userData);
 }
 
@@ -104,7 +104,7 @@ MissionACK HotPoint::updateYawRate(HotPoint::YawRate &Data, int timeout)
 {
   hotPointData.yawRate = Data.yawRate;
   hotPointData.clockwise = Data.clockwise ? 1 : 0;
-  api->send(2, encrypt, SET_MISSION, CODE_HOTPOINT_YAWRATE, &Data, sizeof(Data), 500, 2, 0, 0);
+  api->send(2, api->getEncrypt(), SET_MISSION, CODE_HOTPOINT_YAWRATE, &Data, sizeof(Data), 500, 2, 0, 0);
 
   api->serialDevice->lockACK();
   api->serialDevice->wait(timeout);
@@ -124,13 +124,13 @@ void HotPoint::updateYawRate(float32_t yawRate, bool isClockwise, CallBack callb
 
 void HotPoint::updateRadius(float32_t meter, CallBack callback, UserData userData)
 {
-  api->send(2, encrypt, SET_MISSION, CODE_HOTPOINT_RADIUS, &meter, sizeof(meter), 500, 2,
+  api->send(2, api->getEncrypt(), SET_MISSION, CODE_HOTPOINT_RADIUS, &meter, sizeof(meter), 500, 2,
       callback ? callback : missionCallback, userData);
 }
 
 MissionACK HotPoint::updateRadius(float32_t meter, int timeout)
 {
-  api->send(2, encrypt, SET_MISSION, CODE_HOTPOINT_RADIUS, &meter, sizeof(meter), 500, 2, 0, 0);
+  api->send(2, api->getEncrypt(), SET_MISSION, CODE_HOTPOINT_RADIUS, &meter, sizeof(meter), 500, 2, 0, 0);
 
   api->serialDevice->lockACK();
   api->serialDevice->wait(timeout);
@@ -142,14 +142,14 @@ MissionACK HotPoint::updateRadius(float32_t meter, int timeout)
 void HotPoint::resetYaw(CallBack callback, UserData userData)
 {
   uint8_t zero = 0;
-  api->send(2, encrypt, SET_MISSION, CODE_HOTPOINT_SETYAW, &zero, sizeof(zero), 500, 2,
+  api->send(2, api->getEncrypt(), SET_MISSION, CODE_HOTPOINT_SETYAW, &zero, sizeof(zero), 500, 2,
       callback ? callback : missionCallback, userData);
 }
 
 MissionACK HotPoint::resetYaw(int timeout)
 {
   uint8_t zero = 0;
-  api->send(2, encrypt, SET_MISSION, CODE_HOTPOINT_SETYAW, &zero, sizeof(zero), 500, 2, 0, 0);
+  api->send(2, api->getEncrypt(), SET_MISSION, CODE_HOTPOINT_SETYAW, &zero, sizeof(zero), 500, 2, 0, 0);
 
   api->serialDevice->lockACK();
   api->serialDevice->wait(timeout);
@@ -161,14 +161,14 @@ MissionACK HotPoint::resetYaw(int timeout)
 void HotPoint::readData(CallBack callback, UserData userData)
 {
   uint8_t zero = 0;
-  api->send(2, encrypt, SET_MISSION, CODE_HOTPOINT_LOAD, &zero, sizeof(zero), 500, 2,
+  api->send(2, api->getEncrypt(), SET_MISSION, CODE_HOTPOINT_LOAD, &zero, sizeof(zero), 500, 2,
       callback ? callback : missionCallback, userData);
 }
 
 MissionACK HotPoint::readData(int timeout)
 {
   uint8_t zero = 0;
-  api->send(2, encrypt, SET_MISSION, CODE_HOTPOINT_LOAD, &zero, sizeof(zero), 500, 2, 0, 0);
+  api->send(2, api->getEncrypt(), SET_MISSION, CODE_HOTPOINT_LOAD, &zero, sizeof(zero), 500, 2, 0, 0);
 
   api->serialDevice->lockACK();
   api->serialDevice->wait(timeout);
@@ -0,0 +1,398 @@
+/** @file DJI_InitSequencer.cpp
+ *  @version 3.1.9
+ *  @date November 10, 2016
+ *
+ *  @brief
+ *  Overlapped start-up handshake with cached version data
+ *
+ *  @copyright 2016 DJI. All rights reserved.
+ *
+ */
+
+#include "DJI_InitSequencer.h"
+
+#ifdef __linux__
+#include <stdio.h>
+#include <string.h>
+
+using namespace DJI;
+using namespace DJI::onboardSDK;
+
+//! @note "DJIC", bumped with the layout of CacheEntry
+#define INIT_CACHE_MAGIC 0x434A4944
+
+InitSequencer::InitSequencer(CoreAPI *ControlAPI)
+{
+  api = ControlAPI;
+  memset(&activateData, 0, sizeof(activateData));
+  memset(freq, 0, sizeof(freq));
+  defaultFreq = true;
+  obtainControl = true;
+  cacheFile[0] = 0;
+  cacheCount = 0;
+  redoActivate = false;
+  redoFrequency = false;
+  start = 0;
+  memset(&report, 0, sizeof(report));
+
+  pthread_mutex_init(&lock, 0);
+  pthread_condattr_t attr;
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&cond, &attr);
+  pthread_condattr_destroy(&attr);
+}
+
+InitSequencer::~InitSequencer()
+{
+  if (api)
+    api->cancelSessions(this);
+  pthread_cond_destroy(&cond);
+  pthread_mutex_destroy(&lock);
+}
+
+void InitSequencer::setActivateData(const ActivateData &data) { activateData = data; }
+
+void InitSequencer::setBroadcastFreq(const uint8_t *value)
+{
+  defaultFreq = value == 0;
+  if (value)
+    memcpy(freq, value, sizeof(freq));
+}
+
+void InitSequencer::setObtainControl(bool value) { obtainControl = value; }
+
+void InitSequencer::setCacheFile(const char *path)
+{
+  strncpy(cacheFile, path ? path : "", sizeof(cacheFile) - 1);
+  cacheFile[sizeof(cacheFile) - 1] = 0;
+}
+
+bool InitSequencer::run(int timeout)
+{
+  bool warm = cacheFile[0] && loadCache();
+
+  pthread_mutex_lock(&lock);
+  memset(&report, 0, sizeof(report));
+  report.cachedActivation = warm ? cache[0].activation : (uint16_t)ACK_COMMON_NO_RESPONSE;
+  report.cacheHit = warm;
+  redoActivate = false;
+  redoFrequency = false;
+  start = monotonicTimeUs();
+  begin(INIT_VERSION);
+  if (warm)
+  {
+    //! @note overlap everything that only needs the version
+    api->setVersionData(cache[0].version);
+    begin(INIT_ACTIVATE);
+    begin(INIT_FREQUENCY);
+  }
+  pthread_mutex_unlock(&lock);
+
+  api->getDroneVersion(InitSequencer::versionCallback, this);
+  if (warm)
+  {
+    sendActivate();
+    sendFrequency();
+  }
+
+  time_us end = start + (time_us)timeout * 1000;
+  struct timespec ts;
+  ts.tv_sec = end / 1000000;
+  ts.tv_nsec = (end % 1000000) * 1000;
+
+  pthread_mutex_lock(&lock);
+  while (!finished())
+    if (pthread_cond_timedwait(&cond, &lock, &ts) != 0)
+      break;
+  report.totalUs = monotonicTimeUs() - start;
+  report.ok = true;
+  for (int i = 0; i < INIT_PHASE_NUM; ++i)
+    if (!report.phase[i].ok && (i != INIT_CONTROL || obtainControl))
+      report.ok = false;
+  bool versionOk = report.phase[INIT_VERSION].ok;
+  pthread_mutex_unlock(&lock);
+
+  //! @note on a timeout the phases still waiting would call back into a
+  //! sequencer the caller may be about to destroy
+  api->cancelSessions(this);
+
+  if (cacheFile[0] && versionOk)
+    saveCache();
+
+  API_LOG(api->getDriver(), STATUS_LOG,
+      "Init %s in %llu ms: version %llu, activate %llu, frequency %llu, control %llu ms\n",
+      report.ok ? "done" : "failed", (unsigned long long)report.totalUs / 1000,
+      (unsigned long long)report.phase[INIT_VERSION].endUs / 1000,
+      (unsigned long long)report.phase[INIT_ACTIVATE].endUs / 1000,
+      (unsigned long long)report.phase[INIT_FREQUENCY].endUs / 1000,
+      (unsigned long long)report.phase[INIT_CONTROL].endUs / 1000);
+  return report.ok;
+}
+
+InitReport InitSequencer::getReport() const
+{
+  pthread_mutex_lock(&lock);
+  InitReport ans = report;
+  pthread_mutex_unlock(&lock);
+  return ans;
+}
+
+CoreAPI *InitSequencer::getApi() const { return api; }
+
+void InitSequencer::setApi(CoreAPI *value) { api = value; }
+
+void InitSequencer::begin(InitPhaseId id)
+{
+  InitPhase &phase = report.phase[id];
+  if (!phase.started)
+    phase.startUs = monotonicTimeUs() - start;
+  phase.started = true;
+  phase.done = false;
+  phase.ok = false;
+  phase.attempts++;
+}
+
+void InitSequencer::end(InitPhaseId id, uint16_t ack, bool ok)
+{
+  InitPhase &phase = report.phase[id];
+  phase.done = true;
+  phase.ok = ok;
+  phase.ack = ack;
+  phase.endUs = monotonicTimeUs() - start;
+  pthread_cond_signal(&cond);
+}
+
+//! @note a phase that can not run because what it depends on failed
+void InitSequencer::skip(InitPhaseId id)
+{
+  report.phase[id].done = true;
+  report.phase[id].ok = false;
+  pthread_cond_signal(&cond);
+}
+
+bool InitSequencer::finished() const
+{
+  for (int i = 0; i < INIT_PHASE_NUM; ++i)
+    if (!report.phase[i].done && (i != INIT_CONTROL || obtainControl))
+      return false;
+  return true;
+}
+
+void InitSequencer::sendActivate()
+{
+  ActivateData data = activateData;
+  api->activate(&data, InitSequencer::activateCallback, this);
+}
+
+void InitSequencer::sendFrequency()
+{
+  uint8_t data[16];
+  if (defaultFreq)
+    api->getBroadcastFreqDefaults(data);
+  else
+    memcpy(data, freq, sizeof(data));
+  api->setBroadcastFreq(data, InitSequencer::frequencyCallback, this);
+}
+
+void InitSequencer::sendControl() { api->setControl(true, InitSequencer::controlCallback, this); }
+
+uint16_t InitSequencer::ackOf(Header *protocolHeader)
+{
+  uint16_t ack = ACK_COMMON_NO_RESPONSE;
+  size_t len = protocolHeader->length - EXC_DATA_SIZE;
+  memcpy(&ack, (uint8_t *)protocolHeader + sizeof(Header), len < 2 ? len : 2);
+  return ack;
+}
+
+void InitSequencer::versionCallback(CoreAPI *api, Header *protocolHeader, UserData sequencer)
+{
+  InitSequencer *self = (InitSequencer *)sequencer;
+  CoreAPI::getDroneVersionCallback(api, protocolHeader, 0);
+  const VersionData &version = api->getVersionData();
+  bool ok = version.fwVersion != 0;
+  bool activate = false, frequency = false;
+
+  pthread_mutex_lock(&self->lock);
+  self->end(INIT_VERSION, version.version_ack, ok);
+  if (!ok)
+  {
+    self->skip(INIT_ACTIVATE);
+    self->skip(INIT_FREQUENCY);
+    self->skip(INIT_CONTROL);
+  }
+  else if (!self->report.cacheHit)
+  {
+    self->begin(INIT_ACTIVATE);
+    self->begin(INIT_FREQUENCY);
+    activate = frequency = true;
+  }
+  else
+  {
+    const VersionData &cached = self->cache[0].version;
+    self->report.cacheValid =
+      version.fwVersion == cached.fwVersion &&
+      !strncmp(version.hwVersion, cached.hwVersion, sizeof(cached.hwVersion)) &&
+      !strncmp(version.hw_serial_num, cached.hw_serial_num, sizeof(cached.hw_serial_num));
+    if (!self->report.cacheValid)
+    {
+      API_LOG(api->getDriver(), STATUS_LOG, "Cached version is stale, activate again\n");
+      //! @note resend now if the guess was already answered, else on its ACK
+      if (self->report.phase[INIT_ACTIVATE].done)
+      {
+        self->begin(INIT_ACTIVATE);
+        self->report.phase[INIT_CONTROL].done = false;
+        self->report.phase[INIT_CONTROL].started = false;
+        activate = true;
+      }
+      else
+        self->redoActivate = true;
+      if (self->report.phase[INIT_FREQUENCY].done)
+      {
+        self->begin(INIT_FREQUENCY);
+        frequency = true;
+      }
+      else
+        self->redoFrequency = true;
+    }
+  }
+  pthread_mutex_unlock(&self->lock);
+
+  if (activate)
+    self->sendActivate();
+  if (frequency)
+    self->sendFrequency();
+}
+
+void InitSequencer::activateCallback(CoreAPI *api, Header *protocolHeader, UserData sequencer)
+{
+  InitSequencer *self = (InitSequencer *)sequencer;
+  //! @note stores the activation state and the encryption key
+  CoreAPI::activateCallback(api, protocolHeader, 0);
+  uint16_t ack = ackOf(protocolHeader);
+  bool again = false, control = false;
+
+  pthread_mutex_lock(&self->lock);
+  if (self->redoActivate)
+  {
+    self->redoActivate = false;
+    self->begin(INIT_ACTIVATE);
+    again = true;
+  }
+  else
+  {
+    self->end(INIT_ACTIVATE, ack, ack == ACK_ACTIVE_SUCCESS);
+    if (self->obtainControl && ack == ACK_ACTIVE_SUCCESS)
+    {
+      self->begin(INIT_CONTROL);
+      control = true;
+    }
+    else if (self->obtainControl)
+      self->skip(INIT_CONTROL);
+  }
+  pthread_mutex_unlock(&self->lock);
+
+  if (again)
+    self->sendActivate();
+  if (control)
+    self->sendControl();
+}
+
+void InitSequencer::frequencyCallback(CoreAPI *api, Header *protocolHeader, UserData sequencer)
+{
+  InitSequencer *self = (InitSequencer *)sequencer;
+  CoreAPI::setFrequencyCallback(api, protocolHeader, 0);
+  uint16_t ack = ackOf(protocolHeader);
+  bool again = false;
+
+  pthread_mutex_lock(&self->lock);
+  if (self->redoFrequency)
+  {
+    self->redoFrequency = false;
+    self->begin(INIT_FREQUENCY);
+    again = true;
+  }
+  else
+    self->end(INIT_FREQUENCY, ack, ack == 0);
+  pthread_mutex_unlock(&self->lock);
+
+  if (again)
+    self->sendFrequency();
+}
+
+void InitSequencer::controlCallback(CoreAPI *api __UNUSED, Header *protocolHeader,
+    UserData sequencer)
+{
+  InitSequencer *self = (InitSequencer *)sequencer;
+  uint16_t ack = ackOf(protocolHeader);
+  bool again = false;
+
+  pthread_mutex_lock(&self->lock);
+  if (ack == ACK_SETCONTROL_OBTAIN_RUNNING)
+  {
+    self->begin(INIT_CONTROL);
+    again = true;
+  }
+  else
+    self->end(INIT_CONTROL, ack, ack == ACK_SETCONTROL_OBTAIN_SUCCESS);
+  pthread_mutex_unlock(&self->lock);
+
+  if (again)
+    self->sendControl();
+}
+
+bool InitSequencer::loadCache()
+{
+  cacheCount = 0;
+  FILE *fp = fopen(cacheFile, "rb");
+  if (!fp)
+    return false;
+
+  uint32_t head[2] = { 0, 0 };
+  uint8_t count = 0;
+  if (fread(head, sizeof(head), 1, fp) == 1 && head[0] == INIT_CACHE_MAGIC &&
+      head[1] == sizeof(CacheEntry) && fread(&count, 1, 1, fp) == 1)
+  {
+    if (count > INIT_CACHE_SIZE)
+      count = INIT_CACHE_SIZE;
+    cacheCount = fread(cache, sizeof(CacheEntry), count, fp);
+  }
+  fclose(fp);
+  return cacheCount > 0 && cache[0].version.fwVersion != 0;
+}
+
+//! @note most recent flight controller first, one entry per serial number
+void InitSequencer::saveCache()
+{
+  CacheEntry entry;
+  memset(&entry, 0, sizeof(entry));
+  entry.version = api->getVersionData();
+  pthread_mutex_lock(&lock);
+  entry.activation = report.phase[INIT_ACTIVATE].done ? report.phase[INIT_ACTIVATE].ack
+                                                        : (uint16_t)ACK_COMMON_NO_RESPONSE;
+  pthread_mutex_unlock(&lock);
+
+  CacheEntry table[INIT_CACHE_SIZE];
+  uint8_t count = 0;
+  table[count++] = entry;
+  for (uint8_t i = 0; i < cacheCount && count < INIT_CACHE_SIZE; ++i)
+    if (strncmp(cache[i].version.hw_serial_num, entry.version.hw_serial_num,
+            sizeof(entry.version.hw_serial_num)))
+      table[count++] = cache[i];
+
+  FILE *fp = fopen(cacheFile, "wb");
+  if (!fp)
+  {
+    API_LOG(api->getDriver(), ERROR_LOG, "Can not write %s\n", cacheFile);
+    return;
+  }
+  uint32_t head[2] = { INIT_CACHE_MAGIC, sizeof(CacheEntry) };
+  fwrite(head, sizeof(head), 1, fp);
+  fwrite(&count, 1, 1, fp);
+  fwrite(table, sizeof(CacheEntry), count, fp);
+  fclose(fp);
+  memcpy(cache, table, sizeof(CacheEntry) * count);
+  cacheCount = count;
+}
+
+#endif // __linux__
@@ -0,0 +1,202 @@
+/** @file DJI_Kinematics.cpp
+ *  @version 3.1.9
+ *  @date November 10, 2016
+ *
+ *  @brief
+ *  Attitude and velocity derived once per broadcast sample
+ *
+ *  @copyright 2016 DJI. All rights reserved.
+ *
+ */
+
+#include "DJI_Kinematics.h"
+#include <math.h>
+#include <string.h>
+
+using namespace DJI;
+using namespace DJI::onboardSDK;
+
+KinematicsCache::KinematicsCache()
+{
+  driver = 0;
+  sampleSeq = 0;
+  derivedSeq = 0;
+  claimed = 0;
+  deriveCount = 0;
+  memset(&sample, 0, sizeof(sample));
+  memset(&derived, 0, sizeof(derived));
+}
+
+void KinematicsCache::setDriver(HardDriver *value) { driver = value; }
+
+#ifdef API_LOCK_FREE
+void KinematicsCache::publish(const QuaternionData &q, const VelocityData &v, uint32_t timeStamp)
+{
+  uint32_t seq = __atomic_load_n(&sampleSeq, __ATOMIC_RELAXED);
+  __atomic_store_n(&sampleSeq, seq + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  sample.timeStamp = timeStamp;
+  sample.q = q;
+  sample.v = v;
+  __atomic_store_n(&sampleSeq, seq + 2, __ATOMIC_RELEASE);
+}
+
+uint32_t KinematicsCache::readSample(Sample *out) const
+{
+  for (;;)
+  {
+    uint32_t seq = __atomic_load_n(&sampleSeq, __ATOMIC_ACQUIRE);
+    if (seq & 1)
+      continue;
+    memcpy(out, &sample, sizeof(Sample));
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&sampleSeq, __ATOMIC_RELAXED) == seq)
+      return seq / 2;
+  }
+}
+
+bool KinematicsCache::readDerived(KinematicsData *out) const
+{
+  uint32_t seq = __atomic_load_n(&derivedSeq, __ATOMIC_ACQUIRE);
+  if (seq & 1)
+    return false;
+  memcpy(out, &derived, sizeof(KinematicsData));
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  return __atomic_load_n(&derivedSeq, __ATOMIC_RELAXED) == seq;
+}
+
+void KinematicsCache::writeDerived(const KinematicsData &data)
+{
+  //! @note readers deriving different samples may finish together, the
+  //! loser keeps its result to itself
+  uint32_t seq = __atomic_load_n(&derivedSeq, __ATOMIC_RELAXED);
+  if ((seq & 1) || !__atomic_compare_exchange_n(&derivedSeq, &seq, seq + 1, false,
+                       __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+    return;
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  if (data.generation > derived.generation)
+    derived = data;
+  __atomic_store_n(&derivedSeq, seq + 2, __ATOMIC_RELEASE);
+}
+
+void KinematicsCache::deriveSample(KinematicsData *out)
+{
+  Sample s;
+  uint32_t generation = readSample(&s);
+  derive(out, s.q, s.v);
+  out->generation = generation;
+  out->timeStamp = s.timeStamp;
+  __atomic_fetch_add(&deriveCount, 1, __ATOMIC_RELAXED);
+}
+
+KinematicsData KinematicsCache::get()
+{
+  KinematicsData ans;
+  for (int spin = 0; spin < KINEMATICS_SPIN; ++spin)
+  {
+    uint32_t latest = __atomic_load_n(&sampleSeq, __ATOMIC_ACQUIRE) / 2;
+    if (readDerived(&ans) && ans.generation >= latest)
+      return ans;
+
+    uint32_t seen = __atomic_load_n(&claimed, __ATOMIC_RELAXED);
+    if (seen < latest && __atomic_compare_exchange_n(&claimed, &seen, latest, false,
+                             __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+    {
+      deriveSample(&ans);
+      writeDerived(ans);
+      return ans;
+    }
+  }
+  deriveSample(&ans);
+  return ans;
+}
+
+uint32_t KinematicsCache::getGeneration() const
+{
+  return __atomic_load_n(&sampleSeq, __ATOMIC_ACQUIRE) / 2;
+}
+
+uint32_t KinematicsCache::getDeriveCount() const
+{
+  return __atomic_load_n(&deriveCount, __ATOMIC_RELAXED);
+}
+#else
+//! @note the caller holds lockMSG()
+void KinematicsCache::publish(const QuaternionData &q, const VelocityData &v, uint32_t timeStamp)
+{
+  sample.timeStamp = timeStamp;
+  sample.q = q;
+  sample.v = v;
+  sampleSeq += 2;
+}
+
+KinematicsData KinematicsCache::get()
+{
+  KinematicsData ans;
+  LockPolicy::lockMSG(driver);
+  if (derived.generation < sampleSeq / 2)
+  {
+    derive(&derived, sample.q, sample.v);
+    derived.generation = sampleSeq / 2;
+    derived.timeStamp = sample.timeStamp;
+    deriveCount++;
+  }
+  ans = derived;
+  LockPolicy::freeMSG(driver);
+  return ans;
+}
+
+uint32_t KinematicsCache::getGeneration() const
+{
+  LockPolicy::lockMSG(driver);
+  uint32_t ans = sampleSeq / 2;
+  LockPolicy::freeMSG(driver);
+  return ans;
+}
+
+uint32_t KinematicsCache::getDeriveCount() const
+{
+  LockPolicy::lockMSG(driver);
+  uint32_t ans = deriveCount;
+  LockPolicy::freeMSG(driver);
+  return ans;
+}
+#endif // API_LOCK_FREE
+
+EulerAngle KinematicsCache::getEulerAngle() { return get().euler; }
+
+float64_t KinematicsCache::getGroundSpeed() { return get().groundSpeed; }
+
+Angle KinematicsCache::getHeading() { return get().heading; }
+
+void KinematicsCache::derive(KinematicsData *out, const QuaternionData &q, const VelocityData &v)
+{
+  double q0 = q.q0, q1 = q.q1, q2 = q.q2, q3 = q.q3;
+  double (*r)[3] = out->rotation;
+
+  r[0][0] = 1.0 - 2.0 * (q2 * q2 + q3 * q3);
+  r[0][1] = 2.0 * (q1 * q2 - q0 * q3);
+  r[0][2] = 2.0 * (q1 * q3 + q0 * q2);
+  r[1][0] = 2.0 * (q1 * q2 + q0 * q3);
+  r[1][1] = 1.0 - 2.0 * (q1 * q1 + q3 * q3);
+  r[1][2] = 2.0 * (q2 * q3 - q0 * q1);
+  r[2][0] = 2.0 * (q1 * q3 - q0 * q2);
+  r[2][1] = 2.0 * (q2 * q3 + q0 * q1);
+  r[2][2] = 1.0 - 2.0 * (q1 * q1 + q2 * q2);
+
+  //! @note same angles as Flight::toEulerAngle()
+  double sinPitch = -r[2][0];
+  sinPitch = sinPitch > 1.0 ? 1.0 : (sinPitch < -1.0 ? -1.0 : sinPitch);
+  out->euler.pitch = asin(sinPitch);
+  out->euler.roll = atan2(r[2][1], r[2][2]);
+  out->euler.yaw = atan2(r[1][0], r[0][0]);
+
+  //! @note broadcast velocity is north, east, up
+  double n = v.x, e = v.y, d = -v.z;
+  out->bodyVelocity.x = r[0][0] * n + r[1][0] * e + r[2][0] * d;
+  out->bodyVelocity.y = r[0][1] * n + r[1][1] * e + r[2][1] * d;
+  out->bodyVelocity.z = r[0][2] * n + r[1][2] * e + r[2][2] * d;
+  out->groundSpeed = sqrt(n * n + e * e);
+  out->heading = atan2(e, n);
+  out->q = q;
+}
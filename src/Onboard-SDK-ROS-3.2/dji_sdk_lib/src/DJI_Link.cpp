@@ -21,26 +21,59 @@
 #include "DJI_Codec.h"
 #include <stdio.h>
 #include <string.h>
+#ifdef __linux__
+#include <time.h>
+#endif
 
 #include "DJI_Logging.h"
 
 using namespace DJI::onboardSDK;
 
-CallBack callBack   = 0;
-void*    data       = 0;
-Header*  protHeader = 0;
-
+//! @note called with lockMemory held
 void
 CoreAPI::sendData(unsigned char* buf)
 {
-  size_t  ans;
   Header* pHeader = (Header*)buf;
 
 #ifdef API_TRACE_DATA
   printFrame(serialDevice, pHeader, true);
 #endif
 
-  ans = serialDevice->send(buf, pHeader->length);
+  txStats.frames++;
+  if (!txCombine)
+  {
+    writeData(buf, pHeader->length);
+    return;
+  }
+
+  uint64_t now = txNow();
+  if (txLength && now - txOldest >= txDeadlineUs)
+    flushTx(TX_FLUSH_DEADLINE);
+  if (txLength + pHeader->length > TX_COMBINE_SIZE)
+    flushTx(TX_FLUSH_FULL);
+  if (pHeader->length > TX_COMBINE_SIZE)
+  {
+    writeData(buf, pHeader->length);
+    return;
+  }
+
+  bool first = txLength == 0;
+  if (first)
+    txOldest = now;
+  memcpy(txBuffer + txLength, buf, pHeader->length);
+  txLength += pHeader->length;
+  txFrames++;
+  txAppendSum += now;
+  if (first && txPendingCallback.callback)
+    txPendingCallback.callback(this, pHeader, txPendingCallback.userData);
+}
+
+void
+CoreAPI::writeData(const uint8_t* buf, size_t len)
+{
+  size_t ans = serialDevice->send(buf, len);
+  txStats.writes++;
+  txStats.bytes += len;
   if (ans == 0)
   {
     API_LOG(serialDevice, STATUS_LOG, "Port not send");
@@ -51,6 +84,203 @@ CoreAPI::sendData(unsigned char* buf)
   }
 }
 
+//! @note called with lockMemory held
+void
+CoreAPI::flushTx(TxFlush reason)
+{
+  if (txLength == 0)
+    return;
+
+  uint64_t now = txNow();
+  writeData(txBuffer, txLength);
+  switch (reason)
+  {
+    case TX_FLUSH_FULL:
+      txStats.flushFull++;
+      break;
+    case TX_FLUSH_TICK:
+      txStats.flushTick++;
+      break;
+    case TX_FLUSH_DEADLINE:
+      txStats.flushDeadline++;
+      break;
+    case TX_FLUSH_EXPLICIT:
+      txStats.flushExplicit++;
+      break;
+  }
+  if (now - txOldest > txStats.maxDelayUs)
+    txStats.maxDelayUs = (uint32_t)(now - txOldest);
+  txStats.totalDelayUs += txFrames * now - txAppendSum;
+  txLength    = 0;
+  txFrames    = 0;
+  txAppendSum = 0;
+}
+
+uint64_t
+CoreAPI::txNow() const
+{
+#ifdef __linux__
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#else
+  return (uint64_t)serialDevice->getTimeStamp() * 1000;
+#endif
+}
+
+void
+CoreAPI::setWriteCombining(bool enable, uint32_t deadlineUs)
+{
+  LockPolicy::lockMemory(serialDevice);
+  if (!enable)
+    flushTx(TX_FLUSH_EXPLICIT);
+  txCombine    = enable;
+  txDeadlineUs = deadlineUs;
+  LockPolicy::freeMemory(serialDevice);
+}
+
+bool
+CoreAPI::getWriteCombining() const
+{
+  return txCombine;
+}
+
+#if TX_QUEUE_NUM > 0
+//! @note any thread; false if the queue is full
+bool
+CoreAPI::queueTx(const unsigned char* frame, uint16_t length)
+{
+  uint32_t pos = LockPolicy::load(&txHead);
+  for (;;)
+  {
+    TxSlot* slot = &txQueue[pos & (TX_QUEUE_NUM - 1)];
+    int32_t diff = (int32_t)(LockPolicy::load(&slot->turn) - pos);
+    if (diff == 0)
+    {
+      if (LockPolicy::compareExchange(&txHead, &pos, pos + 1))
+      {
+        memcpy(slot->frame, frame, length);
+        LockPolicy::store(&slot->turn, pos + 1);
+        return true;
+      }
+    }
+    else if (diff < 0)
+      return false;
+    else
+      pos = LockPolicy::load(&txHead);
+  }
+}
+
+//! @note the next frame to send is complete, read by the drainer
+bool
+CoreAPI::txReady() const
+{
+  return LockPolicy::load(&txQueue[txTail & (TX_QUEUE_NUM - 1)].turn) == txTail + 1;
+}
+#endif
+
+//! @note called with lockMemory held, which makes the caller the only reader
+void
+CoreAPI::sendQueued()
+{
+#if TX_QUEUE_NUM > 0
+  while (txReady())
+  {
+    TxSlot* slot = &txQueue[txTail & (TX_QUEUE_NUM - 1)];
+    sendData(slot->frame);
+    LockPolicy::store(&slot->turn, txTail + TX_QUEUE_NUM);
+    txTail++;
+  }
+#endif
+}
+
+/*! @note A sender finding txDrain taken leaves its frame to the holder rather
+ *  than wait for lockMemory. Whoever appends a frame tries to drain afterwards
+ *  and the holder looks again once it let go, so no frame is left behind.
+ */
+void
+CoreAPI::drainTx()
+{
+#if TX_QUEUE_NUM > 0
+  LockPolicy::fence();
+  while (txReady())
+  {
+    if (!LockPolicy::claimBit(&txDrain, 0))
+      return;
+    LockPolicy::lockMemory(serialDevice);
+    sendQueued();
+    LockPolicy::freeMemory(serialDevice);
+    LockPolicy::releaseBit(&txDrain, 0);
+    LockPolicy::fence();
+  }
+#endif
+}
+
+void
+CoreAPI::handOff(const unsigned char* frame, uint16_t length)
+{
+#if TX_QUEUE_NUM > 0
+  while (!queueTx(frame, length))
+  {
+    //! @note full, wait for lockMemory and empty it here
+    LockPolicy::lockMemory(serialDevice);
+    sendQueued();
+    LockPolicy::freeMemory(serialDevice);
+  }
+  drainTx();
+#else
+  //! @note sendData() takes the length from the frame header
+  (void)length;
+  LockPolicy::lockHandOff(serialDevice);
+  sendData((unsigned char*)frame);
+  LockPolicy::freeHandOff(serialDevice);
+#endif
+}
+
+void
+CoreAPI::flush()
+{
+  drainTx();
+  LockPolicy::lockMemory(serialDevice);
+  flushTx(TX_FLUSH_EXPLICIT);
+  LockPolicy::freeMemory(serialDevice);
+}
+
+uint64_t
+CoreAPI::flushIfDue()
+{
+  uint64_t due = 0;
+  LockPolicy::lockMemory(serialDevice);
+  if (txLength)
+  {
+    due = txOldest + txDeadlineUs;
+    if (txNow() >= due)
+    {
+      flushTx(TX_FLUSH_DEADLINE);
+      due = 0;
+    }
+  }
+  LockPolicy::freeMemory(serialDevice);
+  return due;
+}
+
+TxStats
+CoreAPI::getTxStats() const
+{
+  LockPolicy::lockMemory(serialDevice);
+  TxStats ans = txStats;
+  LockPolicy::freeMemory(serialDevice);
+  return ans;
+}
+
+void
+CoreAPI::resetTxStats()
+{
+  LockPolicy::lockMemory(serialDevice);
+  memset(&txStats, 0, sizeof(txStats));
+  LockPolicy::freeMemory(serialDevice);
+}
+
 void
 CoreAPI::appHandler(Header* protocolHeader)
 {
@@ -64,7 +294,7 @@ CoreAPI::appHandler(Header* protocolHeader)
   {
     if (protocolHeader->sessionID > 1 && protocolHeader->sessionID < 32)
     {
-      serialDevice->lockMemory();
+      LockPolicy::lockMemory(serialDevice);
       uint32_t usageFlag = CMDSessionTab[protocolHeader->sessionID].usageFlag;
       if (usageFlag == 1)
       {
@@ -76,12 +306,17 @@ CoreAPI::appHandler(Header* protocolHeader)
           API_LOG(serialDevice, DEBUG_LOG, "Recv Session %d ACK\n",
                   p2protocolHeader->sessionID);
 
-          callBack = CMDSessionTab[protocolHeader->sessionID].handler;
-          data     = CMDSessionTab[protocolHeader->sessionID].userData;
+          if (CMDSessionTab[protocolHeader->sessionID].sent == 1)
+            sampleRtt(&CMDSessionTab[protocolHeader->sessionID],
+                      serialDevice->getTimeStamp());
+          ackCallback = CMDSessionTab[protocolHeader->sessionID].handler;
+          ackUserData = CMDSessionTab[protocolHeader->sessionID].userData;
+          if (ackCallback)
+            ackRunning = ackUserData;
           freeSession(&CMDSessionTab[protocolHeader->sessionID]);
-          serialDevice->freeMemory();
+          LockPolicy::freeMemory(serialDevice);
 
-          if (callBack)
+          if (ackCallback)
           {
             //! Non-blocking callback thread
             if (nonBlockingCBThreadEnable == true)
@@ -90,7 +325,10 @@ CoreAPI::appHandler(Header* protocolHeader)
             }
             else if (nonBlockingCBThreadEnable == false)
             {
-              callBack(this, protocolHeader, data);
+              ackCallback(this, protocolHeader, ackUserData);
+              LockPolicy::lockMemory(serialDevice);
+              ackRunning = 0;
+              LockPolicy::freeMemory(serialDevice);
             }
           }
           else
@@ -108,12 +346,12 @@ CoreAPI::appHandler(Header* protocolHeader)
         }
         else
         {
-          serialDevice->freeMemory();
+          LockPolicy::freeMemory(serialDevice);
         }
       }
       else
       {
-        serialDevice->freeMemory();
+        LockPolicy::freeMemory(serialDevice);
       }
     }
   }
@@ -149,7 +387,7 @@ CoreAPI::appHandler(Header* protocolHeader)
         else if (ACKSessionTab[protocolHeader->sessionID - 1].sessionStatus ==
                  ACK_SESSION_USING)
         {
-          serialDevice->lockMemory();
+          LockPolicy::lockMemory(serialDevice);
           p2protocolHeader =
             (Header*)ACKSessionTab[protocolHeader->sessionID - 1].mmu->pmem;
           if (p2protocolHeader->sequenceNumber ==
@@ -159,7 +397,7 @@ CoreAPI::appHandler(Header* protocolHeader)
                                              "id=%d,seq_num=%d\n",
                     protocolHeader->sessionID, protocolHeader->sequenceNumber);
             sendData(ACKSessionTab[protocolHeader->sessionID - 1].mmu->pmem);
-            serialDevice->freeMemory();
+            LockPolicy::freeMemory(serialDevice);
           }
           else
           {
@@ -170,7 +408,7 @@ CoreAPI::appHandler(Header* protocolHeader)
                     protocolHeader->sequenceNumber);
             ACKSessionTab[protocolHeader->sessionID - 1].sessionStatus =
               ACK_SESSION_PROCESS;
-            serialDevice->freeMemory();
+            LockPolicy::freeMemory(serialDevice);
             recvReqData(protocolHeader);
           }
         }
@@ -220,12 +458,12 @@ CoreAPI::notifyNonBlockingCaller(Header* protocolHeader)
 
   allocateACK(protocolHeader);
 
-  //! Copying protocol header to a global variable - will be passed to the
+  //! Copying protocol header to a member - will be passed to the
   //! Callback thread.
-  //! protHeader is not thread safe and is passed to Callback for legacy
+  //! ackHeader is not thread safe and is passed to Callback for legacy
   //! purposes.
   //! Ack is available in the callback via MissionACKUnion.
-  protHeader = protocolHeader;
+  ackHeader = protocolHeader;
   serialDevice->freeNonBlockCBAck();
 
   serialDevice->lockProtocolHeader();
@@ -246,7 +484,7 @@ CoreAPI::sendPoll()
       if ((curTimestamp - CMDSessionTab[i].preTimestamp) >
           CMDSessionTab[i].timeout)
       {
-        serialDevice->lockMemory();
+        LockPolicy::lockMemory(serialDevice);
         if (CMDSessionTab[i].retry > 0)
         {
           if (CMDSessionTab[i].sent >= CMDSessionTab[i].retry)
@@ -263,6 +501,14 @@ CoreAPI::sendPoll()
             sendData(CMDSessionTab[i].mmu->pmem);
             CMDSessionTab[i].preTimestamp = curTimestamp;
             CMDSessionTab[i].sent++;
+            if (CMDSessionTab[i].cmdSet < RTT_SET_NUM)
+              rtt[CMDSessionTab[i].cmdSet].retransmits++;
+            //! @note back off, the estimate was too short or the link is lossy
+            if (adaptiveTimeout)
+              CMDSessionTab[i].timeout =
+                CMDSessionTab[i].timeout * 2 < maxTimeout
+                  ? CMDSessionTab[i].timeout * 2
+                  : maxTimeout;
           }
         }
         else
@@ -271,7 +517,7 @@ CoreAPI::sendPoll()
           sendData(CMDSessionTab[i].mmu->pmem);
           CMDSessionTab[i].preTimestamp = curTimestamp;
         }
-        serialDevice->freeMemory();
+        LockPolicy::freeMemory(serialDevice);
       }
       else
       {
@@ -280,6 +526,12 @@ CoreAPI::sendPoll()
     }
   }
   //! @note Add auto resendpoll
+  if (txCombine)
+  {
+    LockPolicy::lockMemory(serialDevice);
+    flushTx(TX_FLUSH_TICK);
+    LockPolicy::freeMemory(serialDevice);
+  }
 }
 
 void
@@ -296,6 +548,63 @@ CoreAPI::readPoll()
   {
     byteHandler(buf[i]);
   }
+  //! @note ACKs to everything decoded from this read leave in one write
+  if (txCombine && read_len > 0)
+  {
+    LockPolicy::lockMemory(serialDevice);
+    flushTx(TX_FLUSH_TICK);
+    LockPolicy::freeMemory(serialDevice);
+  }
+}
+
+//! @note once a command set has RTT samples its estimate replaces the caller's
+//! timeout, bounded by [minTimeout, maxTimeout] as they are now, not as they
+//! were when the estimate was taken
+uint16_t
+CoreAPI::sessionTimeout(uint8_t cmdSet, uint16_t timeout) const
+{
+  if (adaptiveTimeout && cmdSet < RTT_SET_NUM && rtt[cmdSet].samples > 0)
+  {
+    timeout = rtt[cmdSet].rto;
+    if (timeout < minTimeout)
+      timeout = minTimeout;
+    if (timeout > maxTimeout)
+      timeout = maxTimeout;
+  }
+  return (timeout > POLL_TICK) ? timeout : POLL_TICK;
+}
+
+//! @note called with lockMemory held, only for sessions sent once
+void
+CoreAPI::sampleRtt(CMDSession* session, time_ms now)
+{
+  if (session->cmdSet >= RTT_SET_NUM)
+    return;
+  RttEstimate* est    = &rtt[session->cmdSet];
+  float32_t    sample = (float32_t)(now - session->preTimestamp);
+
+  if (est->samples == 0)
+  {
+    est->srtt   = sample;
+    est->rttvar = sample / 2;
+  }
+  else
+  {
+    float32_t err = est->srtt > sample ? est->srtt - sample : sample - est->srtt;
+    est->rttvar   = 0.75f * est->rttvar + 0.25f * err;
+    est->srtt     = 0.875f * est->srtt + 0.125f * sample;
+  }
+  est->samples++;
+  est->lastRtt = (uint32_t)sample;
+
+  //! @note POLL_TICK is the resolution of sendPoll, as the clock granularity
+  float32_t var = 4 * est->rttvar > POLL_TICK ? 4 * est->rttvar : POLL_TICK;
+  float32_t rto = est->srtt + var;
+  if (rto < minTimeout)
+    rto = minTimeout;
+  if (rto > maxTimeout)
+    rto = maxTimeout;
+  est->rto = (uint16_t)(rto + 0.5f);
 }
 
 //! @todo Implement callback poll here
@@ -304,10 +613,13 @@ CoreAPI::callbackPoll(CoreAPI* api)
 {
   serialDevice->lockNonBlockCBAck();
   serialDevice->nonBlockWait();
-  //! The protHeader is being passed to the Callback function for legacy
+  //! The ackHeader is being passed to the Callback function for legacy
   //! purposes and is not thread safe.
   //! Ack is already avaialble to you in the callback via the mission ACK Union.
-  callBack(api, protHeader, data);
+  ackCallback(api, ackHeader, ackUserData);
+  LockPolicy::lockMemory(serialDevice);
+  ackRunning = 0;
+  LockPolicy::freeMemory(serialDevice);
   serialDevice->freeNonBlockCBAck();
 }
 
@@ -328,7 +640,7 @@ CoreAPI::setKey(const char* key)
 void
 CoreAPI::setActivation(bool isActivated)
 {
-  serialDevice->lockMSG();
+  LockPolicy::lockMSG(serialDevice);
   if (isActivated)
   {
     broadcastData.activation = 1;
@@ -337,7 +649,7 @@ CoreAPI::setActivation(bool isActivated)
   {
     broadcastData.activation = 0;
   }
-  serialDevice->freeMSG();
+  LockPolicy::freeMSG(serialDevice);
 }
 
 void
@@ -389,13 +701,13 @@ CoreAPI::ackInterface(Ack* parameter)
   }
   else if (parameter->sessionID > 0 && parameter->sessionID < 32)
   {
-    serialDevice->lockMemory();
+    LockPolicy::lockMemory(serialDevice);
     ack_session =
       allocACK(parameter->sessionID,
                calculateLength(parameter->length, parameter->encrypt));
     if (ack_session == (ACKSession*)NULL)
     {
-      serialDevice->freeMemory();
+      LockPolicy::freeMemory(serialDevice);
       return -1;
     }
 
@@ -404,13 +716,13 @@ CoreAPI::ackInterface(Ack* parameter)
     if (ret == 0)
     {
       API_LOG(serialDevice, ERROR_LOG, "encrypt ERROR\n");
-      serialDevice->freeMemory();
+      LockPolicy::freeMemory(serialDevice);
       return -1;
     }
 
     API_LOG(serialDevice, DEBUG_LOG, "Sending data!");
     sendData(ack_session->mmu->pmem);
-    serialDevice->freeMemory();
+    LockPolicy::freeMemory(serialDevice);
     ack_session->sessionStatus = ACK_SESSION_USING;
     return 0;
   }
@@ -418,130 +730,114 @@ CoreAPI::ackInterface(Ack* parameter)
   return -1;
 }
 
+/*! @note With API_LOCK_FREE no lock is held while a frame is built. The
+ *  sequence number and the session slot are claimed with atomics, the frame
+ *  is encrypted and its CRCs computed in a per-thread buffer, and lockMemory
+ *  is held just to place a session frame in session memory. The frame then
+ *  goes through the transmit queue, see drainTx(). Without it the caller
+ *  holds lockSend() throughout.
+ */
 int
 CoreAPI::sendInterface(Command* parameter)
 {
+  static API_THREAD_LOCAL unsigned char frame[BUFFER_SIZE];
   unsigned short ret        = 0;
   CMDSession*    cmdSession = (CMDSession*)NULL;
+  MMU_Tab*       mmu        = (MMU_Tab*)NULL;
+  uint16_t       seq;
   if (parameter->length > PRO_PURE_DATA_MAX_SIZE)
   {
     API_LOG(serialDevice, ERROR_LOG, "ERROR,length=%lu is over-sized\n",
             parameter->length);
     return -1;
   }
+  if (calculateLength(parameter->length, parameter->encrypt) > sizeof(frame))
+  {
+    API_LOG(serialDevice, ERROR_LOG, "ERROR,length=%lu over BUFFER_SIZE\n",
+            parameter->length);
+    return -1;
+  }
 
   switch (parameter->sessionMode)
   {
     case 0:
-      serialDevice->lockMemory();
-      cmdSession = allocSession(
-        CMD_SESSION_0, calculateLength(parameter->length, parameter->encrypt));
-
-      if (cmdSession == (CMDSession*)NULL)
-      {
-        serialDevice->freeMemory();
-        API_LOG(serialDevice, ERROR_LOG, "ERROR,there is not enough memory\n");
-        return -1;
-      }
-      ret = encrypt(cmdSession->mmu->pmem, parameter->buf, parameter->length, 0,
-                    parameter->encrypt, cmdSession->sessionID, seq_num);
+      //! @note fire and forget, no session memory needed
+      ret = encrypt(frame, parameter->buf, parameter->length, 0,
+                    parameter->encrypt, CMD_SESSION_0,
+                    LockPolicy::nextSequence(&seq_num));
       if (ret == 0)
       {
         API_LOG(serialDevice, ERROR_LOG, "encrypt ERROR\n");
-        freeSession(cmdSession);
-        serialDevice->freeMemory();
         return -1;
       }
 
       API_LOG(serialDevice, DEBUG_LOG, "send data in session mode 0\n");
 
-      sendData(cmdSession->mmu->pmem);
-      seq_num++;
-      freeSession(cmdSession);
-      serialDevice->freeMemory();
+      handOff(frame, ret);
       break;
+
+    // Case 2 is almost the same as case 1, except CMD_SESSION_AUTO and retry
+    // settings.
     case 1:
-      serialDevice->lockMemory();
-      cmdSession = allocSession(
-        CMD_SESSION_1, calculateLength(parameter->length, parameter->encrypt));
+    case 2:
+      cmdSession = claimSession(parameter->sessionMode == 1 ? CMD_SESSION_1
+                                                            : CMD_SESSION_AUTO);
       if (cmdSession == (CMDSession*)NULL)
       {
-        serialDevice->freeMemory();
         API_LOG(serialDevice, ERROR_LOG, "ERROR,there is not enough memory\n");
         return -1;
       }
-      if (seq_num == cmdSession->preSeqNum)
+      if (!parameter->handler)
+      {
+        //! @note the ACK goes to notifyCaller(), drop one an earlier blocking
+        //! command got after its wait() timed out
+        serialDevice->lockACK();
+        serialDevice->clearACK();
+        serialDevice->freeACK();
+      }
+      seq = LockPolicy::nextSequence(&seq_num);
+      if (seq == cmdSession->preSeqNum)
       {
-        seq_num++;
+        seq = LockPolicy::nextSequence(&seq_num);
       }
-      ret = encrypt(cmdSession->mmu->pmem, parameter->buf, parameter->length, 0,
-                    parameter->encrypt, cmdSession->sessionID, seq_num);
+      ret = encrypt(frame, parameter->buf, parameter->length, 0,
+                    parameter->encrypt, cmdSession->sessionID, seq);
       if (ret == 0)
       {
         API_LOG(serialDevice, ERROR_LOG, "encrypt ERROR\n");
-        freeSession(cmdSession);
-        serialDevice->freeMemory();
+        releaseSession(cmdSession);
         return -1;
       }
-      cmdSession->preSeqNum = seq_num++;
 
-      cmdSession->handler  = parameter->handler;
-      cmdSession->userData = parameter->userData;
-      cmdSession->timeout =
-        (parameter->timeout > POLL_TICK) ? parameter->timeout : POLL_TICK;
-      cmdSession->preTimestamp = serialDevice->getTimeStamp();
-      cmdSession->sent         = 1;
-      cmdSession->retry        = 1;
-      API_LOG(serialDevice, DEBUG_LOG, "sending session %d\n",
-              cmdSession->sessionID);
-      sendData(cmdSession->mmu->pmem);
-      serialDevice->freeMemory();
-      break;
-
-    // Case 2 is almost the same as case 1, except CMD_SESSION_AUTO and retry
-    // settings.
-    case 2:
-      serialDevice->lockMemory();
-      cmdSession =
-        allocSession(CMD_SESSION_AUTO,
-                     calculateLength(parameter->length, parameter->encrypt));
-      if (cmdSession == (CMDSession*)NULL)
+      LockPolicy::lockHandOff(serialDevice);
+      mmu = allocMemory(ret);
+      if (mmu == (MMU_Tab*)NULL)
       {
-        serialDevice->freeMemory();
+        LockPolicy::freeHandOff(serialDevice);
+        releaseSession(cmdSession);
         API_LOG(serialDevice, ERROR_LOG, "ERROR,there is not enough memory\n");
         return -1;
       }
-      if (seq_num == cmdSession->preSeqNum)
-      {
-        seq_num++;
-      }
-      ret = encrypt(cmdSession->mmu->pmem, parameter->buf, parameter->length, 0,
-                    parameter->encrypt, cmdSession->sessionID, seq_num);
-
-      if (ret == 0)
-      {
-        API_LOG(serialDevice, ERROR_LOG, "encrypt ERROR");
-        freeSession(cmdSession);
-        serialDevice->freeMemory();
-        return -1;
-      }
-      cmdSession->preSeqNum = seq_num++;
+      memcpy(mmu->pmem, frame, ret);
+      cmdSession->mmu       = mmu;
+      cmdSession->preSeqNum = seq;
       cmdSession->handler   = parameter->handler;
       cmdSession->userData  = parameter->userData;
-      cmdSession->timeout =
-        (parameter->timeout > POLL_TICK) ? parameter->timeout : POLL_TICK;
+      cmdSession->cmdSet  = parameter->buf[0];
+      cmdSession->timeout = sessionTimeout(cmdSession->cmdSet, parameter->timeout);
       cmdSession->preTimestamp = serialDevice->getTimeStamp();
       cmdSession->sent         = 1;
-      cmdSession->retry        = parameter->retry;
+      cmdSession->retry = parameter->sessionMode == 1 ? 1 : parameter->retry;
+      cmdSession->usageFlag = 1;
       API_LOG(serialDevice, DEBUG_LOG, "Sending session %d\n",
               cmdSession->sessionID);
-      sendData(cmdSession->mmu->pmem);
-      serialDevice->freeMemory();
+      LockPolicy::freeHandOff(serialDevice);
+      handOff(frame, ret);
       break;
     default:
       API_LOG(serialDevice, ERROR_LOG, "Unknown mode:%d\n",
               parameter->sessionMode);
       break;
   }
-  return 0;
+  return cmdSession ? cmdSession->sessionID : 0;
 }
@@ -0,0 +1,248 @@
+/** @file DJI_LinuxSerialDevice.cpp
+ *  @version 3.1.9
+ *  @date November 10, 2016
+ *
+ *  @brief
+ *  Reference HardDriver for Linux serial ports
+ *
+ *  @copyright 2016 DJI. All rights reserved.
+ *
+ */
+
+#include "DJI_LinuxSerialDevice.h"
+
+#ifdef __linux__
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/serial.h>
+
+using namespace DJI;
+using namespace DJI::onboardSDK;
+
+static speed_t baudrateFlag(unsigned int baudrate)
+{
+  switch (baudrate)
+  {
+    case 9600:
+      return B9600;
+    case 19200:
+      return B19200;
+    case 38400:
+      return B38400;
+    case 57600:
+      return B57600;
+    case 115200:
+      return B115200;
+    case 230400:
+      return B230400;
+    case 460800:
+      return B460800;
+    case 921600:
+      return B921600;
+    case 1000000:
+      return B1000000;
+    case 1500000:
+      return B1500000;
+    case 2000000:
+      return B2000000;
+    default:
+      return B0;
+  }
+}
+
+LinuxSerialDevice::LinuxSerialDevice(const char *Device, unsigned int Baudrate)
+{
+  fd = -1;
+  readTimeout = 100;
+  lowLatency = false;
+  setDevice(Device);
+  setBaudrate(Baudrate);
+
+  pthread_mutex_init(&memLock, 0);
+  pthread_mutex_init(&msgLock, 0);
+  pthread_mutex_init(&headerLock, 0);
+}
+
+LinuxSerialDevice::~LinuxSerialDevice()
+{
+  close();
+  pthread_mutex_destroy(&headerLock);
+  pthread_mutex_destroy(&msgLock);
+  pthread_mutex_destroy(&memLock);
+}
+
+void LinuxSerialDevice::init()
+{
+  API_LOG(this, STATUS_LOG, "Open %s at %u baud\n", device, baudrate);
+  if (!reopen())
+    API_LOG(this, ERROR_LOG, "Failed to open %s\n", device);
+}
+
+bool LinuxSerialDevice::reopen()
+{
+  close();
+  fd = open(device, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+  if (fd < 0)
+    return false;
+  if (!configure())
+  {
+    close();
+    return false;
+  }
+  return true;
+}
+
+void LinuxSerialDevice::close()
+{
+  if (fd >= 0)
+    ::close(fd);
+  fd = -1;
+}
+
+bool LinuxSerialDevice::configure()
+{
+  speed_t speed = baudrateFlag(baudrate);
+  if (speed == B0)
+  {
+    API_LOG(this, ERROR_LOG, "Unsupported baudrate %u\n", baudrate);
+    return false;
+  }
+
+  struct termios tio;
+  if (tcgetattr(fd, &tio) != 0)
+    return false;
+  cfmakeraw(&tio);
+  tio.c_cflag &= ~(CSTOPB | PARENB | CRTSCTS | CSIZE);
+  tio.c_cflag |= CS8 | CLOCAL | CREAD;
+  tio.c_iflag &= ~(IXON | IXOFF | IXANY);
+  //! @note readall() waits in poll(), read() itself never blocks
+  tio.c_cc[VMIN] = 0;
+  tio.c_cc[VTIME] = 0;
+  cfsetispeed(&tio, speed);
+  cfsetospeed(&tio, speed);
+  if (tcsetattr(fd, TCSANOW, &tio) != 0)
+    return false;
+  tcflush(fd, TCIOFLUSH);
+
+  struct serial_struct serial;
+  lowLatency = false;
+  if (ioctl(fd, TIOCGSERIAL, &serial) == 0)
+  {
+    serial.flags |= ASYNC_LOW_LATENCY;
+    lowLatency = ioctl(fd, TIOCSSERIAL, &serial) == 0;
+  }
+  if (!lowLatency)
+    API_LOG(this, DEBUG_LOG, "%s has no low latency mode\n", device);
+  return true;
+}
+
+bool LinuxSerialDevice::getDeviceStatus() { return fd >= 0; }
+
+time_ms LinuxSerialDevice::getTimeStamp()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (time_ms)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+size_t LinuxSerialDevice::send(const uint8_t *buf, size_t len)
+{
+  if (fd < 0)
+    return (size_t)-1;
+
+  size_t sent = 0;
+  while (sent < len)
+  {
+    ssize_t ans = write(fd, buf + sent, len - sent);
+    if (ans > 0)
+    {
+      sent += ans;
+      continue;
+    }
+    if (ans < 0 && errno == EINTR)
+      continue;
+    if (ans < 0 && errno != EAGAIN)
+      return sent ? sent : (size_t)-1;
+
+    //! @note kernel buffer is full, wait until the UART drains a bit
+    struct pollfd pfd = { fd, POLLOUT, 0 };
+    if (poll(&pfd, 1, 1000) <= 0)
+      break;
+  }
+  return sent;
+}
+
+size_t LinuxSerialDevice::readall(uint8_t *buf, size_t maxlen)
+{
+  if (fd < 0)
+    return 0;
+
+  struct pollfd pfd = { fd, POLLIN, 0 };
+  int ready = poll(&pfd, 1, readTimeout);
+  if (ready <= 0 || !(pfd.revents & POLLIN))
+    return 0;
+
+  ssize_t ans = read(fd, buf, maxlen);
+  return ans > 0 ? ans : 0;
+}
+
+void LinuxSerialDevice::lockMemory() { pthread_mutex_lock(&memLock); }
+
+void LinuxSerialDevice::freeMemory() { pthread_mutex_unlock(&memLock); }
+
+void LinuxSerialDevice::lockMSG() { pthread_mutex_lock(&msgLock); }
+
+void LinuxSerialDevice::freeMSG() { pthread_mutex_unlock(&msgLock); }
+
+void LinuxSerialDevice::lockACK() { ack.lock(); }
+
+void LinuxSerialDevice::freeACK() { ack.unlock(); }
+
+void LinuxSerialDevice::notify() { ack.notify(); }
+
+void LinuxSerialDevice::wait(int timeout) { ack.wait(timeout); }
+
+void LinuxSerialDevice::clearACK() { ack.clear(); }
+
+void LinuxSerialDevice::lockProtocolHeader() { pthread_mutex_lock(&headerLock); }
+
+void LinuxSerialDevice::freeProtocolHeader() { pthread_mutex_unlock(&headerLock); }
+
+void LinuxSerialDevice::lockNonBlockCBAck() { nbAck.lock(); }
+
+void LinuxSerialDevice::freeNonBlockCBAck() { nbAck.unlock(); }
+
+void LinuxSerialDevice::notifyNonBlockCBAckRecv()
+{
+  nbAck.lock();
+  nbAck.notify();
+  nbAck.unlock();
+}
+
+void LinuxSerialDevice::nonBlockWait() { nbAck.wait(-1); }
+
+void LinuxSerialDevice::setDevice(const char *value)
+{
+  strncpy(device, value ? value : "", sizeof(device) - 1);
+  device[sizeof(device) - 1] = 0;
+}
+
+const char *LinuxSerialDevice::getDevice() const { return device; }
+
+void LinuxSerialDevice::setBaudrate(unsigned int value) { baudrate = value; }
+
+unsigned int LinuxSerialDevice::getBaudrate() const { return baudrate; }
+
+void LinuxSerialDevice::setReadTimeout(int ms) { readTimeout = ms; }
+
+int LinuxSerialDevice::getReadTimeout() const { return readTimeout; }
+
+bool LinuxSerialDevice::isLowLatency() const { return lowLatency; }
+
+#endif // __linux__
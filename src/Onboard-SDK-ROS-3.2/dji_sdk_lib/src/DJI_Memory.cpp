@@ -19,6 +19,9 @@
 #include <string.h>
 #include "DJI_Memory.h"
 #include "DJI_API.h"
+#ifdef __linux__
+#include <sched.h>
+#endif
 
 using namespace DJI::onboardSDK;
 
@@ -168,7 +171,9 @@ void DJI::onboardSDK::CoreAPI::setupSession()
     CMDSessionTab[i].sessionID = i;
     CMDSessionTab[i].usageFlag = 0;
     CMDSessionTab[i].mmu = (MMU_Tab *)NULL;
+    CMDSessionTab[i].preSeqNum = 0;
   }
+  sessionClaim = 0;
 
   for (i = 0; i < (SESSION_TABLE_NUM - 1); i++)
   {
@@ -178,51 +183,37 @@ void DJI::onboardSDK::CoreAPI::setupSession()
   }
 }
 
-/*! @note Alloc a cmd session for sending cmd data
+/*! @note Claim a cmd session for sending cmd data, without any lock.
  *  when arg session_id = 0/1, it means select session 0/1 to send cmd
  *  otherwise set arg session_id = CMD_SESSION_AUTO (32), which means auto
  *  select a idle session id is between 2~31.
+ *  A claimed session stays invisible to sendPoll() and the ACK handler until
+ *  the sender allocates its memory and sets usageFlag under lockMemory.
  */
 
-CMDSession *DJI::onboardSDK::CoreAPI::allocSession(unsigned short session_id,
-    unsigned short size)
+CMDSession *DJI::onboardSDK::CoreAPI::claimSession(unsigned short session_id)
 {
-  unsigned int i;
-  API_LOG(serialDevice, DEBUG_LOG, "Allocation size %d", size);
-  MMU_Tab *mmu = NULL;
-
   if (session_id == 0 || session_id == 1)
   {
-    if (this->CMDSessionTab[session_id].usageFlag == 0)
-      i = session_id;
-    else
-    {
-      /* session is busy */
-      API_LOG(serialDevice, ERROR_LOG, "session %d is busy\n", session_id);
-      return NULL;
-    }
+    if (LockPolicy::claimBit(&sessionClaim, session_id))
+      return &CMDSessionTab[session_id];
+    /* session is busy */
+    API_LOG(serialDevice, ERROR_LOG, "session %d is busy\n", session_id);
+    return NULL;
   }
-  else
-  {
-    for (i = 2; i < SESSION_TABLE_NUM; i++)
-      if (CMDSessionTab[i].usageFlag == 0)
-        break;
-  }
-  if (i < 32 && CMDSessionTab[i].usageFlag == 0)
-  {
-    CMDSessionTab[i].usageFlag = 1;
-    mmu = allocMemory(size);
-    if (mmu == NULL)
-      CMDSessionTab[i].usageFlag = 0;
-    else
-    {
-      CMDSessionTab[i].mmu = mmu;
+  for (unsigned int i = 2; i < SESSION_TABLE_NUM; i++)
+    if (LockPolicy::claimBit(&sessionClaim, i))
       return &CMDSessionTab[i];
-    }
-  }
   return NULL;
 }
 
+//! @note for a claimed session that never went out
+void DJI::onboardSDK::CoreAPI::releaseSession(CMDSession *session)
+{
+  LockPolicy::releaseBit(&sessionClaim, session->sessionID);
+}
+
+//! @note called with lockMemory held
 void DJI::onboardSDK::CoreAPI::freeSession(CMDSession *session)
 {
   if (session->usageFlag == 1)
@@ -230,7 +221,35 @@ void DJI::onboardSDK::CoreAPI::freeSession(CMDSession *session)
     API_LOG(serialDevice, DEBUG_LOG, "session id %d\n", session->sessionID);
     freeMemory(session->mmu);
     session->usageFlag = 0;
+    LockPolicy::releaseBit(&sessionClaim, session->sessionID);
+  }
+}
+
+void DJI::onboardSDK::CoreAPI::cancelSessions(UserData userData)
+{
+  if (!userData)
+    return;
+  LockPolicy::lockMemory(serialDevice);
+  for (;;)
+  {
+    //! @note scanned again after a running handler, it may have sent more
+    for (unsigned int i = 1; i < SESSION_TABLE_NUM; i++)
+      if (CMDSessionTab[i].usageFlag == 1 && CMDSessionTab[i].handler &&
+          CMDSessionTab[i].userData == userData)
+        freeSession(&CMDSessionTab[i]);
+#ifndef API_SINGLE_THREAD
+    if (ackRunning != userData)
+      break;
+    LockPolicy::freeMemory(serialDevice);
+#ifdef __linux__
+    sched_yield();
+#endif
+    LockPolicy::lockMemory(serialDevice);
+#else
+    break;
+#endif // API_SINGLE_THREAD
   }
+  LockPolicy::freeMemory(serialDevice);
 }
 
 ACKSession *DJI::onboardSDK::CoreAPI::allocACK(unsigned short session_id, unsigned short size)
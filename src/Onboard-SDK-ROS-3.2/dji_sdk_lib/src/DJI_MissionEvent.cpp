@@ -0,0 +1,246 @@
+/** @file DJI_MissionEvent.cpp
+ *  @version 3.1.9
+ *  @date November 10, 2016
+ *
+ *  @brief
+ *  Decoded mission status and waypoint event pushes, queued for the application
+ *
+ *  @copyright 2016 DJI. All rights reserved.
+ *
+ */
+
+#include "DJI_MissionEvent.h"
+#include <string.h>
+
+using namespace DJI;
+using namespace DJI::onboardSDK;
+
+MissionEventQueue::MissionEventQueue(CoreAPI *ControlAPI)
+{
+  api = 0;
+  head = 0;
+  tail = 0;
+  dropped = 0;
+  history = 0;
+  historyCapacity = 0;
+  historyCount = 0;
+  historyNext = 0;
+  setApi(ControlAPI);
+}
+
+MissionEventQueue::~MissionEventQueue() { setApi(0); }
+
+#ifndef API_LOCK_FREE
+//! @note without atomics head, tail and dropped are shared under the
+//! driver's lockMSG(); a queue without an api has no producer to lock out
+static void lockQueue(CoreAPI *api)
+{
+  if (api)
+    LockPolicy::lockMSG(api->getDriver());
+}
+
+static void freeQueue(CoreAPI *api)
+{
+  if (api)
+    LockPolicy::freeMSG(api->getDriver());
+}
+#endif // API_LOCK_FREE
+
+bool MissionEventQueue::push(const MissionEvent &event)
+{
+#ifdef API_LOCK_FREE
+  uint32_t h = __atomic_load_n(&head, __ATOMIC_RELAXED);
+  uint32_t t = __atomic_load_n(&tail, __ATOMIC_ACQUIRE);
+  uint32_t sequence = h + __atomic_load_n(&dropped, __ATOMIC_RELAXED);
+  if (h - t >= MISSION_EVENT_QUEUE_SIZE)
+  {
+    __atomic_fetch_add(&dropped, 1, __ATOMIC_RELAXED);
+    return false;
+  }
+  MissionEvent *slot = &ring[h & (MISSION_EVENT_QUEUE_SIZE - 1)];
+  *slot = event;
+  slot->sequence = sequence;
+  __atomic_store_n(&head, h + 1, __ATOMIC_RELEASE);
+  return true;
+#else
+  CoreAPI *owner = api;
+  bool ans = true;
+  lockQueue(owner);
+  if (head - tail >= MISSION_EVENT_QUEUE_SIZE)
+  {
+    dropped++;
+    ans = false;
+  }
+  else
+  {
+    MissionEvent *slot = &ring[head & (MISSION_EVENT_QUEUE_SIZE - 1)];
+    *slot = event;
+    slot->sequence = head + dropped;
+    head++;
+  }
+  freeQueue(owner);
+  return ans;
+#endif // API_LOCK_FREE
+}
+
+size_t MissionEventQueue::drain(MissionEvent *out, size_t max)
+{
+#ifdef API_LOCK_FREE
+  uint32_t t = __atomic_load_n(&tail, __ATOMIC_RELAXED);
+  uint32_t h = __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+#else
+  //! @note slots between tail and head stay put until tail moves
+  CoreAPI *owner = api;
+  lockQueue(owner);
+  uint32_t t = tail;
+  uint32_t h = head;
+  freeQueue(owner);
+#endif // API_LOCK_FREE
+  size_t count = h - t < max ? h - t : max;
+  for (size_t i = 0; i < count; ++i)
+  {
+    const MissionEvent &event = ring[(t + i) & (MISSION_EVENT_QUEUE_SIZE - 1)];
+    out[i] = event;
+    if (historyCapacity)
+    {
+      history[historyNext] = event;
+      historyNext = (historyNext + 1) % historyCapacity;
+      if (historyCount < historyCapacity)
+        historyCount++;
+    }
+  }
+#ifdef API_LOCK_FREE
+  __atomic_store_n(&tail, t + count, __ATOMIC_RELEASE);
+#else
+  lockQueue(owner);
+  tail = t + count;
+  freeQueue(owner);
+#endif // API_LOCK_FREE
+  return count;
+}
+
+size_t MissionEventQueue::size() const
+{
+#ifdef API_LOCK_FREE
+  return __atomic_load_n(&head, __ATOMIC_ACQUIRE) - __atomic_load_n(&tail, __ATOMIC_ACQUIRE);
+#else
+  CoreAPI *owner = api;
+  lockQueue(owner);
+  size_t ans = head - tail;
+  freeQueue(owner);
+  return ans;
+#endif // API_LOCK_FREE
+}
+
+uint32_t MissionEventQueue::getDropped() const
+{
+#ifdef API_LOCK_FREE
+  return __atomic_load_n(&dropped, __ATOMIC_RELAXED);
+#else
+  CoreAPI *owner = api;
+  lockQueue(owner);
+  uint32_t ans = dropped;
+  freeQueue(owner);
+  return ans;
+#endif // API_LOCK_FREE
+}
+
+void MissionEventQueue::setHistory(MissionEvent *buffer, size_t capacity)
+{
+  history = buffer;
+  historyCapacity = buffer ? capacity : 0;
+  clearHistory();
+}
+
+size_t MissionEventQueue::getHistory(MissionEvent *out, size_t max) const
+{
+  size_t count = historyCount < max ? historyCount : max;
+  //! @note skip the oldest ones if out is shorter than the history
+  size_t first = historyNext + historyCapacity - count;
+  for (size_t i = 0; i < count; ++i)
+    out[i] = history[(first + i) % historyCapacity];
+  return count;
+}
+
+void MissionEventQueue::clearHistory()
+{
+  historyCount = 0;
+  historyNext = 0;
+}
+
+bool MissionEventQueue::decode(uint8_t cmdId, const uint8_t *data, size_t length,
+    MissionEvent *event)
+{
+  if (length == 0 || (cmdId != CODE_MISSION && cmdId != CODE_WAYPOINT))
+    return false;
+
+  memset(event, 0, sizeof(MissionEvent));
+  event->rawLength = length < MISSION_EVENT_RAW_SIZE ? length : MISSION_EVENT_RAW_SIZE;
+  memcpy(event->raw, data, event->rawLength);
+
+  //! @note short pushes leave the missing fields 0
+  uint8_t b[MISSION_EVENT_RAW_SIZE];
+  memset(b, 0, sizeof(b));
+  memcpy(b, data, event->rawLength);
+
+  event->type = MISSION_EVENT_UNKNOWN;
+  if (cmdId == CODE_MISSION)
+  {
+    switch (b[0])
+    {
+      case MISSION_WAYPOINT:
+        event->type = MISSION_EVENT_WAYPOINT_STATUS;
+        event->wayPoint.targetIndex = b[1];
+        event->wayPoint.status = b[2];
+        event->wayPoint.error = b[3];
+        break;
+      case MISSION_HOTPOINT:
+        event->type = MISSION_EVENT_HOTPOINT_STATUS;
+        event->hotPoint.status = b[1];
+        event->hotPoint.radius = b[2] | (b[3] << 8);
+        event->hotPoint.error = b[4];
+        event->hotPoint.velocity = b[5];
+        break;
+      case MISSION_FOLLOW:
+        event->type = MISSION_EVENT_FOLLOW_STATUS;
+        event->follow.status = b[1];
+        event->follow.trackingStatus = b[2];
+        break;
+      case MISSION_IOC:
+        event->type = MISSION_EVENT_IOC_STATUS;
+        break;
+    }
+  }
+  else
+  {
+    switch (b[0])
+    {
+      case 0:
+        event->type = MISSION_EVENT_WAYPOINT_UPLOADED;
+        event->uploaded.valid = b[1];
+        event->uploaded.estimatedTime = b[2] | (b[3] << 8);
+        break;
+      case 1:
+        event->type = MISSION_EVENT_WAYPOINT_FINISHED;
+        event->finished.repeat = b[1];
+        break;
+      case 2:
+        event->type = MISSION_EVENT_WAYPOINT_REACHED;
+        event->reached.index = b[1];
+        event->reached.status = b[2];
+        break;
+    }
+  }
+  return true;
+}
+
+CoreAPI *MissionEventQueue::getApi() const { return api; }
+
+void MissionEventQueue::setApi(CoreAPI *value)
+{
+  if (api && api->getMissionEventQueue() == this)
+    api->setMissionEventQueue(0);
+  api = value;
+  if (api)
+    api->setMissionEventQueue(this);
+}
@@ -0,0 +1,389 @@
+/** @file DJI_MobileTransfer.cpp
+ *  @version 3.1.9
+ *  @date November 10, 2016
+ *
+ *  @brief
+ *  Fragmenting, windowed transfers over the mobile data channel
+ *
+ *  @copyright 2016 DJI. All rights reserved.
+ *
+ */
+
+#include "DJI_MobileTransfer.h"
+
+#ifdef __linux__
+#include <string.h>
+
+using namespace DJI;
+using namespace DJI::onboardSDK;
+
+//! @note acknowledged fragments sent later and this far ahead mark a loss
+#define MOBILE_REORDER_THRESHOLD 3
+
+static inline void putU16(uint8_t *p, uint16_t v)
+{
+  p[0] = v & 0xFF;
+  p[1] = v >> 8;
+}
+
+static inline uint16_t getU16(const uint8_t *p) { return p[0] | (p[1] << 8); }
+
+MobileTransfer::MobileTransfer(CoreAPI *ControlAPI)
+{
+  api = 0;
+  previous.callback = 0;
+  previous.userData = 0;
+  receiveHandler = 0;
+  receiveData = 0;
+  window = 8;
+  rto = 1000000;
+  retryTimes = 10;
+  pthread_mutex_init(&lock, 0);
+
+  txBusy = false;
+  txId = 0;
+  rxActive = false;
+  rxDoneValid = false;
+  rxDoneAt = 0;
+  rxId = 0;
+  rxTotal = 0;
+  rxNext = 0;
+  ackPending = false;
+  memset(rxGot, 0, sizeof(rxGot));
+  resetStats();
+  setApi(ControlAPI);
+}
+
+MobileTransfer::~MobileTransfer()
+{
+  stop();
+  setApi(0);
+  pthread_mutex_destroy(&lock);
+}
+
+bool MobileTransfer::send(const uint8_t *data, size_t len)
+{
+  if (len == 0 || len > MOBILE_MAX_TRANSFER)
+    return false;
+
+  pthread_mutex_lock(&lock);
+  if (txBusy)
+  {
+    pthread_mutex_unlock(&lock);
+    return false;
+  }
+  memcpy(txBuf, data, len);
+  txLen = len;
+  txTotal = (len + MOBILE_FRAGMENT_SIZE - 1) / MOBILE_FRAGMENT_SIZE;
+  txId++;
+  txNext = 0;
+  txNew = 0;
+  txLatest = 0;
+  txLatestSentAt = 0;
+  memset(txAcked, 0, sizeof(txAcked));
+  memset(txSends, 0, sizeof(txSends));
+  txStart = monotonicTimeUs();
+  txBusy = true;
+  stats.transfers++;
+  pthread_mutex_unlock(&lock);
+  return true;
+}
+
+void MobileTransfer::cancel()
+{
+  pthread_mutex_lock(&lock);
+  if (txBusy)
+    complete(false, monotonicTimeUs());
+  pthread_mutex_unlock(&lock);
+}
+
+bool MobileTransfer::isBusy() const
+{
+  pthread_mutex_lock(&lock);
+  bool ans = txBusy;
+  pthread_mutex_unlock(&lock);
+  return ans;
+}
+
+void MobileTransfer::setWindow(uint8_t value)
+{
+  pthread_mutex_lock(&lock);
+  window = value < 1 ? 1 : (value > MOBILE_MAX_WINDOW ? MOBILE_MAX_WINDOW : value);
+  pthread_mutex_unlock(&lock);
+}
+
+uint8_t MobileTransfer::getWindow() const { return window; }
+
+void MobileTransfer::setRetransmitTimeout(uint32_t ms, uint8_t retry)
+{
+  pthread_mutex_lock(&lock);
+  rto = (time_us)ms * 1000;
+  retryTimes = retry ? retry : 1;
+  pthread_mutex_unlock(&lock);
+}
+
+void MobileTransfer::setReceiveCallback(MobileReceiveHandler handler, UserData userData)
+{
+  pthread_mutex_lock(&lock);
+  receiveHandler = handler;
+  receiveData = userData;
+  pthread_mutex_unlock(&lock);
+}
+
+MobileTransferStats MobileTransfer::getStats() const
+{
+  pthread_mutex_lock(&lock);
+  MobileTransferStats ans = stats;
+  pthread_mutex_unlock(&lock);
+  return ans;
+}
+
+void MobileTransfer::resetStats()
+{
+  pthread_mutex_lock(&lock);
+  memset(&stats, 0, sizeof(stats));
+  pthread_mutex_unlock(&lock);
+}
+
+CoreAPI *MobileTransfer::getApi() const { return api; }
+
+void MobileTransfer::setApi(CoreAPI *value)
+{
+  if (api && api->getFromMobileCallback().userData == this)
+    api->setFromMobileCallback(previous);
+  api = value;
+  if (api)
+  {
+    previous = api->getFromMobileCallback();
+    api->setFromMobileCallback(MobileTransfer::fromMobileCallback, this);
+  }
+}
+
+void MobileTransfer::fromMobileCallback(CoreAPI *api, Header *protocolHeader, UserData transfer)
+{
+  MobileTransfer *self = (MobileTransfer *)transfer;
+  //! @note payload starts after the cmdSet and cmdID bytes
+  const uint8_t *frame = (const uint8_t *)protocolHeader + sizeof(Header) + 2;
+  int len = (int)protocolHeader->length - EXC_DATA_SIZE - 2;
+
+  if (len >= 2 && frame[0] == MOBILE_FRAME_MAGIC)
+  {
+    if (frame[1] == FRAME_DATA)
+      self->onData(frame, len);
+    else if (frame[1] == FRAME_ACK)
+      self->onAck(frame, len);
+  }
+  else if (self->previous.callback)
+    self->previous.callback(api, protocolHeader, self->previous.userData);
+  else
+    api->parseFromMobileCallback(api, protocolHeader);
+}
+
+void MobileTransfer::onData(const uint8_t *frame, size_t len)
+{
+  if (len <= MOBILE_DATA_HEADER_SIZE)
+    return;
+  uint8_t id = frame[2];
+  uint16_t seq = getU16(frame + 3);
+  uint16_t total = getU16(frame + 5);
+  size_t size = len - MOBILE_DATA_HEADER_SIZE;
+  if (total == 0 || total > MOBILE_MAX_FRAGMENTS || seq >= total ||
+      (seq + 1 < total && size != MOBILE_FRAGMENT_SIZE))
+    return;
+
+  MobileReceiveHandler handler = 0;
+  UserData userData = 0;
+  time_us now = monotonicTimeUs();
+
+  pthread_mutex_lock(&lock);
+  if (!rxActive && rxDoneValid && id == rxId && total == rxTotal && now - rxDoneAt <= 2 * rto)
+  {
+    //! @note our ACK of a finished transfer was lost, acknowledge it again
+    stats.duplicates++;
+    rxDoneAt = now;
+    ackPending = true;
+    pthread_mutex_unlock(&lock);
+    return;
+  }
+  if (!rxActive || id != rxId || total != rxTotal)
+  {
+    rxActive = true;
+    rxDoneValid = false;
+    rxId = id;
+    rxTotal = total;
+    rxCount = 0;
+    rxNext = 0;
+    rxLen = 0;
+    memset(rxGot, 0, sizeof(rxGot));
+  }
+
+  if (rxGot[seq])
+    stats.duplicates++;
+  else
+  {
+    memcpy(rxBuf + seq * MOBILE_FRAGMENT_SIZE, frame + MOBILE_DATA_HEADER_SIZE, size);
+    rxGot[seq] = true;
+    rxCount++;
+    if (seq + 1 == total)
+      rxLen = seq * MOBILE_FRAGMENT_SIZE + size;
+    while (rxNext < rxTotal && rxGot[rxNext])
+      rxNext++;
+  }
+  ackPending = true;
+
+  if (rxCount == rxTotal)
+  {
+    rxActive = false;
+    rxDoneValid = true;
+    rxDoneAt = now;
+    stats.received++;
+    stats.bytesReceived += rxLen;
+    handler = receiveHandler;
+    userData = receiveData;
+  }
+  pthread_mutex_unlock(&lock);
+
+  //! @note rxBuf is only written from the read thread, which is this one
+  if (handler)
+    handler(this, rxBuf, rxLen, userData);
+}
+
+void MobileTransfer::onAck(const uint8_t *frame, size_t len)
+{
+  if (len < MOBILE_ACK_SIZE)
+    return;
+  uint8_t id = frame[2];
+  uint16_t next = getU16(frame + 3);
+  uint32_t bitmap = frame[5] | (frame[6] << 8) | (frame[7] << 16) | ((uint32_t)frame[8] << 24);
+
+  pthread_mutex_lock(&lock);
+  stats.acksReceived++;
+  if (!txBusy || id != txId || next > txTotal)
+  {
+    pthread_mutex_unlock(&lock);
+    return;
+  }
+
+  for (uint16_t s = txNext; s < txNew; ++s)
+  {
+    bool acked = s < next;
+    if (!acked && s > next)
+      acked = (bitmap >> (s - next - 1)) & 1;
+    if (acked && !txAcked[s])
+    {
+      txAcked[s] = true;
+      if (txSentAt[s] >= txLatestSentAt)
+      {
+        txLatest = s;
+        txLatestSentAt = txSentAt[s];
+      }
+    }
+  }
+  while (txNext < txTotal && txAcked[txNext])
+    txNext++;
+
+  if (txNext == txTotal)
+    complete(true, monotonicTimeUs());
+  pthread_mutex_unlock(&lock);
+}
+
+int MobileTransfer::nextFragment(time_us now)
+{
+  for (uint16_t s = txNext; s < txNew; ++s)
+  {
+    if (txAcked[s])
+      continue;
+    bool lost = txSentAt[s] < txLatestSentAt && txLatest >= s + MOBILE_REORDER_THRESHOLD;
+    if (lost || now - txSentAt[s] >= rto)
+    {
+      if (txSends[s] >= retryTimes)
+      {
+        API_LOG(api->getDriver(), ERROR_LOG, "Mobile transfer %d: fragment %d lost\n", txId, s);
+        complete(false, now);
+        return -1;
+      }
+      return s;
+    }
+  }
+  if (txNew < txTotal && txNew - txNext < window)
+    return txNew;
+  return -1;
+}
+
+void MobileTransfer::complete(bool ok, time_us now)
+{
+  txBusy = false;
+  if (!ok)
+  {
+    stats.failed++;
+    return;
+  }
+  stats.completed++;
+  stats.bytesSent += txLen;
+  stats.lastTransferUs = now - txStart;
+  stats.lastThroughput = stats.lastTransferUs ? txLen * 1000000.0 / stats.lastTransferUs : 0;
+  stats.channelLimit = (double)getRate() * MOBILE_FRAME_SIZE;
+  stats.efficiency = stats.channelLimit > 0 ? stats.lastThroughput / stats.channelLimit : 0;
+}
+
+size_t MobileTransfer::buildAck(uint8_t *frame)
+{
+  uint32_t bitmap = 0;
+  for (int i = 0; i < 32 && rxNext + 1 + i < rxTotal; ++i)
+    if (rxGot[rxNext + 1 + i])
+      bitmap |= 1u << i;
+
+  frame[0] = MOBILE_FRAME_MAGIC;
+  frame[1] = FRAME_ACK;
+  frame[2] = rxId;
+  putU16(frame + 3, rxNext);
+  frame[5] = bitmap & 0xFF;
+  frame[6] = (bitmap >> 8) & 0xFF;
+  frame[7] = (bitmap >> 16) & 0xFF;
+  frame[8] = bitmap >> 24;
+  return MOBILE_ACK_SIZE;
+}
+
+void MobileTransfer::tick(time_us now)
+{
+  uint8_t frame[MOBILE_FRAME_SIZE];
+  size_t len = 0;
+
+  pthread_mutex_lock(&lock);
+  if (ackPending)
+  {
+    //! @note acknowledgements go first, the sender is waiting on them
+    ackPending = false;
+    len = buildAck(frame);
+    stats.acksSent++;
+  }
+  else if (txBusy)
+  {
+    int s = nextFragment(now);
+    if (s >= 0)
+    {
+      size_t offset = s * MOBILE_FRAGMENT_SIZE;
+      size_t size = txLen - offset < MOBILE_FRAGMENT_SIZE ? txLen - offset : MOBILE_FRAGMENT_SIZE;
+      frame[0] = MOBILE_FRAME_MAGIC;
+      frame[1] = FRAME_DATA;
+      frame[2] = txId;
+      putU16(frame + 3, s);
+      putU16(frame + 5, txTotal);
+      memcpy(frame + MOBILE_DATA_HEADER_SIZE, txBuf + offset, size);
+      len = MOBILE_DATA_HEADER_SIZE + size;
+
+      if (txSends[s]++)
+        stats.retransmits++;
+      txSentAt[s] = now;
+      if (s == txNew)
+        txNew++;
+      stats.frames++;
+    }
+  }
+  pthread_mutex_unlock(&lock);
+
+  if (len && api)
+    api->sendToMobile(frame, len);
+}
+
+#endif // __linux__
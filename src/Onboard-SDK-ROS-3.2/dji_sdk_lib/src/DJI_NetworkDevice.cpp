@@ -0,0 +1,438 @@
+/** @file DJI_NetworkDevice.cpp
+ *  @version 3.1.9
+ *  @date November 10, 2016
+ *
+ *  @brief
+ *  HardDriver tunnelling the flight controller byte stream over TCP or UDP
+ *
+ *  @copyright 2016 DJI. All rights reserved.
+ *
+ */
+
+#include "DJI_NetworkDevice.h"
+
+#ifdef __linux__
+#include <errno.h>
+#include <netdb.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+using namespace DJI;
+using namespace DJI::onboardSDK;
+
+//! @note least time between two connection attempts of readall()
+#define NET_RECONNECT_US 1000000
+
+NetFrameParser::NetFrameParser()
+{
+  skipped = 0;
+  reset();
+}
+
+void NetFrameParser::reset()
+{
+  begin = 0;
+  end = 0;
+}
+
+uint32_t NetFrameParser::getSkipped() const { return skipped; }
+
+bool NetFrameParser::append(const uint8_t *data, size_t len)
+{
+  if (end + len > sizeof(buf) && begin > 0)
+  {
+    memmove(buf, buf + begin, end - begin);
+    end -= begin;
+    begin = 0;
+  }
+  if (end + len > sizeof(buf))
+  {
+    skipped += end - begin;
+    reset();
+    return false;
+  }
+  memcpy(buf + end, data, len);
+  end += len;
+  return true;
+}
+
+bool NetFrameParser::next(NetFrameHeader *header, const uint8_t **payload)
+{
+  while (end - begin >= sizeof(NetFrameHeader))
+  {
+    memcpy(header, buf + begin, sizeof(NetFrameHeader));
+    if (header->magic != NET_FRAME_MAGIC || header->length > NET_PAYLOAD_MAX)
+    {
+      begin++;
+      skipped++;
+      continue;
+    }
+    if (end - begin < sizeof(NetFrameHeader) + header->length)
+      return false;
+    *payload = buf + begin + sizeof(NetFrameHeader);
+    begin += sizeof(NetFrameHeader) + header->length;
+    return true;
+  }
+  return false;
+}
+
+size_t NetFrameParser::encode(uint8_t *out, uint8_t type, uint64_t timeUs,
+    const uint8_t *payload, size_t len)
+{
+  NetFrameHeader header;
+  header.magic = NET_FRAME_MAGIC;
+  header.type = type;
+  header.length = len;
+  header.timeUs = timeUs;
+  memcpy(out, &header, sizeof(header));
+  if (len)
+    memcpy(out + sizeof(header), payload, len);
+  return sizeof(header) + len;
+}
+
+NetworkDevice::NetworkDevice(const char *Host, uint16_t Port, NetTransport Transport)
+{
+  strncpy(host, Host ? Host : "", sizeof(host) - 1);
+  host[sizeof(host) - 1] = 0;
+  port = Port;
+  transport = Transport;
+  fd = -1;
+  noDelay = true;
+  readTimeout = 100;
+  pingPeriod = 1000;
+  lastPing = 0;
+  lastConnect = 0;
+  pending = 0;
+  pendingLength = 0;
+  pendingTime = 0;
+  rxTime = 0;
+  memset(&stats, 0, sizeof(stats));
+  memset(sampleRtt, 0, sizeof(sampleRtt));
+  memset(sampleOffset, 0, sizeof(sampleOffset));
+  sampleIndex = 0;
+  offsetValid = false;
+
+  pthread_mutex_init(&sendLock, 0);
+  pthread_mutex_init(&statsLock, 0);
+  pthread_mutex_init(&memLock, 0);
+  pthread_mutex_init(&msgLock, 0);
+  pthread_mutex_init(&headerLock, 0);
+}
+
+NetworkDevice::~NetworkDevice()
+{
+  close();
+  pthread_mutex_destroy(&headerLock);
+  pthread_mutex_destroy(&msgLock);
+  pthread_mutex_destroy(&memLock);
+  pthread_mutex_destroy(&statsLock);
+  pthread_mutex_destroy(&sendLock);
+}
+
+void NetworkDevice::init()
+{
+  API_LOG(this, STATUS_LOG, "Connect to %s:%u over %s\n", host, port,
+      transport == NET_TCP ? "TCP" : "UDP");
+  if (!reconnect())
+    API_LOG(this, ERROR_LOG, "Failed to connect to %s:%u\n", host, port);
+}
+
+bool NetworkDevice::reconnect()
+{
+  close();
+  lastConnect = monotonicTimeUs();
+
+  char service[8];
+  snprintf(service, sizeof(service), "%u", port);
+  struct addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = transport == NET_TCP ? SOCK_STREAM : SOCK_DGRAM;
+  struct addrinfo *list = 0;
+  if (getaddrinfo(host, service, &hints, &list) != 0)
+    return false;
+
+  int sock = -1;
+  for (struct addrinfo *ai = list; ai && sock < 0; ai = ai->ai_next)
+  {
+    sock = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+    if (sock >= 0 && connect(sock, ai->ai_addr, ai->ai_addrlen) != 0)
+    {
+      ::close(sock);
+      sock = -1;
+    }
+  }
+  freeaddrinfo(list);
+  if (sock < 0)
+    return false;
+
+  pthread_mutex_lock(&sendLock);
+  fd = sock;
+  pthread_mutex_unlock(&sendLock);
+  parser.reset();
+  pendingLength = 0;
+  if (!configure())
+  {
+    close();
+    return false;
+  }
+  pthread_mutex_lock(&statsLock);
+  stats.reconnects++;
+  pthread_mutex_unlock(&statsLock);
+  return true;
+}
+
+bool NetworkDevice::configure()
+{
+  if (transport == NET_TCP)
+  {
+    int value = noDelay ? 1 : 0;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &value, sizeof(value));
+    return true;
+  }
+  return sendFrame(NET_HELLO, monotonicTimeUs(), 0, 0);
+}
+
+void NetworkDevice::close()
+{
+  pthread_mutex_lock(&sendLock);
+  if (fd >= 0)
+    ::close(fd);
+  fd = -1;
+  pthread_mutex_unlock(&sendLock);
+}
+
+bool NetworkDevice::getDeviceStatus() { return fd >= 0; }
+
+time_ms NetworkDevice::getTimeStamp() { return monotonicTimeUs() / 1000; }
+
+bool NetworkDevice::sendFrame(uint8_t type, uint64_t timeUs, const uint8_t *payload, size_t len)
+{
+  uint8_t frame[sizeof(NetFrameHeader) + NET_PAYLOAD_MAX];
+  size_t size = NetFrameParser::encode(frame, type, timeUs, payload, len);
+
+  pthread_mutex_lock(&sendLock);
+  size_t sent = 0;
+  while (fd >= 0 && sent < size)
+  {
+    ssize_t ans = ::send(fd, frame + sent, size - sent, MSG_NOSIGNAL);
+    if (ans > 0)
+      sent += ans;
+    else if (ans < 0 && errno == EINTR)
+      continue;
+    else
+      break;
+  }
+  pthread_mutex_unlock(&sendLock);
+
+  if (sent < size)
+    return false;
+  pthread_mutex_lock(&statsLock);
+  stats.framesSent++;
+  stats.bytesSent += len;
+  pthread_mutex_unlock(&statsLock);
+  return true;
+}
+
+size_t NetworkDevice::send(const uint8_t *buf, size_t len)
+{
+  if (fd < 0)
+    return (size_t)-1;
+
+  time_us now = monotonicTimeUs();
+  size_t sent = 0;
+  while (sent < len)
+  {
+    size_t size = len - sent < NET_PAYLOAD_MAX ? len - sent : NET_PAYLOAD_MAX;
+    if (!sendFrame(NET_DATA, now, buf + sent, size))
+      return sent ? sent : (size_t)-1;
+    sent += size;
+  }
+  return sent;
+}
+
+size_t NetworkDevice::takePending(uint8_t *buf, size_t maxlen)
+{
+  size_t size = pendingLength < maxlen ? pendingLength : maxlen;
+  memcpy(buf, pending, size);
+  pending += size;
+  pendingLength -= size;
+
+  pthread_mutex_lock(&statsLock);
+  rxTime = offsetValid ? pendingTime - stats.clockOffsetUs : 0;
+  stats.bytesReceived += size;
+  pthread_mutex_unlock(&statsLock);
+  return size;
+}
+
+void NetworkDevice::onPong(const NetFrameHeader &header, const uint8_t *payload, size_t len,
+    time_us now)
+{
+  uint64_t sentAt;
+  if (len < sizeof(sentAt))
+    return;
+  memcpy(&sentAt, payload, sizeof(sentAt));
+  if (sentAt > now)
+    return;
+
+  //! @note the bridge answered half way through the round trip
+  uint32_t rtt = now - sentAt;
+  int64_t offset = (int64_t)header.timeUs - (int64_t)(sentAt + rtt / 2);
+
+  pthread_mutex_lock(&statsLock);
+  sampleRtt[sampleIndex] = rtt ? rtt : 1;
+  sampleOffset[sampleIndex] = offset;
+  sampleIndex = (sampleIndex + 1) % NET_CLOCK_SAMPLES;
+  int best = -1;
+  for (int i = 0; i < NET_CLOCK_SAMPLES; ++i)
+    if (sampleRtt[i] && (best < 0 || sampleRtt[i] < sampleRtt[best]))
+      best = i;
+  stats.rttUs = sampleRtt[best];
+  stats.clockOffsetUs = sampleOffset[best];
+  offsetValid = true;
+  pthread_mutex_unlock(&statsLock);
+}
+
+size_t NetworkDevice::readall(uint8_t *buf, size_t maxlen)
+{
+  if (pendingLength)
+    return takePending(buf, maxlen);
+
+  time_us now = monotonicTimeUs();
+  if (fd < 0)
+  {
+    if (now - lastConnect < NET_RECONNECT_US || !reconnect())
+    {
+      usleep(readTimeout * 1000);
+      return 0;
+    }
+  }
+  if (pingPeriod && now - lastPing >= (time_us)pingPeriod * 1000)
+  {
+    lastPing = now;
+    uint64_t stamp = now;
+    sendFrame(NET_PING, now, (const uint8_t *)&stamp, sizeof(stamp));
+  }
+
+  time_us end = now + (time_us)readTimeout * 1000;
+  for (;;)
+  {
+    NetFrameHeader header;
+    const uint8_t *payload;
+    while (parser.next(&header, &payload))
+    {
+      pthread_mutex_lock(&statsLock);
+      stats.framesReceived++;
+      stats.skipped = parser.getSkipped();
+      pthread_mutex_unlock(&statsLock);
+
+      if (header.type == NET_PONG)
+        onPong(header, payload, header.length, monotonicTimeUs());
+      else if (header.type == NET_DATA && header.length)
+      {
+        pending = payload;
+        pendingLength = header.length;
+        pendingTime = header.timeUs;
+        return takePending(buf, maxlen);
+      }
+    }
+
+    now = monotonicTimeUs();
+    if (now >= end)
+      return 0;
+    struct pollfd pfd = { fd, POLLIN, 0 };
+    int ready = ::poll(&pfd, 1, (end - now + 999) / 1000);
+    if (ready <= 0 || !(pfd.revents & (POLLIN | POLLHUP | POLLERR)))
+      return 0;
+
+    uint8_t data[sizeof(NetFrameHeader) + NET_PAYLOAD_MAX];
+    ssize_t ans = recv(fd, data, sizeof(data), 0);
+    if (ans < 0 && (errno == EINTR || errno == EAGAIN))
+      continue;
+    if (ans <= 0 && (transport == NET_TCP || ans < 0))
+    {
+      API_LOG(this, ERROR_LOG, "Connection to %s:%u lost\n", host, port);
+      close();
+      return 0;
+    }
+    parser.append(data, ans);
+  }
+}
+
+time_us NetworkDevice::getRxTimeUs() const
+{
+  pthread_mutex_lock(&statsLock);
+  time_us ans = rxTime;
+  pthread_mutex_unlock(&statsLock);
+  return ans;
+}
+
+NetStats NetworkDevice::getStats() const
+{
+  pthread_mutex_lock(&statsLock);
+  NetStats ans = stats;
+  pthread_mutex_unlock(&statsLock);
+  return ans;
+}
+
+void NetworkDevice::lockMemory() { pthread_mutex_lock(&memLock); }
+
+void NetworkDevice::freeMemory() { pthread_mutex_unlock(&memLock); }
+
+void NetworkDevice::lockMSG() { pthread_mutex_lock(&msgLock); }
+
+void NetworkDevice::freeMSG() { pthread_mutex_unlock(&msgLock); }
+
+void NetworkDevice::lockACK() { ack.lock(); }
+
+void NetworkDevice::freeACK() { ack.unlock(); }
+
+void NetworkDevice::notify() { ack.notify(); }
+
+void NetworkDevice::wait(int timeout) { ack.wait(timeout); }
+
+void NetworkDevice::clearACK() { ack.clear(); }
+
+void NetworkDevice::lockProtocolHeader() { pthread_mutex_lock(&headerLock); }
+
+void NetworkDevice::freeProtocolHeader() { pthread_mutex_unlock(&headerLock); }
+
+void NetworkDevice::lockNonBlockCBAck() { nbAck.lock(); }
+
+void NetworkDevice::freeNonBlockCBAck() { nbAck.unlock(); }
+
+void NetworkDevice::notifyNonBlockCBAckRecv()
+{
+  nbAck.lock();
+  nbAck.notify();
+  nbAck.unlock();
+}
+
+void NetworkDevice::nonBlockWait() { nbAck.wait(-1); }
+
+void NetworkDevice::setNoDelay(bool value)
+{
+  noDelay = value;
+  if (fd >= 0 && transport == NET_TCP)
+  {
+    int flag = value ? 1 : 0;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+  }
+}
+
+bool NetworkDevice::getNoDelay() const { return noDelay; }
+
+void NetworkDevice::setReadTimeout(int ms) { readTimeout = ms; }
+
+int NetworkDevice::getReadTimeout() const { return readTimeout; }
+
+void NetworkDevice::setPingPeriod(uint32_t ms) { pingPeriod = ms; }
+
+uint32_t NetworkDevice::getPingPeriod() const { return pingPeriod; }
+
+#endif // __linux__
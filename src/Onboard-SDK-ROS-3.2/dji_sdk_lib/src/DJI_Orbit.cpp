@@ -0,0 +1,299 @@
+/** @file DJI_Orbit.cpp
+ *  @version 3.1.9
+ *  @date November 10, 2016
+ *
+ *  @brief
+ *  Client-side orbit around a moving point, streamed as movement control
+ *
+ *  @copyright 2016 DJI. All rights reserved.
+ *
+ */
+
+#include "DJI_Orbit.h"
+
+#ifdef __linux__
+#include <string.h>
+#include <math.h>
+
+using namespace DJI;
+using namespace DJI::onboardSDK;
+
+//! @note mean earth radius in meters, orbits are small enough for a flat earth
+#define EARTH_RADIUS 6371000.0
+
+OrbitGenerator::OrbitGenerator(Flight *FlightAPI)
+{
+  flight = FlightAPI;
+  pthread_mutex_init(&lock, 0);
+  hasCentre = false;
+  centreLatitude = centreLongitude = 0;
+  centreHeight = 0;
+  centreNorth = centreEast = 0;
+  centreTime = 0;
+  mode = ORBIT_VELOCITY;
+  radius = 10;
+  angularRate = 10;
+  gain = 0.5;
+  responseTime = 0.3;
+  maxSpeed = 10;
+  faceCentre = true;
+  resetStats();
+}
+
+OrbitGenerator::~OrbitGenerator()
+{
+  stop();
+  pthread_mutex_destroy(&lock);
+}
+
+void OrbitGenerator::setCentre(float64_t latitude, float64_t longitude, float32_t height)
+{
+  setCentre(latitude, longitude, height, 0, 0, monotonicTimeUs());
+}
+
+void OrbitGenerator::setCentre(float64_t latitude, float64_t longitude, float32_t height,
+    float64_t north, float64_t east, time_us timestamp)
+{
+  pthread_mutex_lock(&lock);
+  hasCentre = true;
+  centreLatitude = latitude;
+  centreLongitude = longitude;
+  centreHeight = height;
+  centreNorth = north;
+  centreEast = east;
+  centreTime = timestamp;
+  pthread_mutex_unlock(&lock);
+}
+
+void OrbitGenerator::clearCentre()
+{
+  pthread_mutex_lock(&lock);
+  hasCentre = false;
+  pthread_mutex_unlock(&lock);
+}
+
+//! @note called with lock held
+bool OrbitGenerator::centreAt(time_us timestamp, float64_t *latitude, float64_t *longitude) const
+{
+  if (!hasCentre)
+    return false;
+  float64_t dt = 0;
+  if (timestamp > centreTime)
+  {
+    time_us ahead = timestamp - centreTime;
+    if (ahead > ORBIT_MAX_EXTRAPOLATION_US)
+      ahead = ORBIT_MAX_EXTRAPOLATION_US;
+    dt = ahead / 1000000.0;
+  }
+  *latitude = centreLatitude + centreNorth * dt / EARTH_RADIUS;
+  *longitude = centreLongitude + centreEast * dt / (EARTH_RADIUS * cos(centreLatitude));
+  return true;
+}
+
+bool OrbitGenerator::getCentre(time_us timestamp, float64_t *latitude,
+    float64_t *longitude) const
+{
+  pthread_mutex_lock(&lock);
+  bool ans = centreAt(timestamp, latitude, longitude);
+  pthread_mutex_unlock(&lock);
+  return ans;
+}
+
+bool OrbitGenerator::compute(const PositionData &position, time_us now,
+    OrbitSetpoint *setpoint) const
+{
+  float64_t latitude, longitude;
+  pthread_mutex_lock(&lock);
+  if (!centreAt(now, &latitude, &longitude))
+  {
+    pthread_mutex_unlock(&lock);
+    return false;
+  }
+  float32_t height = centreHeight;
+  float64_t vn = centreNorth;
+  float64_t ve = centreEast;
+  if (now > centreTime + ORBIT_MAX_EXTRAPOLATION_US)
+    vn = ve = 0;
+  OrbitMode m = mode;
+  float64_t r = radius;
+  float64_t w = angularRate * M_PI / 180;
+  float64_t k = gain;
+  float64_t lead = responseTime;
+  float64_t limit = maxSpeed;
+  bool face = faceCentre;
+  pthread_mutex_unlock(&lock);
+
+  //! @note aircraft relative to the centre, north/east in meters
+  float64_t north = (position.latitude - latitude) * EARTH_RADIUS;
+  float64_t east = (position.longitude - longitude) * EARTH_RADIUS * cos(latitude);
+  float64_t distance = sqrt(north * north + east * east);
+  float64_t angle = distance > 0.01 ? atan2(east, north) : 0;
+
+  setpoint->angle = angle;
+  setpoint->radiusError = distance - r;
+  setpoint->flag = Flight::VERTICAL_POSITION | Flight::YAW_ANGLE | Flight::HORIZONTAL_GROUND |
+                   Flight::YAW_GROUND | Flight::SMOOTH_ENABLE;
+
+  float64_t x, y;
+  if (m == ORBIT_POSITION)
+  {
+    //! @note one tick ahead, 50Hz before start()
+    float64_t dt = getRate() ? 1.0 / getRate() : 0.02;
+    float64_t next = angle + w * dt;
+    x = r * cos(next) - north + vn * dt;
+    y = r * sin(next) - east + ve * dt;
+    setpoint->flag |= Flight::HORIZONTAL_POSITION;
+  }
+  else
+  {
+    //! @note the aircraft reaches the velocity one response time later, aim
+    //! at where it will be on the circle then
+    float64_t ahead = angle + w * lead;
+    float64_t tangent = w * r;
+    float64_t radial = -k * setpoint->radiusError;
+    x = vn - tangent * sin(ahead) + radial * cos(ahead);
+    y = ve + tangent * cos(ahead) + radial * sin(ahead);
+    setpoint->flag |= Flight::HORIZONTAL_VELOCITY;
+
+    float64_t speed = sqrt(x * x + y * y);
+    if (speed > limit && speed > 0)
+    {
+      x *= limit / speed;
+      y *= limit / speed;
+    }
+  }
+  setpoint->x = x;
+  setpoint->y = y;
+  setpoint->z = height;
+
+  float64_t yaw = 0;
+  if (face)
+  {
+    yaw = angle * 180 / M_PI + 180;
+    if (yaw > 180)
+      yaw -= 360;
+  }
+  else
+  {
+    //! @note along the direction of travel
+    yaw = (angle + (w >= 0 ? M_PI / 2 : -M_PI / 2)) * 180 / M_PI;
+    yaw = fmod(yaw + 540, 360) - 180;
+  }
+  setpoint->yaw = yaw;
+  return true;
+}
+
+void OrbitGenerator::tick(time_us now)
+{
+  Flight *target = flight;
+  if (!target)
+    return;
+
+  OrbitSetpoint setpoint;
+  bool ready = compute(target->getPosition(), now, &setpoint);
+
+  pthread_mutex_lock(&lock);
+  stats.ticks++;
+  if (ready)
+  {
+    float64_t error = fabs(setpoint.radiusError);
+    stats.sent++;
+    stats.lastError = error;
+    if (error > stats.maxError)
+      stats.maxError = error;
+    errorSum += error;
+    errorSquareSum += error * error;
+    stats.meanError = errorSum / stats.sent;
+    stats.rmsError = sqrt(errorSquareSum / stats.sent);
+  }
+  pthread_mutex_unlock(&lock);
+
+  if (ready)
+    target->setMovementControl(setpoint.flag, setpoint.x, setpoint.y, setpoint.z, setpoint.yaw);
+}
+
+OrbitStats OrbitGenerator::getStats() const
+{
+  pthread_mutex_lock(&lock);
+  OrbitStats ans = stats;
+  pthread_mutex_unlock(&lock);
+  return ans;
+}
+
+void OrbitGenerator::resetStats()
+{
+  pthread_mutex_lock(&lock);
+  memset(&stats, 0, sizeof(stats));
+  errorSum = 0;
+  errorSquareSum = 0;
+  pthread_mutex_unlock(&lock);
+}
+
+Flight *OrbitGenerator::getFlight() const { return flight; }
+
+void OrbitGenerator::setFlight(Flight *value) { flight = value; }
+
+void OrbitGenerator::setMode(OrbitMode value)
+{
+  pthread_mutex_lock(&lock);
+  mode = value;
+  pthread_mutex_unlock(&lock);
+}
+
+OrbitMode OrbitGenerator::getMode() const { return mode; }
+
+void OrbitGenerator::setRadius(float64_t value)
+{
+  pthread_mutex_lock(&lock);
+  radius = value < 0 ? 0 : value;
+  pthread_mutex_unlock(&lock);
+}
+
+float64_t OrbitGenerator::getRadius() const { return radius; }
+
+void OrbitGenerator::setAngularRate(float64_t value)
+{
+  pthread_mutex_lock(&lock);
+  angularRate = value;
+  pthread_mutex_unlock(&lock);
+}
+
+float64_t OrbitGenerator::getAngularRate() const { return angularRate; }
+
+void OrbitGenerator::setGain(float64_t value)
+{
+  pthread_mutex_lock(&lock);
+  gain = value < 0 ? 0 : value;
+  pthread_mutex_unlock(&lock);
+}
+
+float64_t OrbitGenerator::getGain() const { return gain; }
+
+void OrbitGenerator::setResponseTime(uint32_t ms)
+{
+  pthread_mutex_lock(&lock);
+  responseTime = ms / 1000.0;
+  pthread_mutex_unlock(&lock);
+}
+
+uint32_t OrbitGenerator::getResponseTime() const { return responseTime * 1000 + 0.5; }
+
+void OrbitGenerator::setMaxSpeed(float64_t value)
+{
+  pthread_mutex_lock(&lock);
+  maxSpeed = value < 0 ? 0 : value;
+  pthread_mutex_unlock(&lock);
+}
+
+float64_t OrbitGenerator::getMaxSpeed() const { return maxSpeed; }
+
+void OrbitGenerator::setFaceCentre(bool value)
+{
+  pthread_mutex_lock(&lock);
+  faceCentre = value;
+  pthread_mutex_unlock(&lock);
+}
+
+bool OrbitGenerator::getFaceCentre() const { return faceCentre; }
+
+#endif // __linux__
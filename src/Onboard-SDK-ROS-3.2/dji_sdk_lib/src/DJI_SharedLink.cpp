@@ -0,0 +1,638 @@
+/** @file DJI_SharedLink.cpp
+ *  @version 3.1.9
+ *  @date November 10, 2016
+ *
+ *  @brief
+ *  Broadcast fan-out and command queue between processes in shared memory
+ *
+ *  @copyright 2016 DJI. All rights reserved.
+ *
+ */
+
+#include "DJI_SharedLink.h"
+
+#ifdef __linux__
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+using namespace DJI;
+using namespace DJI::onboardSDK;
+
+//! @note how often poll() looks for clients whose process is gone
+#define SHARED_REAP_PERIOD_US 100000
+
+//! @note sequence lock writer, a single writer per slot at a time
+static inline void writeBegin(uint32_t *seq)
+{
+  __atomic_store_n(seq, __atomic_load_n(seq, __ATOMIC_RELAXED) + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline void writeEnd(uint32_t *seq)
+{
+  __atomic_store_n(seq, __atomic_load_n(seq, __ATOMIC_RELAXED) + 1, __ATOMIC_RELEASE);
+}
+
+//! @note copies size bytes of a slot, retrying while the writer is at it
+static inline void readConsistent(const uint32_t *seq, void *dest, const void *src, size_t size)
+{
+  for (;;)
+  {
+    uint32_t before = __atomic_load_n(seq, __ATOMIC_ACQUIRE);
+    if (before & 1)
+      continue;
+    memcpy(dest, src, size);
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(seq, __ATOMIC_RELAXED) == before)
+      return;
+  }
+}
+
+static bool needsAuthority(uint8_t cmdSet)
+{
+  return cmdSet == SET_CONTROL || cmdSet == SET_MISSION || cmdSet == SET_VIRTUALRC;
+}
+
+SharedLinkServer::SharedLinkServer(CoreAPI *ControlAPI)
+{
+  api = 0;
+  previous.callback = 0;
+  previous.userData = 0;
+  name[0] = 0;
+  region = 0;
+  lastReap = 0;
+  memset(&stats, 0, sizeof(stats));
+  memset(pending, 0, sizeof(pending));
+  pthread_mutex_init(&lock, 0);
+  setApi(ControlAPI);
+}
+
+SharedLinkServer::~SharedLinkServer()
+{
+  close();
+  setApi(0);
+  pthread_mutex_destroy(&lock);
+}
+
+bool SharedLinkServer::open(const char *value)
+{
+  close();
+  strncpy(name, value, sizeof(name) - 1);
+  name[sizeof(name) - 1] = 0;
+
+  //! @note clients of a crashed daemon keep the old object, they see
+  //! serverPid gone and open again
+  shm_unlink(name);
+  int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0660);
+  if (fd < 0)
+  {
+    API_LOG(api ? api->getDriver() : 0, ERROR_LOG, "Cannot create %s: %s\n", name, strerror(errno));
+    return false;
+  }
+  void *mem = MAP_FAILED;
+  if (ftruncate(fd, sizeof(SharedLinkRegion)) == 0)
+    mem = mmap(0, sizeof(SharedLinkRegion), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (mem == MAP_FAILED)
+  {
+    shm_unlink(name);
+    return false;
+  }
+
+  region = (SharedLinkRegion *)mem;
+  memset(region, 0, sizeof(SharedLinkRegion));
+  for (uint32_t i = 0; i < SHARED_QUEUE_SIZE; ++i)
+    region->queue[i].sequence = i;
+  region->authority = -1;
+  region->version = SHARED_LINK_VERSION;
+  region->size = sizeof(SharedLinkRegion);
+  region->serverPid = getpid();
+  __atomic_store_n(&region->magic, SHARED_LINK_MAGIC, __ATOMIC_RELEASE);
+  return true;
+}
+
+void SharedLinkServer::close()
+{
+  if (!region)
+    return;
+  pthread_mutex_lock(&lock);
+  SharedLinkRegion *old = region;
+  region = 0;
+  memset(pending, 0, sizeof(pending));
+  pthread_mutex_unlock(&lock);
+  munmap(old, sizeof(SharedLinkRegion));
+  shm_unlink(name);
+}
+
+bool SharedLinkServer::isOpen() const { return region != 0; }
+
+int SharedLinkServer::poll()
+{
+  if (!region)
+    return 0;
+
+  //! @note claimed slots turn ready in order, stop at the first that is not
+  SharedCommand batch[SHARED_QUEUE_SIZE];
+  uint8_t priority[SHARED_QUEUE_SIZE];
+  int count = 0;
+  uint32_t tail = region->queueTail;
+  while (count < SHARED_QUEUE_SIZE)
+  {
+    SharedCommand *slot = &region->queue[tail & (SHARED_QUEUE_SIZE - 1)];
+    if (__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) != tail + 1)
+      break;
+    batch[count] = *slot;
+    __atomic_store_n(&slot->sequence, tail + SHARED_QUEUE_SIZE, __ATOMIC_RELEASE);
+    tail++;
+
+    //! @note insertion sort by priority, stable for equal priorities
+    uint8_t c = batch[count].client;
+    uint8_t p = c < SHARED_CLIENT_MAX ? region->client[c].priority : 0;
+    int i = count;
+    SharedCommand command = batch[count];
+    while (i > 0 && priority[i - 1] < p)
+    {
+      batch[i] = batch[i - 1];
+      priority[i] = priority[i - 1];
+      --i;
+    }
+    batch[i] = command;
+    priority[i] = p;
+    count++;
+  }
+  __atomic_store_n(&region->queueTail, tail, __ATOMIC_RELEASE);
+
+  for (int i = 0; i < count; ++i)
+    handle(batch[i]);
+  sweep(monotonicTimeUs());
+  return count;
+}
+
+void SharedLinkServer::handle(const SharedCommand &command)
+{
+  time_us now = monotonicTimeUs();
+  pthread_mutex_lock(&lock);
+  stats.commands++;
+  if (command.client >= SHARED_CLIENT_MAX ||
+      __atomic_load_n(&region->client[command.client].state, __ATOMIC_ACQUIRE) != 1)
+  {
+    stats.failed++;
+    pthread_mutex_unlock(&lock);
+    return;
+  }
+  if (command.length > SHARED_COMMAND_SIZE || command.sessionMode > 2 || !api)
+  {
+    stats.failed++;
+    result(command.client, command.token, SHARED_FAILED, 0, 0, 0);
+    pthread_mutex_unlock(&lock);
+    return;
+  }
+  if (!arbitrate(command, now))
+  {
+    stats.rejected++;
+    result(command.client, command.token, SHARED_REJECTED, 0, 0, 0);
+    pthread_mutex_unlock(&lock);
+    return;
+  }
+  pthread_mutex_unlock(&lock);
+
+  int8_t control = 0;
+  if (command.cmdSet == SET_CONTROL && command.cmdId == CODE_SETCONTROL && command.length >= 1)
+    control = command.data[0] ? 1 : -1;
+
+  uint8_t buf[SHARED_COMMAND_SIZE + 2];
+  buf[0] = command.cmdSet;
+  buf[1] = command.cmdId;
+  memcpy(buf + 2, command.data, command.length);
+
+  Command param;
+  param.sessionMode = command.sessionMode;
+  param.encrypt = command.cmdSet == SET_ACTIVATION ? 0 : api->getEncrypt();
+  param.retry = command.retry;
+  param.timeout = command.timeout;
+  param.length = command.length + 2;
+  param.buf = buf;
+  param.handler = command.sessionMode ? SharedLinkServer::ackCallback : 0;
+  param.userData = this;
+
+  //! @note held across send() so the ACK cannot overtake the pending entry
+  pthread_mutex_lock(&lock);
+  int session = api->send(&param);
+  if (session <= 0)
+  {
+    if (session < 0)
+      stats.failed++;
+    else
+      //! @note no ACK is coming to wait for
+      commitAuthority(command.client, control);
+    result(command.client, command.token, session < 0 ? SHARED_FAILED : SHARED_DONE, 0, 0, 0);
+    pthread_mutex_unlock(&lock);
+    return;
+  }
+
+  Pending *p = &pending[session];
+  if (p->used)
+  {
+    //! @note CoreAPI gave the session up without an ACK
+    stats.timeouts++;
+    result(p->client, p->token, SHARED_TIMEOUT, 0, 0, 0);
+  }
+  uint32_t perTry = api->getAdaptiveTimeout() ? 2000 : command.timeout;
+  p->used = true;
+  p->client = command.client;
+  p->token = command.token;
+  p->deadline = now + ((time_us)(command.retry + 1) * perTry + 100) * 1000;
+  p->control = control;
+  result(command.client, command.token, SHARED_SENT, 0, 0, 0);
+  pthread_mutex_unlock(&lock);
+}
+
+//! @note called with lock held, only decides; the holder changes in commitAuthority()
+bool SharedLinkServer::arbitrate(const SharedCommand &command, time_us now)
+{
+  if (!needsAuthority(command.cmdSet))
+    return true;
+
+  int holder = __atomic_load_n(&region->authority, __ATOMIC_ACQUIRE);
+  int client = command.client;
+  if (command.cmdSet == SET_CONTROL && command.cmdId == CODE_SETCONTROL && command.length >= 1)
+  {
+    if (command.data[0])
+    {
+      if (holder == client)
+        return true;
+      return holder < 0 || !clientAlive(holder, now) ||
+             region->client[holder].priority < region->client[client].priority;
+    }
+    return holder == client;
+  }
+  return holder == client;
+}
+
+//! @note called with lock held
+void SharedLinkServer::commitAuthority(uint8_t client, int8_t control)
+{
+  int holder = __atomic_load_n(&region->authority, __ATOMIC_ACQUIRE);
+  if (control > 0 && holder != client)
+  {
+    API_LOG(api->getDriver(), STATUS_LOG, "Control authority %d -> %d (%s)\n", holder, client,
+        region->client[client].name);
+    __atomic_store_n(&region->authority, client, __ATOMIC_RELEASE);
+    stats.authorityChanges++;
+  }
+  else if (control < 0 && holder == client)
+  {
+    __atomic_store_n(&region->authority, -1, __ATOMIC_RELEASE);
+    stats.authorityChanges++;
+  }
+}
+
+bool SharedLinkServer::clientAlive(int client, time_us now) const
+{
+  const SharedClient *c = &region->client[client];
+  if (__atomic_load_n(&c->state, __ATOMIC_ACQUIRE) != 1)
+    return false;
+  time_us beat = __atomic_load_n(&c->heartbeatUs, __ATOMIC_RELAXED);
+  return now < beat + SHARED_CLIENT_TIMEOUT_US;
+}
+
+void SharedLinkServer::sweep(time_us now)
+{
+  pthread_mutex_lock(&lock);
+  int holder = __atomic_load_n(&region->authority, __ATOMIC_ACQUIRE);
+  if (holder >= 0 && !clientAlive(holder, now))
+  {
+    //! @note the flight controller keeps its control state, the next client
+    //! to obtain control takes over
+    API_LOG(api->getDriver(), ERROR_LOG, "Client %d (%s) timed out, control authority is free\n",
+        holder, region->client[holder].name);
+    __atomic_store_n(&region->authority, -1, __ATOMIC_RELEASE);
+    stats.authorityChanges++;
+  }
+
+  for (size_t i = 1; i < SESSION_TABLE_NUM; ++i)
+    if (pending[i].used && now > pending[i].deadline)
+    {
+      pending[i].used = false;
+      stats.timeouts++;
+      result(pending[i].client, pending[i].token, SHARED_TIMEOUT, 0, 0, 0);
+    }
+  pthread_mutex_unlock(&lock);
+
+  if (now - lastReap < SHARED_REAP_PERIOD_US)
+    return;
+  lastReap = now;
+  for (int i = 0; i < SHARED_CLIENT_MAX; ++i)
+  {
+    SharedClient *c = &region->client[i];
+    if (__atomic_load_n(&c->state, __ATOMIC_ACQUIRE) == 1 && kill(c->pid, 0) != 0 &&
+        errno == ESRCH)
+    {
+      API_LOG(api->getDriver(), STATUS_LOG, "Client %d (%s) is gone\n", i, c->name);
+      __atomic_store_n(&c->state, 0, __ATOMIC_RELEASE);
+    }
+  }
+}
+
+//! @note called with lock held
+void SharedLinkServer::result(uint8_t client, uint32_t token, uint16_t status, uint16_t ack,
+    const uint8_t *data, size_t length)
+{
+  if (region && client < SHARED_CLIENT_MAX)
+  {
+    SharedClient *c = &region->client[client];
+    SharedResult *r = &c->result[token % SHARED_RESULT_NUM];
+    writeBegin(&c->resultSeq);
+    r->token = token;
+    r->status = status;
+    r->ack = ack;
+    r->length = length < SHARED_ACK_SIZE ? length : SHARED_ACK_SIZE;
+    if (data)
+      memcpy(r->data, data, r->length);
+    writeEnd(&c->resultSeq);
+  }
+}
+
+void SharedLinkServer::ackCallback(CoreAPI *api __UNUSED, Header *protocolHeader, UserData server)
+{
+  SharedLinkServer *self = (SharedLinkServer *)server;
+  unsigned int session = protocolHeader->sessionID;
+  if (session >= SESSION_TABLE_NUM)
+    return;
+
+  const uint8_t *data = (const uint8_t *)protocolHeader + sizeof(Header);
+  size_t length = protocolHeader->length - EXC_DATA_SIZE;
+  uint16_t ack = 0;
+  if (length >= 2)
+    ack = data[0] | (data[1] << 8);
+  else if (length == 1)
+    ack = data[0];
+
+  pthread_mutex_lock(&self->lock);
+  Pending *p = &self->pending[session];
+  if (p->used)
+  {
+    p->used = false;
+    self->stats.acked++;
+    if ((p->control > 0 && ack == ACK_SETCONTROL_OBTAIN_SUCCESS) ||
+        (p->control < 0 && ack == ACK_SETCONTROL_RELEASE_SUCCESS))
+      self->commitAuthority(p->client, p->control);
+    self->result(p->client, p->token, SHARED_ACKED, ack, data, length);
+  }
+  pthread_mutex_unlock(&self->lock);
+}
+
+void SharedLinkServer::broadcastCallback(CoreAPI *api, Header *protocolHeader, UserData server)
+{
+  SharedLinkServer *self = (SharedLinkServer *)server;
+  self->publish();
+  if (self->previous.callback)
+    self->previous.callback(api, protocolHeader, self->previous.userData);
+}
+
+void SharedLinkServer::publish()
+{
+  if (!region)
+    return;
+  BroadcastData data = api->getBroadcastData();
+  uint32_t generation = region->generation + 1;
+  SharedBroadcast *slot = &region->broadcast[generation % SHARED_BROADCAST_SLOTS];
+  writeBegin(&slot->sequence);
+  slot->generation = generation;
+  slot->timeUs = monotonicTimeUs();
+  slot->data = data;
+  writeEnd(&slot->sequence);
+  __atomic_store_n(&region->generation, generation, __ATOMIC_RELEASE);
+  pthread_mutex_lock(&lock);
+  stats.broadcasts++;
+  pthread_mutex_unlock(&lock);
+}
+
+int SharedLinkServer::getAuthority() const
+{
+  return region ? __atomic_load_n(&region->authority, __ATOMIC_ACQUIRE) : -1;
+}
+
+SharedLinkStats SharedLinkServer::getStats() const
+{
+  pthread_mutex_lock(&lock);
+  SharedLinkStats ans = stats;
+  pthread_mutex_unlock(&lock);
+  return ans;
+}
+
+CoreAPI *SharedLinkServer::getApi() const { return api; }
+
+void SharedLinkServer::setApi(CoreAPI *value)
+{
+  if (api && api->getBroadcastCallback().userData == this)
+    api->setBroadcastCallback(previous);
+  api = value;
+  if (api)
+  {
+    previous = api->getBroadcastCallback();
+    api->setBroadcastCallback(SharedLinkServer::broadcastCallback, this);
+  }
+}
+
+SharedLinkClient::SharedLinkClient()
+{
+  region = 0;
+  id = -1;
+}
+
+SharedLinkClient::~SharedLinkClient() { close(); }
+
+bool SharedLinkClient::open(const char *name, const char *clientName, uint8_t priority)
+{
+  close();
+  int fd = shm_open(name, O_RDWR, 0);
+  if (fd < 0)
+    return false;
+  void *mem = mmap(0, sizeof(SharedLinkRegion), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (mem == MAP_FAILED)
+    return false;
+
+  SharedLinkRegion *r = (SharedLinkRegion *)mem;
+  if (__atomic_load_n(&r->magic, __ATOMIC_ACQUIRE) != SHARED_LINK_MAGIC ||
+      r->version != SHARED_LINK_VERSION || r->size != sizeof(SharedLinkRegion))
+  {
+    munmap(mem, sizeof(SharedLinkRegion));
+    return false;
+  }
+
+  for (int i = 0; i < SHARED_CLIENT_MAX; ++i)
+  {
+    SharedClient *c = &r->client[i];
+    uint32_t state = 0;
+    //! @note 2 keeps the daemon away until the slot is filled in
+    if (!__atomic_compare_exchange_n(&c->state, &state, 2, false, __ATOMIC_ACQUIRE,
+            __ATOMIC_RELAXED))
+      continue;
+    c->pid = getpid();
+    c->priority = priority;
+    strncpy(c->name, clientName ? clientName : "", sizeof(c->name) - 1);
+    c->name[sizeof(c->name) - 1] = 0;
+    __atomic_store_n(&c->heartbeatUs, monotonicTimeUs(), __ATOMIC_RELAXED);
+    //! @note tokens keep counting across clients of the slot, so a stale
+    //! result never matches a new token
+    if (c->nextToken == 0)
+      c->nextToken = 1;
+    __atomic_store_n(&c->state, 1, __ATOMIC_RELEASE);
+    region = r;
+    id = i;
+    return true;
+  }
+  munmap(mem, sizeof(SharedLinkRegion));
+  return false;
+}
+
+void SharedLinkClient::close()
+{
+  if (!region)
+    return;
+  int32_t self = id;
+  __atomic_compare_exchange_n(&region->authority, &self, -1, false, __ATOMIC_ACQ_REL,
+      __ATOMIC_RELAXED);
+  __atomic_store_n(&region->client[id].state, 0, __ATOMIC_RELEASE);
+  munmap(region, sizeof(SharedLinkRegion));
+  region = 0;
+  id = -1;
+}
+
+bool SharedLinkClient::isOpen() const { return region != 0; }
+
+uint32_t SharedLinkClient::getGeneration() const
+{
+  return region ? __atomic_load_n(&region->generation, __ATOMIC_ACQUIRE) : 0;
+}
+
+bool SharedLinkClient::getBroadcast(BroadcastData *data, uint32_t *generation) const
+{
+  for (;;)
+  {
+    uint32_t latest = getGeneration();
+    if (latest == 0)
+      return false;
+    if (getBroadcast(latest, data))
+    {
+      if (generation)
+        *generation = latest;
+      return true;
+    }
+  }
+}
+
+bool SharedLinkClient::getBroadcast(uint32_t generation, BroadcastData *data) const
+{
+  uint32_t latest = getGeneration();
+  if (generation == 0 || generation > latest || latest - generation >= SHARED_BROADCAST_SLOTS)
+    return false;
+  const SharedBroadcast *slot = &region->broadcast[generation % SHARED_BROADCAST_SLOTS];
+  SharedBroadcast copy;
+  readConsistent(&slot->sequence, &copy, slot, sizeof(SharedBroadcast));
+  if (copy.generation != generation)
+    return false;
+  *data = copy.data;
+  return true;
+}
+
+uint32_t SharedLinkClient::send(CMD_SET cmdSet, uint8_t cmdId, const void *data, size_t length,
+    uint8_t sessionMode, uint16_t timeout, uint8_t retry)
+{
+  if (!region || length > SHARED_COMMAND_SIZE)
+    return 0;
+  heartbeat();
+
+  uint32_t pos = __atomic_load_n(&region->queueHead, __ATOMIC_RELAXED);
+  SharedCommand *slot;
+  for (;;)
+  {
+    slot = &region->queue[pos & (SHARED_QUEUE_SIZE - 1)];
+    uint32_t seq = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+    int32_t diff = (int32_t)(seq - pos);
+    if (diff == 0)
+    {
+      if (__atomic_compare_exchange_n(&region->queueHead, &pos, pos + 1, true, __ATOMIC_RELAXED,
+              __ATOMIC_RELAXED))
+        break;
+    }
+    else if (diff < 0)
+      return 0;
+    else
+      pos = __atomic_load_n(&region->queueHead, __ATOMIC_RELAXED);
+  }
+
+  uint32_t token = __atomic_fetch_add(&region->client[id].nextToken, 1, __ATOMIC_RELAXED);
+  if (token == 0)
+    token = __atomic_fetch_add(&region->client[id].nextToken, 1, __ATOMIC_RELAXED);
+  slot->token = token;
+  slot->client = id;
+  slot->cmdSet = cmdSet;
+  slot->cmdId = cmdId;
+  slot->sessionMode = sessionMode;
+  slot->timeout = timeout;
+  slot->retry = retry;
+  slot->length = length;
+  memcpy(slot->data, data, length);
+  __atomic_store_n(&slot->sequence, pos + 1, __ATOMIC_RELEASE);
+  return token;
+}
+
+uint32_t SharedLinkClient::obtainControl()
+{
+  uint8_t data = 1;
+  return send(SET_CONTROL, CODE_SETCONTROL, &data, 1, 2, 500, 2);
+}
+
+uint32_t SharedLinkClient::releaseControl()
+{
+  uint8_t data = 0;
+  return send(SET_CONTROL, CODE_SETCONTROL, &data, 1, 2, 500, 2);
+}
+
+bool SharedLinkClient::hasControl() const
+{
+  return region && __atomic_load_n(&region->authority, __ATOMIC_ACQUIRE) == id;
+}
+
+bool SharedLinkClient::getResult(uint32_t token, SharedResult *result) const
+{
+  if (!region || token == 0)
+    return false;
+  const SharedClient *c = &region->client[id];
+  readConsistent(&c->resultSeq, result, &c->result[token % SHARED_RESULT_NUM],
+      sizeof(SharedResult));
+  return result->token == token;
+}
+
+bool SharedLinkClient::waitResult(uint32_t token, SharedResult *result, int timeout)
+{
+  time_us end = monotonicTimeUs() + (time_us)timeout * 1000;
+  for (;;)
+  {
+    if (getResult(token, result) && result->status != SHARED_SENT)
+      return true;
+    if (monotonicTimeUs() >= end)
+      return false;
+    heartbeat();
+    usleep(500);
+  }
+}
+
+void SharedLinkClient::heartbeat()
+{
+  if (region)
+    __atomic_store_n(&region->client[id].heartbeatUs, monotonicTimeUs(), __ATOMIC_RELAXED);
+}
+
+int SharedLinkClient::getClientId() const { return id; }
+
+uint8_t SharedLinkClient::getPriority() const { return region ? region->client[id].priority : 0; }
+
+#endif // __linux__
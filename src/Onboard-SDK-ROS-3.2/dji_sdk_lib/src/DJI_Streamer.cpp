@@ -0,0 +1,162 @@
+/** @file DJI_Streamer.cpp
+ *  @version 3.1.9
+ *  @date November 10, 2016
+ *
+ *  @brief
+ *  Fixed-rate command streaming for movement control and VirtualRC
+ *
+ *  @copyright 2016 DJI. All rights reserved.
+ *
+ */
+
+#include "DJI_Streamer.h"
+
+#ifdef __linux__
+
+using namespace DJI;
+using namespace DJI::onboardSDK;
+
+//! @note VirtualRC::sendData must not be called faster than this
+#define VRC_MAX_RATE 25
+
+CommandStreamer::CommandStreamer(Flight *FlightAPI, VirtualRC *VirtualRCAPI)
+{
+  flight = FlightAPI;
+  vrc = VirtualRCAPI;
+  pthread_mutex_init(&setpointLock, 0);
+  target = TARGET_NONE;
+  updateTime = 0;
+  timeout = 0;
+  timeoutAction = TIMEOUT_BRAKE;
+  timedOut = false;
+  sent = 0;
+  timeouts = 0;
+  vrcDivider = 0;
+}
+
+CommandStreamer::~CommandStreamer()
+{
+  stop();
+  pthread_mutex_destroy(&setpointLock);
+}
+
+void CommandStreamer::setTimeout(uint32_t timeoutMs, TimeoutAction action)
+{
+  pthread_mutex_lock(&setpointLock);
+  timeout = timeoutMs;
+  timeoutAction = action;
+  pthread_mutex_unlock(&setpointLock);
+}
+
+void CommandStreamer::setMovementControl(uint8_t flag, float32_t x, float32_t y, float32_t z,
+    float32_t yaw)
+{
+  FlightData data;
+  data.flag = flag;
+  data.x = x;
+  data.y = y;
+  data.z = z;
+  data.yaw = yaw;
+  setMovementControl(data);
+}
+
+void CommandStreamer::setMovementControl(const FlightData &data)
+{
+  pthread_mutex_lock(&setpointLock);
+  movement = data;
+  target = TARGET_MOVEMENT;
+  updateTime = monotonicTimeUs();
+  pthread_mutex_unlock(&setpointLock);
+}
+
+void CommandStreamer::setVRCData(const VirtualRCData &data)
+{
+  pthread_mutex_lock(&setpointLock);
+  vrcData = data;
+  target = TARGET_VIRTUALRC;
+  updateTime = monotonicTimeUs();
+  pthread_mutex_unlock(&setpointLock);
+}
+
+void CommandStreamer::clearSetpoint()
+{
+  pthread_mutex_lock(&setpointLock);
+  target = TARGET_NONE;
+  pthread_mutex_unlock(&setpointLock);
+}
+
+CommandStreamer::Target CommandStreamer::getTarget() const
+{
+  pthread_mutex_lock(&setpointLock);
+  Target ans = target;
+  pthread_mutex_unlock(&setpointLock);
+  return ans;
+}
+
+bool CommandStreamer::isTimedOut() const { return timedOut; }
+
+uint64_t CommandStreamer::getSentCount() const { return sent; }
+
+uint64_t CommandStreamer::getTimeoutCount() const { return timeouts; }
+
+Flight *CommandStreamer::getFlight() const { return flight; }
+
+void CommandStreamer::setFlight(Flight *value) { flight = value; }
+
+VirtualRC *CommandStreamer::getVirtualRC() const { return vrc; }
+
+void CommandStreamer::setVirtualRC(VirtualRC *value) { vrc = value; }
+
+void CommandStreamer::tick(time_us now)
+{
+  Target curTarget;
+  FlightData curMovement;
+  VirtualRCData curVRC;
+  bool expired;
+  TimeoutAction action;
+
+  pthread_mutex_lock(&setpointLock);
+  curTarget = target;
+  curMovement = movement;
+  curVRC = vrcData;
+  action = timeoutAction;
+  expired = timeout != 0 && now > updateTime && (now - updateTime) > (time_us)timeout * 1000;
+  pthread_mutex_unlock(&setpointLock);
+
+  if (curTarget == TARGET_NONE)
+    return;
+
+  if (expired)
+  {
+    if (!timedOut.exchange(true))
+      timeouts++;
+    if (action == TIMEOUT_STOP)
+      return;
+    //! @note brake: hold position with zero velocities, keep VirtualRC switches
+    curMovement.flag = Flight::HORIZONTAL_VELOCITY | Flight::VERTICAL_VELOCITY |
+                       Flight::YAW_RATE | Flight::HORIZONTAL_GROUND;
+    curMovement.x = curMovement.y = curMovement.z = curMovement.yaw = 0;
+    curVRC.roll = curVRC.pitch = curVRC.throttle = curVRC.yaw = 1024;
+  }
+  else
+    timedOut = false;
+
+  if (curTarget == TARGET_MOVEMENT && flight)
+  {
+    flight->setMovementControl(curMovement.flag, curMovement.x, curMovement.y, curMovement.z,
+        curMovement.yaw);
+    sent++;
+  }
+  else if (curTarget == TARGET_VIRTUALRC && vrc)
+  {
+    uint32_t divider = (getRate() + VRC_MAX_RATE - 1) / VRC_MAX_RATE;
+    if (++vrcDivider >= divider)
+    {
+      vrcDivider = 0;
+      vrc->sendData(curVRC);
+      sent++;
+    }
+  }
+}
+
+#endif // __linux__
@@ -0,0 +1,298 @@
+/** @file DJI_Thread.cpp
+ *  @version 3.1.9
+ *  @date November 10, 2016
+ *
+ *  @brief
+ *  Periodic real-time thread support for DJI onboardSDK library
+ *
+ *  @copyright 2016 DJI. All rights reserved.
+ *
+ */
+
+#include "DJI_Thread.h"
+#include "DJI_ThreadTopology.h"
+
+#ifdef __linux__
+#include <sched.h>
+#include <errno.h>
+#include <time.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+using namespace DJI;
+using namespace DJI::onboardSDK;
+
+time_us DJI::onboardSDK::monotonicTimeUs()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (time_us)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void DJI::onboardSDK::sleepUntilUs(time_us deadline)
+{
+  struct timespec ts;
+  ts.tv_sec = deadline / 1000000;
+  ts.tv_nsec = (deadline % 1000000) * 1000;
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, 0) == EINTR)
+    ;
+}
+
+//! @note false when the config leaves CPU placement to the kernel
+AckSignal::AckSignal()
+{
+  pending = false;
+  pthread_mutex_init(&mutex, 0);
+  pthread_condattr_t attr;
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&recv, &attr);
+  pthread_condattr_destroy(&attr);
+}
+
+AckSignal::~AckSignal()
+{
+  pthread_cond_destroy(&recv);
+  pthread_mutex_destroy(&mutex);
+}
+
+void AckSignal::lock() { pthread_mutex_lock(&mutex); }
+
+void AckSignal::unlock() { pthread_mutex_unlock(&mutex); }
+
+void AckSignal::notify()
+{
+  pending = true;
+  pthread_cond_signal(&recv);
+}
+
+void AckSignal::wait(int timeout)
+{
+  if (timeout < 0)
+  {
+    while (!pending)
+      pthread_cond_wait(&recv, &mutex);
+  }
+  else
+  {
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += timeout;
+    while (!pending)
+      if (pthread_cond_timedwait(&recv, &mutex, &deadline) == ETIMEDOUT)
+        break;
+  }
+  pending = false;
+}
+
+void AckSignal::clear() { pending = false; }
+
+static bool cpuSetOf(const ThreadConfig *config, cpu_set_t *cpus)
+{
+  CPU_ZERO(cpus);
+  if (config->cpu >= 0)
+    CPU_SET(config->cpu, cpus);
+  for (int i = 0; i < 32; ++i)
+    if (config->cpuMask & (1u << i))
+      CPU_SET(i, cpus);
+  return CPU_COUNT(cpus) > 0;
+}
+
+//! @note the parts pthread attributes can not carry: name and nice value
+static void applyThreadIdentity(const ThreadConfig *config, bool realtime)
+{
+  if (config->name[0])
+    pthread_setname_np(pthread_self(), config->name);
+  if (!realtime && config->niceness)
+    setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), config->niceness);
+}
+
+bool DJI::onboardSDK::applyThreadConfig(const ThreadConfig *config)
+{
+  if (!config)
+    return false;
+
+  cpu_set_t cpus;
+  if (cpuSetOf(config, &cpus))
+    pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+
+  bool realtime = false;
+  if (config->priority > 0)
+  {
+    struct sched_param param;
+    param.sched_priority = config->priority;
+    realtime = pthread_setschedparam(pthread_self(), config->roundRobin ? SCHED_RR : SCHED_FIFO,
+                   &param) == 0;
+  }
+  applyThreadIdentity(config, realtime);
+  return realtime;
+}
+
+PeriodicThread::PeriodicThread()
+{
+  running = false;
+  realtime = false;
+  rate = 0;
+  periodUs = 0;
+  memset(&config, 0, sizeof(config));
+  config.cpu = -1;
+  topology = 0;
+  role = THREAD_STREAMER;
+  pthread_mutex_init(&statsLock, 0);
+  resetPeriodStats();
+}
+
+PeriodicThread::~PeriodicThread()
+{
+  //! @note derived classes must stop() in their own destructor, tick() is
+  //! pure virtual by the time this one runs.
+  stop();
+  pthread_mutex_destroy(&statsLock);
+}
+
+bool PeriodicThread::start(uint32_t rateHz, const ThreadConfig *value)
+{
+  if (running || rateHz == 0 || rateHz > 1000000)
+    return false;
+
+  rate = rateHz;
+  periodUs = 1000000 / rateHz;
+  realtime = false;
+  resetPeriodStats();
+  running = true;
+
+  if (value)
+    config = *value;
+  else if (topology)
+    config = topology->getConfig(role);
+  else
+  {
+    memset(&config, 0, sizeof(config));
+    config.cpu = -1;
+  }
+
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  cpu_set_t cpus;
+  if (cpuSetOf(&config, &cpus))
+    pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus);
+  if (config.priority > 0)
+  {
+    struct sched_param param;
+    param.sched_priority = config.priority;
+    pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(&attr, config.roundRobin ? SCHED_RR : SCHED_FIFO);
+    pthread_attr_setschedparam(&attr, &param);
+    realtime = true;
+  }
+
+  int ret = pthread_create(&thread, &attr, PeriodicThread::entry, this);
+  if (ret == EPERM && realtime)
+  {
+    //! @note not allowed to use SCHED_FIFO, fall back to the default scheduler
+    realtime = false;
+    pthread_attr_setinheritsched(&attr, PTHREAD_INHERIT_SCHED);
+    ret = pthread_create(&thread, &attr, PeriodicThread::entry, this);
+  }
+  pthread_attr_destroy(&attr);
+
+  if (ret != 0)
+  {
+    running = false;
+    realtime = false;
+    return false;
+  }
+  return true;
+}
+
+void PeriodicThread::stop()
+{
+  if (!running.exchange(false))
+    return;
+  pthread_join(thread, 0);
+}
+
+bool PeriodicThread::isRunning() const { return running; }
+
+bool PeriodicThread::isRealtime() const { return realtime; }
+
+uint32_t PeriodicThread::getRate() const { return rate; }
+
+PeriodStats PeriodicThread::getPeriodStats() const
+{
+  pthread_mutex_lock(&statsLock);
+  PeriodStats ans = stats;
+  pthread_mutex_unlock(&statsLock);
+  return ans;
+}
+
+void PeriodicThread::setTopology(ThreadTopology *value, ThreadRole threadRole)
+{
+  topology = value;
+  role = threadRole;
+}
+
+void PeriodicThread::resetPeriodStats()
+{
+  pthread_mutex_lock(&statsLock);
+  memset(&stats, 0, sizeof(stats));
+  jitterSum = 0;
+  pthread_mutex_unlock(&statsLock);
+}
+
+void *PeriodicThread::entry(void *self)
+{
+  ((PeriodicThread *)self)->run();
+  return 0;
+}
+
+void PeriodicThread::record(int64_t jitterUs, uint64_t overruns)
+{
+  pthread_mutex_lock(&statsLock);
+  if (stats.ticks == 0 || jitterUs < stats.minJitterUs)
+    stats.minJitterUs = jitterUs;
+  if (stats.ticks == 0 || jitterUs > stats.maxJitterUs)
+    stats.maxJitterUs = jitterUs;
+  stats.ticks++;
+  stats.overruns += overruns;
+  jitterSum += jitterUs;
+  stats.meanJitterUs = jitterSum / stats.ticks;
+  pthread_mutex_unlock(&statsLock);
+}
+
+void PeriodicThread::run()
+{
+  applyThreadIdentity(&config, realtime);
+  if (topology)
+    topology->attach(role);
+
+  time_us deadline = monotonicTimeUs() + periodUs;
+  while (running)
+  {
+    sleepUntilUs(deadline);
+    time_us now = monotonicTimeUs();
+    if (!running)
+      break;
+
+    tick(deadline);
+
+    //! @note skip deadlines already missed instead of bursting to catch up
+    uint64_t missed = 0;
+    time_us scheduled = deadline;
+    time_us end = monotonicTimeUs();
+    deadline += periodUs;
+    if (end >= deadline)
+    {
+      missed = (end - deadline) / periodUs + 1;
+      deadline += missed * periodUs;
+    }
+    record((int64_t)(now - scheduled), missed);
+  }
+  onStop();
+  if (topology)
+    topology->leave(role);
+}
+
+#endif // __linux__
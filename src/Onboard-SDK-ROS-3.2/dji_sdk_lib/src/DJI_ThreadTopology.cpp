@@ -0,0 +1,320 @@
+/** @file DJI_ThreadTopology.cpp
+ *  @version 3.1.9
+ *  @date November 10, 2016
+ *
+ *  @brief
+ *  CPU placement, scheduling and usage counters for the threads of a link
+ *
+ *  @copyright 2016 DJI. All rights reserved.
+ *
+ */
+
+#include "DJI_ThreadTopology.h"
+
+#ifdef __linux__
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+using namespace DJI;
+using namespace DJI::onboardSDK;
+
+ThreadTopology::ThreadTopology()
+{
+  memset(slot, 0, sizeof(slot));
+  for (int i = 0; i < THREAD_ROLE_NUM; ++i)
+    slot[i].config.cpu = -1;
+  pthread_mutex_init(&lock, 0);
+}
+
+ThreadTopology::~ThreadTopology() { pthread_mutex_destroy(&lock); }
+
+void ThreadTopology::setConfig(ThreadRole role, const ThreadConfig &config)
+{
+  if (role >= THREAD_ROLE_NUM)
+    return;
+  pthread_mutex_lock(&lock);
+  slot[role].config = config;
+  slot[role].config.name[sizeof(config.name) - 1] = 0;
+  pthread_mutex_unlock(&lock);
+}
+
+ThreadConfig ThreadTopology::getConfig(ThreadRole role) const
+{
+  ThreadConfig ans;
+  memset(&ans, 0, sizeof(ans));
+  ans.cpu = -1;
+  if (role >= THREAD_ROLE_NUM)
+    return ans;
+  pthread_mutex_lock(&lock);
+  ans = slot[role].config;
+  pthread_mutex_unlock(&lock);
+  return ans;
+}
+
+bool ThreadTopology::enter(ThreadRole role)
+{
+  if (role >= THREAD_ROLE_NUM)
+    return false;
+  ThreadConfig config = getConfig(role);
+  bool realtime = applyThreadConfig(&config);
+  attach(role);
+  return realtime;
+}
+
+void ThreadTopology::attach(ThreadRole role)
+{
+  if (role >= THREAD_ROLE_NUM)
+    return;
+  pthread_mutex_lock(&lock);
+  Slot *s = &slot[role];
+  memset(&s->usage, 0, sizeof(s->usage));
+  s->thread = pthread_self();
+  s->usage.tid = (pid_t)syscall(SYS_gettid);
+  s->usage.active = pthread_getcpuclockid(s->thread, &s->clock) == 0;
+  pthread_mutex_unlock(&lock);
+}
+
+void ThreadTopology::leave(ThreadRole role)
+{
+  if (role >= THREAD_ROLE_NUM)
+    return;
+  pthread_mutex_lock(&lock);
+  //! @note keep the final numbers, the thread is still alive here
+  if (slot[role].usage.active && pthread_equal(slot[role].thread, pthread_self()))
+  {
+    sample(&slot[role]);
+    slot[role].usage.active = false;
+  }
+  pthread_mutex_unlock(&lock);
+}
+
+ThreadUsage ThreadTopology::getUsage(ThreadRole role) const
+{
+  ThreadUsage ans;
+  memset(&ans, 0, sizeof(ans));
+  if (role >= THREAD_ROLE_NUM)
+    return ans;
+  pthread_mutex_lock(&lock);
+  //! @note leave() takes the lock too, so an active thread can not exit meanwhile
+  if (slot[role].usage.active)
+    sample(&slot[role]);
+  ans = slot[role].usage;
+  pthread_mutex_unlock(&lock);
+  return ans;
+}
+
+const char *ThreadTopology::getRoleName(ThreadRole role)
+{
+  switch (role)
+  {
+    case THREAD_READER:
+      return "reader";
+    case THREAD_POLLER:
+      return "poller";
+    case THREAD_CALLBACK:
+      return "callback";
+    case THREAD_STREAMER:
+      return "streamer";
+    default:
+      return "unknown";
+  }
+}
+
+//! @note called with lock held
+void ThreadTopology::sample(Slot *s) const
+{
+  ThreadUsage *usage = &s->usage;
+  struct timespec ts;
+  if (clock_gettime(s->clock, &ts) == 0)
+    usage->cpuTimeUs = (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+
+  cpu_set_t cpus;
+  if (pthread_getaffinity_np(s->thread, sizeof(cpus), &cpus) == 0)
+  {
+    usage->cpuMask = 0;
+    for (int i = 0; i < 32; ++i)
+      if (CPU_ISSET(i, &cpus))
+        usage->cpuMask |= 1u << i;
+  }
+  struct sched_param param;
+  if (pthread_getschedparam(s->thread, &usage->policy, &param) == 0)
+    usage->priority = param.sched_priority;
+
+  char path[64];
+  char line[128];
+  snprintf(path, sizeof(path), "/proc/self/task/%d/status", (int)usage->tid);
+  FILE *file = fopen(path, "r");
+  if (file)
+  {
+    unsigned long long value;
+    while (fgets(line, sizeof(line), file))
+      if (sscanf(line, "voluntary_ctxt_switches: %llu", &value) == 1)
+        usage->voluntarySwitches = value;
+      else if (sscanf(line, "nonvoluntary_ctxt_switches: %llu", &value) == 1)
+        usage->involuntarySwitches = value;
+    fclose(file);
+  }
+
+  //! @note field 39 of stat, counted after the command name which may hold spaces
+  snprintf(path, sizeof(path), "/proc/self/task/%d/stat", (int)usage->tid);
+  file = fopen(path, "r");
+  if (file)
+  {
+    char buf[512];
+    size_t len = fread(buf, 1, sizeof(buf) - 1, file);
+    buf[len] = 0;
+    fclose(file);
+    char *p = strrchr(buf, ')');
+    for (int field = 2; p && field < 39; ++field)
+      p = strchr(p + 1, ' ');
+    if (p)
+      usage->cpu = atoi(p + 1);
+  }
+}
+
+LinkThreads::LinkThreads(CoreAPI *ControlAPI, ThreadTopology *Topology)
+{
+  api = ControlAPI;
+  topology = Topology;
+  pollPeriod = 10;
+  running = false;
+  txPending = false;
+  pthread_mutex_init(&wakeLock, 0);
+  pthread_condattr_t attr;
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&wake, &attr);
+  pthread_condattr_destroy(&attr);
+}
+
+LinkThreads::~LinkThreads()
+{
+  stop();
+  pthread_cond_destroy(&wake);
+  pthread_mutex_destroy(&wakeLock);
+}
+
+bool LinkThreads::start()
+{
+  if (running || !api)
+    return false;
+  running = true;
+  CallBackHandler pending;
+  pending.callback = LinkThreads::txPendingCallback;
+  pending.userData = this;
+  api->setTxPendingCallback(pending);
+  if (pthread_create(&reader, 0, LinkThreads::readerEntry, this) != 0)
+  {
+    running = false;
+    detachApi();
+    return false;
+  }
+  if (pthread_create(&poller, 0, LinkThreads::pollerEntry, this) != 0)
+  {
+    running = false;
+    pthread_join(reader, 0);
+    detachApi();
+    return false;
+  }
+  return true;
+}
+
+void LinkThreads::stop()
+{
+  if (!running.exchange(false))
+    return;
+  pthread_mutex_lock(&wakeLock);
+  pthread_cond_signal(&wake);
+  pthread_mutex_unlock(&wakeLock);
+  pthread_join(poller, 0);
+  pthread_join(reader, 0);
+  detachApi();
+}
+
+void LinkThreads::detachApi()
+{
+  CallBackHandler none;
+  none.callback = 0;
+  none.userData = 0;
+  api->setTxPendingCallback(none);
+}
+
+//! @note called with the memory lock of the CoreAPI held
+void LinkThreads::txPendingCallback(CoreAPI *api, Header *protocolHeader, UserData self)
+{
+  LinkThreads *link = (LinkThreads *)self;
+  (void)api;
+  (void)protocolHeader;
+  pthread_mutex_lock(&link->wakeLock);
+  link->txPending = true;
+  pthread_cond_signal(&link->wake);
+  pthread_mutex_unlock(&link->wakeLock);
+}
+
+bool LinkThreads::isRunning() const { return running; }
+
+void *LinkThreads::readerEntry(void *self)
+{
+  LinkThreads *link = (LinkThreads *)self;
+  if (link->topology)
+    link->topology->enter(THREAD_READER);
+  while (link->running)
+    link->api->readPoll();
+  if (link->topology)
+    link->topology->leave(THREAD_READER);
+  return 0;
+}
+
+void *LinkThreads::pollerEntry(void *self)
+{
+  LinkThreads *link = (LinkThreads *)self;
+  if (link->topology)
+    link->topology->enter(THREAD_POLLER);
+  time_us nextPoll = monotonicTimeUs();
+  while (link->running)
+  {
+    time_us now = monotonicTimeUs();
+    if (now >= nextPoll)
+    {
+      link->api->sendPoll();
+      nextPoll += (time_us)link->pollPeriod * 1000;
+      if (nextPoll < now)
+        nextPoll = now + (time_us)link->pollPeriod * 1000;
+    }
+
+    //! @note sleep until the next poll or until buffered frames are due
+    time_us until = nextPoll;
+    time_us due = link->api->flushIfDue();
+    if (due && due < until)
+      until = due;
+    struct timespec ts;
+    ts.tv_sec = until / 1000000;
+    ts.tv_nsec = (until % 1000000) * 1000;
+    pthread_mutex_lock(&link->wakeLock);
+    if (!link->txPending && link->running)
+      pthread_cond_timedwait(&link->wake, &link->wakeLock, &ts);
+    link->txPending = false;
+    pthread_mutex_unlock(&link->wakeLock);
+  }
+  if (link->topology)
+    link->topology->leave(THREAD_POLLER);
+  return 0;
+}
+
+CoreAPI *LinkThreads::getApi() const { return api; }
+
+void LinkThreads::setApi(CoreAPI *value) { api = value; }
+
+ThreadTopology *LinkThreads::getTopology() const { return topology; }
+
+void LinkThreads::setTopology(ThreadTopology *value) { topology = value; }
+
+void LinkThreads::setPollPeriod(uint32_t ms) { pollPeriod = ms ? ms : 1; }
+
+uint32_t LinkThreads::getPollPeriod() const { return pollPeriod; }
+
+#endif // __linux__
@@ -0,0 +1,337 @@
+/** @file DJI_Trigger.cpp
+ *  @version 3.1.9
+ *  @date November 10, 2016
+ *
+ *  @brief
+ *  Conditions on broadcast data, evaluated as frames are decoded
+ *
+ *  @copyright 2016 DJI. All rights reserved.
+ *
+ */
+
+#include "DJI_Trigger.h"
+#include <math.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <time.h>
+#endif // __linux__
+
+using namespace DJI;
+using namespace DJI::onboardSDK;
+
+//! @note broadcast channels in the order CoreAPI::broadcast() decodes them,
+//! on the M100 GPS and RTK are missing and the later channels move down
+enum BroadcastChannel
+{
+  CHANNEL_POSITION = 5,
+  CHANNEL_VELOCITY = 3,
+  CHANNEL_RC = 9,
+  CHANNEL_GIMBAL = 10,
+  CHANNEL_STATUS = 11,
+  CHANNEL_BATTERY = 12,
+  CHANNEL_CTRL_INFO = 13
+};
+
+static float64_t readHeight(const BroadcastData &d) { return d.pos.height; }
+static float64_t readAltitude(const BroadcastData &d) { return d.pos.altitude; }
+static float64_t readPositionHealth(const BroadcastData &d) { return d.pos.health; }
+static float64_t readVelocityX(const BroadcastData &d) { return d.v.x; }
+static float64_t readVelocityY(const BroadcastData &d) { return d.v.y; }
+static float64_t readVelocityZ(const BroadcastData &d) { return d.v.z; }
+static float64_t readHorizontalSpeed(const BroadcastData &d)
+{
+  return sqrt(d.v.x * d.v.x + d.v.y * d.v.y);
+}
+static float64_t readGimbalRoll(const BroadcastData &d) { return d.gimbal.roll; }
+static float64_t readGimbalPitch(const BroadcastData &d) { return d.gimbal.pitch; }
+static float64_t readGimbalYaw(const BroadcastData &d) { return d.gimbal.yaw; }
+static float64_t readRCMode(const BroadcastData &d) { return d.rc.mode; }
+static float64_t readRCGear(const BroadcastData &d) { return d.rc.gear; }
+static float64_t readFlightStatus(const BroadcastData &d) { return d.status; }
+static float64_t readBattery(const BroadcastData &d) { return d.battery; }
+static float64_t readCtrlMode(const BroadcastData &d) { return d.ctrlInfo.mode; }
+static float64_t readCtrlDevice(const BroadcastData &d) { return d.ctrlInfo.deviceStatus; }
+
+typedef struct FieldInfo
+{
+  uint8_t channel;
+  float64_t (*read)(const BroadcastData &data);
+} FieldInfo;
+
+//! @note indexed by TriggerField
+static const FieldInfo fieldInfo[TRIGGER_FIELD_NUM] = {
+  { CHANNEL_POSITION, readHeight },
+  { CHANNEL_POSITION, readAltitude },
+  { CHANNEL_POSITION, readPositionHealth },
+  { CHANNEL_VELOCITY, readVelocityX },
+  { CHANNEL_VELOCITY, readVelocityY },
+  { CHANNEL_VELOCITY, readVelocityZ },
+  { CHANNEL_VELOCITY, readHorizontalSpeed },
+  { CHANNEL_GIMBAL, readGimbalRoll },
+  { CHANNEL_GIMBAL, readGimbalPitch },
+  { CHANNEL_GIMBAL, readGimbalYaw },
+  { CHANNEL_RC, readRCMode },
+  { CHANNEL_RC, readRCGear },
+  { CHANNEL_STATUS, readFlightStatus },
+  { CHANNEL_BATTERY, readBattery },
+  { CHANNEL_CTRL_INFO, readCtrlMode },
+  { CHANNEL_CTRL_INFO, readCtrlDevice },
+};
+
+TriggerRegistry::TriggerRegistry(CoreAPI *ControlAPI)
+{
+  api = 0;
+  memset(trigger, 0, sizeof(trigger));
+#ifdef __linux__
+  pthread_mutex_init(&mutex, 0);
+  pthread_condattr_t attr;
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&cond, &attr);
+  pthread_condattr_destroy(&attr);
+#endif // __linux__
+  setApi(ControlAPI);
+}
+
+TriggerRegistry::~TriggerRegistry()
+{
+  setApi(0);
+#ifdef __linux__
+  pthread_cond_destroy(&cond);
+  pthread_mutex_destroy(&mutex);
+#endif // __linux__
+}
+
+int TriggerRegistry::add(const TriggerSpec &spec, TriggerCallback callback, UserData userData)
+{
+  if (spec.field >= TRIGGER_FIELD_NUM || spec.hysteresis < 0)
+    return -1;
+
+  lock();
+  int id = -1;
+  for (int i = 0; i < TRIGGER_MAX; ++i)
+    if (!trigger[i].used)
+    {
+      id = i;
+      break;
+    }
+  if (id >= 0)
+  {
+    Trigger *t = &trigger[id];
+    memset(t, 0, sizeof(*t));
+    t->spec = spec;
+    t->channel = fieldInfo[spec.field].channel;
+    t->read = fieldInfo[spec.field].read;
+    t->callback = callback;
+    t->userData = userData;
+    t->used = true;
+  }
+  unlock();
+  return id;
+}
+
+bool TriggerRegistry::remove(int id)
+{
+  if (id < 0 || id >= TRIGGER_MAX)
+    return false;
+  lock();
+  bool ans = trigger[id].used;
+  trigger[id].used = false;
+  unlock();
+  return ans;
+}
+
+void TriggerRegistry::clear()
+{
+  lock();
+  for (int i = 0; i < TRIGGER_MAX; ++i)
+    trigger[i].used = false;
+  unlock();
+}
+
+bool TriggerRegistry::isTrue(int id) const
+{
+  if (id < 0 || id >= TRIGGER_MAX)
+    return false;
+  lock();
+  bool ans = trigger[id].used && trigger[id].known && trigger[id].state;
+  unlock();
+  return ans;
+}
+
+uint32_t TriggerRegistry::getFireCount(int id) const
+{
+  if (id < 0 || id >= TRIGGER_MAX)
+    return 0;
+  lock();
+  uint32_t ans = trigger[id].fires;
+  unlock();
+  return ans;
+}
+
+float64_t TriggerRegistry::getLastValue(int id) const
+{
+  if (id < 0 || id >= TRIGGER_MAX)
+    return 0;
+  lock();
+  float64_t ans = trigger[id].last;
+  unlock();
+  return ans;
+}
+
+#ifdef __linux__
+bool TriggerRegistry::wait(int id, int timeout)
+{
+  if (id < 0 || id >= TRIGGER_MAX)
+    return false;
+
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  ts.tv_sec += timeout / 1000;
+  ts.tv_nsec += (long)(timeout % 1000) * 1000000;
+  if (ts.tv_nsec >= 1000000000)
+  {
+    ts.tv_sec++;
+    ts.tv_nsec -= 1000000000;
+  }
+
+  pthread_mutex_lock(&mutex);
+  Trigger *t = &trigger[id];
+  bool ans = t->used && t->spec.mode == TRIGGER_LEVEL && t->known && t->state;
+  uint32_t fires = t->fires;
+  while (!ans && t->used)
+  {
+    bool timedOut = pthread_cond_timedwait(&cond, &mutex, &ts) != 0;
+    //! @note a one-shot trigger is gone once it fired, its count still moved
+    ans = t->fires != fires;
+    if (timedOut)
+      break;
+  }
+  pthread_mutex_unlock(&mutex);
+  return ans;
+}
+
+bool TriggerRegistry::waitUntil(const TriggerSpec &spec, int timeout)
+{
+  TriggerSpec level = spec;
+  level.mode = TRIGGER_LEVEL;
+  level.oneShot = false;
+  int id = add(level);
+  if (id < 0)
+    return false;
+  bool ans = wait(id, timeout);
+  remove(id);
+  return ans;
+}
+#endif // __linux__
+
+uint16_t TriggerRegistry::channelsOf(uint16_t enableFlag, const FirmwareBehaviour &firmware)
+{
+  if (!firmware.isM100)
+    return enableFlag;
+  return (enableFlag & 0x003F) | ((enableFlag & 0xFFC0) << 2);
+}
+
+uint32_t TriggerRegistry::evaluate(const BroadcastData &data, uint16_t enableFlag,
+    const FirmwareBehaviour &firmware)
+{
+  uint16_t channels = channelsOf(enableFlag, firmware);
+  uint32_t fired = 0;
+
+  lock();
+  for (int i = 0; i < TRIGGER_MAX; ++i)
+  {
+    Trigger *t = &trigger[i];
+    if (!t->used || !(channels & (1 << t->channel)))
+      continue;
+
+    float64_t value = t->read(data);
+    const TriggerSpec &spec = t->spec;
+    bool state = false;
+    switch (spec.compare)
+    {
+      case TRIGGER_ABOVE:
+        state = value > (t->known && t->state ? spec.threshold - spec.hysteresis : spec.threshold);
+        break;
+      case TRIGGER_BELOW:
+        state = value < (t->known && t->state ? spec.threshold + spec.hysteresis : spec.threshold);
+        break;
+      case TRIGGER_EQUAL:
+        state = value == spec.threshold;
+        break;
+      case TRIGGER_NOT_EQUAL:
+        state = value != spec.threshold;
+        break;
+      case TRIGGER_CHANGED:
+        state = t->known && value != t->last;
+        break;
+    }
+
+    //! @note every change is an edge of its own
+    bool edge = state && (spec.compare == TRIGGER_CHANGED || !t->known || !t->state);
+    if (spec.mode == TRIGGER_LEVEL ? state : edge)
+    {
+      t->fires++;
+      t->firedValue = value;
+      fired |= 1u << i;
+    }
+    t->known = true;
+    t->state = state;
+    t->last = value;
+  }
+  unlock();
+  return fired;
+}
+
+void TriggerRegistry::fire(uint32_t fired)
+{
+  for (int i = 0; fired && i < TRIGGER_MAX; ++i)
+  {
+    if (!(fired & (1u << i)))
+      continue;
+    fired &= ~(1u << i);
+
+    lock();
+    Trigger *t = &trigger[i];
+    TriggerCallback callback = t->used ? t->callback : 0;
+    UserData userData = t->userData;
+    float64_t value = t->firedValue;
+    if (t->spec.oneShot)
+      t->used = false;
+    unlock();
+
+    if (callback)
+      callback(this, i, value, userData);
+  }
+#ifdef __linux__
+  pthread_mutex_lock(&mutex);
+  pthread_cond_broadcast(&cond);
+  pthread_mutex_unlock(&mutex);
+#endif // __linux__
+}
+
+CoreAPI *TriggerRegistry::getApi() const { return api; }
+
+void TriggerRegistry::setApi(CoreAPI *value)
+{
+  if (api && api->getTriggerRegistry() == this)
+    api->setTriggerRegistry(0);
+  api = value;
+  if (api)
+    api->setTriggerRegistry(this);
+}
+
+void TriggerRegistry::lock() const
+{
+#ifdef __linux__
+  pthread_mutex_lock(&mutex);
+#endif // __linux__
+}
+
+void TriggerRegistry::unlock() const
+{
+#ifdef __linux__
+  pthread_mutex_unlock(&mutex);
+#endif // __linux__
+}
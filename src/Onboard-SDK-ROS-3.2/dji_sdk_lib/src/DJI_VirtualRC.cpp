@@ -25,20 +25,20 @@ void VirtualRC::setControl(bool enable, VirtualRC::CutOff cutoffType)
   VirtualRCSetting setting;
   setting.cutoff = cutoffType;
   setting.enable = enable ? 1 : 0;
-  api->send(0, encrypt, SET_VIRTUALRC, CODE_VIRTUALRC_SETTINGS, &setting, sizeof(setting));
+  api->send(0, api->getEncrypt(), SET_VIRTUALRC, CODE_VIRTUALRC_SETTINGS, &setting, sizeof(setting));
 }
 
 void VirtualRC::sendData(VirtualRCData Data)
 {
   vrcData = Data; 
   //!api->send command was moved to this function from sendData(). 
-  api->send(0, encrypt, SET_VIRTUALRC, CODE_VIRTUALRC_DATA, &vrcData, sizeof(vrcData));
+  api->send(0, api->getEncrypt(), SET_VIRTUALRC, CODE_VIRTUALRC_DATA, &vrcData, sizeof(vrcData));
 }
 
 //!This function will be deprecated in a future release. Please use sendData(VirtualRCData Data) instead. 
 void VirtualRC::sendData()
 {
-  api->send(0, encrypt, SET_VIRTUALRC, CODE_VIRTUALRC_DATA, &vrcData, sizeof(vrcData));
+  api->send(0, api->getEncrypt(), SET_VIRTUALRC, CODE_VIRTUALRC_DATA, &vrcData, sizeof(vrcData));
 }
 
 //!This function will not be maintained and will be deprecated in a future release. Please use resetVRCData() instead.
@@ -12,6 +12,7 @@
 
 #include "DJI_WayPoint.h"
 #include <string.h>
+#include <math.h>
 
 using namespace DJI;
 using namespace DJI::onboardSDK;
@@ -36,7 +37,7 @@ void WayPoint::init(WayPointInitData *Info, CallBack callback, UserData userData
   if (Info)
     setInfo(*Info);
 
-  api->send(2, encrypt, SET_MISSION, CODE_WAYPOINT_INIT, &info, sizeof(info), 500, 2,
+  api->send(2, api->getEncrypt(), SET_MISSION, CODE_WAYPOINT_INIT, &info, sizeof(info), 500, 2,
     callback ? callback : missionCallback, userData);
 }
 
@@ -45,7 +46,7 @@ MissionACK WayPoint::init(WayPointInitData *Info, int timeout)
   if (Info)
     setInfo(*Info);
 
-  api->send(2, encrypt, SET_MISSION, CODE_WAYPOINT_INIT, &info, sizeof(info), 500, 2, 0, 0);
+  api->send(2, api->getEncrypt(), SET_MISSION, CODE_WAYPOINT_INIT, &info, sizeof(info), 500, 2, 0, 0);
 
   api->serialDevice->lockACK();
   api->serialDevice->wait(timeout);
@@ -58,7 +59,7 @@ void WayPoint::start(CallBack callback, UserData userData)
 {
   uint8_t start = 0;
 
-  api->send(2, encrypt, SET_MISSION, CODE_WAYPOINT_SETSTART, &start, sizeof(start), 500, 2,
+  api->send(2, api->getEncrypt(), SET_MISSION, CODE_WAYPOINT_SETSTART, &start, sizeof(start), 500, 2,
     callback ? callback : missionCallback, userData);
 }
 
@@ -66,7 +67,7 @@ MissionACK WayPoint::start(int timeout)
 {
   uint8_t start = 0;
 
-  api->send(2, encrypt, SET_MISSION, CODE_WAYPOINT_SETSTART, &start, sizeof(start), 500, 2, 0, 0);
+  api->send(2, api->getEncrypt(), SET_MISSION, CODE_WAYPOINT_SETSTART, &start, sizeof(start), 500, 2, 0, 0);
 
   api->serialDevice->lockACK();
   api->serialDevice->wait(timeout);
@@ -79,7 +80,7 @@ void WayPoint::stop(CallBack callback, UserData userData)
 {
   uint8_t stop = 1;
 
-  api->send(2, encrypt, SET_MISSION, CODE_WAYPOINT_SETSTART, &stop, sizeof(stop), 500, 2,
+  api->send(2, api->getEncrypt(), SET_MISSION, CODE_WAYPOINT_SETSTART, &stop, sizeof(stop), 500, 2,
     callback ? callback : missionCallback, userData);
 }
 
@@ -87,7 +88,7 @@ MissionACK WayPoint::stop(int timeout)
 {
   uint8_t stop = 1;
 
-  api->send(2, encrypt, SET_MISSION, CODE_WAYPOINT_SETSTART, &stop, sizeof(stop), 500, 2, 0,0);
+  api->send(2, api->getEncrypt(), SET_MISSION, CODE_WAYPOINT_SETSTART, &stop, sizeof(stop), 500, 2, 0,0);
 
   api->serialDevice->lockACK();
   api->serialDevice->wait(timeout);
@@ -100,7 +101,7 @@ void WayPoint::pause(bool isPause, CallBack callback, UserData userData)
 {
  uint8_t data = isPause ? 0 : 1;
  
- api->send(2, encrypt, SET_MISSION, CODE_WAYPOINT_SETPAUSE, &data, sizeof(data), 500, 2,
+ api->send(2, api->getEncrypt(), SET_MISSION, CODE_WAYPOINT_SETPAUSE, &data, sizeof(data), 500, 2,
     callback ? callback : missionCallback, userData);
 }
 
@@ -108,7 +109,7 @@ MissionACK WayPoint::pause(bool isPause, int timeout)
 {
  uint8_t data = isPause ? 0 : 1;
 
- api->send(2, encrypt, SET_MISSION, CODE_WAYPOINT_SETPAUSE, &data, sizeof(data), 500, 2, 0, 0);
+ api->send(2, api->getEncrypt(), SET_MISSION, CODE_WAYPOINT_SETPAUSE, &data, sizeof(data), 500, 2, 0, 0);
 
  api->serialDevice->lockACK();
  api->serialDevice->wait(timeout);
@@ -121,7 +122,7 @@ void WayPoint::readIdleVelocity(CallBack callback, UserData userData)
 {
   uint8_t zero = 0;
   
-  api->send(2, encrypt, SET_MISSION, CODE_WAYPOINT_GETVELOCITY, &zero, sizeof(zero), 500, 2,
+  api->send(2, api->getEncrypt(), SET_MISSION, CODE_WAYPOINT_GETVELOCITY, &zero, sizeof(zero), 500, 2,
     callback ? callback : idleVelocityCallback, userData ? userData : this);
 }
 
@@ -139,7 +140,7 @@ bool WayPoint::uploadIndexData(uint8_t pos, CallBack callback, UserData userData
   else
     return false; //! @note range error
 
-  api->send(2, encrypt, SET_MISSION, CODE_WAYPOINT_ADDPOINT, &send, sizeof(send), 1000, 4,
+  api->send(2, api->getEncrypt(), SET_MISSION, CODE_WAYPOINT_ADDPOINT, &send, sizeof(send), 1000, 4,
     callback ? callback : uploadIndexDataCallback, userData);
 
   return true;
@@ -158,7 +159,7 @@ WayPointDataACK WayPoint::uploadIndexData(WayPointData *data, int timeout)
     throw std::runtime_error("Range error\n");
 #endif
 
-  api->send(2, encrypt, SET_MISSION, CODE_WAYPOINT_ADDPOINT, &wpData, sizeof(wpData), 1000, 4, 0, 0);
+  api->send(2, api->getEncrypt(), SET_MISSION, CODE_WAYPOINT_ADDPOINT, &wpData, sizeof(wpData), 1000, 4, 0, 0);
 
   api->serialDevice->lockACK();
   api->serialDevice->wait(timeout);
@@ -176,7 +177,7 @@ WayPointDataACK WayPoint::uploadIndexData(WayPointData *data, int timeout)
 WayPointInitACK WayPoint::getWaypointSettings(int timeout)
 {
   uint8_t arbNumber = 0;
-  api->send(2, encrypt, SET_MISSION, CODE_WAYPOINT_INFO_READ, &arbNumber, sizeof(arbNumber), 1000, 4, 0, 0);
+  api->send(2, api->getEncrypt(), SET_MISSION, CODE_WAYPOINT_INFO_READ, &arbNumber, sizeof(arbNumber), 1000, 4, 0, 0);
 
   api->serialDevice->lockACK();
   api->serialDevice->wait(timeout);
@@ -188,13 +189,13 @@ WayPointInitACK WayPoint::getWaypointSettings(int timeout)
 void WayPoint::getWaypointSettings(CallBack callback, UserData userData)
 {
   uint8_t arbNumber = 0;
-  api->send(2, encrypt, SET_MISSION, CODE_WAYPOINT_INFO_READ, &arbNumber, sizeof(arbNumber), 1000, 4,
+  api->send(2, api->getEncrypt(), SET_MISSION, CODE_WAYPOINT_INFO_READ, &arbNumber, sizeof(arbNumber), 1000, 4,
     callback ? callback : getWaypointSettingsCallback, userData ? userData : this);
 }
 
 WayPointDataACK WayPoint::getIndex(uint8_t index, int timeout)
 {
-  api->send(2, encrypt, SET_MISSION, CODE_WAYPOINT_INDEX_READ, &index, sizeof(index), 1000, 4, 0, 0);
+  api->send(2, api->getEncrypt(), SET_MISSION, CODE_WAYPOINT_INDEX_READ, &index, sizeof(index), 1000, 4, 0, 0);
 
   api->serialDevice->lockACK();
   api->serialDevice->wait(timeout);
@@ -205,14 +206,14 @@ WayPointDataACK WayPoint::getIndex(uint8_t index, int timeout)
 
 void WayPoint::getIndex(uint8_t index, CallBack callback, UserData userData)
 {
-  api->send(2, encrypt, SET_MISSION, CODE_WAYPOINT_INDEX_READ, &index, sizeof(index), 1000, 4,
+  api->send(2, api->getEncrypt(), SET_MISSION, CODE_WAYPOINT_INDEX_READ, &index, sizeof(index), 1000, 4,
     callback ? callback : uploadIndexDataCallback, userData ? userData : this);
 }
 
 void WayPoint::updateIdleVelocity(float32_t meterPreSecond, CallBack callback,
                                   UserData userData)
 {
-  api->send(2, encrypt, SET_MISSION, CODE_WAYPOINT_SETVELOCITY, &meterPreSecond,
+  api->send(2, api->getEncrypt(), SET_MISSION, CODE_WAYPOINT_SETVELOCITY, &meterPreSecond,
     sizeof(meterPreSecond), 500, 2, callback ? callback : idleVelocityCallback,
     userData ? userData : this);
 }
@@ -313,3 +314,154 @@ void WayPoint::setIndex(WayPointData *value, size_t pos)
   index[pos] = *value;
   for (int i = 0; i < 8; ++i) index[pos].reserved[i] = 0;
 }
+
+const WayPointData *WayPoint::getIndexData(uint8_t pos) const
+{
+  if (index == 0 || pos >= info.indexNumber)
+    return 0;
+  return &index[pos];
+}
+
+CoreAPI *WayPoint::getApi() const { return api; }
+
+void WayPoint::setApi(CoreAPI *value) { api = value; }
+
+//! @note mean earth radius in meters, good enough for local ENU over a mission
+#define EARTH_RADIUS 6371000.0
+
+static bool pinned(const WayPointData *list, size_t i, size_t count)
+{
+  if (i == 0 || i == count - 1)
+    return true;
+  if (list[i].hasAction || list[i].actionNumber || list[i].damping != 0)
+    return true;
+  return list[i].turnMode != list[i - 1].turnMode || list[i].turnMode != list[i + 1].turnMode;
+}
+
+size_t WayPoint::decimate(WayPointData *list, size_t count, float32_t crossTrack,
+    float32_t altitude, WayPointDecimation *report, float32_t pointUploadMs)
+{
+  if (report)
+    memset(report, 0, sizeof(WayPointDecimation));
+  if (list == 0 || count == 0)
+    return 0;
+
+  double *east = new double[count];
+  double *north = new double[count];
+  bool *keep = new bool[count];
+  size_t *stack = new size_t[2 * count];
+
+  //! @note latitude/longitude are in radians
+  double cosLat = cos(list[0].latitude);
+  size_t pins = 0;
+  for (size_t i = 0; i < count; ++i)
+  {
+    east[i] = (list[i].longitude - list[0].longitude) * cosLat * EARTH_RADIUS;
+    north[i] = (list[i].latitude - list[0].latitude) * EARTH_RADIUS;
+    keep[i] = pinned(list, i, count);
+    if (keep[i] && i != 0 && i != count - 1)
+      pins++;
+  }
+
+  double hTol = crossTrack > 0 ? crossTrack : 0;
+  double vTol = altitude > 0 ? altitude : 0;
+  double maxH = 0, maxV = 0;
+
+  //! @note iterative, recursion depth would be the path length in the worst case
+  size_t top = 0;
+  for (size_t a = 0, b = 1; b < count; ++b)
+    if (keep[b])
+    {
+      stack[top++] = a;
+      stack[top++] = b;
+      a = b;
+    }
+
+  while (top > 0)
+  {
+    size_t b = stack[--top];
+    size_t a = stack[--top];
+    if (b - a < 2)
+      continue;
+
+    double dx = east[b] - east[a];
+    double dy = north[b] - north[a];
+    double len2 = dx * dx + dy * dy;
+    size_t worst = 0;
+    double worstScore = 1.0;
+    double worstH = 0, worstV = 0;
+    for (size_t i = a + 1; i < b; ++i)
+    {
+      double px = east[i] - east[a];
+      double py = north[i] - north[a];
+      double t = len2 > 0 ? (px * dx + py * dy) / len2 : 0;
+      t = t < 0 ? 0 : (t > 1 ? 1 : t);
+      double ex = px - t * dx;
+      double ey = py - t * dy;
+      double h = sqrt(ex * ex + ey * ey);
+      double v = fabs(list[i].altitude - (list[a].altitude + t * (list[b].altitude - list[a].altitude)));
+
+      //! @note normalized error, above 1 the point is out of tolerance
+      double score = 0;
+      if (h > hTol)
+        score = hTol > 0 ? h / hTol : h + 1;
+      if (v > vTol)
+      {
+        double s = vTol > 0 ? v / vTol : v + 1;
+        score = s > score ? s : score;
+      }
+      if (score > worstScore)
+      {
+        worstScore = score;
+        worst = i;
+      }
+      if (h > worstH)
+        worstH = h;
+      if (v > worstV)
+        worstV = v;
+    }
+
+    if (worst)
+    {
+      keep[worst] = true;
+      stack[top++] = a;
+      stack[top++] = worst;
+      stack[top++] = worst;
+      stack[top++] = b;
+    }
+    else
+    {
+      //! @note the whole span is dropped, remember how far it was off
+      if (worstH > maxH)
+        maxH = worstH;
+      if (worstV > maxV)
+        maxV = worstV;
+    }
+  }
+
+  size_t out = 0;
+  for (size_t i = 0; i < count; ++i)
+    if (keep[i])
+    {
+      if (out != i)
+        list[out] = list[i];
+      list[out].index = out;
+      out++;
+    }
+
+  delete[] east;
+  delete[] north;
+  delete[] keep;
+  delete[] stack;
+
+  if (report)
+  {
+    report->inputPoints = count;
+    report->outputPoints = out;
+    report->pinnedPoints = pins;
+    report->maxCrossTrack = maxH;
+    report->maxAltitude = maxV;
+    report->savedUploadMs = (count - out) * pointUploadMs;
+  }
+  return out;
+}
@@ -0,0 +1,601 @@
+/** @file DJI_WayPointUploader.cpp
+ *  @version 3.1.9
+ *  @date November 10, 2016
+ *
+ *  @brief
+ *  Pipelined waypoint upload for DJI onboardSDK library
+ *
+ *  @copyright 2016 DJI. All rights reserved.
+ *
+ */
+
+#include "DJI_WayPointUploader.h"
+
+#ifdef __linux__
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include "DJI_Link.h"
+
+using namespace DJI;
+using namespace DJI::onboardSDK;
+
+//! @note worst case frame of CODE_WAYPOINT_ADDPOINT: header, CRC32 and AES padding
+#define ADDPOINT_FRAME_SIZE (sizeof(Header) + SET_CMD_SIZE + sizeof(WayPointData) + 4 + 16)
+
+WayPointUploader::WayPointUploader(WayPoint *WayPointAPI)
+{
+  wp = WayPointAPI;
+  window = 4;
+  retryTimes = 4;
+  ackTimeout = 1000;
+  readbackEnable = false;
+
+  pthread_mutex_init(&lock, 0);
+  pthread_condattr_t attr;
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&cond, &attr);
+  pthread_condattr_destroy(&attr);
+
+  for (size_t i = 0; i < SESSION_TABLE_NUM; ++i)
+  {
+    slots[i].owner = this;
+    slots[i].state = SLOT_IDLE;
+  }
+  memset(&stats, 0, sizeof(stats));
+  memset(pointRtt, 0, sizeof(pointRtt));
+  memset(accepted, 0, sizeof(accepted));
+  rttSum = 0;
+
+  requestDone = false;
+  requestLen = 0;
+  memset(&syncStats, 0, sizeof(syncStats));
+  invalidate();
+}
+
+WayPointUploader::~WayPointUploader()
+{
+  //! @note sessions still pending hold a pointer to our slots
+  cancel();
+  pthread_cond_destroy(&cond);
+  pthread_mutex_destroy(&lock);
+}
+
+void WayPointUploader::cancel()
+{
+  if (wp && wp->getApi())
+  {
+    //! @note not under lock, the ACK callbacks take it
+    CoreAPI *api = wp->getApi();
+    for (size_t i = 0; i < SESSION_TABLE_NUM; ++i)
+      api->cancelSessions(&slots[i]);
+    api->cancelSessions(this);
+  }
+  pthread_mutex_lock(&lock);
+  for (size_t i = 0; i < SESSION_TABLE_NUM; ++i)
+    slots[i].state = SLOT_IDLE;
+  pthread_mutex_unlock(&lock);
+}
+
+bool WayPointUploader::upload(int timeout)
+{
+  if (!wp)
+    return false;
+  uint8_t indexes[256];
+  uint16_t count = wp->getInfo().indexNumber;
+  for (uint16_t i = 0; i < count; ++i)
+    indexes[i] = i;
+  return upload(indexes, count, timeout);
+}
+
+bool WayPointUploader::upload(const uint8_t *indexes, uint16_t count, int timeout)
+{
+  if (!wp || !wp->getApi())
+    return false;
+
+  for (uint16_t i = 0; i < count; ++i)
+    if (!wp->getIndexData(indexes[i]))
+    {
+      API_LOG(wp->getApi()->getDriver(), ERROR_LOG, "Waypoint %d is not set\n", indexes[i]);
+      return false;
+    }
+
+  pthread_mutex_lock(&lock);
+  memset(&stats, 0, sizeof(stats));
+  memset(pointRtt, 0, sizeof(pointRtt));
+  memset(accepted, 0, sizeof(accepted));
+  rttSum = 0;
+  stats.points = count;
+
+  time_us start = monotonicTimeUs();
+  time_us end = start + (time_us)timeout * 1000;
+  uint16_t next = 0;
+  uint8_t active = window;
+
+  while (stats.uploaded + stats.failed < count)
+  {
+    time_us now = monotonicTimeUs();
+
+    //! @note handle ACKs and timeouts first, they free slots for new points
+    for (uint8_t i = 0; i < active; ++i)
+    {
+      Slot *slot = &slots[i];
+      switch (slot->state)
+      {
+        case SLOT_ADD_ACKED:
+          if (slot->ack != 0)
+            retry(slot);
+          else if (readbackEnable)
+            issue(slot, true);
+          else
+            finish(slot, true);
+          break;
+        case SLOT_READ_ACKED:
+          if (slot->ack == 0 && samePoint(slot->readback, *wp->getIndexData(slot->index)))
+            finish(slot, true);
+          else
+          {
+            stats.mismatches++;
+            retry(slot);
+          }
+          break;
+        case SLOT_WAIT_ADD:
+        case SLOT_WAIT_READ:
+          if (now >= slot->deadline)
+          {
+            if (slot->unsent)
+              issue(slot, slot->state == SLOT_WAIT_READ);
+            else if (slot->state == SLOT_WAIT_READ && slot->attempts < retryTimes)
+            {
+              //! @note the point was accepted, only the readback got lost
+              slot->attempts++;
+              issue(slot, true);
+            }
+            else
+              retry(slot);
+          }
+          break;
+        default:
+          break;
+      }
+    }
+
+    for (uint8_t i = 0; i < active && next < count; ++i)
+      if (slots[i].state == SLOT_IDLE)
+      {
+        slots[i].index = indexes[next++];
+        slots[i].attempts = 0;
+        issue(&slots[i], false);
+      }
+
+    if (stats.uploaded + stats.failed >= count || now >= end)
+      break;
+
+    bool ready = false;
+    time_us wake = end;
+    for (uint8_t i = 0; i < active; ++i)
+    {
+      if (slots[i].state == SLOT_ADD_ACKED || slots[i].state == SLOT_READ_ACKED)
+        ready = true;
+      else if (slots[i].state != SLOT_IDLE && slots[i].deadline < wake)
+        wake = slots[i].deadline;
+    }
+    if (ready)
+      continue;
+
+    struct timespec ts;
+    ts.tv_sec = wake / 1000000;
+    ts.tv_nsec = (wake % 1000000) * 1000;
+    pthread_cond_timedwait(&cond, &lock, &ts);
+  }
+
+  //! @note out of time, whatever is left has failed
+  for (uint8_t i = 0; i < active; ++i)
+    if (slots[i].state != SLOT_IDLE)
+    {
+      slots[i].state = SLOT_IDLE;
+      stats.failed++;
+    }
+  stats.failed += count - next;
+  stats.totalUs = monotonicTimeUs() - start;
+  bool ans = stats.uploaded == count;
+  pthread_mutex_unlock(&lock);
+
+  API_LOG(wp->getApi()->getDriver(), STATUS_LOG,
+      "Uploaded %d/%d waypoints in %llu ms, %u retries\n", stats.uploaded, count,
+      (unsigned long long)(stats.totalUs / 1000), stats.retries);
+  return ans;
+}
+
+bool WayPointUploader::sync(int timeout)
+{
+  if (!wp || !wp->getApi())
+    return false;
+
+  time_us end = monotonicTimeUs() + (time_us)timeout * 1000;
+  WayPointInitData info = wp->getInfo();
+  uint32_t localInit = hashInfo(info);
+  int32_t roundTrips = 0;
+
+  pthread_mutex_lock(&lock);
+  memset(&syncStats, 0, sizeof(syncStats));
+  syncStats.points = info.indexNumber;
+
+  //! @note settings as the flight controller has them now
+  uint8_t zero = 0;
+  bool settingsKnown = false;
+  uint32_t remoteInit = 0;
+  if (request(CODE_WAYPOINT_INFO_READ, &zero, sizeof(zero), end))
+  {
+    WayPointInitACK ack;
+    memset(&ack, 0, sizeof(ack));
+    memcpy(&ack, requestAck, requestLen < sizeof(ack) ? requestLen : sizeof(ack));
+    if (ack.ack == 0 && requestLen >= sizeof(ack))
+    {
+      settingsKnown = true;
+      remoteInit = hashInfo(ack.data);
+    }
+  }
+  roundTrips++;
+
+  //! @note somebody else initialized a different mission, our point cache is stale
+  if (!settingsKnown || !initValid || remoteInit != confirmedInit)
+  {
+    initValid = false;
+    memset(pointValid, 0, sizeof(pointValid));
+  }
+
+  if (!settingsKnown || remoteInit != localInit)
+  {
+    syncStats.fullInit = true;
+    memset(pointValid, 0, sizeof(pointValid));
+    bool ok = request(CODE_WAYPOINT_INIT, &info, sizeof(info), end) && requestLen >= 1 &&
+              requestAck[0] == 0;
+    roundTrips++;
+    if (!ok)
+    {
+      initValid = false;
+      pthread_mutex_unlock(&lock);
+      API_LOG(wp->getApi()->getDriver(), ERROR_LOG, "Waypoint init failed\n");
+      return false;
+    }
+  }
+  initValid = true;
+  confirmedInit = localInit;
+
+  uint8_t dirty[256];
+  uint16_t count = 0;
+  for (uint16_t i = 0; i < info.indexNumber; ++i)
+  {
+    const WayPointData *point = wp->getIndexData(i);
+    if (!point)
+    {
+      pthread_mutex_unlock(&lock);
+      API_LOG(wp->getApi()->getDriver(), ERROR_LOG, "Waypoint %d is not set\n", i);
+      return false;
+    }
+    if (pointValid[i] && confirmedPoint[i] == hash(point, sizeof(WayPointData)))
+      syncStats.skipped++;
+    else
+      dirty[count++] = i;
+  }
+  pthread_mutex_unlock(&lock);
+
+  time_us now = monotonicTimeUs();
+  bool ans = true;
+  if (count > 0)
+    ans = upload(dirty, count, now < end ? (end - now) / 1000 : 0);
+
+  pthread_mutex_lock(&lock);
+  for (uint16_t i = 0; i < count; ++i)
+  {
+    pointValid[dirty[i]] = accepted[dirty[i]];
+    confirmedPoint[dirty[i]] = hash(wp->getIndexData(dirty[i]), sizeof(WayPointData));
+  }
+  if (count > 0)
+  {
+    roundTrips += stats.sends;
+    syncStats.uploaded = stats.uploaded;
+    syncStats.failed = stats.failed;
+  }
+  //! @note baseline: init, one upload per point and one readback per point if enabled
+  int32_t plain = 1 + info.indexNumber * (readbackEnable ? 2 : 1);
+  syncStats.savedRoundTrips = plain - roundTrips;
+  SyncStats result = syncStats;
+  pthread_mutex_unlock(&lock);
+
+  API_LOG(wp->getApi()->getDriver(), STATUS_LOG,
+      "Waypoint sync: %d uploaded, %d unchanged, %s, %d round trips saved\n", result.uploaded,
+      result.skipped, result.fullInit ? "full init" : "settings kept", result.savedRoundTrips);
+  return ans;
+}
+
+void WayPointUploader::invalidate()
+{
+  pthread_mutex_lock(&lock);
+  initValid = false;
+  confirmedInit = 0;
+  memset(pointValid, 0, sizeof(pointValid));
+  memset(confirmedPoint, 0, sizeof(confirmedPoint));
+  pthread_mutex_unlock(&lock);
+}
+
+bool WayPointUploader::request(uint8_t cmd, void *data, size_t len, time_us end)
+{
+  unsigned char buf[SET_CMD_SIZE + sizeof(WayPointInitData)];
+  Command param;
+
+  buf[0] = SET_MISSION;
+  buf[1] = cmd;
+  memcpy(buf + SET_CMD_SIZE, data, len);
+  param.buf = buf;
+  param.length = SET_CMD_SIZE + len;
+  param.sessionMode = 2;
+  param.encrypt = wp->getApi()->getEncrypt();
+  param.retry = retryTimes;
+  param.timeout = ackTimeout;
+  param.handler = requestCallback;
+  param.userData = this;
+
+  requestDone = false;
+  requestLen = 0;
+  while (wp->getApi()->send(&param) < 0)
+  {
+    //! @note no free session yet, sendPoll() frees timed out ones
+    pthread_mutex_unlock(&lock);
+    usleep(POLL_TICK * 1000);
+    pthread_mutex_lock(&lock);
+    if (monotonicTimeUs() >= end)
+      return false;
+  }
+
+  struct timespec ts;
+  ts.tv_sec = end / 1000000;
+  ts.tv_nsec = (end % 1000000) * 1000;
+  while (!requestDone)
+    if (pthread_cond_timedwait(&cond, &lock, &ts) != 0)
+      break;
+  return requestDone;
+}
+
+void WayPointUploader::requestCallback(CoreAPI *api __UNUSED, Header *protocolHeader,
+    UserData uploader)
+{
+  WayPointUploader *up = (WayPointUploader *)uploader;
+  size_t len = protocolHeader->length - EXC_DATA_SIZE;
+
+  pthread_mutex_lock(&up->lock);
+  up->requestLen = len < MAX_ACK_SIZE ? len : MAX_ACK_SIZE;
+  memcpy(up->requestAck, ((unsigned char *)protocolHeader) + sizeof(Header), up->requestLen);
+  up->requestDone = true;
+  pthread_cond_broadcast(&up->cond);
+  pthread_mutex_unlock(&up->lock);
+}
+
+uint32_t WayPointUploader::hash(const void *data, size_t len)
+{
+  //! @note FNV-1a
+  const uint8_t *p = (const uint8_t *)data;
+  uint32_t ans = 2166136261u;
+  for (size_t i = 0; i < len; ++i)
+  {
+    ans ^= p[i];
+    ans *= 16777619u;
+  }
+  return ans;
+}
+
+uint32_t WayPointUploader::hashInfo(const WayPointInitData &info)
+{
+  //! @note only the fields the flight controller keeps, it does not echo the rest
+  WayPointInitData key;
+  memset(&key, 0, sizeof(key));
+  key.indexNumber = info.indexNumber;
+  key.maxVelocity = info.maxVelocity;
+  key.idleVelocity = info.idleVelocity;
+  key.finishAction = info.finishAction;
+  key.executiveTimes = info.executiveTimes;
+  key.yawMode = info.yawMode;
+  key.traceMode = info.traceMode;
+  key.RCLostAction = info.RCLostAction;
+  key.gimbalPitch = info.gimbalPitch;
+  return hash(&key, sizeof(key));
+}
+
+bool WayPointUploader::issue(Slot *slot, bool readback)
+{
+  unsigned char buf[SET_CMD_SIZE + sizeof(WayPointData)];
+  Command param;
+
+  buf[0] = SET_MISSION;
+  if (readback)
+  {
+    buf[1] = CODE_WAYPOINT_INDEX_READ;
+    buf[2] = slot->index;
+    param.length = SET_CMD_SIZE + 1;
+    param.handler = readbackCallback;
+  }
+  else
+  {
+    buf[1] = CODE_WAYPOINT_ADDPOINT;
+    memcpy(buf + SET_CMD_SIZE, wp->getIndexData(slot->index), sizeof(WayPointData));
+    param.length = SET_CMD_SIZE + sizeof(WayPointData);
+    param.handler = addPointCallback;
+  }
+  param.buf = buf;
+  param.sessionMode = 2;
+  param.encrypt = wp->getApi()->getEncrypt();
+  //! @note one send per session, retries are handled here point by point
+  param.retry = 1;
+  param.timeout = ackTimeout;
+  param.userData = slot;
+
+  time_us now = monotonicTimeUs();
+  slot->state = readback ? SLOT_WAIT_READ : SLOT_WAIT_ADD;
+  if (wp->getApi()->send(&param) < 0)
+  {
+    slot->unsent = true;
+    slot->deadline = now + POLL_TICK * 1000;
+    return false;
+  }
+
+  slot->unsent = false;
+  slot->sentAt = now;
+  slot->deadline = now + (time_us)ackTimeout * 1000;
+  stats.sends++;
+  if (readback)
+    stats.readbacks++;
+  else if (slot->attempts++ > 0)
+    stats.retries++;
+  return true;
+}
+
+void WayPointUploader::retry(Slot *slot)
+{
+  if (slot->attempts >= retryTimes)
+    finish(slot, false);
+  else
+    issue(slot, false);
+}
+
+void WayPointUploader::finish(Slot *slot, bool ok)
+{
+  slot->state = SLOT_IDLE;
+  if (!ok)
+  {
+    pointRtt[slot->index] = 0;
+    stats.failed++;
+    API_LOG(wp->getApi()->getDriver(), ERROR_LOG, "Waypoint %d upload failed\n", slot->index);
+    return;
+  }
+
+  time_us rtt = pointRtt[slot->index];
+  accepted[slot->index] = true;
+  if (stats.uploaded == 0 || rtt < stats.minRttUs)
+    stats.minRttUs = rtt;
+  if (stats.uploaded == 0 || rtt > stats.maxRttUs)
+    stats.maxRttUs = rtt;
+  stats.uploaded++;
+  rttSum += rtt;
+  stats.meanRttUs = rttSum / stats.uploaded;
+}
+
+void WayPointUploader::onAck(Slot *slot, Header *protocolHeader, bool readback)
+{
+  unsigned char *payload = ((unsigned char *)protocolHeader) + sizeof(Header);
+  size_t len = protocolHeader->length - EXC_DATA_SIZE;
+  time_us now = monotonicTimeUs();
+
+  pthread_mutex_lock(&lock);
+  if (slot->state != (readback ? SLOT_WAIT_READ : SLOT_WAIT_ADD) || len < 2 ||
+      payload[1] != slot->index)
+  {
+    //! @note late ACK of a slot already reused or given up
+    pthread_mutex_unlock(&lock);
+    return;
+  }
+
+  slot->ack = payload[0];
+  if (readback)
+  {
+    memset(&slot->readback, 0, sizeof(slot->readback));
+    memcpy(&slot->readback, payload + 2,
+        len - 2 < sizeof(WayPointData) ? len - 2 : sizeof(WayPointData));
+    slot->state = SLOT_READ_ACKED;
+  }
+  else
+  {
+    pointRtt[slot->index] = now - slot->sentAt;
+    slot->state = SLOT_ADD_ACKED;
+  }
+  pthread_cond_signal(&cond);
+  pthread_mutex_unlock(&lock);
+}
+
+void WayPointUploader::addPointCallback(CoreAPI *api __UNUSED, Header *protocolHeader,
+    UserData slot)
+{
+  Slot *s = (Slot *)slot;
+  s->owner->onAck(s, protocolHeader, false);
+}
+
+void WayPointUploader::readbackCallback(CoreAPI *api __UNUSED, Header *protocolHeader,
+    UserData slot)
+{
+  Slot *s = (Slot *)slot;
+  s->owner->onAck(s, protocolHeader, true);
+}
+
+bool WayPointUploader::samePoint(const WayPointData &a, const WayPointData &b)
+{
+  //! @note the flight controller stores float32 internally, compare with tolerance
+  if (a.index != b.index || fabs(a.latitude - b.latitude) > 1e-9 ||
+      fabs(a.longitude - b.longitude) > 1e-9 || fabs(a.altitude - b.altitude) > 0.01)
+    return false;
+  if (a.yaw != b.yaw || a.turnMode != b.turnMode || a.hasAction != b.hasAction ||
+      a.actionNumber != b.actionNumber)
+    return false;
+  for (int i = 0; i < a.actionNumber && i < 16; ++i)
+    if (a.commandList[i] != b.commandList[i] || a.commandParameter[i] != b.commandParameter[i])
+      return false;
+  return true;
+}
+
+void WayPointUploader::setWindow(uint8_t value)
+{
+  uint8_t max = getMaxWindow();
+  window = value == 0 ? 1 : (value > max ? max : value);
+}
+
+uint8_t WayPointUploader::getWindow() const { return window; }
+
+uint8_t WayPointUploader::getMaxWindow() const
+{
+  //! @note leave a quarter of the session memory and two auto sessions to other commands
+  size_t byMemory = (MEMORY_SIZE * 3 / 4) / ADDPOINT_FRAME_SIZE;
+  size_t bySession = SESSION_TABLE_NUM - 4;
+  size_t ans = byMemory < bySession ? byMemory : bySession;
+  return ans == 0 ? 1 : ans;
+}
+
+void WayPointUploader::setRetry(uint8_t retry, int timeout)
+{
+  retryTimes = retry == 0 ? 1 : retry;
+  ackTimeout = timeout > POLL_TICK ? timeout : POLL_TICK;
+}
+
+void WayPointUploader::setReadback(bool value) { readbackEnable = value; }
+
+bool WayPointUploader::getReadback() const { return readbackEnable; }
+
+SyncStats WayPointUploader::getSyncStats() const
+{
+  pthread_mutex_lock(&lock);
+  SyncStats ans = syncStats;
+  pthread_mutex_unlock(&lock);
+  return ans;
+}
+
+UploadStats WayPointUploader::getStats() const
+{
+  pthread_mutex_lock(&lock);
+  UploadStats ans = stats;
+  pthread_mutex_unlock(&lock);
+  return ans;
+}
+
+time_us WayPointUploader::getPointRtt(uint8_t index) const
+{
+  pthread_mutex_lock(&lock);
+  time_us ans = pointRtt[index];
+  pthread_mutex_unlock(&lock);
+  return ans;
+}
+
+WayPoint *WayPointUploader::getWayPoint() const { return wp; }
+
+void WayPointUploader::setWayPoint(WayPoint *value) { wp = value; }
+
+#endif // __linux__
@@ -0,0 +1,121 @@
+/** @file bench_script_engine.cpp
+ *  @version 3.1.8
+ *  @date July 29th, 2016
+ *
+ *  @brief
+ *  Script compiler cost on the README demo scripts: compiling on every run,
+ *  as the stream loop tokenised on every run, against script_load() from
+ *  its cache. Also checks a changed SC target is recompiled.
+ *
+ *  @copyright 2016 DJI. All rights reserved.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <chrono>
+#include <fstream>
+#include <string>
+
+#include "script_engine.h"
+
+static const struct
+{
+    const char *name;
+    const char *text;
+}demo_table[] =
+{
+    {"pid", "XP 0.8 0.35 0.3\nXV 0.8 0.35 0.3\nYP 0.8 0.35 0.3\nYV 0.8 0.35 0.3\n"
+            "PZ 0.8 0.35 0.3\n\nVEL 1.0 1.0 1.0\nERR 0.1 0.1 0.1\n"},
+    {"flight", "D 1 1 2\nWAIT_TIME 2\nINC 0 0 1\nWAIT\nD 99 99 -1\nWAIT\n"},
+    {"vision", "T T T T T\nWAIT_TIME 0.5\nD 99 99 -1\n\nT T T T T\nWAIT_TIME 0.5\nD 99 99 -1\n"},
+    {"fail_safe", "FAIL_SAFE HEIGHT_FIX #execute height fix script\n"
+                  "\tT T T T T\n\tWAIT_TIME 0.5\n\tD 99 99 -1\n\n"
+                  "FAIL_SAFE DATE_BACK #back to last state (State Machine)\n"
+                  "\tT T T T T\n\tWAIT_TIME 0.5\n\tD 99 99 -1\n"},
+    {"landing", "D 99 99 0.5\nWAIT\nL\n"},
+    {"mission", "SC pid\nSC flight\nSC vision\nSC landing\n"}
+};
+
+static const int demo_count = sizeof(demo_table) / sizeof(demo_table[0]);
+
+static double now_us()
+{
+    return std::chrono::duration<double, std::micro>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool write_file(const std::string& path, const char *text)
+{
+    std::ofstream fout(path.c_str());
+    fout << text;
+    return fout.good();
+}
+
+int main(int argc, char **argv)
+{
+    int runs = argc > 1 ? atoi(argv[1]) : 20000;
+    char dir[] = "/tmp/bench_script_engine.XXXXXX";
+    if(!mkdtemp(dir))
+    {
+        perror("mkdtemp");
+        return 1;
+    }
+    std::string prefix = std::string(dir) + "/";
+    for(int i = 0; i < demo_count; ++i)
+    {
+        write_file(prefix + demo_table[i].name, demo_table[i].text);
+    }
+
+    bool ok = true;
+    double total_compile = 0, total_cached = 0;
+    printf("%d runs of each README demo script\n", runs);
+    for(int i = 0; i < demo_count; ++i)
+    {
+        std::string path = prefix + demo_table[i].name;
+        script_program prog;
+        prog.prefix = prefix;
+        double start = now_us();
+        for(int j = 0; j < runs; ++j)
+        {
+            ok = script_compile_file(prog, path) && ok;
+        }
+        double compile = (now_us() - start) / runs;
+
+        std::shared_ptr<const script_program> first = script_load(path, prefix);
+        start = now_us();
+        for(int j = 0; j < runs; ++j)
+        {
+            ok = script_load(path, prefix) == first && ok;
+        }
+        double cached = (now_us() - start) / runs;
+
+        size_t count = 0;
+        for(size_t j = 0; j < prog.blocks.size(); ++j)
+        {
+            count += prog.blocks[j].code.size();
+        }
+        printf("%-10s %2lu instructions %2lu files  compile %6.2f us  cached %5.2f us\n",
+               demo_table[i].name, (unsigned long)count, (unsigned long)prog.sources.size(),
+               compile, cached);
+        total_compile += compile;
+        total_cached += cached;
+    }
+    printf("%-37scompile %6.2f us  cached %5.2f us\n", "all six", total_compile, total_cached);
+
+    //a changed SC target makes the caller compile again
+    std::string mission = prefix + "mission";
+    std::shared_ptr<const script_program> before = script_load(mission, prefix);
+    usleep(10000);
+    write_file(prefix + "landing", "D 99 99 0.3\nWAIT\nL\n");
+    std::shared_ptr<const script_program> after = script_load(mission, prefix);
+    bool recompiled = after != before && after->error.empty();
+    printf("changed SC target %s\n", recompiled ? "recompiled" : "NOT recompiled");
+
+    for(int i = 0; i < demo_count; ++i)
+    {
+        unlink((prefix + demo_table[i].name).c_str());
+    }
+    rmdir(dir);
+    return ok && recompiled ? 0 : 1;
+}
@@ -33,6 +33,7 @@
 #include "ctrl_type.h"
 #include "controllerNode.h"
 #include "gpio_set.h"
+#include "script_engine.h"
 
 static bool waitFlag = 0, date_back_flag = 0, interrupted = 1, count_down_flag = 1;
 static bool state_machine_flag = 1;
@@ -46,6 +47,7 @@ dji_sdk_controller::flight_msg car_pose, circle_pose, tape_pose;
 bool car_pose_detected, circle_pose_detected, tape_pose_detected;
 
 bool command_process(int layer, std::istream& input, std::string param);
+bool script_process(int layer, const script_program& prog, int32_t block, std::string param);
 
 void catch_signal(int sign)
 {
@@ -225,21 +227,22 @@ void waitForTime(const float seconds)
 
 bool call_proxy(std::string filename, bool basic=false)
 {
-    bool proxy_callback;
-    std::ifstream fin;
+    std::shared_ptr<const script_program> prog;
 
     if(basic)
     {
-        fin.open(BASIC_SCRIPT_PREFIX + filename);
+        prog = script_load(BASIC_SCRIPT_PREFIX + filename, SCRIPT_PREFIX);
     }
     else
     {
-        fin.open(SCRIPT_PREFIX + filename);
+        prog = script_load(SCRIPT_PREFIX + filename, SCRIPT_PREFIX);
     }
-    proxy_callback = command_process(CALL_PROXY_LAYER, fin, "SILENT");//next param with "MACHINE"
-    fin.close();
-
-    return proxy_callback;
+    if(!prog->error.empty())
+    {
+        std::cout << "[" << filename << "] " << prog->error << std::endl;
+        return false;
+    }
+    return script_process(CALL_PROXY_LAYER, *prog, 0, "SILENT");//next param with "MACHINE"
 }
 
 void state_machine(int state)
@@ -343,308 +346,370 @@ void fail_callback(std::string set_flag)
     }
 }
 
-enum execution_flag command_execute(dji_sdk_controller::flight_msg& msg, std::string cmd, std::istream& input=std::cin)
+typedef enum execution_flag (*command_handler)(dji_sdk_controller::flight_msg& msg, \
+                    const script_program& prog, const script_instruction& ins);
+
+static enum execution_flag set_vector(dji_sdk_controller::flight_msg& msg, const script_instruction& ins, \
+                    int16_t type, dji_sdk_controller::flight_msg *store)
 {
-    boost::algorithm::to_upper(cmd);
-    if(cmd.compare("STATE") == 0){
-        int state;
-        input >> state;
-            state_machine(state);
-            return INPUT_NO_PUB;
+    msg.type = type;
+    msg.data.x = ins.arg[0]; msg.data.y = ins.arg[1]; msg.data.z = ins.arg[2];
+    if(store)
+    {
+        store->data = msg.data;
     }
+    return INPUT_PUB;
+}
+
+static enum execution_flag cmd_unknown(dji_sdk_controller::flight_msg& msg, const script_program& prog, const script_instruction& ins)
+{
+    std::cout<<"["<<boost::algorithm::to_upper_copy(prog.strings[ins.text])<<"] " << "Undeclared Commands." << std::endl << std::endl;
+    //disp_helper();
+    return NO_INPUT_NO_PUB;
+}
+
+static enum execution_flag cmd_state(dji_sdk_controller::flight_msg& msg, const script_program& prog, const script_instruction& ins)
+{
+    state_machine((int)ins.arg[0]);
+    return INPUT_NO_PUB;
+}
+
+static enum execution_flag cmd_land(dji_sdk_controller::flight_msg& msg, const script_program& prog, const script_instruction& ins)
+{
+    msg.type = LANDING;
+    msg.data.x=0; msg.data.y=0; msg.data.z=0;
+    return NO_INPUT_PUB;
+}
+
+static enum execution_flag cmd_grab_motor(dji_sdk_controller::flight_msg& msg, const script_program& prog, const script_instruction& ins)
+{
+    setGPIO(GPIO157, GPIO_LOW);
+    setGPIO(GPIO157, GPIO_HIGH);
+    setGPIO(GPIO157, GPIO_LOW);
+    std::cout << "Grab Motor Called. Next: " << std::endl;
+    return NO_INPUT_NO_PUB;
+}
+
+static enum execution_flag cmd_release_motor(dji_sdk_controller::flight_msg& msg, const script_program& prog, const script_instruction& ins)
+{
+    setGPIO(GPIO158, GPIO_LOW);
+    setGPIO(GPIO158, GPIO_HIGH);
+    setGPIO(GPIO158, GPIO_LOW);
+    std::cout << "Release Motor Called. Next: " << std::endl;
+    return NO_INPUT_NO_PUB;
+}
+
+static enum execution_flag cmd_takeoff(dji_sdk_controller::flight_msg& msg, const script_program& prog, const script_instruction& ins)
+{
+    msg.type = TAKEOFF;
+    msg.data.x=0; msg.data.y=0; msg.data.z=0;
+    return NO_INPUT_PUB;
+}
+
+static enum execution_flag cmd_pid_x_pos(dji_sdk_controller::flight_msg& msg, const script_program& prog, const script_instruction& ins)
+{
+    return set_vector(msg, ins, PID_X_POS, &pid_px);
+}
+
+static enum execution_flag cmd_pid_y_pos(dji_sdk_controller::flight_msg& msg, const script_program& prog, const script_instruction& ins)
+{
+    return set_vector(msg, ins, PID_Y_POS, &pid_py);
+}
+
+static enum execution_flag cmd_pid_x_vel(dji_sdk_controller::flight_msg& msg, const script_program& prog, const script_instruction& ins)
+{
+    return set_vector(msg, ins, PID_X_VEL, &pid_vx);
+}
+
+static enum execution_flag cmd_pid_y_vel(dji_sdk_controller::flight_msg& msg, const script_program& prog, const script_instruction& ins)
+{
+    return set_vector(msg, ins, PID_Y_VEL, &pid_vy);
+}
+
+static enum execution_flag cmd_pid_z(dji_sdk_controller::flight_msg& msg, const script_program& prog, const script_instruction& ins)
+{
+    return set_vector(msg, ins, PID_Z, &pid_z);
+}
+
+static enum execution_flag cmd_vel_lim(dji_sdk_controller::flight_msg& msg, const script_program& prog, const script_instruction& ins)
+{
+    return set_vector(msg, ins, VEL_LIM, &vel_limit);
+}
+
+static enum execution_flag cmd_err_lim(dji_sdk_controller::flight_msg& msg, const script_program& prog, const script_instruction& ins)
+{
+    return set_vector(msg, ins, ERR_LIM, &err_limit);
+}
+
+static enum execution_flag cmd_dest(dji_sdk_controller::flight_msg& msg, const script_program& prog, const script_instruction& ins)
+{
+    return set_vector(msg, ins, DEST, NULL);
+}
+
+static enum execution_flag cmd_dest_inc(dji_sdk_controller::flight_msg& msg, const script_program& prog, const script_instruction& ins)
+{
+    return set_vector(msg, ins, DEST_INC, NULL);
+}
+
+static enum execution_flag cmd_dest_static(dji_sdk_controller::flight_msg& msg, const script_program& prog, const script_instruction& ins)
+{
+    return set_vector(msg, ins, DEST_STATIC, &dest);
+}
 
-    if (cmd.compare("L") == 0||cmd.compare("LAND") == 0||cmd.compare("LANDING") == 0)             //0x09
+static enum execution_flag cmd_circle_detect(dji_sdk_controller::flight_msg& msg, const script_program& prog, const script_instruction& ins)
+{
+    circle_pose_detected = false;
+    waitForTime(0.3);
+    if(circle_pose_detected)
     {
-        msg.type = LANDING;
-        msg.data.x=0; msg.data.y=0; msg.data.z=0;
+        msg.type = DEST_INC;
+        msg.data.x = circle_pose.data.x;    msg.data.y = circle_pose.data.y;    msg.data.z = circle_pose.data.z + 0.5;
+        circle_pose_detected = false;
         return NO_INPUT_PUB;
     }
-    else if (cmd.compare("MG") == 0) // Grab Motor
-    {
-        setGPIO(GPIO157, GPIO_LOW);
-        setGPIO(GPIO157, GPIO_HIGH);
-        setGPIO(GPIO157, GPIO_LOW);
-        std::cout << "Grab Motor Called. Next: " << std::endl;
-        return NO_INPUT_NO_PUB;
-    }
-    else if (cmd.compare("MR") == 0) // Release Motor
+    else
     {
-        setGPIO(GPIO158, GPIO_LOW);
-        setGPIO(GPIO158, GPIO_HIGH);
-        setGPIO(GPIO158, GPIO_LOW);
-        std::cout << "Release Motor Called. Next: " << std::endl;
+        interrupted = 1;
         return NO_INPUT_NO_PUB;
     }
-    else if (cmd.compare("TAKEOFF") == 0)                                                         //0x0A
+}
+
+static enum execution_flag cmd_car_detect(dji_sdk_controller::flight_msg& msg, const script_program& prog, const script_instruction& ins)
+{
+    car_pose_detected = false;
+    waitForTime(0.3);
+    if(car_pose_detected)
     {
-        msg.type = TAKEOFF;
-        msg.data.x=0; msg.data.y=0; msg.data.z=0;
+        msg.type = DEST_INC;
+        msg.data.x = car_pose.data.x;    msg.data.y = car_pose.data.y;    msg.data.z = car_pose.data.z + 0.5;
+        car_pose_detected = false;
         return NO_INPUT_PUB;
     }
-    else if (cmd.compare("XP") == 0)             //0x04
-    {
-        msg.type = PID_X_POS;
-        input >> msg.data.x >> msg.data.y >> msg.data.z;
-        pid_px.data = msg.data;
-        return INPUT_PUB;
-    }
-    else if(cmd.compare("YP") == 0)         //0x05
-    {
-        msg.type = PID_Y_POS;
-        input >> msg.data.x >> msg.data.y >> msg.data.z;
-        pid_py.data = msg.data;
-        return INPUT_PUB;
-    }
-    else if (cmd.compare("XV") == 0)             //0x04
-    {
-        msg.type = PID_X_VEL;
-        input >> msg.data.x >> msg.data.y >> msg.data.z;
-        pid_vx.data = msg.data;
-        return INPUT_PUB;
-    }
-    else if(cmd.compare("YV") == 0)         //0x05
-    {
-        msg.type = PID_Y_VEL;
-        input >> msg.data.x >> msg.data.y >> msg.data.z;
-        pid_vy.data = msg.data;
-        return INPUT_PUB;
-    }
-    else if(cmd.compare("PZ") == 0)         //0x06
-    {
-        msg.type = PID_Z;
-        input >> msg.data.x >> msg.data.y >> msg.data.z;
-        pid_z.data = msg.data;
-        return INPUT_PUB;
-    }
-    else if(cmd.compare("VEL") == 0)        //0x02
+    else
     {
-        input >> msg.data.x >> msg.data.y >> msg.data.z;
-        msg.type = VEL_LIM;
-        vel_limit.data = msg.data;
-        return INPUT_PUB;
+        interrupted = 1;
+        return NO_INPUT_NO_PUB;
     }
-    else if(cmd.compare("ERR") == 0)        //0x03
+}
+
+static enum execution_flag cmd_tape_detect(dji_sdk_controller::flight_msg& msg, const script_program& prog, const script_instruction& ins)
+{
+    return NO_INPUT_NO_PUB;
+}
+
+static enum execution_flag cmd_wait_time(dji_sdk_controller::flight_msg& msg, const script_program& prog, const script_instruction& ins)
+{
+    float seconds = ins.arg[0];
+    std::cout << "Wait for time: " << seconds<<std::endl;
+    waitForTime(seconds);
+    return NO_INPUT_NO_PUB;
+}
+
+static enum execution_flag cmd_wait(dji_sdk_controller::flight_msg& msg, const script_program& prog, const script_instruction& ins)
+{
+    waitUntilReady();
+    return NO_INPUT_NO_PUB;
+}
+
+static enum execution_flag cmd_wait_flag(dji_sdk_controller::flight_msg& msg, const script_program& prog, const script_instruction& ins)
+{
+    waitUntilReady_proxy((int)ins.arg[0]);
+    return INPUT_NO_PUB;
+}
+
+static enum execution_flag cmd_fail_safe(dji_sdk_controller::flight_msg& msg, const script_program& prog, const script_instruction& ins)
+{
+    return FAIL_SAFE;
+}
+
+static enum execution_flag cmd_script(dji_sdk_controller::flight_msg& msg, const script_program& prog, const script_instruction& ins)
+{
+    return SCRIPT;
+}
+
+static enum execution_flag cmd_print(dji_sdk_controller::flight_msg& msg, const script_program& prog, const script_instruction& ins)
+{
+    system("clear");
+    disp_param();   disp_helper();
+    return NO_INPUT_NO_PUB;
+}
+
+static enum execution_flag cmd_clear(dji_sdk_controller::flight_msg& msg, const script_program& prog, const script_instruction& ins)
+{
+    system("clear");    disp_helper();
+    return NO_INPUT_NO_PUB;
+}
+
+static enum execution_flag cmd_exit(dji_sdk_controller::flight_msg& msg, const script_program& prog, const script_instruction& ins)
+{
+    system("clear");
+    std::cout << "bye." << std::endl;
+    exit(-1);
+}
+
+//indexed by script_opcode
+static const command_handler command_table[] =
+{
+    cmd_unknown,
+    cmd_state,
+    cmd_land,               //0x09
+    cmd_grab_motor,
+    cmd_release_motor,
+    cmd_takeoff,            //0x0A
+    cmd_pid_x_pos,          //0x04
+    cmd_pid_y_pos,          //0x06
+    cmd_pid_x_vel,          //0x05
+    cmd_pid_y_vel,          //0x07
+    cmd_pid_z,              //0x08
+    cmd_vel_lim,            //0x02
+    cmd_err_lim,            //0x03
+    cmd_dest,               //0x01
+    cmd_dest_inc,           //0x0B
+    cmd_dest_static,        //0x0C
+    cmd_circle_detect,      //0x0B, CIRCLE_DETECT
+    cmd_car_detect,         //0x0B, CAR_DETECT
+    cmd_tape_detect,        //0x0B, TAPE_DETECT
+    cmd_wait_time,          //INTERNAL
+    cmd_wait,               //INTERNAL
+    cmd_wait_flag,          //INTERNAL
+    cmd_fail_safe,          //INTERNAL
+    cmd_script,             //INTERNAL
+    cmd_print,
+    cmd_clear,
+    cmd_exit
+};
+static_assert(sizeof(command_table) / sizeof(command_table[0]) == OP_COUNT, "command_table out of sync with script_opcode");
+
+enum execution_flag command_execute(dji_sdk_controller::flight_msg& msg, const script_program& prog, const script_instruction& ins)
+{
+    return command_table[ins.op](msg, prog, ins);
+}
+
+int fail_layer_helper(int layer)
+{
+    if(layer < FAIL_SAFE_LAYER)
     {
-        input >> msg.data.x >> msg.data.y >> msg.data.z;
-        msg.type = ERR_LIM;
-        err_limit.data = msg.data;
-        return INPUT_PUB;
+        layer += FAIL_SAFE_LAYER;
     }
-    else if(cmd.compare("D") == 0||cmd.compare("DEST") == 0)                                      //0x01
+    return (++layer);
+}
+
+bool process_finish(int layer, int line_num)
+{
+    if(interrupted)
     {
-        msg.type = DEST;
-        input >> msg.data.x >> msg.data.y >> msg.data.z;
-        return INPUT_PUB;
+        interrupted = 0;
+        std::cout << "[ECHO_"<<layer<<", " <<line_num<< "] INTERRUPTED." << std::endl;
+        return false;
     }
-    else if(cmd.compare("INC") == 0)                                                              //0x0B
+    else
     {
-        msg.type = DEST_INC;
-        input >> msg.data.x >> msg.data.y >> msg.data.z;// text length or cancel auto-fill
-        return INPUT_PUB;
+        std::cout << "[ECHO_"<<layer<<"] FINISHED." << std::endl<<std::endl;
+        return true;
     }
-    else if(cmd.compare("STATIC") == 0)                                                           //0x0C
+}
+
+//false stops the script the instruction belongs to
+bool instruction_process(int layer, const script_program& prog, const script_instruction& ins, \
+                    dji_sdk_controller::flight_msg& msg, const std::string& param)
+{
+    switch(command_execute(msg, prog, ins))
     {
-        msg.type = DEST_STATIC;
-        input >> msg.data.x >> msg.data.y >> msg.data.z;
-        dest.data = msg.data;
-        return INPUT_PUB;
-    }
-    else if(cmd.compare("C") == 0||cmd.compare("C_DETECT") == 0)                                  //0x0B, CIRCLE_DETECT
+    case INPUT_PUB:
+    case NO_INPUT_PUB:
     {
-        circle_pose_detected = false;
-        waitForTime(0.3);
-        if(circle_pose_detected)
+        position_pub->publish(msg);
+        if (param.compare("SILENT") == 0)
         {
-            msg.type = DEST_INC;
-            msg.data.x = circle_pose.data.x;    msg.data.y = circle_pose.data.y;    msg.data.z = circle_pose.data.z + 0.5;
-            circle_pose_detected = false;
-            return NO_INPUT_PUB;
+            std::stringstream tmp;
+            tmp << "[ECHO_"<<layer<<"] ";
+            genVector3Msg(tmp, prog.strings[ins.text], msg.data.x, msg.data.y, msg.data.z);
+            std::cout << tmp.str() << std::endl;
         }
-        else
-        {
-            interrupted = 1;
-            return NO_INPUT_NO_PUB;
+        else{
+            std::cout<<std::endl << "[(" <<msg.type<<"), (" <<msg.data.x<<"," <<msg.data.y<<"," <<msg.data.z <<") ] published."<<std::endl;
+            std::cout << "[Success!]Please Select Another One:             " <<std::endl;
         }
     }
-    else if(cmd.compare("T") == 0||cmd.compare("T_DETECT") == 0)                                  //0x0B, CAR_DETECT
+        break;
+    case INPUT_NO_PUB:
+    case NO_INPUT_NO_PUB:
+        break;
+    case FAIL_SAFE:
     {
-        car_pose_detected = false;
-        waitForTime(0.3);
-        if(car_pose_detected)
-        {
-            msg.type = DEST_INC;
-            msg.data.x = car_pose.data.x;    msg.data.y = car_pose.data.y;    msg.data.z = car_pose.data.z + 0.5;
-            car_pose_detected = false;
-            return NO_INPUT_PUB;
-        }
-        else
+        const std::string& set_flag = prog.strings[ins.name];
+        std::cout << set_flag << std::endl;
+
+        if(!script_process(fail_layer_helper(layer), prog, ins.block, "SILENT"))
         {
-            interrupted = 1;
-            return NO_INPUT_NO_PUB;
+            fail_callback(set_flag);
+#ifdef CHAIN_EFFECT
+            return false;
+#endif
         }
     }
-    else if(cmd.compare("TAPE_DETECT") == 0)                                                      //0x0B, TAPE_DETECT
-    {
-        return NO_INPUT_NO_PUB;
-    }
-    else if(cmd.compare("WAIT_TIME") == 0)                                                        //INTERNAL
-    {
-        float seconds;
-        input >> seconds;
-        std::cout << "Wait for time: " << seconds<<std::endl;
-        waitForTime(seconds);
-        return NO_INPUT_NO_PUB;
-    }
-    else if(cmd.compare("WAIT") == 0||cmd.compare("WAIT_NONE") == 0)                              //INTERNAL
+        break;
+    case SCRIPT:
     {
         waitUntilReady();
-        return NO_INPUT_NO_PUB;
-    }
-    else if(cmd.compare("WAIT_FLAG") == 0)                                                        //INTERNAL
-    {
-        int flag_type;
-        input >> flag_type;
-        waitUntilReady_proxy(flag_type);
-        return INPUT_NO_PUB;
-    }
-    else if(cmd.compare("FAIL_SAFE") == 0)                                                        //INTERNAL
-    {
-        return FAIL_SAFE;
-    }
-    else if(cmd.compare("SC") == 0||cmd.compare("SCRIPT") == 0)                                   //INTERNAL
-    {
-        return SCRIPT;
+        script_process(layer+1, prog, ins.block, prog.blocks[ins.block].param);
     }
-    else if(cmd.compare("P")==0||cmd.compare("PRINT")==0||cmd.compare("DISPLAY")==0)
-    {
-        system("clear");
-        disp_param();   disp_helper();
-        return NO_INPUT_NO_PUB;
-    }
-    else if(cmd.compare("CLEAR")==0||cmd.compare("CLS")==0)
-    {
-        system("clear");    disp_helper();
-        return NO_INPUT_NO_PUB;
-    }
-    else if(cmd.compare("Q")==0||cmd.compare("EXIT")==0)
-    {
-        system("clear");
-        std::cout << "bye." << std::endl;
-        exit(-1);
-    }
-    else{
-        std::cout<<"["<<cmd<<"] " << "Undeclared Commands." << std::endl << std::endl;
-        //disp_helper();
-        return NO_INPUT_NO_PUB;
+        break;
     }
+    return true;
 }
 
-int fail_layer_helper(int layer)
+//run a compiled block, FAIL_SAFE bodies and SC targets are blocks of the same program
+bool script_process(int layer, const script_program& prog, int32_t block, std::string param)
 {
-    if(layer < FAIL_SAFE_LAYER)
+    int line_num = 0;
+    dji_sdk_controller::flight_msg msg;
+    const std::vector<script_instruction>& code = prog.blocks[block].code;
+
+    for(size_t pc = 0; pc < code.size() && !interrupted; ++pc)
     {
-        layer += FAIL_SAFE_LAYER;
+        ros::spinOnce();
+        line_num = code[pc].line_num;
+        if(!instruction_process(layer, prog, code[pc], msg, param))
+        {
+            return false;//aka chain effect
+        }
     }
-    return (++layer);
+    return process_finish(layer, line_num);
 }
 
+//interactive input, compiled and run one command at a time
 bool command_process(int layer, std::istream& input, std::string param="SILENT")
 {
     int line_num = 1;
-    std::string cmd;
+    script_instruction ins;
     dji_sdk_controller::flight_msg msg;
-    enum execution_flag cmd_right;
 
     while(!input.eof()&&!interrupted)//input not meet with endl
     {
         ros::spinOnce();
-        input >> cmd;
-
-        cmd_right = command_execute(msg, cmd, input);
+        script_program prog;
+        prog.prefix = SCRIPT_PREFIX;
 
-        switch(cmd_right)
+        switch(script_compile_next(prog, input, ins, line_num))
         {
-        case INPUT_PUB:
-        case NO_INPUT_PUB:
-        {
-            position_pub->publish(msg);
-            if (param.compare("SILENT") == 0)
+        case SCRIPT_OK:
+            if(!instruction_process(layer, prog, ins, msg, param))
             {
-                std::stringstream tmp;
-                tmp << "[ECHO_"<<layer<<"] ";
-                genVector3Msg(tmp, cmd, msg.data.x, msg.data.y, msg.data.z);
-                std::cout << tmp.str() << std::endl;
-            }
-            else{
-                std::cout<<std::endl << "[(" <<msg.type<<"), (" <<msg.data.x<<"," <<msg.data.y<<"," <<msg.data.z <<") ] published."<<std::endl;
-                std::cout << "[Success!]Please Select Another One:             " <<std::endl;
+                return false;
             }
-        }
             break;
-        case INPUT_NO_PUB:
-        case NO_INPUT_NO_PUB:
+        case SCRIPT_ERROR:
+            std::cout << "[ECHO_"<<layer<<"] " << prog.error << std::endl;
             break;
-        case FAIL_SAFE:
-        {
-            bool callback_status;
-            int peek_ch;
-            std::string tmp, cmd_tmp, set_flag;
-            std::istringstream ss_tmp;
-
-            input >> set_flag;
-            std::cout << set_flag << std::endl;
-
-            std::getline(input, cmd_tmp);
-            peek_ch = input.peek();
-            while(peek_ch != EOF && peek_ch == '\t')
-            {
-                std::getline(input, tmp);
-                cmd_tmp = cmd_tmp.append("\n\t").append(tmp);
-                peek_ch = input.peek();
-            }
-            ss_tmp.str(cmd_tmp);
-
-            callback_status = command_process(fail_layer_helper(layer), ss_tmp);
-            if(!callback_status)
-            {
-                fail_callback(set_flag);
-#ifdef CHAIN_EFFECT
-                return callback_status;//aka 'return false'
-#endif
-            }
-        }
-            break;
-        case SCRIPT:
-        {
-            std::string tmp;
-            input >> tmp;
-
-            std::filebuf fbIn;
-            fbIn.open(SCRIPT_PREFIX + tmp, std::ios::in);
-
-            waitUntilReady();
-            std::istream fin(&fbIn);
-            fin >> tmp;
-            command_process(layer+1, fin, tmp);
-        }
+        case SCRIPT_END:
             break;
         }
     }
-
-    if(interrupted)
-    {
-        interrupted = 0;
-        std::cout << "[ECHO_"<<layer<<", " <<line_num<< "] INTERRUPTED." << std::endl;
-        return false;
-    }
-    else
-    {
-        ++line_num;
-        std::cout << "[ECHO_"<<layer<<"] FINISHED." << std::endl<<std::endl;
-        return true;
-    }
+    return process_finish(layer, line_num);
 }
 
+
 int loadFromFile(std::string file_name = "")
 {
     if(file_name.empty())
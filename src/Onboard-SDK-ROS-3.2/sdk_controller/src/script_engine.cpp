@@ -0,0 +1,381 @@
+/** @file script_engine.cpp
+ *  @version 3.1.8
+ *  @date July 29th, 2016
+ *
+ *  @brief
+ *  Flight script compiler, scripts are parsed once and cached.
+ *
+ *  @copyright 2016 DJI. All rights reserved.
+ *
+ */
+#include <ctype.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <boost/algorithm/string.hpp>
+
+#include "script_engine.h"
+
+enum operand_kind
+{
+    ARG_NONE,
+    ARG_INT,
+    ARG_FLOAT,
+    ARG_VECTOR,
+    ARG_BLOCK,  //FAIL_SAFE <flag> then the rest of the line and the lines indented by a tab
+    ARG_FILE    //SC <file>
+};
+
+static const struct
+{
+    const char *name;
+    enum script_opcode op;
+}command_table[] =
+{
+    {"STATE", OP_STATE},
+    {"L", OP_LAND}, {"LAND", OP_LAND}, {"LANDING", OP_LAND},
+    {"MG", OP_GRAB_MOTOR},
+    {"MR", OP_RELEASE_MOTOR},
+    {"TAKEOFF", OP_TAKEOFF},
+    {"XP", OP_PID_X_POS},
+    {"YP", OP_PID_Y_POS},
+    {"XV", OP_PID_X_VEL},
+    {"YV", OP_PID_Y_VEL},
+    {"PZ", OP_PID_Z},
+    {"VEL", OP_VEL_LIM},
+    {"ERR", OP_ERR_LIM},
+    {"D", OP_DEST}, {"DEST", OP_DEST},
+    {"INC", OP_DEST_INC},
+    {"STATIC", OP_DEST_STATIC},
+    {"C", OP_CIRCLE_DETECT}, {"C_DETECT", OP_CIRCLE_DETECT},
+    {"T", OP_CAR_DETECT}, {"T_DETECT", OP_CAR_DETECT},
+    {"TAPE_DETECT", OP_TAPE_DETECT},
+    {"WAIT_TIME", OP_WAIT_TIME},
+    {"WAIT", OP_WAIT}, {"WAIT_NONE", OP_WAIT},
+    {"WAIT_FLAG", OP_WAIT_FLAG},
+    {"FAIL_SAFE", OP_FAIL_SAFE},
+    {"SC", OP_SCRIPT}, {"SCRIPT", OP_SCRIPT},
+    {"P", OP_PRINT}, {"PRINT", OP_PRINT}, {"DISPLAY", OP_PRINT},
+    {"CLEAR", OP_CLEAR}, {"CLS", OP_CLEAR},
+    {"Q", OP_EXIT}, {"EXIT", OP_EXIT}
+};
+
+//indexed by script_opcode
+static const enum operand_kind operand_table[OP_COUNT] =
+{
+    ARG_NONE,   //OP_UNKNOWN
+    ARG_INT,    //OP_STATE
+    ARG_NONE,   //OP_LAND
+    ARG_NONE,   //OP_GRAB_MOTOR
+    ARG_NONE,   //OP_RELEASE_MOTOR
+    ARG_NONE,   //OP_TAKEOFF
+    ARG_VECTOR, //OP_PID_X_POS
+    ARG_VECTOR, //OP_PID_Y_POS
+    ARG_VECTOR, //OP_PID_X_VEL
+    ARG_VECTOR, //OP_PID_Y_VEL
+    ARG_VECTOR, //OP_PID_Z
+    ARG_VECTOR, //OP_VEL_LIM
+    ARG_VECTOR, //OP_ERR_LIM
+    ARG_VECTOR, //OP_DEST
+    ARG_VECTOR, //OP_DEST_INC
+    ARG_VECTOR, //OP_DEST_STATIC
+    ARG_NONE,   //OP_CIRCLE_DETECT
+    ARG_NONE,   //OP_CAR_DETECT
+    ARG_NONE,   //OP_TAPE_DETECT
+    ARG_FLOAT,  //OP_WAIT_TIME
+    ARG_NONE,   //OP_WAIT
+    ARG_INT,    //OP_WAIT_FLAG
+    ARG_BLOCK,  //OP_FAIL_SAFE
+    ARG_FILE,   //OP_SCRIPT
+    ARG_NONE,   //OP_PRINT
+    ARG_NONE,   //OP_CLEAR
+    ARG_NONE    //OP_EXIT
+};
+
+static bool compile_block(script_program& prog, std::istream& input, int32_t block, int line);
+
+enum script_opcode script_lookup(const std::string& token)
+{
+    static std::map<std::string, enum script_opcode> commands;
+    if(commands.empty())
+    {
+        for(size_t i = 0; i < sizeof(command_table) / sizeof(command_table[0]); ++i)
+        {
+            commands[command_table[i].name] = command_table[i].op;
+        }
+    }
+
+    std::map<std::string, enum script_opcode>::const_iterator it;
+    it = commands.find(boost::algorithm::to_upper_copy(token));
+    return it == commands.end() ? OP_UNKNOWN : it->second;
+}
+
+//skip blanks and '#' comments, false at the end of input
+static bool skip_space(std::istream& input, int& line)
+{
+    int ch;
+    while((ch = input.peek()) != EOF)
+    {
+        if(ch == '#')
+        {
+            input.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+            ++line;
+        }
+        else if(isspace(ch))
+        {
+            if(ch == '\n') ++line;
+            input.get();
+        }
+        else
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static int32_t add_string(script_program& prog, const std::string& str)
+{
+    prog.strings.push_back(str);
+    return prog.strings.size() - 1;
+}
+
+static bool add_source(script_program& prog, const std::string& path)
+{
+    struct stat st;
+    if(stat(path.c_str(), &st) != 0)
+    {
+        return false;
+    }
+    script_source source;
+    source.path = path;
+    source.mtime = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+    source.size = st.st_size;
+    prog.sources.push_back(source);
+    return true;
+}
+
+static bool fail(script_program& prog, int line, const std::string& what)
+{
+    std::stringstream tmp;
+    tmp << "line " << line << ": " << what;
+    prog.error = tmp.str();
+    return false;
+}
+
+static bool read_number(script_program& prog, std::istream& input, int& line,
+                        bool integer, double *value)
+{
+    std::string token;
+    char *end;
+
+    if(!skip_space(input, line) || !(input >> token))
+    {
+        return fail(prog, line, "missing operand");
+    }
+    if(integer)
+    {
+        *value = strtol(token.c_str(), &end, 10);
+    }
+    else
+    {
+        *value = strtod(token.c_str(), &end);
+    }
+    if(end != token.c_str() + token.size())
+    {
+        return fail(prog, line, "bad operand '" + token + "'");
+    }
+    return true;
+}
+
+//SC targets are compiled once per program, a script calling itself refers to
+//the same block
+static bool compile_target(script_program& prog, const std::string& name, int line,
+                           int32_t *block)
+{
+    std::string path = prog.prefix + name;
+    std::map<std::string, int32_t>::const_iterator it = prog.files.find(path);
+    if(it != prog.files.end())
+    {
+        *block = it->second;
+        return true;
+    }
+
+    std::ifstream fin(path.c_str());
+    if(!fin.is_open() || !add_source(prog, path))
+    {
+        return fail(prog, line, "cannot open '" + path + "'");
+    }
+    *block = prog.blocks.size();
+    prog.blocks.push_back(script_block());
+    prog.files[path] = *block;
+
+    //first token of an SC target is its echo mode
+    int target_line = 1;
+    std::string param;
+    if(skip_space(fin, target_line))
+    {
+        fin >> param;
+    }
+    prog.blocks[*block].param = param;
+
+    if(!compile_block(prog, fin, *block, target_line))
+    {
+        prog.error = path + ", " + prog.error;
+        return false;
+    }
+    return true;
+}
+
+enum script_status script_compile_next(script_program& prog, std::istream& input,
+                                       script_instruction& ins, int& line)
+{
+    std::string token;
+
+    if(!skip_space(input, line) || !(input >> token))
+    {
+        return SCRIPT_END;
+    }
+
+    ins.op = script_lookup(token);
+    ins.line_num = line;
+    ins.text = add_string(prog, token);
+    ins.name = -1;
+    ins.block = -1;
+    ins.arg[0] = ins.arg[1] = ins.arg[2] = 0;
+
+    bool ok = true;
+    switch(operand_table[ins.op])
+    {
+    case ARG_NONE:
+        break;
+    case ARG_INT:
+        ok = read_number(prog, input, line, true, &ins.arg[0]);
+        break;
+    case ARG_FLOAT:
+        ok = read_number(prog, input, line, false, &ins.arg[0]);
+        break;
+    case ARG_VECTOR:
+        ok = read_number(prog, input, line, false, &ins.arg[0]) &&
+             read_number(prog, input, line, false, &ins.arg[1]) &&
+             read_number(prog, input, line, false, &ins.arg[2]);
+        break;
+    case ARG_BLOCK:
+    {
+        std::string flag, body, tmp;
+        if(!skip_space(input, line) || !(input >> flag))
+        {
+            ok = fail(prog, line, "missing FAIL_SAFE flag");
+            break;
+        }
+        ins.name = add_string(prog, flag);
+
+        int body_line = line;
+        std::getline(input, body);
+        ++line;
+        while(input.peek() == '\t')
+        {
+            std::getline(input, tmp);
+            body.append("\n").append(tmp);
+            ++line;
+        }
+
+        std::istringstream ss_tmp(body);
+        ins.block = prog.blocks.size();
+        prog.blocks.push_back(script_block());
+        ok = compile_block(prog, ss_tmp, ins.block, body_line);
+    }
+        break;
+    case ARG_FILE:
+    {
+        std::string name;
+        if(!skip_space(input, line) || !(input >> name))
+        {
+            ok = fail(prog, line, "missing script name");
+            break;
+        }
+        ins.name = add_string(prog, name);
+        ok = compile_target(prog, name, line, &ins.block);
+    }
+        break;
+    }
+    return ok ? SCRIPT_OK : SCRIPT_ERROR;
+}
+
+static bool compile_block(script_program& prog, std::istream& input, int32_t block, int line)
+{
+    script_instruction ins;
+    enum script_status status;
+
+    //prog.blocks may grow while compiling, so no reference is held
+    while((status = script_compile_next(prog, input, ins, line)) == SCRIPT_OK)
+    {
+        prog.blocks[block].code.push_back(ins);
+    }
+    return status == SCRIPT_END;
+}
+
+bool script_compile_file(script_program& prog, const std::string& path)
+{
+    prog.blocks.clear();
+    prog.strings.clear();
+    prog.files.clear();
+    prog.sources.clear();
+    prog.error.clear();
+
+    std::ifstream fin(path.c_str());
+    if(!fin.is_open() || !add_source(prog, path))
+    {
+        prog.error = "cannot open '" + path + "'";
+        return false;
+    }
+    prog.blocks.push_back(script_block());
+    if(!compile_block(prog, fin, 0, 1))
+    {
+        prog.error = path + ", " + prog.error;
+        return false;
+    }
+    return true;
+}
+
+static bool script_fresh(const script_program& prog)
+{
+    struct stat st;
+    for(size_t i = 0; i < prog.sources.size(); ++i)
+    {
+        const script_source& source = prog.sources[i];
+        if(stat(source.path.c_str(), &st) != 0 ||
+           (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec != source.mtime ||
+           st.st_size != source.size)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::shared_ptr<const script_program> script_load(const std::string& path,
+                                                  const std::string& prefix)
+{
+    //a program stays alive while it runs even if a nested call recompiles it
+    static std::map<std::string, std::shared_ptr<const script_program> > cache;
+
+    std::map<std::string, std::shared_ptr<const script_program> >::iterator it;
+    it = cache.find(path);
+    if(it != cache.end() && it->second->prefix == prefix && script_fresh(*it->second))
+    {
+        return it->second;
+    }
+
+    std::shared_ptr<script_program> prog(new script_program());
+    prog->prefix = prefix;
+    if(!script_compile_file(*prog, path))
+    {
+        cache.erase(path);
+        return std::shared_ptr<const script_program>(prog);
+    }
+    cache[path] = prog;
+    return prog;
+}
@@ -0,0 +1,102 @@
+
+#ifndef __SCRIPT_ENGINE_H__
+#define __SCRIPT_ENGINE_H__
+
+#include <stdint.h>
+#include <istream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+//Script compiler: a script is tokenised once into instructions with parsed
+//operands, command_process() then only dispatches on the opcode.
+
+enum script_opcode
+{
+    OP_UNKNOWN = 0,
+    OP_STATE,
+    OP_LAND,
+    OP_GRAB_MOTOR,
+    OP_RELEASE_MOTOR,
+    OP_TAKEOFF,
+    OP_PID_X_POS,
+    OP_PID_Y_POS,
+    OP_PID_X_VEL,
+    OP_PID_Y_VEL,
+    OP_PID_Z,
+    OP_VEL_LIM,
+    OP_ERR_LIM,
+    OP_DEST,
+    OP_DEST_INC,
+    OP_DEST_STATIC,
+    OP_CIRCLE_DETECT,
+    OP_CAR_DETECT,
+    OP_TAPE_DETECT,
+    OP_WAIT_TIME,
+    OP_WAIT,
+    OP_WAIT_FLAG,
+    OP_FAIL_SAFE,
+    OP_SCRIPT,
+    OP_PRINT,
+    OP_CLEAR,
+    OP_EXIT,
+    OP_COUNT
+};
+
+enum script_status
+{
+    SCRIPT_OK       =   0x0,
+    SCRIPT_END      =   0x1, //input exhausted, no instruction
+    SCRIPT_ERROR    =   0x2  //see script_program::error
+};
+
+typedef struct
+{
+    uint8_t op;
+    uint16_t line_num;
+    int32_t text;   //token as written, index into script_program::strings
+    int32_t name;   //FAIL_SAFE flag or SC file name, -1 if none
+    int32_t block;  //FAIL_SAFE body or SC target, -1 if none
+    double arg[3];
+}script_instruction;
+
+typedef struct
+{
+    std::string param;  //echo mode, the first token of an SC target
+    std::vector<script_instruction> code;
+}script_block;
+
+typedef struct
+{
+    std::string path;
+    int64_t mtime;
+    int64_t size;
+}script_source;
+
+struct script_program
+{
+    std::string prefix; //directory SC file names are resolved in
+    std::vector<script_block> blocks;   //block 0 is the top level
+    std::vector<std::string> strings;
+    std::map<std::string, int32_t> files;   //SC target path -> block
+    std::vector<script_source> sources; //every file compiled in
+    std::string error;
+};
+
+enum script_opcode script_lookup(const std::string& token);
+
+//compile the next instruction of input, nested FAIL_SAFE bodies and SC
+//targets are added to prog.blocks
+enum script_status script_compile_next(script_program& prog, std::istream& input,
+                                       script_instruction& ins, int& line);
+
+//compile a whole file into block 0
+bool script_compile_file(script_program& prog, const std::string& path);
+
+//compiled file, recompiled when it or a file it calls changed; error is set
+//if it does not compile
+std::shared_ptr<const script_program> script_load(const std::string& path,
+                                                  const std::string& prefix);
+
+#endif